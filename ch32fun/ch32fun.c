@@ -245,7 +245,31 @@ WEAK size_t strlen(const char *s)
 	return s-a;
 }
 WEAK size_t strnlen(const char *s, size_t n) { const char *p = memchr(s, 0, n); return p ? (size_t)(p-s) : n;}
+#if FUNCONF_FAST_MEMFUNCS
+// Word accesses into byte buffers, without upsetting strict aliasing.
+typedef uint32_t __attribute__((may_alias)) funmemword_t;
+
+WEAK void *memset(void *dest, int c, size_t n)
+{
+	unsigned char *s = dest;
+	for (; ((uintptr_t)s & 3) && n; n--) *s++ = c;
+
+	uint32_t w = (unsigned char)c;
+	w |= w << 8;
+	w |= w << 16; // Not * 0x01010101, there's no multiply on rv32ec.
+	funmemword_t *ws = (funmemword_t *)s;
+#if FUNCONF_FAST_MEMFUNCS > 1
+	for (; n >= 16; n -= 16, ws += 4) { ws[0] = w; ws[1] = w; ws[2] = w; ws[3] = w; }
+#endif
+	for (; n >= 4; n -= 4) *ws++ = w;
+
+	s = (unsigned char *)ws;
+	for (; n; n--) *s++ = c;
+	return dest;
+}
+#else
 WEAK void *memset(void *dest, int c, size_t n) { unsigned char *s = dest; for (; n; n--, s++) *s = c; return dest; }
+#endif
 WEAK char *strcpy(char *d, const char *s)
 {
 	char *d0=d;
@@ -449,6 +473,89 @@ WEAK char *strrchr(const char *s, int c)
 	return __memrchr(s, c, strlen(s) + 1);
 }
 
+#if FUNCONF_FAST_MEMFUNCS
+// Only aligned word accesses, the QingKe V2 traps on misaligned ones and the
+// others split them up anyway.
+WEAK void *memcpy(void *dest, const void *src, size_t n)
+{
+	unsigned char *d = dest;
+	const unsigned char *s = src;
+
+	if (!(((uintptr_t)d ^ (uintptr_t)s) & 3)) {
+		for (; ((uintptr_t)d & 3) && n; n--) *d++ = *s++;
+		funmemword_t *wd = (funmemword_t *)d;
+		const funmemword_t *ws = (const funmemword_t *)s;
+#if FUNCONF_FAST_MEMFUNCS > 1
+		for (; n >= 16; n -= 16, wd += 4, ws += 4) {
+			uint32_t a = ws[0], b = ws[1], c = ws[2], e = ws[3];
+			wd[0] = a; wd[1] = b; wd[2] = c; wd[3] = e;
+		}
+#endif
+		for (; n >= 4; n -= 4) *wd++ = *ws++;
+		d = (unsigned char *)wd;
+		s = (const unsigned char *)ws;
+	}
+#if FUNCONF_FAST_MEMFUNCS > 1
+	else if (n >= 8) {
+		// Source and destination disagree on alignment: read whole words
+		// from the source and shift them into place.  The last read may
+		// touch bytes past the end, but never past the end of that word.
+		for (; (uintptr_t)d & 3; n--) *d++ = *s++;
+		unsigned shift = ((uintptr_t)s & 3) * 8;
+		const funmemword_t *ws = (const funmemword_t *)((uintptr_t)s & ~3);
+		funmemword_t *wd = (funmemword_t *)d;
+		uint32_t prev = *ws++;
+		for (; n >= 4; n -= 4) {
+			uint32_t next = *ws++;
+			*wd++ = (prev >> shift) | (next << (32 - shift));
+			prev = next;
+		}
+		d = (unsigned char *)wd;
+		s = (const unsigned char *)ws - 4 + shift / 8;
+	}
+#endif
+	for (; n; n--) *d++ = *s++;
+	return dest;
+}
+
+WEAK int memcmp(const void *vl, const void *vr, size_t n)
+{
+	const unsigned char *l=vl, *r=vr;
+	if (!(((uintptr_t)l ^ (uintptr_t)r) & 3)) {
+		for (; ((uintptr_t)l & 3) && n && *l == *r; n--, l++, r++);
+		if (!((uintptr_t)l & 3))
+			for (; n >= 4 && *(const funmemword_t *)l == *(const funmemword_t *)r; n -= 4, l += 4, r += 4);
+	}
+	// Whatever is left, and finding which byte of a word differed.
+	for (; n && *l == *r; n--, l++, r++);
+	return n ? *l-*r : 0;
+}
+
+WEAK void *memmove(void *dest, const void *src, size_t n)
+{
+	char *d = dest;
+	const char *s = src;
+
+	if (d==s) return d;
+	if ((uintptr_t)s-(uintptr_t)d-n <= -2*n) return memcpy(d, s, n);
+
+	if (d<s) {
+		if (!(((uintptr_t)d ^ (uintptr_t)s) & 3)) {
+			for (; (uintptr_t)d & 3; n--) { if (!n) return dest; *d++ = *s++; }
+			for (; n >= 4; n -= 4, d += 4, s += 4) *(funmemword_t *)d = *(const funmemword_t *)s;
+		}
+		for (; n; n--) *d++ = *s++;
+	} else {
+		if (!(((uintptr_t)d ^ (uintptr_t)s) & 3)) {
+			while ((uintptr_t)(d+n) & 3) { if (!n--) return dest; d[n] = s[n]; }
+			while (n >= 4) n -= 4, *(funmemword_t *)(d+n) = *(const funmemword_t *)(s+n);
+		}
+		while (n) n--, d[n] = s[n];
+	}
+
+	return dest;
+}
+#else
 WEAK void *memcpy(void *dest, const void *src, size_t n)
 {
 	unsigned char *d = dest;
@@ -481,6 +588,7 @@ WEAK void *memmove(void *dest, const void *src, size_t n)
 
 	return dest;
 }
+#endif
 WEAK void *memchr(const void *src, int c, size_t n)
 {
 	const unsigned char *s = src;
@@ -522,42 +630,73 @@ WEAK int puts(const char *s)
 
 #define mini_strlen strlen
 
-int mini_itoa(long value, unsigned int radix, int uppercase, int unsig, char *buffer)
+/* Divides by 10 with shifts and adds, for cores without a divider (rv32ec
+ * would otherwise call __udivsi3 and __umodsi3 for every digit).  From
+ * Hacker's Delight, 10-1. */
+static inline uint32_t mini_divu10(uint32_t n, unsigned int *rem)
 {
-	char	*pbuffer = buffer;
-	int	negative = 0;
-	int	i, len;
-
-	/* No support for unusual radixes. */
-	if (radix > 16)
-		return 0;
-
-	if (value < 0 && !unsig) {
-		negative = 1;
-		value = -value;
+#if defined(__riscv_div)
+	*rem = n % 10;
+	return n / 10;
+#else
+	uint32_t q = (n >> 1) + (n >> 2);
+	q += q >> 4;
+	q += q >> 8;
+	q += q >> 16;
+	q >>= 3;
+	uint32_t r = n - (((q << 2) + q) << 1);
+	if (r > 9) {
+		q++;
+		r -= 10;
 	}
+	*rem = r;
+	return q;
+#endif
+}
 
-	/* This builds the string back to front ... */
+/* Writes value backwards, ending just before end.  Returns where it starts. */
+static char *mini_utoa_rev(uint32_t value, unsigned int radix, int uppercase, char *end)
+{
+	char a = (uppercase ? 'A' : 'a') - 10;
 	do {
-		int digit = value % radix;
-		*(pbuffer++) = (digit < 10 ? '0' + digit : (uppercase ? 'A' : 'a') + digit - 10);
-		value /= radix;
-	} while (value > 0);
+		unsigned int digit;
+		if (radix == 16) {
+			digit = value & 0xf;
+			value >>= 4;
+		} else if (radix == 10) {
+			value = mini_divu10(value, &digit);
+		} else {
+			digit = value % radix;
+			value /= radix;
+		}
+		*(--end) = digit + (digit < 10 ? '0' : a);
+	} while (value);
+	return end;
+}
 
+/* Returns where the number starts in buffer, which it fills up to end. */
+static char *mini_ntoa(long value, unsigned int radix, int uppercase, int unsig, char *end)
+{
+	int negative = (value < 0 && !unsig);
+	char *p = mini_utoa_rev(negative ? -(unsigned long)value : (unsigned long)value, radix, uppercase, end);
 	if (negative)
-		*(pbuffer++) = '-';
+		*(--p) = '-';
+	return p;
+}
 
-	*(pbuffer) = '\0';
+int mini_itoa(long value, unsigned int radix, int uppercase, int unsig, char *buffer)
+{
+	char bf[34]; /* Room for 32 binary digits and a sign. */
+	int len;
 
-	/* ... now we reverse it (could do it recursively but will
-	 * conserve the stack space) */
-	len = (pbuffer - buffer);
-	for (i = 0; i < len / 2; i++) {
-		char j = buffer[i];
-		buffer[i] = buffer[len-i-1];
-		buffer[len-i-1] = j;
-	}
+	/* No support for unusual radixes. */
+	if (radix < 2 || radix > 16)
+		return 0;
 
+	char *p = mini_ntoa(value, radix, uppercase, unsig, bf + sizeof(bf));
+	len = bf + sizeof(bf) - p;
+	memcpy(buffer, p, len);
+	buffer[len] = '\0';
 	return len;
 }
 
@@ -597,17 +736,13 @@ _puts(char *s, int len, void *buf)
 {
 	if(!buf) return len;
 	struct mini_buff *b = buf;
-	char * p0 = b->buffer;
-	int i;
-	/* Copy to buffer */
-	for (i = 0; i < len; i++) {
-		if(b->pbuffer == b->buffer + b->buffer_len - 1) {
-			break;
-		}
-		*(b->pbuffer ++) = s[i];
-	}
+	/* Copy to buffer, as much as fits */
+	unsigned int room = b->buffer_len - 1 - (b->pbuffer - b->buffer);
+	if((unsigned int)len > room) len = room;
+	memcpy(b->pbuffer, s, len);
+	b->pbuffer += len;
 	*(b->pbuffer) = 0;
-	return b->pbuffer - p0;
+	return b->pbuffer - b->buffer;
 }
 
 #ifdef MINI_PRINTF_ENABLE_OBJECTS
@@ -645,7 +780,7 @@ int
 mini_vpprintf(int (*puts)(char* s, int len, void* buf), void* buf, const char *fmt, va_list va)
 {
 	char bf[24];
-	char bf2[24];
+	char bf2[12];
 	char ch;
 #ifdef MINI_PRINTF_ENABLE_OBJECTS
 	void* obj;
@@ -655,17 +790,20 @@ mini_vpprintf(int (*puts)(char* s, int len, void* buf), void* buf, const char *f
 		puts = _puts; buf = (void*)0;
 	}
 	int n = 0;
-	while ((ch=*(fmt++))) {
+	while ((ch=*fmt)) {
 		int len;
 		if (ch!='%') {
-			len = 1;
-			len = puts(&ch, len, buf);
+			/* Hand over everything up to the next % in one go. */
+			const char *run = fmt;
+			while (*(++fmt) && *fmt != '%');
+			len = puts((char*)run, fmt - run, buf);
 		} else {
 			char pad_char = ' ';
 			int pad_to = 0;
 			char l = 0;
 			char *ptr;
 
+			fmt++;
 			ch=*(fmt++);
 
 			/* Zero padding requested */
@@ -687,28 +825,21 @@ mini_vpprintf(int (*puts)(char* s, int len, void* buf), void* buf, const char *f
 					goto end;
 				case 'u':
 				case 'd':
-					if(l) {
-						len = mini_itoa(va_arg(va, unsigned long), 10, 0, (ch=='u'), bf2);
-					} else {
-						if(ch == 'u') {
-							len = mini_itoa((unsigned long) va_arg(va, unsigned int), 10, 0, 1, bf2);
-						} else {
-							len = mini_itoa((long) va_arg(va, int), 10, 0, 0, bf2);
-						}
-					}
-					len = mini_pad(bf2, len, pad_char, pad_to, bf);
-					len = puts(bf, len, buf);
-					break;
-
 				case 'x':
 				case 'X':
-					if(l) {
-						len = mini_itoa(va_arg(va, unsigned long), 16, (ch=='X'), 1, bf2);
+					/* Numbers are built in place, right to left, at the end of bf2. */
+					if(ch == 'd') {
+						ptr = mini_ntoa(l ? va_arg(va, long) : (long) va_arg(va, int), 10, 0, 0, bf2 + sizeof(bf2));
 					} else {
-						len = mini_itoa((unsigned long) va_arg(va, unsigned int), 16, (ch=='X'), 1, bf2);
+						ptr = mini_utoa_rev(l ? va_arg(va, unsigned long) : va_arg(va, unsigned int),
+							(ch == 'u') ? 10 : 16, (ch == 'X'), bf2 + sizeof(bf2));
 					}
-					len = mini_pad(bf2, len, pad_char, pad_to, bf);
-					len = puts(bf, len, buf);
+					len = bf2 + sizeof(bf2) - ptr;
+					if (pad_to > 0) {
+						len = mini_pad(ptr, len, pad_char, pad_to, bf);
+						ptr = bf;
+					}
+					len = puts(ptr, len, buf);
 					break;
 
 				case 'c' :
@@ -880,7 +1011,9 @@ void HardFault_Handler( void )			__attribute__((section(VECTOR_HANDLER_SECTION))
 void Ecall_M_Mode_Handler( void )		__attribute__((section(VECTOR_HANDLER_SECTION))) __attribute((weak,alias("DefaultIRQHandler"))) __attribute__((used));
 void Ecall_U_Mode_Handler( void )		__attribute__((section(VECTOR_HANDLER_SECTION))) __attribute((weak,alias("DefaultIRQHandler"))) __attribute__((used));
 void Break_Point_Handler( void )		__attribute__((section(VECTOR_HANDLER_SECTION))) __attribute((weak,alias("DefaultIRQHandler"))) __attribute__((used));
+#if !FUNCONF_USE_TASKS // Otherwise it's funTaskRun()'s.
 void SysTick_Handler( void )			__attribute__((section(VECTOR_HANDLER_SECTION))) __attribute((weak,alias("DefaultIRQHandler"))) __attribute__((used));
+#endif
 void SW_Handler( void )					__attribute__((section(VECTOR_HANDLER_SECTION))) __attribute((weak,alias("DefaultIRQHandler"))) __attribute__((used));
 void WWDG_IRQHandler( void )			__attribute__((section(VECTOR_HANDLER_SECTION))) __attribute((weak,alias("DefaultIRQHandler"))) __attribute__((used));
 void PVD_IRQHandler( void )				__attribute__((section(VECTOR_HANDLER_SECTION))) __attribute((weak,alias("DefaultIRQHandler"))) __attribute__((used));
@@ -1716,6 +1849,96 @@ static void internal_handle_input( volatile uint32_t * dmdata0 )
 }
 
 
+#if defined( FUNCONF_DEBUGPRINTF_RING ) && FUNCONF_DEBUGPRINTF_RING
+
+#if FUNCONF_DEBUGPRINTF_RING & ( FUNCONF_DEBUGPRINTF_RING - 1 )
+	#error FUNCONF_DEBUGPRINTF_RING must be a power of two
+#endif
+
+// Ring buffer mode: printf output is copied into RAM and the host reads it
+// out in bulk, so writing never waits on the debugger.  The address of the
+// ring lives in DMDATA1, and DMDATA0 status 0x82 tells the host to go look.
+// head/tail are free running byte counters, head is only written here, tail
+// is only written by the host.  If the ring is full, output is dropped and
+// counted in `dropped`.
+struct DebugPrintfRing
+{
+	uint32_t magic;
+	uint32_t size;
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	volatile uint32_t dropped;
+	uint8_t data[FUNCONF_DEBUGPRINTF_RING];
+};
+
+#define DEBUGPRINTF_RING_MAGIC 0x676e6972 // "ring"
+
+static struct DebugPrintfRing debug_printf_ring = { DEBUGPRINTF_RING_MAGIC, FUNCONF_DEBUGPRINTF_RING, 0, 0, 0, { 0 } };
+
+static void internal_advertise_ring( void )
+{
+	*DMDATA1 = (uint32_t)&debug_printf_ring;
+	*DMDATA0 = 0x82;
+}
+
+void poll_input( void )
+{
+	volatile uint32_t * dmdata0 = (volatile uint32_t *)DMDATA0;
+	if( ((*dmdata0) & 0x80) == 0 )
+	{
+		internal_handle_input( dmdata0 );
+		internal_advertise_ring();
+	}
+}
+
+WEAK int _write(int fd, const char *buf, int size)
+{
+	(void)fd;
+	struct DebugPrintfRing * ring = &debug_printf_ring;
+
+	if( size == 0 )
+	{
+		poll_input();
+		return 0;
+	}
+
+	uint8_t irqs = __isenabled_irq();
+	__disable_irq();
+
+	uint32_t head = ring->head;
+	uint32_t space = FUNCONF_DEBUGPRINTF_RING - ( head - ring->tail );
+	int len = size;
+	if( (uint32_t)len > space )
+	{
+		ring->dropped += len - space;
+		len = space;
+	}
+
+	uint32_t place = head & ( FUNCONF_DEBUGPRINTF_RING - 1 );
+	uint32_t first = FUNCONF_DEBUGPRINTF_RING - place;
+	if( first > (uint32_t)len ) first = len;
+	memcpy( ring->data + place, buf, first );
+	memcpy( ring->data, buf + first, len - first );
+	__asm__ volatile( "" : : : "memory" ); // The data has to land before the debugger can see the new head.
+	ring->head = head + len;
+
+	if( irqs ) __enable_irq();
+	return len;
+}
+
+WEAK int putchar(int c)
+{
+	char ch = c;
+	return _write( 0, &ch, 1 );
+}
+
+void SetupDebugPrintf( void )
+{
+	internal_advertise_ring();
+}
+
+#else
+
 void poll_input( void )
 {
 	volatile uint32_t * dmdata0 = (volatile uint32_t *)DMDATA0;
@@ -1825,6 +2048,8 @@ void SetupDebugPrintf( void )
 	*DMDATA0 = 0x80;
 }
 
+#endif // FUNCONF_DEBUGPRINTF_RING
+
 void CallConstructors( void )
 {
 	extern void (*__init_array_start[])(void);
@@ -1941,6 +2166,136 @@ uint64_t funSysTick64( void )
 #endif
 }
 
+#if FUNCONF_USE_TASKS
+
+#if defined( CH5xx ) || defined( CH32H41x ) || defined( CH32V10x )
+#error FUNCONF_USE_TASKS needs a SysTick with SR and a 32-bit CMP, not done for this chip yet.
+#endif
+
+#define FUN_TASK_RUNNING 0xff // Still this while it's running means it only re-checked a FUN_TASK_WAIT_UNTIL.
+
+static struct funTask * fun_tasks;
+static volatile uint32_t fun_task_events;
+static volatile uint8_t fun_task_woken;
+
+void funTaskAdd( struct funTask * t, char (*fn)( struct funTask * t ) )
+{
+	struct funTask ** pt = &fun_tasks;
+	while( *pt ) pt = &(*pt)->next;
+	t->next = 0;
+	t->fn = fn;
+	t->resume = 0;
+	t->wait = FUN_TASK_READY;
+	*pt = t;
+}
+
+void funTaskSignal( uint32_t events )
+{
+	// Only mask MIE, __disable_irq() would clear MPIE out from under an ISR.
+	uint32_t mstatus = __get_MSTATUS();
+	__set_MSTATUS( mstatus & ~0x8 );
+	fun_task_events |= events;
+	fun_task_woken = 1;
+	__set_MSTATUS( mstatus );
+}
+
+int funTaskPoll( void )
+{
+	struct funTask ** pt = &fun_tasks;
+	struct funTask * t;
+	int progress = 0;
+	uint32_t now = funSysTick32();
+
+	fun_task_woken = 0;
+	while( ( t = *pt ) )
+	{
+		if( t->wait == FUN_TASK_TIMED && TimeElapsed32( now, t->wake ) < 0 )
+		{
+			pt = &t->next;
+			continue;
+		}
+		if( t->wait == FUN_TASK_EVENT )
+		{
+			uint32_t mstatus = __get_MSTATUS();
+			__set_MSTATUS( mstatus & ~0x8 );
+			uint32_t got = fun_task_events & t->events;
+			fun_task_events &= ~got;
+			__set_MSTATUS( mstatus );
+			if( !got )
+			{
+				pt = &t->next;
+				continue;
+			}
+			t->events = got;
+		}
+
+		uint8_t was = t->wait;
+		t->wait = FUN_TASK_RUNNING;
+		if( !t->fn( t ) )
+		{
+			*pt = t->next; // Finished.
+			progress = 1;
+			continue;
+		}
+		if( t->wait == FUN_TASK_RUNNING ) t->wait = was;
+		else progress = 1;
+		pt = &t->next;
+	}
+	return progress;
+}
+
+void SysTick_Handler( void ) __attribute__((interrupt)) __attribute__((section(VECTOR_HANDLER_SECTION))) __attribute__((used));
+void SysTick_Handler( void )
+{
+	// Only here to wake funTaskRun().
+	SysTick->CTLR &= ~SYSTICK_CTLR_STIE;
+	SysTick->SR = 0;
+	fun_task_woken = 1;
+}
+
+void funTaskRun( void )
+{
+	NVIC_EnableIRQ( SysTick_IRQn );
+	__enable_irq();
+	while( fun_tasks )
+	{
+		if( funTaskPoll() ) continue;
+
+		// Nothing moved.  Sleep until an interrupt, or until the first timed
+		// wait is up.  With MIE off so nothing can slip in between checking
+		// and sleeping; a pending interrupt still ends the WFI.
+		__set_MSTATUS( __get_MSTATUS() & ~0x8 );
+		int sleep = !fun_task_woken;
+		int timed = 0;
+		int32_t soonest = 0x7fffffff;
+		uint32_t now = funSysTick32();
+		struct funTask * t;
+		for( t = fun_tasks; t; t = t->next )
+		{
+			if( t->wait != FUN_TASK_TIMED ) continue;
+			int32_t left = TimeElapsed32( t->wake, now );
+			if( left < soonest ) soonest = left;
+			timed = 1;
+		}
+		if( sleep && timed )
+		{
+			if( soonest <= 0 ) sleep = 0;
+			else
+			{
+				SysTick->CMP = SysTick->CNT + soonest;
+				SysTick->SR = 0;
+				SysTick->CTLR |= SYSTICK_CTLR_STIE;
+				// If it already went by, the compare won't fire.
+				if( TimeElapsed32( funSysTick32(), now ) >= soonest ) sleep = 0;
+			}
+		}
+		if( sleep ) __WFI();
+		__enable_irq();
+	}
+}
+
+#endif
+
 #if defined(CH32H41x)
 void StartV5F(v5f_main function)
 {
@@ -58,6 +58,9 @@
            printf will fast-path to exit after the first timeout. It will still do the string
            formatting, but will not wait on output. Timeout is configured with
            FUNCONF_DEBUGPRINTF_TIMEOUT.
+           If FUNCONF_DEBUGPRINTF_RING is set, printf instead copies into a RAM ring buffer
+           of that size, and never waits.  minichlink -T pulls it out in bulk.  If the ring
+           fills up, output is dropped.
         d. If you hard fault, it will wait indefinitely for a debugger to attach, once attached,
            will printf the fault cause, and the memory address of the fault. Space can be saved
            by setting FUNCONF_DEBUG_HARDFAULT to 0.
@@ -82,6 +85,7 @@
 #define FUNCONF_TINYVECTOR 0            // If enabled, Does not allow normal interrupts.
 #define FUNCONF_UART_PRINTF_BAUD 115200 // Only used if FUNCONF_USE_UARTPRINTF is set.
 #define FUNCONF_DEBUGPRINTF_TIMEOUT 0x100000 // Arbitrary time units, this is around 200ms.
+#define FUNCONF_DEBUGPRINTF_RING 0      // If nonzero, printf goes into a RAM ring of this many bytes (power of 2) that minichlink reads out in bulk, never blocking.
 #define FUNCONF_ENABLE_HPE 1            // Enable hardware interrupt stack.  Very good on QingKeV4, i.e. x035, v10x, v20x, v30x, but questionable on 003. 
                                         // If you are using that, consider using INTERRUPT_DECORATOR as an attribute to your interrupt handlers.
 #define FUNCONF_USE_5V_VDD 0            // Enable this if you plan to use your part at 5V - affects USB and PD configration on the x035.
@@ -90,6 +94,9 @@
 #define FUNCONF_SUPPORT_CONSTRUCTORS 0	// Call functions with __attribute__((constructor)) in SystemInit()
 #define FUNCONF_ICACHE_EN 1				// Enables ICache on cores that support it, may require power-down + power up to work properly at flash time.
 #define FUNCONF_OVERRIDE_STARTUP 0      // User code will have its own `handle_reset` and `InterruptVector`
+#define FUNCONF_FAST_MEMFUNCS 2         // memcpy/memset/memmove/memcmp: 0 = bytewise (smallest), 1 = by word, 2 = by word, unrolled.  Default 0 on rv32ec, 2 elsewhere.
+#define FUNCONF_CHECK_PRINTF_FORMAT 0   // Have the compiler check mini_snprintf/mini_pprintf arguments against the format, like it does for printf.
+#define FUNCONF_USE_TASKS 0             // Cooperative stackless tasks (funTaskRun) with SysTick waits.  Takes over SysTick_Handler.
 */
 
 // Sanity check for when porting old code.
@@ -148,6 +155,22 @@
 	#define FUNCONF_TINYVECTOR 0
 #endif
 
+#ifndef FUNCONF_FAST_MEMFUNCS
+	#if defined( __riscv_32e ) || defined( __riscv_e )
+		#define FUNCONF_FAST_MEMFUNCS 0 // Every byte counts on the V003 and friends.
+	#else
+		#define FUNCONF_FAST_MEMFUNCS 2
+	#endif
+#endif
+
+#ifndef FUNCONF_USE_TASKS
+	#define FUNCONF_USE_TASKS 0
+#endif
+
+#ifndef FUNCONF_CHECK_PRINTF_FORMAT
+	#define FUNCONF_CHECK_PRINTF_FORMAT 0 // Off, since %O and %R (MINI_PRINTF_ENABLE_OBJECTS) would warn.
+#endif
+
 #if FUNCONF_ENABLE_HPE == 1
 	#define INTERRUPT_DECORATOR  __attribute__((interrupt("WCH-Interrupt-fast")))
 #else
@@ -1124,12 +1147,110 @@ void CallConstructors( void );
 // Functions from ch32fun.c
 #include <stdarg.h>
 
+#if FUNCONF_CHECK_PRINTF_FORMAT
+	#define MINI_PRINTF_FORMAT( fmt, args ) __attribute__((format(printf, fmt, args)))
+#else
+	#define MINI_PRINTF_FORMAT( fmt, args )
+#endif
+
 int mini_vsnprintf( char *buffer, unsigned int buffer_len, const char *fmt, va_list va );
 int mini_vpprintf( int (*puts)(char* s, int len, void* buf), void* buf, const char *fmt, va_list va );
-int mini_snprintf(char* buffer, unsigned int buffer_len, const char *fmt, ...);
-int mini_pprintf(int (*puts)(char*s, int len, void* buf), void* buf, const char *fmt, ...);
+int mini_snprintf(char* buffer, unsigned int buffer_len, const char *fmt, ...) MINI_PRINTF_FORMAT( 3, 4 );
+int mini_pprintf(int (*puts)(char*s, int len, void* buf), void* buf, const char *fmt, ...) MINI_PRINTF_FORMAT( 3, 4 );
 int mini_itoa(long value, unsigned int radix, int uppercase, int unsig,	char *buffer);
 
+#if FUNCONF_USE_TASKS
+/* Cooperative tasks, protothread style.  A task is a function that gets
+   called over and over by funTaskRun(), and picks up where it left off each
+   time.  It has no stack of its own, so locals are gone after any wait; keep
+   anything that matters in a struct with the funTask as its first member.
+   Only one wait per source line, and no switch() around the waits.
+
+	char Blinker( struct funTask * t )
+	{
+		FUN_TASK_BEGIN( t );
+		while( 1 )
+		{
+			funDigitalWrite( PC0, FUN_HIGH );
+			FUN_TASK_DELAY( Ticks_from_Ms( 100 ) );
+			funDigitalWrite( PC0, FUN_LOW );
+			FUN_TASK_WAIT_EVENT( BUTTON_EVENT );   // From an ISR: funTaskSignal( BUTTON_EVENT );
+		}
+		FUN_TASK_END();
+	}
+
+	funTaskAdd( &blinker, Blinker );
+	funTaskRun();
+
+   When no task can run, funTaskRun() sleeps in WFI until an interrupt or the
+   next timed wait, using the SysTick compare interrupt (it turns interrupts
+   on, and SysTick_Handler is its own).  A FUN_TASK_WAIT_UNTIL() is only
+   re-checked when something wakes it, see the warning there.
+*/
+
+struct funTask
+{
+	struct funTask * next;
+	char (*fn)( struct funTask * t );
+	void * resume;   // Where fn picks back up, 0 to start from the top.
+	uint32_t wake;   // funSysTick32() of the end of the last timed wait.
+	uint32_t events; // What it's waiting for, then which of those came in.
+	uint8_t wait;    // FUN_TASK_* below.
+};
+
+#define FUN_TASK_READY   0
+#define FUN_TASK_POLL    1
+#define FUN_TASK_TIMED   2
+#define FUN_TASK_EVENT   3
+
+#define FUN_TASK_LABEL_( line ) _fun_task_##line
+#define FUN_TASK_LABEL( line ) FUN_TASK_LABEL_( line )
+
+#define FUN_TASK_BEGIN( t ) struct funTask * _ft = (t); if( _ft->resume ) goto *_ft->resume
+#define FUN_TASK_END() do { _ft->resume = 0; return 0; } while( 0 )
+
+// Return to the scheduler, coming back here next time around.
+#define FUN_TASK_SUSPEND( waitfor ) do { \
+	_ft->resume = &&FUN_TASK_LABEL( __LINE__ ); _ft->wait = (waitfor); return 1; \
+	FUN_TASK_LABEL( __LINE__ ):; } while( 0 )
+
+#define FUN_TASK_YIELD() FUN_TASK_SUSPEND( FUN_TASK_READY )
+// Coming back to re-check leaves wait alone, so funTaskPoll() can tell nothing happened.
+//
+// WARNING: A waiting FUN_TASK_WAIT_UNTIL() doesn't keep funTaskRun() awake.
+// If cond only changes in hardware (a peripheral flag) or in an ISR, and no
+// other task is running or in a timed wait, funTaskRun() goes into WFI and
+// may never come back to look at it.  Whatever makes cond true has to wake
+// the scheduler, so enable that peripheral's interrupt and signal from it:
+//
+//	void USART1_IRQHandler( void ) __attribute__((interrupt));
+//	void USART1_IRQHandler( void )
+//	{
+//		USART1->CTLR1 &= ~USART_CTLR1_RXNEIE; // The task reads DATAR.
+//		funTaskSignal( 0 );
+//	}
+//	...
+//		USART1->CTLR1 |= USART_CTLR1_RXNEIE;
+//		FUN_TASK_WAIT_UNTIL( USART1->STATR & USART_STATR_RXNE );
+//
+// Or wait with a FUN_TASK_DELAY() in a loop to poll it.  Conditions that other
+// tasks change are fine as is, the task that changed it counts as progress.
+#define FUN_TASK_WAIT_UNTIL( cond ) do { \
+	_ft->resume = &&FUN_TASK_LABEL( __LINE__ ); _ft->wait = FUN_TASK_POLL; \
+	FUN_TASK_LABEL( __LINE__ ): if( !( cond ) ) return 1; } while( 0 )
+#define FUN_TASK_SLEEP_UNTIL( time ) do { _ft->wake = (time); FUN_TASK_SUSPEND( FUN_TASK_TIMED ); } while( 0 )
+#define FUN_TASK_DELAY( ticks ) FUN_TASK_SLEEP_UNTIL( funSysTick32() + (ticks) )
+// Waits for any of these bits from funTaskSignal(), clears them and leaves them in t->events.
+#define FUN_TASK_WAIT_EVENT( mask ) do { _ft->events = (mask); FUN_TASK_SUSPEND( FUN_TASK_EVENT ); } while( 0 )
+
+// FUN_TASK_SLEEP_UNTIL( t->wake + period ) runs every period without drifting.
+
+void funTaskAdd( struct funTask * t, char (*fn)( struct funTask * t ) );
+void funTaskSignal( uint32_t events ); // OK from ISRs.
+int funTaskPoll( void );  // Runs everything that's ready once.  Returns nonzero if anything got anywhere.
+void funTaskRun( void );  // Never returns, sleeps when there's nothing to do.
+#endif
+
 #endif // __ASSEMBLER__
 
 
@@ -0,0 +1,145 @@
+/* Cooperative tasks with FUNCONF_USE_TASKS.
+
+   Blinks PC0 from one task, and measures what switching costs with a few
+   others:
+     yield  Two tasks that do nothing but FUN_TASK_YIELD() at each other,
+            which includes stepping over the ones that are waiting.
+     event  One task funTaskSignal()s, the other is waiting in
+            FUN_TASK_WAIT_EVENT(), time from signal to it running.
+     timed  How late a FUN_TASK_SLEEP_UNTIL() wakes up out of WFI.
+
+   Everything is in core clocks (FUNCONF_SYSTICK_USE_HCLK).  To see what the
+   scheduler costs in flash, build once with FUNCONF_USE_TASKS 0 and the
+   tasks #if'd out, and compare the sizes make prints. */
+
+#include "ch32fun.h"
+#include <stdio.h>
+
+#define YIELDS 1000
+#define EVENTS 100
+#define WAKES 20
+
+#define EVENT_PING 1
+
+static struct funTask blinker, yield_a, yield_b, pinger, ponger, sleeper, reporter;
+
+static volatile int yields_left;
+static uint32_t yield_cycles;
+
+static uint32_t ping_time;
+static uint32_t event_total;
+static int events_seen;
+
+static uint32_t wake_late_total;
+static uint32_t wake_late_worst;
+static int wakes_seen;
+
+static char Blinker( struct funTask * t )
+{
+	FUN_TASK_BEGIN( t );
+	t->wake = funSysTick32();
+	while( 1 )
+	{
+		funDigitalWrite( PC0, FUN_HIGH );
+		FUN_TASK_SLEEP_UNTIL( t->wake + Ticks_from_Ms( 50 ) );
+		funDigitalWrite( PC0, FUN_LOW );
+		FUN_TASK_SLEEP_UNTIL( t->wake + Ticks_from_Ms( 450 ) );
+	}
+	FUN_TASK_END();
+}
+
+static char YieldA( struct funTask * t )
+{
+	static uint32_t start;
+	FUN_TASK_BEGIN( t );
+	start = funSysTick32();
+	while( yields_left > 0 )
+	{
+		yields_left--;
+		FUN_TASK_YIELD();
+	}
+	yield_cycles = funSysTick32() - start;
+	FUN_TASK_END();
+}
+
+static char YieldB( struct funTask * t )
+{
+	FUN_TASK_BEGIN( t );
+	while( yields_left > 0 )
+	{
+		yields_left--;
+		FUN_TASK_YIELD();
+	}
+	FUN_TASK_END();
+}
+
+static char Pinger( struct funTask * t )
+{
+	static int i;
+	FUN_TASK_BEGIN( t );
+	FUN_TASK_WAIT_UNTIL( yield_cycles );
+	for( i = 0; i < EVENTS; i++ )
+	{
+		ping_time = funSysTick32();
+		funTaskSignal( EVENT_PING );
+		FUN_TASK_DELAY( Ticks_from_Ms( 1 ) );
+	}
+	FUN_TASK_END();
+}
+
+static char Ponger( struct funTask * t )
+{
+	FUN_TASK_BEGIN( t );
+	while( events_seen < EVENTS )
+	{
+		FUN_TASK_WAIT_EVENT( EVENT_PING );
+		event_total += funSysTick32() - ping_time;
+		events_seen++;
+	}
+	FUN_TASK_END();
+}
+
+static char Sleeper( struct funTask * t )
+{
+	FUN_TASK_BEGIN( t );
+	FUN_TASK_WAIT_UNTIL( events_seen == EVENTS );
+	t->wake = funSysTick32();
+	while( wakes_seen < WAKES )
+	{
+		FUN_TASK_SLEEP_UNTIL( t->wake + Ticks_from_Ms( 7 ) );
+		uint32_t late = funSysTick32() - t->wake;
+		wake_late_total += late;
+		if( late > wake_late_worst ) wake_late_worst = late;
+		wakes_seen++;
+	}
+	FUN_TASK_END();
+}
+
+static char Reporter( struct funTask * t )
+{
+	FUN_TASK_BEGIN( t );
+	FUN_TASK_WAIT_UNTIL( wakes_seen == WAKES );
+	printf( "yield  %lu cycles per switch\n", yield_cycles / YIELDS );
+	printf( "event  %lu cycles from signal to running\n", event_total / EVENTS );
+	printf( "timed  %lu cycles late on average, %lu worst\n", wake_late_total / WAKES, wake_late_worst );
+	FUN_TASK_END();
+}
+
+int main()
+{
+	SystemInit();
+	Delay_Ms( 100 );
+
+	funGpioInitAll();
+	funPinMode( PC0, GPIO_Speed_10MHz | GPIO_CNF_OUT_PP );
+
+	yields_left = YIELDS;
+	funTaskAdd( &blinker, Blinker );
+	funTaskAdd( &yield_a, YieldA );
+	funTaskAdd( &yield_b, YieldB );
+	funTaskAdd( &pinger, Pinger );
+	funTaskAdd( &ponger, Ponger );
+	funTaskAdd( &sleeper, Sleeper );
+	funTaskAdd( &reporter, Reporter );
+	funTaskRun();
+}
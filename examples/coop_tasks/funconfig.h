@@ -0,0 +1,11 @@
+#ifndef _FUNCONFIG_H
+#define _FUNCONFIG_H
+
+// Place configuration items here, you can see a full list in ch32fun/ch32fun.h
+// To reconfigure to a different processor, update TARGET_MCU in the  Makefile
+
+#define FUNCONF_SYSTICK_USE_HCLK 1      // So SysTick counts core clocks.
+#define FUNCONF_USE_TASKS 1
+
+#endif
+
@@ -0,0 +1,52 @@
+/* Debug printf through a RAM ring buffer.
+
+   With FUNCONF_DEBUGPRINTF_RING set, printf never waits for the debugger, it
+   just copies into RAM and minichlink -T pulls it out in bulk while this keeps
+   running.  This prints as fast as it can, and shows how many cycles the
+   write itself takes, so you can compare it against regular debug printf
+   (comment out FUNCONF_DEBUGPRINTF_RING in funconfig.h).
+
+   minichlink reports how fast it's pulling data out whenever the output
+   pauses.  If the ring overflows, output is dropped (and reported) instead of
+   stalling. */
+
+#include "ch32fun.h"
+#include <stdio.h>
+
+uint32_t count;
+
+void handle_debug_input( int numbytes, uint8_t * data )
+{
+	printf( "Got %d bytes: %c\n", numbytes, data[0] );
+}
+
+int main()
+{
+	SystemInit();
+
+	static const char line[] = "0123456789abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ\n";
+
+	while(1)
+	{
+		// Time just the transport, no formatting.
+		uint32_t start = SysTick->CNT;
+		_write( 0, line, sizeof( line ) - 1 );
+		uint32_t cycles_write = SysTick->CNT - start;
+
+		// And a whole printf.
+		start = SysTick->CNT;
+		printf( "%lu\n", count );
+		uint32_t cycles_printf = SysTick->CNT - start;
+
+		if( ( count & 0xff ) == 0 )
+		{
+			Delay_Ms( 100 ); // Let the host catch up, so this line doesn't get dropped.
+			printf( "_write of %d bytes: %lu cycles, short printf: %lu cycles\n",
+				(int)sizeof( line ) - 1, cycles_write, cycles_printf );
+			Delay_Ms( 2000 );
+		}
+		count++;
+
+		poll_input();
+	}
+}
@@ -0,0 +1,12 @@
+#ifndef _FUNCONFIG_H
+#define _FUNCONFIG_H
+
+// Place configuration items here, you can see a full list in ch32fun/ch32fun.h
+// To reconfigure to a different processor, update TARGET_MCU in the  Makefile
+
+#define FUNCONF_USE_DEBUGPRINTF 1
+#define FUNCONF_DEBUGPRINTF_RING 512    // printf copies into a 512 byte RAM ring, minichlink -T reads it out.
+#define FUNCONF_SYSTICK_USE_HCLK 1      // So SysTick counts core clocks.
+
+#endif
+
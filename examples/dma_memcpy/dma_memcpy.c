@@ -0,0 +1,95 @@
+/* Finds where DMA starts beating the CPU at memcpy/memset, for picking
+   FUNDMA_MIN_BYTES in extralibs/fundma.h.
+
+   For each size, in core clocks:
+     cpu    memcpy() (or memset()) doing it all.
+     start  How long funDmaMemcpy() keeps the CPU before returning.
+     done   From the call until the callback has run.
+     spare  Out of "done", how much the CPU got to spend on other things.
+
+   Once "done" is close to "cpu", using the DMA is a win, since almost all
+   of it is "spare".  Copies are word aligned, the DMA gets slower the less
+   aligned source and destination are with each other. */
+
+#include "ch32fun.h"
+#include <stdio.h>
+#include <string.h>
+
+#define FUNDMA_IMPLEMENTATION
+#define FUNDMA_MIN_BYTES 0  // We want to time the DMA even where it's not worth it.
+#define FUNDMA_USE_IRQ 1
+#include "fundma.h"
+
+#if defined( CH32V003 ) || defined( CH32V00x ) || defined( CH641 )
+#define BENCH_MAX 512 // Only 2 kB of RAM.
+#else
+#define BENCH_MAX 4096
+#endif
+
+static const uint16_t sizes[] = { 16, 32, 48, 64, 96, 128, 256, 512, 1024, 2048, 4096 };
+
+static uint32_t bufa[BENCH_MAX / 4];
+static uint32_t bufb[BENCH_MAX / 4];
+
+static volatile int completed;
+static volatile uint32_t completed_at;
+
+static void Done( void * opaque )
+{
+	completed_at = SysTick->CNT;
+	completed++;
+}
+
+// What the control loop gets done while it waits.
+static volatile uint32_t spare_work;
+
+static void Bench( const char * name, size_t n, int is_set )
+{
+	uint32_t start, cpu, issue, done, spare;
+
+	start = SysTick->CNT;
+	if( is_set ) memset( bufb, 0xaa, n );
+	else memcpy( bufb, bufa, n );
+	cpu = (uint32_t)SysTick->CNT - start;
+
+	completed = 0;
+	start = SysTick->CNT;
+	int h = is_set ? funDmaMemset( bufb, 0x55, n, Done, 0 ) : funDmaMemcpy( bufb, bufa, n, Done, 0 );
+	issue = (uint32_t)SysTick->CNT - start;
+
+	// Count how many times around a loop we make, then see what that loop costs.
+	uint32_t loops = 0;
+	while( !completed ) { spare_work++; loops++; }
+	done = completed_at - start;
+
+	start = SysTick->CNT;
+	while( loops-- ) spare_work++;
+	spare = (uint32_t)SysTick->CNT - start;
+
+	funDmaWait( h );
+	printf( "%5d %7s %6lu %6lu %6lu %6lu\n", (int)n, name, cpu, issue, done, spare );
+}
+
+int main()
+{
+	SystemInit();
+	funDmaInit();
+	__enable_irq();
+	Delay_Ms( 100 );
+
+	unsigned i;
+	for( i = 0; i < sizeof( bufa ) / 4; i++ ) bufa[i] = i * 0x9e3779b9;
+
+	printf( "bytes    what    cpu  start   done  spare\n" );
+	for( i = 0; i < sizeof( sizes ) / sizeof( sizes[0] ); i++ )
+	{
+		if( sizes[i] > BENCH_MAX ) break;
+		Bench( "memcpy", sizes[i], 0 );
+		if( memcmp( bufa, bufb, sizes[i] ) ) printf( "MISMATCH\n" );
+		Bench( "memset", sizes[i], 1 );
+		for( size_t j = 0; j < sizes[i]; j++ )
+			if( ((uint8_t *)bufb)[j] != 0x55 ) { printf( "MISMATCH\n" ); break; }
+	}
+
+	while( 1 );
+}
@@ -0,0 +1,132 @@
+/* Cycle counts for memcpy, memset, memmove and memcmp.
+
+   Each column is "bytewise / ch32fun", where bytewise is what ch32fun used to
+   do (and still does with FUNCONF_FAST_MEMFUNCS 0) and ch32fun is whatever
+   FUNCONF_FAST_MEMFUNCS in funconfig.h picks.  memcpy is timed with both
+   buffers word aligned, then with the source one byte off, which is the
+   slow path.  memmove overlaps, memcmp compares equal buffers (the worst
+   case).  Every number is the best of a few runs, less the cost of reading
+   SysTick.
+
+   Build with different TARGET_MCU's and FUNCONF_FAST_MEMFUNCS settings to
+   compare, and check the .map for what each costs in flash. */
+
+#include "ch32fun.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined( CH32V003 ) || defined( CH32V00x ) || defined( CH641 )
+#define BENCH_MAX 512 // Only 2 kB of RAM.
+#else
+#define BENCH_MAX 4096
+#endif
+
+static const uint16_t sizes[] = { 1, 2, 3, 4, 7, 8, 16, 31, 32, 64, 127, 128, 256, 512, 1024, 2048, 4096 };
+
+static uint32_t bufa[BENCH_MAX / 4 + 2];
+static uint32_t bufb[BENCH_MAX / 4 + 2];
+
+// What ch32fun.c had before, kept out of line so they're really called.
+__attribute__((noinline)) static void * bytewise_memcpy( void * dest, const void * src, size_t n )
+{
+	unsigned char * d = dest;
+	const unsigned char * s = src;
+	for( ; n; n-- ) *d++ = *s++;
+	return dest;
+}
+
+__attribute__((noinline)) static void * bytewise_memset( void * dest, int c, size_t n )
+{
+	unsigned char * s = dest;
+	for( ; n; n--, s++ ) *s = c;
+	return dest;
+}
+
+__attribute__((noinline)) static void * bytewise_memmove( void * dest, const void * src, size_t n )
+{
+	char * d = dest;
+	const char * s = src;
+	if( d < s ) for( ; n; n-- ) *d++ = *s++;
+	else while( n ) n--, d[n] = s[n];
+	return dest;
+}
+
+__attribute__((noinline)) static int bytewise_memcmp( const void * vl, const void * vr, size_t n )
+{
+	const unsigned char * l = vl, * r = vr;
+	for( ; n && *l == *r; n--, l++, r++ );
+	return n ? *l - *r : 0;
+}
+
+// Called through these, so the compiler can't inline or fold anything.
+static void * (* volatile copy_fn[2])( void *, const void *, size_t ) = { bytewise_memcpy, memcpy };
+static void * (* volatile set_fn[2])( void *, int, size_t ) = { bytewise_memset, memset };
+static void * (* volatile move_fn[2])( void *, const void *, size_t ) = { bytewise_memmove, memmove };
+static int (* volatile cmp_fn[2])( const void *, const void *, size_t ) = { bytewise_memcmp, memcmp };
+
+static uint32_t overhead;
+volatile int sink;
+
+#define RUNS 3
+#define TIMEIT( result, expr ) do { \
+	int _r; result = 0xffffffff; \
+	for( _r = 0; _r < RUNS; _r++ ) { \
+		uint32_t _start = SysTick->CNT; \
+		expr; \
+		uint32_t _t = (uint32_t)SysTick->CNT - _start; \
+		if( _t < result ) result = _t; \
+	} \
+	result = ( result > overhead ) ? result - overhead : 0; \
+} while( 0 )
+
+int main()
+{
+	SystemInit();
+	Delay_Ms( 100 );
+
+	overhead = 0;
+	TIMEIT( overhead, );
+
+	uint8_t * a = (uint8_t *)bufa;
+	uint8_t * b = (uint8_t *)bufb;
+	unsigned i;
+	for( i = 0; i < sizeof( bufa ); i++ ) a[i] = i * 7;
+
+	printf( "FUNCONF_FAST_MEMFUNCS %d, cycles as bytewise/ch32fun\n", FUNCONF_FAST_MEMFUNCS );
+	printf( "bytes %11s %11s %11s %11s %11s\n", "memcpy", "memcpy+1", "memset", "memmove", "memcmp" );
+	for( i = 0; i < sizeof( sizes ) / sizeof( sizes[0] ); i++ )
+	{
+		size_t n = sizes[i];
+		uint32_t c[5][2];
+		int v;
+		if( n > BENCH_MAX ) break;
+
+		for( v = 0; v < 2; v++ )
+		{
+			TIMEIT( c[0][v], copy_fn[v]( b, a, n ) );
+			TIMEIT( c[1][v], copy_fn[v]( b, a + 1, n ) );
+			TIMEIT( c[2][v], set_fn[v]( b, 0x55, n ) );
+			TIMEIT( c[3][v], move_fn[v]( a + 4, a, n ) );
+			copy_fn[1]( b, a, n );
+			TIMEIT( c[4][v], sink = cmp_fn[v]( a, b, n ) );
+		}
+
+		printf( "%5d", (int)n );
+		for( v = 0; v < 5; v++ )
+			printf( " %5lu/%-5lu", c[v][0], c[v][1] );
+		printf( "\n" );
+	}
+
+	// Make sure it's still right while we're here.
+	int ok = 1;
+	for( i = 0; i < 64; i++ )
+	{
+		memset( b, 0, 80 );
+		memcpy( b + ( i & 7 ), a + ( i >> 3 ), 40 + ( i & 3 ) );
+		if( bytewise_memcmp( b + ( i & 7 ), a + ( i >> 3 ), 40 + ( i & 3 ) ) ) ok = 0;
+		if( memcmp( b + ( i & 7 ), a + ( i >> 3 ), 40 + ( i & 3 ) ) ) ok = 0;
+	}
+	printf( "%s\n", ok ? "Results check out" : "MISMATCH" );
+
+	while( 1 );
+}
@@ -0,0 +1,68 @@
+/* Cycles per call for ch32fun's printf engine (mini_vpprintf).
+
+   "sink" formats through mini_pprintf into a puts that throws the text away,
+   so it's just the formatting, and also counts how many times puts was
+   called.  "snprintf" adds copying into a buffer.  The last column is a real
+   printf(), so it includes getting the text out over whatever
+   FUNCONF_USE_*PRINTF you have; run minichlink -T to read it.
+
+   Build with TARGET_MCU?=CH32V003 and then CH32V307 to compare a core with
+   no divider against one with. */
+
+#include "ch32fun.h"
+#include <stdio.h>
+
+static volatile int sink_calls;
+
+static int Sink( char * s, int len, void * buf )
+{
+	sink_calls++;
+	return len;
+}
+
+static uint32_t overhead;
+static char out[64];
+
+#define RUNS 3
+#define TIMEIT( result, expr ) do { \
+	int _r; result = 0xffffffff; \
+	for( _r = 0; _r < RUNS; _r++ ) { \
+		uint32_t _start = SysTick->CNT; \
+		expr; \
+		uint32_t _t = (uint32_t)SysTick->CNT - _start; \
+		if( _t < result ) result = _t; \
+	} \
+	result = ( result > overhead ) ? result - overhead : 0; \
+} while( 0 )
+
+#define BENCH( name, ... ) do { \
+	uint32_t tsink, tsn, tpf; \
+	TIMEIT( tsink, mini_pprintf( Sink, 0, __VA_ARGS__ ) ); \
+	sink_calls = 0; mini_pprintf( Sink, 0, __VA_ARGS__ ); \
+	int calls = sink_calls; \
+	TIMEIT( tsn, snprintf( out, sizeof( out ), __VA_ARGS__ ) ); \
+	TIMEIT( tpf, printf( __VA_ARGS__ ) ); \
+	printf( "\n%-22s %6lu %6d %8lu %7lu\n", name, tsink, calls, tsn, tpf ); \
+} while( 0 )
+
+volatile int vi = -123456;
+volatile unsigned vx = 0xdeadbeef;
+volatile uint32_t big = 4000000000u;
+
+int main()
+{
+	SystemInit();
+	Delay_Ms( 100 );
+
+	overhead = 0;
+	TIMEIT( overhead, );
+
+	printf( "%-22s %6s %6s %8s %7s\n", "format", "sink", "puts", "snprintf", "printf" );
+	BENCH( "%d %x %s", "%d %x %s", vi, vx, "hello" );
+	BENCH( "literal only", "The quick brown fox\n" );
+	BENCH( "%lu", "%lu", big );
+	BENCH( "%08x", "%08x", vx );
+	BENCH( "mixed", "T=%d.%02d C, state %s, 0x%04X\n", vi / 100, 45, "run", 0xbeef );
+
+	while( 1 );
+}
@@ -0,0 +1,9 @@
+#ifndef _FUNCONFIG_H
+#define _FUNCONFIG_H
+
+#define CH32V30x           1
+#define FUNCONF_ENABLE_HPE 0 // funrtos.h switches threads itself, the HPE can't be on.
+#define FUNCONF_SYSTICK_USE_HCLK 1 // So SysTick counts core clocks.
+
+#endif
+
@@ -0,0 +1,137 @@
+// RTOS timing test, to see how long funrtos.h takes to get from an interrupt
+// to the thread waiting on it, and to switch between threads.
+//
+// Like interrupt_timing_test, this expects Pin A4 hard connected to A5, and
+// will signal on A6.  A thread drops A5 once a tick, EXTI4_IRQHandler stamps
+// SysTick and pushes it into a queue, and the highest priority thread, which
+// was blocked on that queue, raises A6 as soon as it runs.  Meanwhile two low
+// priority threads are busy doing float math, so every wakeup has to preempt
+// one of them, save its FPU registers and all.
+//
+// On a scope, PA5 falling to PA6 rising is the whole interrupt to thread time.
+// Over the serial port it prints, in core clocks, from the top of the ISR to
+// the thread running (min/avg/max of 1000), and what a funRtosYield() to
+// another thread of the same priority costs.  The max is what to look at: it
+// should stay close to the min however long you leave it running, since
+// nothing in the kernel loops over threads.
+
+#define FUNRTOS_IMPLEMENTATION
+#include "ch32fun.h"
+#include "funrtos.h"
+#include <stdio.h>
+
+#define SAMPLES 1000
+#define YIELDS 1000
+
+static uint32_t stamp_items[16];
+static struct funQueue stamps = FUNQUEUE_INIT( stamp_items );
+
+static volatile uint32_t lat_min, lat_max, lat_sum, lat_count;
+static volatile uint32_t yield_cycles;
+static volatile uint32_t load_count[2];
+
+void EXTI4_IRQHandler( void ) __attribute__((interrupt));
+void EXTI4_IRQHandler( void )
+{
+	uint32_t now = SysTick->CNT;
+	EXTI->INTFR = EXTI_Line4;
+	funQueuePush( &stamps, now );
+}
+
+static void Responder( void * arg )
+{
+	uint32_t stamp;
+	while( 1 )
+	{
+		funQueuePop( &stamps, &stamp, FUNRTOS_FOREVER );
+		funDigitalWrite( PA6, FUN_HIGH );
+		uint32_t lat = (uint32_t)SysTick->CNT - stamp;
+		if( lat < lat_min ) lat_min = lat;
+		if( lat > lat_max ) lat_max = lat;
+		lat_sum += lat;
+		lat_count++;
+	}
+}
+
+static void Load( void * arg )
+{
+	int i = (int)(intptr_t)arg;
+	volatile float f = 1.0f + i;
+	while( 1 )
+	{
+		f = f * 1.0001f + 0.5f;
+		if( f > 1000.0f ) f = 1.0f;
+		load_count[i]++;
+	}
+}
+
+static volatile uint32_t pingpong;
+static void PingPong( void * arg )
+{
+	int i;
+	uint32_t start = SysTick->CNT;
+	for( i = 0; i < YIELDS; i++ )
+	{
+		pingpong++;
+		funRtosYield();
+	}
+	// The second one to finish has seen both of them go YIELDS times.
+	if( pingpong == 2 * YIELDS ) yield_cycles = ( (uint32_t)SysTick->CNT - start ) / ( 2 * YIELDS );
+}
+
+static void Stimulus( void * arg )
+{
+	funRtosSleep( 10 ); // Let PingPong finish.
+	printf( "Yield to another thread: %lu cycles\n", yield_cycles );
+
+	while( 1 )
+	{
+		lat_min = 0xffffffff;
+		lat_max = lat_sum = lat_count = 0;
+		uint32_t load0 = load_count[0], load1 = load_count[1];
+		while( lat_count < SAMPLES )
+		{
+			funDigitalWrite( PA6, FUN_LOW );
+			funDigitalWrite( PA5, FUN_HIGH );
+			funRtosSleep( 1 );
+			funDigitalWrite( PA5, FUN_LOW ); // Falling edge on PA4, EXTI4 goes.
+			funRtosSleep( 1 );
+		}
+		printf( "ISR to thread: min %lu avg %lu max %lu cycles, load ran %lu/%lu\n",
+			lat_min, lat_sum / lat_count, lat_max, load_count[0] - load0, load_count[1] - load1 );
+	}
+}
+
+static struct funThread responder, load[2], pingpong_threads[2], stimulus;
+static uint32_t responder_stack[128] __attribute__((aligned(16)));
+static uint32_t load_stack[2][128] __attribute__((aligned(16)));
+static uint32_t pingpong_stack[2][128] __attribute__((aligned(16)));
+static uint32_t stimulus_stack[256] __attribute__((aligned(16)));
+
+int main()
+{
+	SystemInit();
+	funGpioInitAll();
+	RCC->APB2PCENR |= RCC_APB2Periph_AFIO;
+
+	funPinMode( PA4, GPIO_CFGLR_IN_FLOAT );
+	funPinMode( PA5, GPIO_CFGLR_OUT_50Mhz_PP );
+	funPinMode( PA6, GPIO_CFGLR_OUT_50Mhz_PP );
+	funDigitalWrite( PA5, FUN_HIGH );
+	funDigitalWrite( PA6, FUN_LOW );
+
+	AFIO->EXTICR[1] = AFIO_EXTICR2_EXTI4_PA;
+	EXTI->INTENR = EXTI_INTENR_MR4;
+	EXTI->FTENR = EXTI_FTENR_TR4;  // Falling edge trigger
+	NVIC_EnableIRQ( EXTI4_IRQn );
+
+	printf( "Testing\n" );
+
+	funRtosThread( &responder, Responder, 0, responder_stack, sizeof( responder_stack ), 10 );
+	funRtosThread( &pingpong_threads[0], PingPong, 0, pingpong_stack[0], sizeof( pingpong_stack[0] ), 6 );
+	funRtosThread( &pingpong_threads[1], PingPong, 0, pingpong_stack[1], sizeof( pingpong_stack[1] ), 6 );
+	funRtosThread( &stimulus, Stimulus, 0, stimulus_stack, sizeof( stimulus_stack ), 5 );
+	funRtosThread( &load[0], Load, (void *)0, load_stack[0], sizeof( load_stack[0] ), 1 );
+	funRtosThread( &load[1], Load, (void *)1, load_stack[1], sizeof( load_stack[1] ), 1 );
+	funRtosStart();
+}
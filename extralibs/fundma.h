@@ -0,0 +1,317 @@
+/* Single-File-Header for asynchronous memcpy / memset using the mem2mem mode
+   of DMA1 on the CH32V003, V00x, V10x, V20x, V30x, X03x, L103 and CH641.
+
+   Lets you start copying an LCD frame or a network buffer and keep running
+   your control loop while the DMA does the moving.
+
+   If you are including this in main, simply
+	#define FUNDMA_IMPLEMENTATION
+
+   Other defines include:
+	#define FUNDMA_CHANNELS (1<<6)
+		Which DMA1 channels (1..7) it may use.  It takes the first of these
+		that isn't enabled, so channels you also point at peripherals are
+		fine as long as they are idle when you start a copy.  Not 7 by
+		default, fsusb.c copies with it from the USB interrupt.
+	#define FUNDMA_MIN_BYTES 64
+		Anything shorter is done by the CPU right away, since setting up the
+		DMA costs more than just doing it.  See examples/dma_memcpy to find
+		the crossover on your chip.
+	#define FUNDMA_USE_IRQ 1
+		Finish transfers in the DMA1_ChannelN_IRQHandler's of FUNDMA_CHANNELS
+		(so you can't have your own handlers for those).  Without it, nothing
+		happens until you call funDmaPoll(), funDmaBusy(), funDmaWait() or
+		start another transfer, and callbacks get called from there.
+
+   Call funDmaInit() once, then:
+	int h = funDmaMemcpy( dest, src, n, callback, opaque );
+	int h = funDmaMemset( dest, c, n, callback, opaque );
+
+   Both return 0 if it's already done (short, or no channel was free, so the
+   CPU did it), otherwise a handle you can give to funDmaBusy( h ) or
+   funDmaWait( h ).  The handle is the channel number, so it only means
+   anything until the next transfer is started.  callback may be 0; if not,
+   it's called with opaque once the transfer is done, even if that's before
+   funDmaMemcpy returns.  From a callback you may start another transfer.
+
+   Don't touch the destination (or change the source) until it's done.  The
+   DMA shares the bus with the CPU, so on the smaller parts expect some of the
+   CPU's time to go to it.  Copies more than 65535 words long are done in
+   pieces, which needs FUNDMA_USE_IRQ or polling to move along.
+*/
+
+#ifndef _FUNDMA_H
+#define _FUNDMA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef void (*fundma_callback_t)( void * opaque );
+
+void funDmaInit( void );
+int funDmaMemcpy( void * dest, const void * src, size_t n, fundma_callback_t cb, void * opaque );
+int funDmaMemset( void * dest, int c, size_t n, fundma_callback_t cb, void * opaque );
+int funDmaBusy( int handle );
+void funDmaWait( int handle );
+void funDmaPoll( void );
+
+#ifdef FUNDMA_IMPLEMENTATION
+
+#include "ch32fun.h"
+#include <string.h>
+
+#if defined( CH5xx ) || defined( CH32H41x )
+#error fundma.h does not support this chip yet
+#endif
+
+#ifndef FUNDMA_CHANNELS
+#define FUNDMA_CHANNELS (1<<6)
+#endif
+
+#ifndef FUNDMA_MIN_BYTES
+#define FUNDMA_MIN_BYTES 64
+#endif
+
+#ifndef FUNDMA_USE_IRQ
+#define FUNDMA_USE_IRQ 0
+#endif
+
+#if ( FUNDMA_CHANNELS & ~0xfe ) || !FUNDMA_CHANNELS
+#error FUNDMA_CHANNELS must be a mask of channels 1 through 7
+#endif
+
+struct FunDmaChannel
+{
+	fundma_callback_t cb;
+	void * opaque;
+	uint32_t dest;      // Where the next piece goes.
+	uint32_t src;
+	uint32_t remaining; // In transfers, not bytes.
+	uint32_t fill;      // memset reads from here.
+	uint16_t cfgr;
+};
+
+static struct FunDmaChannel fundma_channels[8];
+static volatile uint8_t fundma_inuse[8];
+
+#define FUNDMA_REGS( n ) ((DMA_Channel_TypeDef *)( DMA1_Channel1_BASE + ( (n) - 1 ) * 0x14 ))
+#define FUNDMA_FLAGS( n, f ) ((f) << ( ( (n) - 1 ) * 4 ))
+
+// Start the next (up to) 65535 transfers.
+static void FunDmaKick( int n )
+{
+	struct FunDmaChannel * c = &fundma_channels[n];
+	DMA_Channel_TypeDef * ch = FUNDMA_REGS( n );
+	uint32_t count = ( c->remaining > 0xffff ) ? 0xffff : c->remaining;
+	int shift = ( c->cfgr & DMA_CFGR1_PSIZE ) >> 8;
+
+	ch->CFGR = 0;
+	DMA1->INTFCR = FUNDMA_FLAGS( n, DMA1_IT_GL1 );
+
+	// Same as fsusb's copyBuffer: mem2mem goes from MADDR to PADDR with DIR set.
+	ch->MADDR = c->src;
+	ch->PADDR = c->dest;
+	ch->CNTR = count;
+	c->remaining -= count;
+	c->dest += count << shift;
+	if( c->cfgr & DMA_CFGR1_MINC ) c->src += count << shift;
+	ch->CFGR = c->cfgr | DMA_CFGR1_EN;
+}
+
+// Returns nonzero if channel n is still busy.  Calls the callback if it just finished.
+static int FunDmaService( int n )
+{
+	if( !fundma_inuse[n] ) return 0;
+	if( !( DMA1->INTFR & FUNDMA_FLAGS( n, DMA1_IT_TC1 | DMA1_IT_TE1 ) ) ) return 1;
+
+	struct FunDmaChannel * c = &fundma_channels[n];
+	if( c->remaining && !( DMA1->INTFR & FUNDMA_FLAGS( n, DMA1_IT_TE1 ) ) )
+	{
+		FunDmaKick( n );
+		return 1;
+	}
+
+	FUNDMA_REGS( n )->CFGR = 0;
+	DMA1->INTFCR = FUNDMA_FLAGS( n, DMA1_IT_GL1 );
+
+	// Let go of it before the callback, so the callback can use it again.
+	fundma_callback_t cb = c->cb;
+	fundma_inuse[n] = 0;
+	if( cb ) cb( c->opaque );
+	return 0;
+}
+
+// Claims a free channel, or returns 0 if there isn't one.
+static int FunDmaClaim( void )
+{
+	int n;
+#if !FUNDMA_USE_IRQ
+	funDmaPoll();
+#endif
+	// Only clear MIE: __disable_irq() would also clear MPIE, which breaks
+	// returning from an interrupt if we got here from a callback.
+	uint32_t mstatus = __get_MSTATUS();
+	__set_MSTATUS( mstatus & ~0x8 );
+	for( n = 1; n < 8; n++ )
+	{
+		if( !( FUNDMA_CHANNELS & ( 1 << n ) ) || fundma_inuse[n] ) continue;
+		if( FUNDMA_REGS( n )->CFGR & DMA_CFGR1_EN ) continue; // Someone else's.
+		fundma_inuse[n] = 1;
+		break;
+	}
+	__set_MSTATUS( mstatus );
+	return ( n < 8 ) ? n : 0;
+}
+
+static int FunDmaStart( int n, uint32_t dest, uint32_t src, uint32_t count, uint16_t cfgr, fundma_callback_t cb, void * opaque )
+{
+	struct FunDmaChannel * c = &fundma_channels[n];
+	if( !count )
+	{
+		// Short enough (FUNDMA_MIN_BYTES set very low) that the ragged ends were
+		// all of it.  Starting with CNTR = 0 would never finish.
+		fundma_inuse[n] = 0;
+		if( cb ) cb( opaque );
+		return 0;
+	}
+	c->cb = cb;
+	c->opaque = opaque;
+	c->dest = dest;
+	c->src = src;
+	c->remaining = count;
+	c->cfgr = cfgr | DMA_CFGR1_MEM2MEM | DMA_CFGR1_DIR | DMA_CFGR1_PINC | ( FUNDMA_USE_IRQ ? DMA_CFGR1_TCIE | DMA_CFGR1_TEIE : 0 );
+	FunDmaKick( n );
+	return n;
+}
+
+void funDmaInit( void )
+{
+	int n;
+	RCC->AHBPCENR |= RCC_AHBPeriph_DMA1;
+	for( n = 1; n < 8; n++ )
+	{
+		if( !( FUNDMA_CHANNELS & ( 1 << n ) ) ) continue;
+		fundma_inuse[n] = 0;
+#if FUNDMA_USE_IRQ
+		NVIC_EnableIRQ( DMA1_Channel1_IRQn + n - 1 );
+#endif
+	}
+}
+
+int funDmaMemcpy( void * dest, const void * src, size_t n, fundma_callback_t cb, void * opaque )
+{
+	uintptr_t d = (uintptr_t)dest;
+	uintptr_t s = (uintptr_t)src;
+	int ch;
+
+	if( n < FUNDMA_MIN_BYTES || !( ch = FunDmaClaim() ) )
+	{
+		memcpy( dest, src, n );
+		if( cb ) cb( opaque );
+		return 0;
+	}
+
+	if( !( ( d ^ s ) & 3 ) )
+	{
+		// Same alignment: CPU does the ragged ends, DMA does words.
+		uint32_t head = -d & 3;
+		uint32_t words = ( n - head ) / 4;
+		uint32_t tail = head + words * 4;
+		memcpy( dest, src, head );
+		memcpy( (uint8_t *)dest + tail, (const uint8_t *)src + tail, n - tail );
+		return FunDmaStart( ch, d + head, s + head, words,
+			DMA_CFGR1_MINC | DMA_CFGR1_MSIZE_1 | DMA_CFGR1_PSIZE_1, cb, opaque );
+	}
+	else if( !( ( d ^ s ) & 1 ) )
+	{
+		uint32_t head = d & 1;
+		uint32_t halves = ( n - head ) / 2;
+		uint32_t tail = head + halves * 2;
+		memcpy( dest, src, head );
+		memcpy( (uint8_t *)dest + tail, (const uint8_t *)src + tail, n - tail );
+		return FunDmaStart( ch, d + head, s + head, halves,
+			DMA_CFGR1_MINC | DMA_CFGR1_MSIZE_0 | DMA_CFGR1_PSIZE_0, cb, opaque );
+	}
+	return FunDmaStart( ch, d, s, n, DMA_CFGR1_MINC, cb, opaque );
+}
+
+int funDmaMemset( void * dest, int c, size_t n, fundma_callback_t cb, void * opaque )
+{
+	uintptr_t d = (uintptr_t)dest;
+	int ch;
+
+	if( n < FUNDMA_MIN_BYTES || !( ch = FunDmaClaim() ) )
+	{
+		memset( dest, c, n );
+		if( cb ) cb( opaque );
+		return 0;
+	}
+
+	// The DMA reads the same word over and over (no MINC).
+	uint32_t head = -d & 3;
+	uint32_t words = ( n - head ) / 4;
+	uint32_t tail = head + words * 4;
+	memset( dest, c, head );
+	memset( (uint8_t *)dest + tail, c, n - tail );
+	uint32_t fill = (uint8_t)c;
+	fill |= fill << 8;
+	fill |= fill << 16; // Not * 0x01010101, there's no multiply on rv32ec.
+	fundma_channels[ch].fill = fill;
+	return FunDmaStart( ch, d + head, (uintptr_t)&fundma_channels[ch].fill, words,
+		DMA_CFGR1_MSIZE_1 | DMA_CFGR1_PSIZE_1, cb, opaque );
+}
+
+int funDmaBusy( int handle )
+{
+#if FUNDMA_USE_IRQ
+	return fundma_inuse[handle];
+#else
+	return FunDmaService( handle );
+#endif
+}
+
+void funDmaWait( int handle )
+{
+	while( funDmaBusy( handle ) );
+}
+
+void funDmaPoll( void )
+{
+#if !FUNDMA_USE_IRQ
+	int n;
+	for( n = 1; n < 8; n++ )
+		if( FUNDMA_CHANNELS & ( 1 << n ) ) FunDmaService( n );
+#endif
+}
+
+#if FUNDMA_USE_IRQ
+#define FUNDMA_HANDLER( n ) \
+void DMA1_Channel##n##_IRQHandler( void ) __attribute__((interrupt)); \
+void DMA1_Channel##n##_IRQHandler( void ) { FunDmaService( n ); }
+
+#if FUNDMA_CHANNELS & ( 1 << 1 )
+FUNDMA_HANDLER( 1 )
+#endif
+#if FUNDMA_CHANNELS & ( 1 << 2 )
+FUNDMA_HANDLER( 2 )
+#endif
+#if FUNDMA_CHANNELS & ( 1 << 3 )
+FUNDMA_HANDLER( 3 )
+#endif
+#if FUNDMA_CHANNELS & ( 1 << 4 )
+FUNDMA_HANDLER( 4 )
+#endif
+#if FUNDMA_CHANNELS & ( 1 << 5 )
+FUNDMA_HANDLER( 5 )
+#endif
+#if FUNDMA_CHANNELS & ( 1 << 6 )
+FUNDMA_HANDLER( 6 )
+#endif
+#if FUNDMA_CHANNELS & ( 1 << 7 )
+FUNDMA_HANDLER( 7 )
+#endif
+#endif
+
+#endif // FUNDMA_IMPLEMENTATION
+
+#endif // _FUNDMA_H
@@ -0,0 +1,460 @@
+/* Single-File-Header for a small preemptive RTOS kernel for the QingKe V2 and
+   V4 cores (CH32V003, V00x, V20x, V30x, X03x, L103 and CH641).  Not the V10x,
+   its SysTick is laid out differently.
+
+   Threads have fixed priorities 1..31 (higher runs first), threads of the
+   same priority share the CPU round robin, one SysTick tick at a time.  The
+   scheduler picks the next thread from a bitmap of ready priorities, so it
+   takes the same time no matter how many threads there are.  Context
+   switches happen in SW_Handler (the software interrupt), which is pended
+   whenever something readies a thread more important than the running one,
+   including from your own interrupts.
+
+   If you are including this in main, simply
+	#define FUNRTOS_IMPLEMENTATION
+
+   Other defines include:
+	#define FUNRTOS_TICK_HZ 1000
+		How often SysTick_Handler runs, for funRtosSleep() and time slices.
+
+   This owns SysTick_Handler and SW_Handler, so you can't have your own, and
+   FUNCONF_USE_TASKS must be off.  FUNCONF_ENABLE_HPE must be 0 as well: the
+   HPE puts the registers of the interrupted thread in its own stack and gives
+   them back on mret, which is exactly what switching threads can't have.
+   Without HPE interrupts don't nest, so every interrupt runs to the end
+   before anything is switched, and the kernel never needs to lock anything
+   against them.
+
+	static struct funThread worker;
+	static uint32_t worker_stack[64] __attribute__((aligned(16)));
+	funRtosThread( &worker, WorkerFn, arg, worker_stack, sizeof( worker_stack ), 5 );
+	funRtosStart(); // Doesn't return, main() becomes the idle thread.
+
+   funRtosThread() returns 0, or -1 (and makes no thread) if prio isn't 1..31.
+
+   A thread that returns from its function is gone.  Threads may call
+   funRtosYield(), funRtosSleep( ticks ) and funRtosTicks().
+
+   funQueue is a lock-free queue of uint32_t's, for one producer (usually an
+   interrupt) and one consumer thread.  The size has to be a power of 2.
+	static uint32_t items[16];
+	static struct funQueue q = FUNQUEUE_INIT( items );
+	funQueuePush( &q, v );                   // From anywhere, 0 if it's full.
+	funQueuePop( &q, &v, FUNRTOS_FOREVER );  // From a thread, 0 on timeout.
+	funQueueTryPop( &q, &v );                // Doesn't block.
+
+   See examples_v30x/rtos_timing_test for interrupt to thread latency and
+   switch times.
+*/
+
+#ifndef _FUNRTOS_H
+#define _FUNRTOS_H
+
+#include <stdint.h>
+
+#define FUNRTOS_FOREVER 0xffffffff
+
+struct funThread
+{
+	uint32_t * sp;  // Must be first, SW_Handler keeps the saved context here.
+	struct funThread * next;  // Ready list, circular.
+	struct funThread * prev;
+	struct funThread * next_sleeper;
+	uint32_t wake;
+	uint8_t prio;
+	uint8_t ready;
+	uint8_t sleeping;
+	uint8_t timed_out;
+};
+
+struct funQueue
+{
+	volatile uint16_t head; // Only the producer writes this.
+	volatile uint16_t tail; // Only the consumer writes this.
+	uint16_t mask;
+	uint32_t * items;
+	struct funThread * volatile waiter;
+};
+
+#define FUNQUEUE_INIT( items ) { 0, 0, sizeof( items ) / sizeof( items[0] ) - 1, items, 0 }
+
+int funRtosThread( struct funThread * t, void (*fn)( void * arg ), void * arg, uint32_t * stack, uint32_t stack_bytes, int prio );
+void funRtosStart( void ) __attribute__((noreturn));
+void funRtosYield( void );
+void funRtosSleep( uint32_t ticks );
+void funRtosExit( void ) __attribute__((noreturn));
+uint32_t funRtosTicks( void );
+struct funThread * funRtosSelf( void );
+
+int funQueuePush( struct funQueue * q, uint32_t v );
+int funQueuePop( struct funQueue * q, uint32_t * v, uint32_t timeout );
+int funQueueTryPop( struct funQueue * q, uint32_t * v );
+
+#ifdef FUNRTOS_IMPLEMENTATION
+
+#include "ch32fun.h"
+#include <string.h>
+
+#if defined( CH5xx ) || defined( CH32H41x ) || defined( CH32V10x )
+#error funrtos.h does not support this chip yet
+#endif
+
+#if FUNCONF_ENABLE_HPE
+#error funrtos.h needs FUNCONF_ENABLE_HPE 0, the hardware stack would restore the wrong thread
+#endif
+
+#if FUNCONF_USE_TASKS
+#error funrtos.h and FUNCONF_USE_TASKS both want SysTick_Handler
+#endif
+
+#ifndef FUNRTOS_TICK_HZ
+#define FUNRTOS_TICK_HZ 1000
+#endif
+
+#define FUNRTOS_TICK_CYCLES ( DELAY_MS_TIME * 1000 / FUNRTOS_TICK_HZ )
+
+// What SW_Handler pushes, in words from sp: mepc, mstatus, ra, then x5 and up,
+// then f0..f31 and fcsr if there's an FPU.  Kept a multiple of 16 bytes.  These
+// go into the asm as text, so they have to be plain numbers.
+#if defined( __riscv_32e ) || defined( __riscv_e )
+#define FUNRTOS_FRAME_WORDS 16
+#elif defined( __riscv_flen )
+#define FUNRTOS_FRAME_WORDS 68
+#else
+#define FUNRTOS_FRAME_WORDS 32
+#endif
+#define FUNRTOS_SLOT_X( n ) ( 3 + (n) - 5 ) // x5 and up, ra is in 2.
+
+static struct funThread * funrtos_ready[32];
+static uint32_t funrtos_ready_mask;
+static struct funThread * funrtos_sleepers; // Sorted by wake.
+static struct funThread funrtos_idle;
+static volatile uint32_t funrtos_ticks;
+static uint8_t funrtos_started;
+
+// Not static, SW_Handler finds them by name.
+struct funThread * funrtos_current __attribute__((used));
+struct funThread * FunRtosSwitch( void ) __attribute__((used));
+
+static void FunRtosReady( struct funThread * t )
+{
+	struct funThread * h = funrtos_ready[t->prio];
+	t->ready = 1;
+	if( !h )
+	{
+		t->next = t->prev = t;
+		funrtos_ready[t->prio] = t;
+		funrtos_ready_mask |= 1u << t->prio;
+		return;
+	}
+	// At the end of its priority.
+	t->next = h;
+	t->prev = h->prev;
+	h->prev->next = t;
+	h->prev = t;
+}
+
+static void FunRtosUnready( struct funThread * t )
+{
+	t->ready = 0;
+	if( t->next == t )
+	{
+		funrtos_ready[t->prio] = 0;
+		funrtos_ready_mask &= ~( 1u << t->prio );
+		return;
+	}
+	t->prev->next = t->next;
+	t->next->prev = t->prev;
+	if( funrtos_ready[t->prio] == t ) funrtos_ready[t->prio] = t->next;
+}
+
+static void FunRtosSleepInsert( struct funThread * t, uint32_t wake )
+{
+	struct funThread ** p = &funrtos_sleepers;
+	t->wake = wake;
+	t->sleeping = 1;
+	t->timed_out = 0;
+	while( *p && (int32_t)( (*p)->wake - wake ) <= 0 ) p = &(*p)->next_sleeper;
+	t->next_sleeper = *p;
+	*p = t;
+}
+
+static void FunRtosSleepRemove( struct funThread * t )
+{
+	struct funThread ** p = &funrtos_sleepers;
+	if( !t->sleeping ) return;
+	while( *p != t ) p = &(*p)->next_sleeper;
+	*p = t->next_sleeper;
+	t->sleeping = 0;
+}
+
+// Pend a switch if the thread that should run isn't the one running.
+static void FunRtosReschedule( void )
+{
+	if( funrtos_started && funrtos_ready[31 - __builtin_clz( funrtos_ready_mask )] != funrtos_current )
+		NVIC_SetPendingIRQ( Software_IRQn );
+}
+
+// Only clear MIE: __disable_irq() also clears MPIE, which breaks returning
+// from an interrupt if we got here from one.
+static inline uint32_t FunRtosLock( void )
+{
+	uint32_t mstatus = __get_MSTATUS();
+	__set_MSTATUS( mstatus & ~0x8 );
+	return mstatus;
+}
+
+static inline void FunRtosUnlock( uint32_t mstatus )
+{
+	__set_MSTATUS( mstatus );
+}
+
+// Called from SW_Handler with the outgoing thread saved, returns the one to restore.
+struct funThread * FunRtosSwitch( void )
+{
+	NVIC_ClearPendingIRQ( Software_IRQn );
+	return funrtos_current = funrtos_ready[31 - __builtin_clz( funrtos_ready_mask )];
+}
+
+#define FUNRTOS_STR2( x ) #x
+#define FUNRTOS_STR( x ) FUNRTOS_STR2( x )
+#define FUNRTOS_SAVE( r, slot ) "	sw " #r ", " FUNRTOS_STR( slot ) "*4(sp)\n"
+#define FUNRTOS_LOAD( r, slot ) "	lw " #r ", " FUNRTOS_STR( slot ) "*4(sp)\n"
+#define FUNRTOS_FSAVE( r, slot ) "	fsw " #r ", " FUNRTOS_STR( slot ) "*4(sp)\n"
+#define FUNRTOS_FLOAD( r, slot ) "	flw " #r ", " FUNRTOS_STR( slot ) "*4(sp)\n"
+
+#if defined( __riscv_32e ) || defined( __riscv_e )
+#define FUNRTOS_XHIGH( op )
+#else
+#define FUNRTOS_XHIGH( op ) \
+	op( x16, 14 ) op( x17, 15 ) op( x18, 16 ) op( x19, 17 ) op( x20, 18 ) op( x21, 19 ) \
+	op( x22, 20 ) op( x23, 21 ) op( x24, 22 ) op( x25, 23 ) op( x26, 24 ) op( x27, 25 ) \
+	op( x28, 26 ) op( x29, 27 ) op( x30, 28 ) op( x31, 29 )
+#endif
+
+#define FUNRTOS_XALL( op ) \
+	op( x1, 2 ) op( x5, 3 ) op( x6, 4 ) op( x7, 5 ) op( x8, 6 ) op( x9, 7 ) op( x10, 8 ) \
+	op( x11, 9 ) op( x12, 10 ) op( x13, 11 ) op( x14, 12 ) op( x15, 13 ) FUNRTOS_XHIGH( op )
+
+#if defined( __riscv_flen )
+#define FUNRTOS_FALL( op ) \
+	op( f0, 32 ) op( f1, 33 ) op( f2, 34 ) op( f3, 35 ) op( f4, 36 ) op( f5, 37 ) op( f6, 38 ) \
+	op( f7, 39 ) op( f8, 40 ) op( f9, 41 ) op( f10, 42 ) op( f11, 43 ) op( f12, 44 ) op( f13, 45 ) \
+	op( f14, 46 ) op( f15, 47 ) op( f16, 48 ) op( f17, 49 ) op( f18, 50 ) op( f19, 51 ) op( f20, 52 ) \
+	op( f21, 53 ) op( f22, 54 ) op( f23, 55 ) op( f24, 56 ) op( f25, 57 ) op( f26, 58 ) op( f27, 59 ) \
+	op( f28, 60 ) op( f29, 61 ) op( f30, 62 ) op( f31, 63 )
+#define FUNRTOS_FP_SAVE FUNRTOS_FALL( FUNRTOS_FSAVE ) \
+	"	frcsr t0\n" FUNRTOS_SAVE( t0, 64 )
+#define FUNRTOS_FP_LOAD FUNRTOS_LOAD( t0, 64 ) \
+	"	fscsr t0\n" FUNRTOS_FALL( FUNRTOS_FLOAD )
+#else
+#define FUNRTOS_FP_SAVE
+#define FUNRTOS_FP_LOAD
+#endif
+
+// Saves everything the interrupted thread had on its own stack, swaps stacks
+// and restores the next thread the same way.  If nothing changed, it's the
+// same thread coming back.
+void SW_Handler( void ) __attribute__((naked));
+void SW_Handler( void )
+{
+	asm volatile(
+ADD_ARCH_ZICSR
+"	addi sp, sp, -" FUNRTOS_STR( FUNRTOS_FRAME_WORDS ) "*4\n"
+	FUNRTOS_XALL( FUNRTOS_SAVE )
+"	csrr t0, mepc\n"
+	FUNRTOS_SAVE( t0, 0 )
+"	csrr t0, mstatus\n"
+	FUNRTOS_SAVE( t0, 1 )
+	FUNRTOS_FP_SAVE
+"	la t0, funrtos_current\n\
+	lw t0, 0(t0)\n\
+	sw sp, 0(t0)\n\
+	call FunRtosSwitch\n\
+	lw sp, 0(a0)\n"
+	FUNRTOS_FP_LOAD
+	FUNRTOS_LOAD( t0, 0 )
+"	csrw mepc, t0\n"
+	FUNRTOS_LOAD( t0, 1 )
+"	csrw mstatus, t0\n"
+	FUNRTOS_XALL( FUNRTOS_LOAD )
+"	addi sp, sp, " FUNRTOS_STR( FUNRTOS_FRAME_WORDS ) "*4\n\
+	mret\n" );
+}
+
+void SysTick_Handler( void ) __attribute__((interrupt));
+void SysTick_Handler( void )
+{
+	struct funThread * t;
+	SysTick->CMP += FUNRTOS_TICK_CYCLES;
+	SysTick->SR = 0;
+	uint32_t now = ++funrtos_ticks;
+
+	while( ( t = funrtos_sleepers ) && (int32_t)( now - t->wake ) >= 0 )
+	{
+		funrtos_sleepers = t->next_sleeper;
+		t->sleeping = 0;
+		t->timed_out = 1;
+		FunRtosReady( t );
+	}
+
+	// Time slice: the next one of the same priority goes first.
+	t = funrtos_current;
+	if( t->ready ) funrtos_ready[t->prio] = t->next;
+	FunRtosReschedule();
+}
+
+int funRtosThread( struct funThread * t, void (*fn)( void * arg ), void * arg, uint32_t * stack, uint32_t stack_bytes, int prio )
+{
+	// 0 is the idle thread, and funrtos_ready_mask has 32 bits.
+	if( prio < 1 || prio > 31 ) return -1;
+
+	uint32_t * sp = (uint32_t *)( ( (uintptr_t)stack + stack_bytes ) & ~15 ) - FUNRTOS_FRAME_WORDS;
+	memset( sp, 0, FUNRTOS_FRAME_WORDS * 4 );
+	sp[0] = (uint32_t)fn;
+	// Comes up in machine mode with interrupts on, with the FPU state of whoever made it.
+	sp[1] = ( __get_MSTATUS() & ~0x8 ) | 0x1880;
+	sp[2] = (uint32_t)funRtosExit;
+	sp[FUNRTOS_SLOT_X( 10 )] = (uint32_t)arg;
+
+	memset( t, 0, sizeof( *t ) );
+	t->sp = sp;
+	t->prio = prio;
+
+	uint32_t ms = FunRtosLock();
+	FunRtosReady( t );
+	FunRtosReschedule();
+	FunRtosUnlock( ms );
+	return 0;
+}
+
+void funRtosStart( void )
+{
+	// main() carries on as the idle thread, its context is saved the first time it's switched out.
+	funrtos_idle.prio = 0;
+	__disable_irq();
+	// No nesting, whatever the startup code set: an interrupt that interrupted
+	// another must not switch threads out from under it.  (INESTEN)
+	__set_INTSYSCR( __get_INTSYSCR() & ~0x2 );
+	FunRtosReady( &funrtos_idle );
+	funrtos_current = &funrtos_idle;
+	funrtos_started = 1;
+
+	SysTick->CMP = SysTick->CNT + FUNRTOS_TICK_CYCLES;
+	SysTick->SR = 0;
+	SysTick->CTLR |= SYSTICK_CTLR_STIE;
+	// Switches go last, after any other pending interrupt.
+	NVIC_SetPriority( Software_IRQn, 0xff );
+	NVIC_EnableIRQ( SysTick_IRQn );
+	NVIC_EnableIRQ( Software_IRQn );
+	FunRtosReschedule();
+	__enable_irq();
+
+	while( 1 ) __WFI();
+}
+
+void funRtosYield( void )
+{
+	uint32_t ms = FunRtosLock();
+	struct funThread * t = funrtos_current;
+	funrtos_ready[t->prio] = t->next;
+	FunRtosReschedule();
+	FunRtosUnlock( ms );
+}
+
+void funRtosSleep( uint32_t ticks )
+{
+	uint32_t ms = FunRtosLock();
+	struct funThread * t = funrtos_current;
+	FunRtosUnready( t );
+	FunRtosSleepInsert( t, funrtos_ticks + ( ticks ? ticks : 1 ) );
+	FunRtosReschedule();
+	FunRtosUnlock( ms );
+}
+
+void funRtosExit( void )
+{
+	FunRtosLock();
+	FunRtosUnready( funrtos_current );
+	FunRtosReschedule();
+	__set_MSTATUS( __get_MSTATUS() | 0x8 );
+	while( 1 ); // Switched out for good before we get here.
+}
+
+uint32_t funRtosTicks( void )
+{
+	return funrtos_ticks;
+}
+
+struct funThread * funRtosSelf( void )
+{
+	return funrtos_current;
+}
+
+int funQueuePush( struct funQueue * q, uint32_t v )
+{
+	uint16_t h = q->head;
+	if( (uint16_t)( h - q->tail ) > q->mask ) return 0;
+	q->items[h & q->mask] = v;
+	__asm__ volatile( "" : : : "memory" );
+	q->head = h + 1;
+
+	// The consumer only sets waiter with interrupts off after seeing it empty,
+	// so either it saw this item, or it's waiting by now.
+	if( q->waiter )
+	{
+		uint32_t ms = FunRtosLock();
+		struct funThread * t = q->waiter;
+		if( t && !t->ready )
+		{
+			q->waiter = 0;
+			FunRtosSleepRemove( t );
+			FunRtosReady( t );
+			FunRtosReschedule();
+		}
+		FunRtosUnlock( ms );
+	}
+	return 1;
+}
+
+int funQueueTryPop( struct funQueue * q, uint32_t * v )
+{
+	uint16_t t = q->tail;
+	if( q->head == t ) return 0;
+	*v = q->items[t & q->mask];
+	__asm__ volatile( "" : : : "memory" );
+	q->tail = t + 1;
+	return 1;
+}
+
+int funQueuePop( struct funQueue * q, uint32_t * v, uint32_t timeout )
+{
+	struct funThread * self = funrtos_current;
+	uint32_t until = funrtos_ticks + timeout;
+	while( !funQueueTryPop( q, v ) )
+	{
+		uint32_t ms = FunRtosLock();
+		if( q->head == q->tail )
+		{
+			uint32_t now = funrtos_ticks;
+			if( timeout != FUNRTOS_FOREVER && (int32_t)( until - now ) <= 0 )
+			{
+				FunRtosUnlock( ms );
+				return 0;
+			}
+			q->waiter = self;
+			FunRtosUnready( self );
+			if( timeout != FUNRTOS_FOREVER ) FunRtosSleepInsert( self, until );
+			FunRtosReschedule();
+			FunRtosUnlock( ms ); // Switched out here, until a push or the timeout.
+			ms = FunRtosLock();
+			q->waiter = 0;
+		}
+		FunRtosUnlock( ms );
+	}
+	return 1;
+}
+
+#endif // FUNRTOS_IMPLEMENTATION
+
+#endif // _FUNRTOS_H
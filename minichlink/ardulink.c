@@ -4,10 +4,12 @@
 #include "serial_dev.h"
 #include "minichlink.h"
 
-void * TryInit_Ardulink(const init_hints_t*);
+void * TryInit_Ardulink(struct MiniChlinkFunctions * mcf, const init_hints_t*);
 
 static int ArdulinkWriteReg32(void * dev, uint8_t reg_7_bit, uint32_t command);
 static int ArdulinkReadReg32(void * dev, uint8_t reg_7_bit, uint32_t * commandresp);
+static int ArdulinkReadReg32Multi(void * dev, uint8_t reg_7_bit, uint32_t * commandresp, int count);
+static int ArdulinkExecuteDMIQueue(void * dev, struct DMIOp * ops, int count);
 static int ArdulinkFlushLLCommands(void * dev);
 static int ArdulinkDelayUS(void * dev, int microseconds);
 static int ArdulinkControl3v3(void * dev, int power_on);
@@ -36,6 +38,7 @@ int ArdulinkWriteReg32(void * dev, uint8_t reg_7_bit, uint32_t command)
 
 	if (serial_dev_read(&((ardulink_ctx_t*)dev)->serial, buf, 1) == -1)
 		return -errno;
+	InternalCountRoundTrip(dev);
 
 	return buf[0] == '+' ? 0 : -71; // EPROTO
 }
@@ -51,6 +54,7 @@ int ArdulinkReadReg32(void * dev, uint8_t reg_7_bit, uint32_t * commandresp)
 
 	if (serial_dev_read(&((ardulink_ctx_t*)dev)->serial, buf, 4) == -1)
 		return -errno;
+	InternalCountRoundTrip(dev);
 
 	*commandresp = (uint32_t)buf[0] | (uint32_t)buf[1] << 8 | \
 		(uint32_t)buf[2] << 16 | (uint32_t)buf[3] << 24;
@@ -60,6 +64,88 @@ int ArdulinkReadReg32(void * dev, uint8_t reg_7_bit, uint32_t * commandresp)
 	return 0;
 }
 
+// Pipelines reads: the Arduino's serial RX buffer is 64 bytes, so send up to
+// 16 'r' commands (32 bytes) at a time, then collect all the replies.
+int ArdulinkReadReg32Multi(void * dev, uint8_t reg_7_bit, uint32_t * commandresp, int count)
+{
+	uint8_t buf[16*4];
+	while (count > 0) {
+		int i;
+		int n = count > 16 ? 16 : count;
+		for (i = 0; i < n; i++) {
+			buf[i*2+0] = 'r';
+			buf[i*2+1] = reg_7_bit;
+		}
+
+		if (serial_dev_write(&((ardulink_ctx_t*)dev)->serial, buf, n * 2) == -1)
+			return -errno;
+
+		if (serial_dev_read(&((ardulink_ctx_t*)dev)->serial, buf, n * 4) == -1)
+			return -errno;
+		InternalCountRoundTrip(dev);
+
+		for (i = 0; i < n; i++) {
+			uint8_t * b = buf + i * 4;
+			*(commandresp++) = (uint32_t)b[0] | (uint32_t)b[1] << 8 | \
+				(uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+		}
+		count -= n;
+	}
+	return 0;
+}
+
+// Same idea for a mixed list of register accesses.  Send as many as fit in
+// 64 bytes, then collect the replies ('+' for a write, 4 bytes for a read).
+int ArdulinkExecuteDMIQueue(void * dev, struct DMIOp * ops, int count)
+{
+	uint8_t cmd[64];
+	uint8_t reply[64];
+	int i = 0;
+	while (i < count) {
+		int first = i;
+		int clen = 0;
+		int rlen = 0;
+		while (i < count) {
+			struct DMIOp * op = &ops[i];
+			if (clen + (op->is_read ? 2 : 6) > sizeof(cmd) || rlen + (op->is_read ? 4 : 1) > sizeof(reply))
+				break;
+			cmd[clen++] = op->is_read ? 'r' : 'w';
+			cmd[clen++] = op->reg_7_bit;
+			if (op->is_read) {
+				rlen += 4;
+			} else {
+				cmd[clen++] = op->value & 0xff;
+				cmd[clen++] = (op->value >> 8) & 0xff;
+				cmd[clen++] = (op->value >> 16) & 0xff;
+				cmd[clen++] = (op->value >> 24) & 0xff;
+				rlen += 1;
+			}
+			i++;
+		}
+
+		if (serial_dev_write(&((ardulink_ctx_t*)dev)->serial, cmd, clen) == -1)
+			return -errno;
+
+		if (serial_dev_read(&((ardulink_ctx_t*)dev)->serial, reply, rlen) == -1)
+			return -errno;
+		InternalCountRoundTrip(dev);
+
+		uint8_t * r = reply;
+		for (; first < i; first++) {
+			if (ops[first].is_read) {
+				*ops[first].result = (uint32_t)r[0] | (uint32_t)r[1] << 8 | \
+					(uint32_t)r[2] << 16 | (uint32_t)r[3] << 24;
+				r += 4;
+			} else {
+				if (*r != '+')
+					return -71; // EPROTO
+				r++;
+			}
+		}
+	}
+	return 0;
+}
+
 int ArdulinkFlushLLCommands(void * dev)
 {
 	return 0;
@@ -103,7 +189,7 @@ int ArdulinkSetupInterface( void * dev )
 {
 	char first;
 	// Let the bootloader do its thing.
-	MCF.DelayUS(dev, 3UL*1000UL*1000UL);
+	MCF( dev ).DelayUS(dev, 3UL*1000UL*1000UL);
 
 	serial_dev_write(&((ardulink_ctx_t*)dev)->serial, "?", 1);
 
@@ -121,7 +207,7 @@ int ArdulinkSetupInterface( void * dev )
 	return DefaultSetupInterface( dev );
 }
 
-void * TryInit_Ardulink(const init_hints_t* hints)
+void * TryInit_Ardulink(struct MiniChlinkFunctions * mcf, const init_hints_t* hints)
 {
 	ardulink_ctx_t *ctx;
 
@@ -167,13 +253,15 @@ void * TryInit_Ardulink(const init_hints_t* hints)
 
 	fprintf(stderr, "Ardulink: synced.\n");
 
-	MCF.WriteReg32 = ArdulinkWriteReg32;
-	MCF.ReadReg32 = ArdulinkReadReg32;
-	MCF.FlushLLCommands = ArdulinkFlushLLCommands;
-	MCF.Control3v3 = ArdulinkControl3v3;
-	MCF.DelayUS = ArdulinkDelayUS;
-	MCF.Exit = ArdulinkExit;
-	MCF.SetupInterface = ArdulinkSetupInterface;
+	mcf->WriteReg32 = ArdulinkWriteReg32;
+	mcf->ReadReg32 = ArdulinkReadReg32;
+	mcf->ReadReg32Multi = ArdulinkReadReg32Multi;
+	mcf->ExecuteDMIQueue = ArdulinkExecuteDMIQueue;
+	mcf->FlushLLCommands = ArdulinkFlushLLCommands;
+	mcf->Control3v3 = ArdulinkControl3v3;
+	mcf->DelayUS = ArdulinkDelayUS;
+	mcf->Exit = ArdulinkExit;
+	mcf->SetupInterface = ArdulinkSetupInterface;
 
 	return ctx;
 }
@@ -49,7 +49,7 @@ int CH5xxSetClock(void * dev, uint32_t clock) {
 	if (iss->debugger) return 0;
 	if (clock == 0) {
 		uint32_t rr = 0;
-		MCF.ReadWord(dev, 0x40001008, &rr);
+		MCF( dev ).ReadWord(dev, 0x40001008, &rr);
 #if DEBUG_CH5xx_MINICHLINK
 		fprintf(stderr, "Setting clock, current = %08x\n", rr);
 #endif
@@ -77,8 +77,8 @@ int CH5xxSetClock(void * dev, uint32_t clock) {
 				ch5xx_write_safe(dev, 0x40001008, 0x5e, 0); // 20MHz
 				// ch5xx_write_safe(dev, 0x40001008, 0x48, 0); // 75MHz
 				// Disable watchdog
-				MCF.WriteWord(dev, 0x40001000, 0x5555);
-				MCF.WriteWord(dev, 0x40001004, 0x7fff);
+				MCF( dev ).WriteWord(dev, 0x40001000, 0x5555);
+				MCF( dev ).WriteWord(dev, 0x40001004, 0x7fff);
 			} else {
 				return 0;
 			}
@@ -107,41 +107,41 @@ void ch5xx_write_safe(void * dev, uint32_t addr, uint32_t value, uint8_t mode) {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 	
 	if ((iss->statetag & 0xFFFF00FF) != (STTAG( "5WWS" ) &0xFFFF00FF)) {
-		MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-
-		MCF.WriteReg32(dev, DMDATA0, 0x40001040);
-		MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
-		MCF.WriteReg32(dev, DMDATA0, 0x57);
-		MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100e); // Write a4 from DATA0.
-		MCF.WriteReg32(dev, DMDATA0, 0xa8);
-		MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100f); // Write a5 from DATA0.
-
-		MCF.WriteReg32(dev, DMPROGBUF0, 0x00e68023); // sb  a4,0x0(a3)
-		MCF.WriteReg32(dev, DMPROGBUF1, 0x00f68023); // sb  a5,0x0(a3)
-		MCF.WriteReg32(dev, DMPROGBUF2, 0x00010001); // c.nop c.nop
-		MCF.WriteReg32(dev, DMPROGBUF4, 0x00100073); // c.ebreak	
+		MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+
+		MCF( dev ).WriteReg32(dev, DMDATA0, 0x40001040);
+		MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
+		MCF( dev ).WriteReg32(dev, DMDATA0, 0x57);
+		MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100e); // Write a4 from DATA0.
+		MCF( dev ).WriteReg32(dev, DMDATA0, 0xa8);
+		MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100f); // Write a5 from DATA0.
+
+		MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x00e68023); // sb  a4,0x0(a3)
+		MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0x00f68023); // sb  a5,0x0(a3)
+		MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0x00010001); // c.nop c.nop
+		MCF( dev ).WriteReg32(dev, DMPROGBUF4, 0x00100073); // c.ebreak	
 	}
 
 	if (mode == 0 && iss->statetag != STTAG( "5WBS" )) {
-		MCF.WriteReg32(dev, DMPROGBUF3, 0x00c28023); // sb  a2,0x0(t0)
+		MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0x00c28023); // sb  a2,0x0(t0)
 		iss->statetag = STTAG( "5WBS" );
 	} else if (mode == 1 && iss->statetag != STTAG( "5WHS" )) {
-		MCF.WriteReg32(dev, DMPROGBUF3, 0x00c29023); // sh  a2,0x0(t0)  
+		MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0x00c29023); // sh  a2,0x0(t0)  
 		iss->statetag = STTAG( "5WHS" );
 	} else if (mode == 2 && iss->statetag != STTAG( "5WBS" )) {
-		MCF.WriteReg32(dev, DMPROGBUF3, 0x00c2a023); // sw  a2,0x0(t0)  
+		MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0x00c2a023); // sw  a2,0x0(t0)  
 		iss->statetag = STTAG( "5WWS" );
 	}
 
-	MCF.WriteReg32(dev, DMDATA0, addr);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x1005); // Write t0 from DATA0.
-	MCF.WriteReg32(dev, DMDATA0, value);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100c); // Write a2 from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, addr);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x1005); // Write t0 from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, value);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100c); // Write a2 from DATA0.
 
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
 
 	int ret = 0;
-	ret |= MCF.WaitForDoneOp(dev, 1);
+	ret |= MCF( dev ).WaitForDoneOp(dev, 1);
 	iss->currentstateval = -1;
 
 	if(ret) fprintf(stderr, "Fault on ch5xx_write_safe\n");
@@ -152,21 +152,21 @@ uint8_t ch5xx_flash_begin(void * dev, uint8_t cmd) {
 
 	if (iss->statetag != STTAG("FBEG")) {
 		if ((iss->statetag & 0xff) != 'F') {
-			MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-			MCF.WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
-			MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
+			MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+			MCF( dev ).WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
+			MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
 		}
-		MCF.WriteReg32(dev, DMPROGBUF0, 0x00068323); // sb zero,6(a3);
-		MCF.WriteReg32(dev, DMPROGBUF1, 0x00014715); // c.li a4,5; c.nop;
-		MCF.WriteReg32(dev, DMPROGBUF2, 0x00e68323); // sb a4,6(a3);
-		MCF.WriteReg32(dev, DMPROGBUF3, 0x00f68223); // sb a5,4(a3);
-		MCF.WriteReg32(dev, DMPROGBUF4, 0x00100073); // c.ebreak
+		MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x00068323); // sb zero,6(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0x00014715); // c.li a4,5; c.nop;
+		MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0x00e68323); // sb a4,6(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0x00f68223); // sb a5,4(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF4, 0x00100073); // c.ebreak
 
 		iss->statetag = STTAG("FBEG");  
 	}
 
-	MCF.WriteReg32(dev, DMDATA0, cmd); // Write command to a5
-	MCF.WriteReg32(dev, DMCOMMAND, 0x0027100f); // Execute program.
+	MCF( dev ).WriteReg32(dev, DMDATA0, cmd); // Write command to a5
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x0027100f); // Execute program.
 	
 	return cmd;
 }
@@ -176,19 +176,19 @@ void ch5xx_flash_end(void * dev) {
 
 	if (iss->statetag != STTAG("FEND")) {
 		if ((iss->statetag & 0xff) != 'F') {
-			MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-			MCF.WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
-			MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
+			MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+			MCF( dev ).WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
+			MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
 		}
-		MCF.WriteReg32(dev, DMPROGBUF0, 0x00668703); // lb a4,6(a3);
-		MCF.WriteReg32(dev, DMPROGBUF1, 0xfe074ee3); // blt a4,zero,-4;
-		MCF.WriteReg32(dev, DMPROGBUF2, 0x00068323); // sb zero,6(a3);
-		MCF.WriteReg32(dev, DMPROGBUF3, 0x00100073); // c.ebreak
+		MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x00668703); // lb a4,6(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0xfe074ee3); // blt a4,zero,-4;
+		MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0x00068323); // sb zero,6(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0x00100073); // c.ebreak
 
 		iss->statetag = STTAG("FEND");  
 	}
 
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
 }
 
 void ch5xx_flash_out(void * dev, uint8_t val)
@@ -197,20 +197,20 @@ void ch5xx_flash_out(void * dev, uint8_t val)
 
 	if (iss->statetag != STTAG("FOUT")) {
 		if ((iss->statetag & 0xff) != 'F') {
-			MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-			MCF.WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
-			MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
+			MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+			MCF( dev ).WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
+			MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
 		}
-		MCF.WriteReg32(dev, DMPROGBUF0, 0x00668703); // lb a4,6(a3);
-		MCF.WriteReg32(dev, DMPROGBUF1, 0xfe074ee3); // blt a4,zero,-4;
-		MCF.WriteReg32(dev, DMPROGBUF2, 0x00f68223); // sb a5,4(a3);
-		MCF.WriteReg32(dev, DMPROGBUF3, 0x00100073); // c.ebreak
+		MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x00668703); // lb a4,6(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0xfe074ee3); // blt a4,zero,-4;
+		MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0x00f68223); // sb a5,4(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0x00100073); // c.ebreak
 
 		iss->statetag = STTAG("FOUT");  
 	}
 
-	MCF.WriteReg32(dev, DMDATA0, val); // Write command to a4
-	MCF.WriteReg32(dev, DMCOMMAND, 0x0027100f); // Execute program.
+	MCF( dev ).WriteReg32(dev, DMDATA0, val); // Write command to a4
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x0027100f); // Execute program.
 	
 }
 
@@ -221,26 +221,26 @@ uint8_t ch5xx_flash_in(void * dev)
 
 	if (iss->statetag != STTAG("FLIN")) {
 		if ((iss->statetag & 0xff) != 'F') {
-			MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-			MCF.WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
-			MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
+			MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+			MCF( dev ).WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
+			MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
 		}
-		MCF.WriteReg32(dev, DMPROGBUF0, 0x00668703); // lb a4,6(a3);
-		MCF.WriteReg32(dev, DMPROGBUF1, 0xfe074ee3); // blt a4,zero,-4;
-		MCF.WriteReg32(dev, DMPROGBUF2, 0x00468783); // lb a5,4(a3);
-		MCF.WriteReg32(dev, DMPROGBUF3, 0x00100073); // c.ebreak
+		MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x00668703); // lb a4,6(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0xfe074ee3); // blt a4,zero,-4;
+		MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0x00468783); // lb a5,4(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0x00100073); // c.ebreak
 
 		iss->statetag = STTAG( "FLIN" );  
 	}
 
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
 	
-	r = MCF.WaitForDoneOp(dev, 0);
+	r = MCF( dev ).WaitForDoneOp(dev, 0);
 	if (r) return 0;
 
 	uint32_t rr;
-	MCF.WriteReg32(dev, DMCOMMAND, 0x0022100f); // Read a5 into DATA0.
-	MCF.ReadReg32(dev, DMDATA0, &rr);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x0022100f); // Read a5 into DATA0.
+	MCF( dev ).ReadReg32(dev, DMDATA0, &rr);
 	r = rr & 0xff;
 	
 	return r;
@@ -268,14 +268,14 @@ uint8_t ch5xx_flash_open(void* dev, uint8_t op) {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 
 	uint8_t glob_rom_cfg;
-	MCF.ReadByte(dev, 0x40001044, &glob_rom_cfg);
+	MCF( dev ).ReadByte(dev, 0x40001044, &glob_rom_cfg);
 	// fprintf(stderr, "RS = %02x, op = %02x\n", glob_rom_cfg, op);
 	if ((glob_rom_cfg & 0xe0) != op) {
 		ch5xx_write_safe(dev, 0x40001044, op, 0);
-		MCF.ReadByte(dev, 0x40001044, &glob_rom_cfg);
+		MCF( dev ).ReadByte(dev, 0x40001044, &glob_rom_cfg);
 		// fprintf(stderr, "RS = %02x\n", glob_rom_cfg);
 	}
-	MCF.WriteByte(dev, 0x40001806, 4);
+	MCF( dev ).WriteByte(dev, 0x40001806, 4);
 	if (iss->target_chip_type == CHIP_CH570){
 		ch5xx_flash_begin(dev, 0xff);
 		ch5xx_flash_out(dev, 0xff);
@@ -289,7 +289,7 @@ uint8_t ch5xx_flash_open(void* dev, uint8_t op) {
 
 void ch5xx_flash_close(void* dev) {
 	uint8_t glob_rom_cfg;
-	MCF.ReadByte(dev, 0x40001044, &glob_rom_cfg);
+	MCF( dev ).ReadByte(dev, 0x40001044, &glob_rom_cfg);
 	ch5xx_flash_end(dev);
 	ch5xx_write_safe(dev, 0x40001044, glob_rom_cfg & 0x10, 0);
 }
@@ -308,7 +308,7 @@ uint8_t ch5xx_flash_wait(void* dev) {
 		if ((ret & 1) == 0) {
 			return (ret & 0xff) | 1;
 		}
-		// MCF.DelayUS(dev, 100);
+		// MCF( dev ).DelayUS(dev, 100);
 		timer--;
 	} while (timer != 0);
 	return 0;
@@ -336,31 +336,31 @@ int ch5xx_read_eeprom(void * dev, uint32_t addr, uint8_t* buffer, uint32_t len)
 
 	if (iss->statetag != STTAG("FREP")) {
 		if ((iss->statetag & 0xff) != 'F') {
-			MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-			MCF.WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
-			MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
+			MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+			MCF( dev ).WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
+			MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
 		}
 
-		MCF.WriteReg32(dev, DMPROGBUF0, 0x00668703); // lb a4,6(a3);
-		MCF.WriteReg32(dev, DMPROGBUF1, 0xfe074ee3); // blt a4,zero,-4;
-		MCF.WriteReg32(dev, DMPROGBUF2, 0x00468583); // lb a1,4(a3);
-		MCF.WriteReg32(dev, DMPROGBUF7, 0xfe5ff06f); // jal zero,-28
+		MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x00668703); // lb a4,6(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0xfe074ee3); // blt a4,zero,-4;
+		MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0x00468583); // lb a1,4(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF7, 0xfe5ff06f); // jal zero,-28
 		iss->statetag = STTAG("FREP");
 	}
 	
 	for (int i = 0; i < len; i++) {
 		uint32_t local_buffer = 0;
-		MCF.WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
+		MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
 		do {
-			r = MCF.ReadReg32(dev, DMABSTRACTCS, &rrv);
+			r = MCF( dev ).ReadReg32(dev, DMABSTRACTCS, &rrv);
 			if(r) return r;
 			if (rrv & (0x700)) {
 				fprintf(stderr, "Error in ch5xx_read_eeprom: %08x\n", rrv);
 				return rrv;
 			}
 		} while((rrv & (1<<12)));
-		MCF.WriteReg32(dev, DMCOMMAND, 0x0022100b); // Read a1 into DATA0.
-		MCF.ReadReg32(dev, DMDATA0, &local_buffer);
+		MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x0022100b); // Read a1 into DATA0.
+		MCF( dev ).ReadReg32(dev, DMDATA0, &local_buffer);
 		*(buffer + i) = local_buffer & 0xff;
 	}
 	
@@ -387,32 +387,32 @@ int ch5xx_read_options(void * dev, uint32_t addr, uint8_t* buffer) {
 
 	if (iss->statetag != STTAG("FOPT")) {
 		if ((iss->statetag & 0xff) != 'F') {
-			MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-			MCF.WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
-			MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
+			MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+			MCF( dev ).WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
+			MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
 		}
-		MCF.WriteReg32(dev, DMDATA0, 4);
-		MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100f); // Write a5 from DATA0
-		MCF.WriteReg32(dev, DMDATA0, 8);
-		MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100c); // Write a2 from DATA0
-
-		MCF.WriteReg32(dev, DMPROGBUF0, 0x00668703); // lb a4,6(a3);
-		MCF.WriteReg32(dev, DMPROGBUF1, 0xfe074ee3); // blt a4,zero,-4;
-		MCF.WriteReg32(dev, DMPROGBUF2, 0x00468583); // lb a1,4(a3);
-		MCF.WriteReg32(dev, DMPROGBUF3, 0xc9e3167d); // c.addi a2,-1; blt a5,a2,-14 [0xfec7c9e3]
-		MCF.WriteReg32(dev, DMPROGBUF4, 0xe219fec7); //               c.bnez a2,6
-		MCF.WriteReg32(dev, DMPROGBUF5, 0x9002428c); // c.lw a1,0(a3) c.ebrake 
-		MCF.WriteReg32(dev, DMPROGBUF6, 0x17f14288); // c.lw a0,0(a3) c.addi a5,-4
-		MCF.WriteReg32(dev, DMPROGBUF7, 0xfe5ff06f); // jal zero,-28
+		MCF( dev ).WriteReg32(dev, DMDATA0, 4);
+		MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100f); // Write a5 from DATA0
+		MCF( dev ).WriteReg32(dev, DMDATA0, 8);
+		MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100c); // Write a2 from DATA0
+
+		MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x00668703); // lb a4,6(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0xfe074ee3); // blt a4,zero,-4;
+		MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0x00468583); // lb a1,4(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0xc9e3167d); // c.addi a2,-1; blt a5,a2,-14 [0xfec7c9e3]
+		MCF( dev ).WriteReg32(dev, DMPROGBUF4, 0xe219fec7); //               c.bnez a2,6
+		MCF( dev ).WriteReg32(dev, DMPROGBUF5, 0x9002428c); // c.lw a1,0(a3) c.ebrake 
+		MCF( dev ).WriteReg32(dev, DMPROGBUF6, 0x17f14288); // c.lw a0,0(a3) c.addi a5,-4
+		MCF( dev ).WriteReg32(dev, DMPROGBUF7, 0xfe5ff06f); // jal zero,-28
 		iss->statetag = STTAG("FOPT");
 	}
 	
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
 	
 	uint32_t rrv;
 	int r;
 	do {
-		r = MCF.ReadReg32(dev, DMABSTRACTCS, &rrv);
+		r = MCF( dev ).ReadReg32(dev, DMABSTRACTCS, &rrv);
 		if(r) return r;
 		if (rrv & (0x700)) {
 			fprintf(stderr, "Error in ch5xx_read_options: %08x\n", rrv);
@@ -420,10 +420,10 @@ int ch5xx_read_options(void * dev, uint32_t addr, uint8_t* buffer) {
 		}
 	} while((rrv & (1<<12)));
 	
-	MCF.WriteReg32(dev, DMCOMMAND, 0x0022100a); // Read a0 into DATA0.
-	MCF.ReadReg32(dev, DMDATA0, (uint32_t*)buffer);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x0022100b); // Read a1 into DATA0.
-	MCF.ReadReg32(dev, DMDATA0, (uint32_t*)(buffer+4));
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x0022100a); // Read a0 into DATA0.
+	MCF( dev ).ReadReg32(dev, DMDATA0, (uint32_t*)buffer);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x0022100b); // Read a1 into DATA0.
+	MCF( dev ).ReadReg32(dev, DMDATA0, (uint32_t*)(buffer+4));
 
 	ch5xx_flash_close(dev);
 	return 0;
@@ -438,7 +438,7 @@ int ch5xx_read_options_bulk(void* dev, uint32_t addr, uint8_t* buffer, uint32_t
 	uint32_t dmdata0;
 
 	uint32_t dmdata0_offset = 0xe0000380;
-	MCF.ReadReg32(dev, DMHARTINFO, &dmdata0_offset);
+	MCF( dev ).ReadReg32(dev, DMHARTINFO, &dmdata0_offset);
 	dmdata0_offset = 0xe0000000 | (dmdata0_offset & 0x7ff);
 
 	ch5xx_flash_open(dev, 0x20);
@@ -455,29 +455,29 @@ int ch5xx_read_options_bulk(void* dev, uint32_t addr, uint8_t* buffer, uint32_t
 	
 	if (iss->statetag != STTAG("FOPB") || iss->statetag != STTAG("FVER")) {
 		if ((iss->statetag & 0xff) != 'F') {
-			MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-			MCF.WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
-			MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
+			MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+			MCF( dev ).WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
+			MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
 		}
-		MCF.WriteReg32(dev, DMDATA0, dmdata0_offset);
-		MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100a); // Write a0 from DATA0.
+		MCF( dev ).WriteReg32(dev, DMDATA0, dmdata0_offset);
+		MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100a); // Write a0 from DATA0.
 
-		MCF.WriteReg32(dev, DMPROGBUF0, 0x47910001); // c.nop; li a5,4;
-		MCF.WriteReg32(dev, DMPROGBUF1, 0x00668703); // lb a4,6(a3);
-		MCF.WriteReg32(dev, DMPROGBUF2, 0xfe074ee3); // blt a4,zero,-4;
-		MCF.WriteReg32(dev, DMPROGBUF3, 0x00468703); // lb a4,4(a3);
-		MCF.WriteReg32(dev, DMPROGBUF4, 0xfbed17fd); // c.addi a5,-1; c.bnez a5,-14;
-		MCF.WriteReg32(dev, DMPROGBUF5, 0xc10c428c); // c.lw a1,0(a3); c.sw a1,0,(a0);
-		MCF.WriteReg32(dev, DMPROGBUF6, 0x00100073); // ebreak
+		MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x47910001); // c.nop; li a5,4;
+		MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0x00668703); // lb a4,6(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0xfe074ee3); // blt a4,zero,-4;
+		MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0x00468703); // lb a4,4(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF4, 0xfbed17fd); // c.addi a5,-1; c.bnez a5,-14;
+		MCF( dev ).WriteReg32(dev, DMPROGBUF5, 0xc10c428c); // c.lw a1,0(a3); c.sw a1,0,(a0);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF6, 0x00100073); // ebreak
 
 		iss->statetag = STTAG("FOPB");
 	}
 
 for (int i = 0; i < len; i += 4) {
 		uint8_t timeout = 100;
-		MCF.WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
+		MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
 		do {
-			r = MCF.ReadReg32(dev, DMABSTRACTCS, &dmdata0);
+			r = MCF( dev ).ReadReg32(dev, DMABSTRACTCS, &dmdata0);
 			if(r) return r;
 			if (dmdata0 & (0x700)) {
 				fprintf(stderr, "Error in ch5xx_read_option_bulk: %08x\n", dmdata0);
@@ -485,7 +485,7 @@ for (int i = 0; i < len; i += 4) {
 			}
 			timeout--;
 		} while((dmdata0 & (1<<12)) && timeout);
-		MCF.ReadReg32(dev, DMDATA0, (uint32_t*)(buffer + i));
+		MCF( dev ).ReadReg32(dev, DMDATA0, (uint32_t*)(buffer + i));
 	}
 
 	ch5xx_flash_close(dev);
@@ -495,7 +495,7 @@ for (int i = 0; i < len; i += 4) {
 int ch5xx_read_secret_uuid(void * dev, uint8_t * buffer) {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 	if(!iss->target_chip) {
-		MCF.DetermineChipType(dev);
+		MCF( dev ).DetermineChipType(dev);
 	}
 
 	iss->statetag = STTAG("5SID");
@@ -503,45 +503,45 @@ int ch5xx_read_secret_uuid(void * dev, uint8_t * buffer) {
 	uint8_t local_buffer[8] = {0, 0, 0, 0, 0, 0, 0, 0};
 	
 	uint32_t dmdata0_offset = 0xe0000380;
-	MCF.ReadReg32(dev, DMHARTINFO, &dmdata0_offset);
+	MCF( dev ).ReadReg32(dev, DMHARTINFO, &dmdata0_offset);
 	dmdata0_offset = 0xe0000000 | (dmdata0_offset & 0x7ff);
 
 	ch5xx_flash_open(dev, 0x20);
 	ch5xx_flash_addr(dev, 0x4b, 0);
 	
-	MCF.WriteReg32(dev, DMDATA0, 0xffffffff);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x1005); // Write t0 from DATA0
-	MCF.WriteReg32(dev, DMDATA0, dmdata0_offset);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100a); // Write a0 from DATA0
-	MCF.WriteReg32(dev, DMDATA0, 0xf);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100b); // Write a1 from DATA0
-	MCF.WriteReg32(dev, DMDATA0, 0);
-	MCF.WriteReg32(dev, DMDATA1, 0);
-
-	MCF.WriteReg32(dev, DMPROGBUF0, 0x00668703); // lb a4,6(a3);
-	MCF.WriteReg32(dev, DMPROGBUF1, 0xfe074ee3); // blt a4,zero,-4;
-	MCF.WriteReg32(dev, DMPROGBUF2, 0xf79342d8); // c.lw a4,4(a3); andi a5,a1,0x7;
-	MCF.WriteReg32(dev, DMPROGBUF3, 0x97aa0075); //                c.add a5,a0;
-	MCF.WriteReg32(dev, DMPROGBUF4, 0x00078603); // lb a2,0x0(a5);
-	MCF.WriteReg32(dev, DMPROGBUF5, 0x8f3115fd); // c.addi a1,-1; c.xor a4,a2;
-	MCF.WriteReg32(dev, DMPROGBUF6, 0x00e78023); // sb a4,0(a5);
-	MCF.WriteReg32(dev, DMPROGBUF7, 0x00100073); // c.ebreak
-	// MCF.WriteReg32(dev, DMPROGBUF7, 0xfe5592e3); // bne a1,t0,-28;
-	// MCF.WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0xffffffff);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x1005); // Write t0 from DATA0
+	MCF( dev ).WriteReg32(dev, DMDATA0, dmdata0_offset);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100a); // Write a0 from DATA0
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0xf);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100b); // Write a1 from DATA0
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0);
+	MCF( dev ).WriteReg32(dev, DMDATA1, 0);
+
+	MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x00668703); // lb a4,6(a3);
+	MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0xfe074ee3); // blt a4,zero,-4;
+	MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0xf79342d8); // c.lw a4,4(a3); andi a5,a1,0x7;
+	MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0x97aa0075); //                c.add a5,a0;
+	MCF( dev ).WriteReg32(dev, DMPROGBUF4, 0x00078603); // lb a2,0x0(a5);
+	MCF( dev ).WriteReg32(dev, DMPROGBUF5, 0x8f3115fd); // c.addi a1,-1; c.xor a4,a2;
+	MCF( dev ).WriteReg32(dev, DMPROGBUF6, 0x00e78023); // sb a4,0(a5);
+	MCF( dev ).WriteReg32(dev, DMPROGBUF7, 0x00100073); // c.ebreak
+	// MCF( dev ).WriteReg32(dev, DMPROGBUF7, 0xfe5592e3); // bne a1,t0,-28;
+	// MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
 	uint32_t rrv;
 	int r;
 	for (int i = 0xf; i > -1; i--) {
-		MCF.WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
+		MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
 		do {
-			r = MCF.ReadReg32(dev, DMABSTRACTCS, &rrv);
+			r = MCF( dev ).ReadReg32(dev, DMABSTRACTCS, &rrv);
 			if(r) return r;
 			if (rrv & (0x700)) {
-				MCF.WriteReg32(dev, DMABSTRACTCS, 0x08000700); // Clear out any dmabstractcs errors.
+				MCF( dev ).WriteReg32(dev, DMABSTRACTCS, 0x08000700); // Clear out any dmabstractcs errors.
 			}
 		} while((rrv & (1<<12)));
 	}
-	MCF.ReadReg32(dev, DMDATA0, (uint32_t*)local_buffer);
-	MCF.ReadReg32(dev, DMDATA1, (uint32_t*)(local_buffer+4));
+	MCF( dev ).ReadReg32(dev, DMDATA0, (uint32_t*)local_buffer);
+	MCF( dev ).ReadReg32(dev, DMDATA1, (uint32_t*)(local_buffer+4));
 
 	*((uint32_t*)buffer) = local_buffer[3]<<24|local_buffer[2]<<16|local_buffer[1]<<8|local_buffer[0];
 	*(((uint32_t*)buffer)+1) = local_buffer[7]<<24|local_buffer[6]<<16|local_buffer[5]<<8|local_buffer[4];
@@ -558,7 +558,7 @@ int CH5xxReadUUID(void * dev, uint8_t * buffer) {
 
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 	if(!iss->target_chip) {
-		MCF.DetermineChipType(dev);
+		MCF( dev ).DetermineChipType(dev);
 	}
 
 	enum RiscVChip chip = iss->target_chip_type;
@@ -568,12 +568,12 @@ int CH5xxReadUUID(void * dev, uint8_t * buffer) {
 		addr = 0x3F018;
 	}
 
-	int r = MCF.ReadWord(dev, addr, (uint32_t*)(buffer));
+	int r = MCF( dev ).ReadWord(dev, addr, (uint32_t*)(buffer));
 	if (r) {
 		fprintf(stderr, "Error reading UUID\n");
 		return r;
 	}
-	r = MCF.ReadWord(dev, addr+4, (uint32_t*)(buffer+4));
+	r = MCF( dev ).ReadWord(dev, addr+4, (uint32_t*)(buffer+4));
 	if (r) {
 		fprintf(stderr, "Error reading UUID\n");
 		return r;
@@ -587,7 +587,7 @@ int CH5xxReadUUID(void * dev, uint8_t * buffer) {
 int CH5xxReadUUID_old(void * dev, uint8_t * buffer) {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 	if(!iss->target_chip) {
-		MCF.DetermineChipType(dev);
+		MCF( dev ).DetermineChipType(dev);
 	}
 
 	iss->statetag = STTAG("5UID");
@@ -607,26 +607,26 @@ int CH5xxReadUUID_old(void * dev, uint8_t * buffer) {
 		ch5xx_flash_addr(dev, 0xb, (0x3F018 | 0x40000));
 	}
 	
-	MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-	MCF.WriteReg32(dev, DMDATA0, 4);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100f); // Write a5 from DATA0
-	MCF.WriteReg32(dev, DMDATA0, 8);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100c); // Write a2 from DATA0
-
-	MCF.WriteReg32(dev, DMPROGBUF0, 0x00668703); // lb a4,6(a3);
-	MCF.WriteReg32(dev, DMPROGBUF1, 0xfe074ee3); // blt a4,zero,-4;
-	MCF.WriteReg32(dev, DMPROGBUF2, 0x00468583); // lb a1,4(a3);
-	MCF.WriteReg32(dev, DMPROGBUF3, 0xc9e3167d); // c.addi a2,-1; blt a5,a2,-14 [0xfec7c9e3]
-	MCF.WriteReg32(dev, DMPROGBUF4, 0xe219fec7); //               c.bnez a2,6
-	MCF.WriteReg32(dev, DMPROGBUF5, 0x9002428c); // c.lw a1,0(a3) c.ebrake 
-	MCF.WriteReg32(dev, DMPROGBUF6, 0x17f14288); // c.lw a0,0(a3) c.addi a5,-4
-	MCF.WriteReg32(dev, DMPROGBUF7, 0xfe5ff06f); // jal zero,-28
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
+	MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+	MCF( dev ).WriteReg32(dev, DMDATA0, 4);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100f); // Write a5 from DATA0
+	MCF( dev ).WriteReg32(dev, DMDATA0, 8);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100c); // Write a2 from DATA0
+
+	MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x00668703); // lb a4,6(a3);
+	MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0xfe074ee3); // blt a4,zero,-4;
+	MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0x00468583); // lb a1,4(a3);
+	MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0xc9e3167d); // c.addi a2,-1; blt a5,a2,-14 [0xfec7c9e3]
+	MCF( dev ).WriteReg32(dev, DMPROGBUF4, 0xe219fec7); //               c.bnez a2,6
+	MCF( dev ).WriteReg32(dev, DMPROGBUF5, 0x9002428c); // c.lw a1,0(a3) c.ebrake 
+	MCF( dev ).WriteReg32(dev, DMPROGBUF6, 0x17f14288); // c.lw a0,0(a3) c.addi a5,-4
+	MCF( dev ).WriteReg32(dev, DMPROGBUF7, 0xfe5ff06f); // jal zero,-28
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
 	
 	uint32_t rrv;
 	int r;
 	do {
-		r = MCF.ReadReg32(dev, DMABSTRACTCS, &rrv);
+		r = MCF( dev ).ReadReg32(dev, DMABSTRACTCS, &rrv);
 		if(r) return r;
 		if (rrv & (0x700)) {
 			fprintf(stderr, "Error in CH5xxReadUUID: %08x\n", rrv);
@@ -634,10 +634,10 @@ int CH5xxReadUUID_old(void * dev, uint8_t * buffer) {
 		}
 	} while((rrv & (1<<12)));
 	
-	MCF.WriteReg32(dev, DMCOMMAND, 0x0022100a); // Read a0 into DATA0.
-	MCF.ReadReg32(dev, DMDATA0, (uint32_t*)local_buffer);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x0022100b); // Read a1 into DATA0.
-	MCF.ReadReg32(dev, DMDATA0, (uint32_t*)(local_buffer+4));
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x0022100a); // Read a0 into DATA0.
+	MCF( dev ).ReadReg32(dev, DMDATA0, (uint32_t*)local_buffer);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x0022100b); // Read a1 into DATA0.
+	MCF( dev ).ReadReg32(dev, DMDATA0, (uint32_t*)(local_buffer+4));
 	
 	uint16_t temp = (local_buffer[0]|(local_buffer[1]<<8)) + (local_buffer[2]|(local_buffer[3]<<8)) + (local_buffer[4]|(local_buffer[5]<<8));
 		local_buffer[6] = temp&0xFF;
@@ -662,54 +662,54 @@ int ch5xx_write_flash_using_microblob2(void * dev, uint32_t start_addr, uint8_t*
 	uint32_t dmdata0;
 	uint32_t data_to_write = 0x00000001;
 	uint32_t dmdata0_offset = 0xe0000380;
-	MCF.ReadReg32(dev, DMHARTINFO, &dmdata0_offset);
+	MCF( dev ).ReadReg32(dev, DMHARTINFO, &dmdata0_offset);
 	dmdata0_offset = 0xe0000000 | (dmdata0_offset & 0x7ff);
 	
 	if (iss->lastwriteflags != 100) {
 		for (int i = 0; i < ch5xx_write_block_bin_len; i+=4) {
-		MCF.WriteWord(dev, iss->target_chip->ram_base+i, *((uint32_t*)(ch5xx_write_block_bin + i)));
+		MCF( dev ).WriteWord(dev, iss->target_chip->ram_base+i, *((uint32_t*)(ch5xx_write_block_bin + i)));
 		// fprintf(stderr, "i= %i, data = %08x\n", i, *((uint32_t*)(ch5xx_write_block_bin + i)));
 		}
 		iss->lastwriteflags = 100; // This will indicate that we already have suitable microblob in RAM
 	}
 
-	// MCF.WriteReg32( dev, DMSHDWCFGR, 0x5aa50000 | (1<<10) ); // Shadow Config Reg
-	// MCF.WriteReg32( dev, DMCFGR, 0x5aa50000 | (1<<10) ); // CFGR (1<<10 == Allow output from slave)
+	// MCF( dev ).WriteReg32( dev, DMSHDWCFGR, 0x5aa50000 | (1<<10) ); // Shadow Config Reg
+	// MCF( dev ).WriteReg32( dev, DMCFGR, 0x5aa50000 | (1<<10) ); // CFGR (1<<10 == Allow output from slave)
 
 	ch5xx_flash_open(dev, 0xe0);
 
 	if ((iss->statetag & 0xff) != 'F') {
-		MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-		MCF.WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
-		MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
+		MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+		MCF( dev ).WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
+		MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
 	}
-	MCF.WriteReg32(dev, DMDATA0, dmdata0_offset); // DMDATA0 offset
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100b); // Write a1 from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, dmdata0_offset); // DMDATA0 offset
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100b); // Write a1 from DATA0.
 	
-	MCF.WriteReg32(dev, DMDATA0, start_addr);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x1006); // Write t1 from DATA0.
-
-	MCF.WriteReg32(dev, DMDATA0, 0x000090c3); 
-	MCF.WriteReg32(dev, DMCOMMAND, 0x002307b0);
-	MCF.WriteReg32(dev, DMDATA0, 0); 
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230300); // Clear mstatus
-	MCF.WriteReg32(dev, DMDATA0, iss->target_chip->ram_base); 
-	MCF.WriteReg32(dev, DMCOMMAND, 0x002307b1); // Write dpc from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, start_addr);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x1006); // Write t1 from DATA0.
+
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0x000090c3); 
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x002307b0);
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0); 
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230300); // Clear mstatus
+	MCF( dev ).WriteReg32(dev, DMDATA0, iss->target_chip->ram_base); 
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x002307b1); // Write dpc from DATA0.
 	
-	MCF.WriteReg32(dev, DMDATA1, 1);
-	MCF.WriteReg32(dev, DMCONTROL, 0x40000001);
-	if (iss->target_chip_type == CHIP_CH570 || iss->target_chip_type == CHIP_CH585) MCF.WriteReg32(dev, DMCONTROL, 0x40000001);
+	MCF( dev ).WriteReg32(dev, DMDATA1, 1);
+	MCF( dev ).WriteReg32(dev, DMCONTROL, 0x40000001);
+	if (iss->target_chip_type == CHIP_CH570 || iss->target_chip_type == CHIP_CH585) MCF( dev ).WriteReg32(dev, DMCONTROL, 0x40000001);
 
-	MCF.WriteReg32(dev, DMDATA0, 0);
-	MCF.WriteReg32(dev, DMDATA1, 0);
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0);
+	MCF( dev ).WriteReg32(dev, DMDATA1, 0);
 	uint32_t byte = 0;
 	while(byte < len) {
 		uint32_t current_word;
 		if (!data) current_word = data_to_write++; // For testing purposes fill memory with incrementing words
 		else current_word = *((uint32_t*)(data+byte));
 
-		if (current_word) MCF.WriteReg32( dev, DMDATA0, current_word);
-		else MCF.WriteReg32( dev, DMDATA1, 2);
+		if (current_word) MCF( dev ).WriteReg32( dev, DMDATA0, current_word);
+		else MCF( dev ).WriteReg32( dev, DMDATA1, 2);
 		byte += 4;
 		// Wait every block to be written to flash it takes ~1.5-2ms.
 		// Previously we were waiting for new address in DMDATA0, but it would fail sometimes
@@ -722,17 +722,17 @@ int ch5xx_write_flash_using_microblob2(void * dev, uint32_t start_addr, uint8_t*
 					r = -1;
 					goto write_end;
 				}
-				MCF.ReadReg32(dev, DMDATA0, &dmdata0);
+				MCF( dev ).ReadReg32(dev, DMDATA0, &dmdata0);
 			} while(dmdata0);
 			timer = 0;
 			fprintf(stderr, ".");
 		}
 	}
 	r = 0;
-	MCF.WriteReg32(dev, DMDATA1, dmdata0_offset); // Signal to microblob that we're done writing
-	MCF.DelayUS(dev,10000);
+	MCF( dev ).WriteReg32(dev, DMDATA1, dmdata0_offset); // Signal to microblob that we're done writing
+	MCF( dev ).DelayUS(dev,10000);
 write_end:
-	MCF.WriteReg32(dev, DMCONTROL, 0x80000001);
+	MCF( dev ).WriteReg32(dev, DMCONTROL, 0x80000001);
 	ch5xx_flash_close(dev);
 	
 	return r;
@@ -757,20 +757,20 @@ int ch5xx_write_flash(void * dev, uint32_t start_addr, uint8_t* data, uint32_t l
 
 		if (iss->statetag != STTAG("FWRT")) {
 			if ((iss->statetag & 0xff) != 'F') {
-				MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-				MCF.WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
-				MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
+				MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+				MCF( dev ).WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
+				MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
 			}
 			
-			MCF.WriteReg32(dev, DMDATA0, 21);
-			MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x1005); // Write t0 from DATA0.
+			MCF( dev ).WriteReg32(dev, DMDATA0, 21);
+			MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x1005); // Write t0 from DATA0.
 			
-			MCF.WriteReg32(dev, DMPROGBUF0, 0x4791c298); // c.sw a4,0(a3); c.li a5,0x4;
-			MCF.WriteReg32(dev, DMPROGBUF1, 0x00668703); // lb a4,6(a3);
-			MCF.WriteReg32(dev, DMPROGBUF2, 0xfe074ee3); // blt a4,zero,-4;
-			MCF.WriteReg32(dev, DMPROGBUF3, 0x00568323); // sb t0,6(a3);
-			MCF.WriteReg32(dev, DMPROGBUF4, 0xfbed17fd); // c.addi a5,-1; c.bnez a5,-14;
-			MCF.WriteReg32(dev, DMPROGBUF5, 0x00100073); // c.ebreak
+			MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x4791c298); // c.sw a4,0(a3); c.li a5,0x4;
+			MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0x00668703); // lb a4,6(a3);
+			MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0xfe074ee3); // blt a4,zero,-4;
+			MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0x00568323); // sb t0,6(a3);
+			MCF( dev ).WriteReg32(dev, DMPROGBUF4, 0xfbed17fd); // c.addi a5,-1; c.bnez a5,-14;
+			MCF( dev ).WriteReg32(dev, DMPROGBUF5, 0x00100073); // c.ebreak
 			iss->statetag = STTAG("FWRT");
 		}
 		
@@ -779,13 +779,13 @@ int ch5xx_write_flash(void * dev, uint32_t start_addr, uint8_t* data, uint32_t l
 		uint32_t block = len>256?256:len;
 		
 		for (uint32_t i = 0; i < block/4; i++) {
-			MCF.WriteReg32(dev, DMDATA0, *((uint32_t*)(data+position)));
-			// MCF.WriteReg32( dev, DMDATA0, data_to_write );
+			MCF( dev ).WriteReg32(dev, DMDATA0, *((uint32_t*)(data+position)));
+			// MCF( dev ).WriteReg32( dev, DMDATA0, data_to_write );
 			// data_to_write++;
-			MCF.WriteReg32(dev, DMCOMMAND, 0x0027100e); // Write a4 and execute.
+			MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x0027100e); // Write a4 and execute.
 			
 			do {
-				r = MCF.ReadReg32(dev, DMABSTRACTCS, &rrv);
+				r = MCF( dev ).ReadReg32(dev, DMABSTRACTCS, &rrv);
 				if(r) return r;
 				if (rrv & (0x700)) {
 					fprintf(stderr, "Error: %08x\n", rrv);
@@ -811,22 +811,22 @@ void ch570_write_word_special(void * dev, uint32_t address, uint32_t word) {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 	
 	iss->statetag = STTAG("XXXX");
-	MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
-
-	MCF.WriteReg32( dev, DMPROGBUF0, 0x7b251073 ); // 
-	MCF.WriteReg32( dev, DMPROGBUF1, 0x7b359073 ); // 
-	MCF.WriteReg32( dev, DMPROGBUF2, 0xe0000537 ); // 
-	MCF.WriteReg32( dev, DMPROGBUF3, 0x0f852583 ); // 
-	MCF.WriteReg32( dev, DMPROGBUF4, 0x0f452503 ); // 
-	MCF.WriteReg32( dev, DMPROGBUF5, 0x2573c188 ); // 
-	MCF.WriteReg32( dev, DMPROGBUF6, 0x25f37b20 ); // 
-	MCF.WriteReg32( dev, DMPROGBUF7, 0x90027b30 ); // 
-
-	MCF.WriteReg32( dev, DMDATA0, word ); //R32_PA_DIR
-	MCF.WriteReg32( dev, DMDATA1, address ); //R32_PA_DIR
+	MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+
+	MCF( dev ).WriteReg32( dev, DMPROGBUF0, 0x7b251073 ); // 
+	MCF( dev ).WriteReg32( dev, DMPROGBUF1, 0x7b359073 ); // 
+	MCF( dev ).WriteReg32( dev, DMPROGBUF2, 0xe0000537 ); // 
+	MCF( dev ).WriteReg32( dev, DMPROGBUF3, 0x0f852583 ); // 
+	MCF( dev ).WriteReg32( dev, DMPROGBUF4, 0x0f452503 ); // 
+	MCF( dev ).WriteReg32( dev, DMPROGBUF5, 0x2573c188 ); // 
+	MCF( dev ).WriteReg32( dev, DMPROGBUF6, 0x25f37b20 ); // 
+	MCF( dev ).WriteReg32( dev, DMPROGBUF7, 0x90027b30 ); // 
+
+	MCF( dev ).WriteReg32( dev, DMDATA0, word ); //R32_PA_DIR
+	MCF( dev ).WriteReg32( dev, DMDATA1, address ); //R32_PA_DIR
 	
-	MCF.WriteReg32( dev, DMCOMMAND, 0x02210000 ); // Execute.
-	MCF.WaitForDoneOp(dev, 0);
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x02210000 ); // Execute.
+	MCF( dev ).WaitForDoneOp(dev, 0);
 
 }
 
@@ -834,29 +834,29 @@ void ch570_write_word_special(void * dev, uint32_t address, uint32_t word) {
 // Apparently the difference is that it enters "safe mode" permanently until it's closed, or chip is reset.
 void ch570_disable_acauto(void * dev) {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
-	// MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x1005); // Write t0 from DATA0.
+	// MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x1005); // Write t0 from DATA0.
 	
-	MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-
-	MCF.WriteReg32(dev, DMDATA0, 0x40001808);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100b); // Write a1 from DATA0.
-	MCF.WriteReg32(dev, DMDATA0, 0);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100c); // Write a2 from DATA0.
-	MCF.WriteReg32(dev, DMDATA0, 0x40001040);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
-	MCF.WriteReg32(dev, DMDATA0, 0x57);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100e); // Write a4 from DATA0.
-	MCF.WriteReg32(dev, DMDATA0, 0xa8);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100f); // Write a5 from DATA0.
-
-	MCF.WriteReg32(dev, DMPROGBUF0, 0x00c28023); // sb  a2,0x0(t0)
-	MCF.WriteReg32(dev, DMPROGBUF1, 0x00e68023); // sb  a4,0x0(a3)
-	MCF.WriteReg32(dev, DMPROGBUF2, 0x00f68023); // sb  a5,0x0(a3)
+	MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0x40001808);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100b); // Write a1 from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100c); // Write a2 from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0x40001040);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0x57);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100e); // Write a4 from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0xa8);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100f); // Write a5 from DATA0.
+
+	MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x00c28023); // sb  a2,0x0(t0)
+	MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0x00e68023); // sb  a4,0x0(a3)
+	MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0x00f68023); // sb  a5,0x0(a3)
 	
-	MCF.WriteReg32(dev, DMPROGBUF3, 0x00100073); // c.ebreak	
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
+	MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0x00100073); // c.ebreak	
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
 
-	MCF.WaitForDoneOp(dev, 0);
+	MCF( dev ).WaitForDoneOp(dev, 0);
 
 	iss->currentstateval = -1;
 }
@@ -868,11 +868,11 @@ void ch570_disable_acauto(void * dev) {
 void ch570_disable_read_protection(void * dev) {
 	uint8_t options[4];
 
-  MCF.SetClock(dev, 0);
+  MCF( dev ).SetClock(dev, 0);
 	
 	CH5xxErase(dev, 0, 0, 1);
 	ch570_disable_acauto(dev);
-	MCF.WriteWord(dev, 0x40001808, 0x749da58b);
+	MCF( dev ).WriteWord(dev, 0x40001808, 0x749da58b);
 	
 	ch5xx_read_options_bulk(dev, 0x3EFFC, options, 4);
 	printf("Current option bytes - %08x\n", ((uint32_t*)options)[0]);
@@ -897,7 +897,7 @@ int ch5xx_verify_data(void* dev, uint32_t addr, uint8_t* data, uint32_t len) {
 	}
 	
 	uint32_t dmdata0_offset = 0xe0000380;
-	MCF.ReadReg32(dev, DMHARTINFO, &dmdata0_offset);
+	MCF( dev ).ReadReg32(dev, DMHARTINFO, &dmdata0_offset);
 	dmdata0_offset = 0xe0000000 | (dmdata0_offset & 0x7ff);
 
 	ch5xx_flash_open(dev, 0x20);
@@ -906,31 +906,31 @@ int ch5xx_verify_data(void* dev, uint32_t addr, uint8_t* data, uint32_t len) {
 
 	if (iss->statetag != STTAG("FVER")) {
 		if ((iss->statetag & 0xff) != 'F') {
-			MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-			MCF.WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
-			MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
+			MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+			MCF( dev ).WriteReg32(dev, DMDATA0, R32_FLASH_DATA);
+			MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
 		}
-		MCF.WriteReg32(dev, DMDATA0, dmdata0_offset);
-		MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100a); // Write a0 from DATA0.
+		MCF( dev ).WriteReg32(dev, DMDATA0, dmdata0_offset);
+		MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100a); // Write a0 from DATA0.
 
-		MCF.WriteReg32(dev, DMPROGBUF0, 0x47910001); // c.nop; li a5,4;
-		MCF.WriteReg32(dev, DMPROGBUF1, 0x00668703); // lb a4,6(a3);
-		MCF.WriteReg32(dev, DMPROGBUF2, 0xfe074ee3); // blt a4,zero,-4;
-		MCF.WriteReg32(dev, DMPROGBUF3, 0x00468703); // lb a4,4(a3);
-		MCF.WriteReg32(dev, DMPROGBUF4, 0xfbed17fd); // c.addi a5,-1; c.bnez a5,-14;
-		MCF.WriteReg32(dev, DMPROGBUF5, 0xc10c428c); // c.lw a1,0(a3); c.sw a1,0,(a0);
-		MCF.WriteReg32(dev, DMPROGBUF6, 0x00100073); // ebreak
+		MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x47910001); // c.nop; li a5,4;
+		MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0x00668703); // lb a4,6(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0xfe074ee3); // blt a4,zero,-4;
+		MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0x00468703); // lb a4,4(a3);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF4, 0xfbed17fd); // c.addi a5,-1; c.bnez a5,-14;
+		MCF( dev ).WriteReg32(dev, DMPROGBUF5, 0xc10c428c); // c.lw a1,0(a3); c.sw a1,0,(a0);
+		MCF( dev ).WriteReg32(dev, DMPROGBUF6, 0x00100073); // ebreak
 
 		iss->statetag = STTAG("FVER");
 	}
 	
 	for (int i = 0; i < len; i += 4) {
 		uint8_t timeout = 200;
-		MCF.WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
-		MCF.ReadReg32(dev, DMDATA0, &dmdata0);
+		MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
+		MCF( dev ).ReadReg32(dev, DMDATA0, &dmdata0);
 		if (dmdata0 != *((uint32_t*)(data+i))) {
 			do {
-				r = MCF.ReadReg32(dev, DMABSTRACTCS, &dmdata0);
+				r = MCF( dev ).ReadReg32(dev, DMABSTRACTCS, &dmdata0);
 				if(r) return r;
 				if (dmdata0 & (0x700)) {
 					fprintf(stderr, "Error in ch5xx_verify_data: %08x\n", dmdata0);
@@ -938,7 +938,7 @@ int ch5xx_verify_data(void* dev, uint32_t addr, uint8_t* data, uint32_t len) {
 				}
 				timeout--;
 			} while((dmdata0 & (1<<12)) && timeout);
-			MCF.ReadReg32(dev, DMDATA0, &dmdata0);
+			MCF( dev ).ReadReg32(dev, DMDATA0, &dmdata0);
 			if (dmdata0 != *((uint32_t*)(data+i))) {
 				fprintf(stderr, "Verification failed at byte %d. dmdata0 = %08x, data = %08x\n", i, dmdata0, *((uint32_t*)(data+i)));
 				return -1;
@@ -957,7 +957,7 @@ int CH5xxErase(void* dev, uint32_t addr, uint32_t len, int type) {
 	int sector_size = iss->target_chip->sector_size;
 	uint8_t flash_cmd;
 
-	MCF.SetClock(dev, 0);
+	MCF( dev ).SetClock(dev, 0);
 
 	if(type == 1) {
 		// Whole-chip flash
@@ -1032,7 +1032,7 @@ int CH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob_si
 		return -1;
 	}
 
-	MCF.SetClock(dev, 0);
+	MCF( dev ).SetClock(dev, 0);
 	
 	uint32_t sector_size = iss->target_chip->sector_size;
 	if (iss->current_area == RAM_AREA) sector_size = 4;
@@ -1049,7 +1049,7 @@ int CH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob_si
 
 	if (iss->target_chip_type == CHIP_CH570) {
 		uint32_t options;
-		MCF.ReadWord(dev, 0x40001058, &options);
+		MCF( dev ).ReadWord(dev, 0x40001058, &options);
 		if ((options&0x800000) || (options&0x200000)) {
 			printf("Flash is write/read protected. You may need to remove protection using 'minichlink -p'\n"); 
 		}
@@ -1058,7 +1058,7 @@ int CH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob_si
 	if (iss->current_area == PROGRAM_AREA || iss->current_area == BOOTLOADER_AREA) {
 		if (iss->current_area == BOOTLOADER_AREA) {
 			uint8_t info_reg = 0;
-			MCF.ReadByte(dev, R8_GLOB_CFG_INFO, &info_reg);
+			MCF( dev ).ReadByte(dev, R8_GLOB_CFG_INFO, &info_reg);
 			if (!(info_reg & (1<<5))) {
 				fprintf(stderr, "You need to be in bootloader mode to flash to BOOTLOADER partition.\n R8_GLOB_CFG_INFO = %02x\n", info_reg);
 				ret = -2;
@@ -1073,11 +1073,11 @@ int CH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob_si
 		}
 		if (spad) {
 			if (spad + blob_size <= sector_size) {
-				MCF.ReadBinaryBlob(dev, (address_to_write - spad), sector_size, start_pad);
+				MCF( dev ).ReadBinaryBlob(dev, (address_to_write - spad), sector_size, start_pad);
 				memcpy(start_pad + spad, blob, blob_size);
 				epad = 0;
 			} else {
-				MCF.ReadBinaryBlob(dev, (address_to_write - spad), spad, start_pad);
+				MCF( dev ).ReadBinaryBlob(dev, (address_to_write - spad), spad, start_pad);
 				memcpy(start_pad + spad, blob, sector_size - spad);
 			}
 			if (new_blob_size >= sector_size - spad) new_blob_size -= sector_size - spad;
@@ -1085,7 +1085,7 @@ int CH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob_si
 		}
 		if (epad) {
 			if (new_blob_size) memcpy(end_pad, blob + (blob_size - epad), epad);
-			MCF.ReadBinaryBlob(dev, (address_to_write + blob_size), sector_size - epad, end_pad + epad);
+			MCF( dev ).ReadBinaryBlob(dev, (address_to_write + blob_size), sector_size - epad, end_pad + epad);
 			if (new_blob_size >= epad) new_blob_size -= epad;
 			else new_blob_size = 0;
 		}
@@ -1171,7 +1171,7 @@ int CH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob_si
 		if (spad) {
 			ssize = (sector_size - spad);
 			for (int i = 0; i < ssize; i++) {
-				ret = MCF.WriteByte(dev, address_to_write+i, *((uint8_t*)(blob+i)));
+				ret = MCF( dev ).WriteByte(dev, address_to_write+i, *((uint8_t*)(blob+i)));
 				if (ret) {
 					fprintf(stderr, "Error on WriteByte while writing to RAM.\n");
 					goto end;
@@ -1180,7 +1180,7 @@ int CH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob_si
 		}
 		if (new_blob_size >= 4) {
 			for (int i = 0; i < new_blob_size; i += 4) {
-				ret = MCF.WriteWord(dev, address_to_write+ssize+i, *((uint32_t*)(blob+ssize+i)));
+				ret = MCF( dev ).WriteWord(dev, address_to_write+ssize+i, *((uint32_t*)(blob+ssize+i)));
 				if (ret) {
 					fprintf(stderr, "Error on WriteWord while writing to RAM.\n");
 					goto end;
@@ -1190,7 +1190,7 @@ int CH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob_si
 		if (epad) {
 			uint32_t epad_address = address_to_write + blob_size - epad;
 			for (int i = 0; i < spad; i++) {
-				ret = MCF.WriteByte(dev, epad_address + i, *((uint8_t*)(blob + (blob_size - epad) + i)));
+				ret = MCF( dev ).WriteByte(dev, epad_address + i, *((uint8_t*)(blob + (blob_size - epad) + i)));
 				if (ret) {
 					fprintf(stderr, "Error on WriteByte while writing to RAM.\n");
 					goto end;
@@ -1257,35 +1257,35 @@ void CH5xxBlink(void* dev, uint8_t port, uint8_t pin, uint32_t delay) {
 	if(!delay) delay = 500;
 	uint32_t delay_count = 2133 * delay;
 
-	MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+	MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
 	
-	MCF.WriteReg32(dev, DMDATA0, port_reg); //R32_PA_DIR
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100c); // Write a2 from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, port_reg); //R32_PA_DIR
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100c); // Write a2 from DATA0.
 
-	MCF.WriteReg32(dev, DMDATA0, delay_count);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, delay_count);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
 
-	MCF.WriteReg32(dev, DMDATA0, pin_mask );
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100e); // Write a4 from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, pin_mask );
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100e); // Write a4 from DATA0.
 
-	MCF.WriteReg32(dev, DMPROGBUF0, 0x87b6c218); 
-	MCF.WriteReg32(dev, DMPROGBUF1, 0x00062423); 
-	MCF.WriteReg32(dev, DMPROGBUF2, 0xfffd17fd); 
-	MCF.WriteReg32(dev, DMPROGBUF3, 0xc61887b6); 
-	MCF.WriteReg32(dev, DMPROGBUF4, 0xfffd17fd); 
-	MCF.WriteReg32(dev, DMPROGBUF5, 0x0000b7fd); 
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
+	MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x87b6c218); 
+	MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0x00062423); 
+	MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0xfffd17fd); 
+	MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0xc61887b6); 
+	MCF( dev ).WriteReg32(dev, DMPROGBUF4, 0xfffd17fd); 
+	MCF( dev ).WriteReg32(dev, DMPROGBUF5, 0x0000b7fd); 
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
 
 	fprintf(stderr, "Running blink\n");
 	fprintf(stderr, "Press Enter to stop, or Ctrl+C to close and keep blinking\n");
 	
 	do {
 		if(IsKBHit()) break;
-		r = MCF.ReadReg32(dev, DMABSTRACTCS, &rrv);
+		r = MCF( dev ).ReadReg32(dev, DMABSTRACTCS, &rrv);
 		if(r) return;
 	} while((rrv & (1<<12)));
 
-	MCF.WriteReg32(dev, DMCONTROL, 0x80000003);
+	MCF( dev ).WriteReg32(dev, DMCONTROL, 0x80000003);
 }
 
 // Test function that was used during development, will remove it later.
@@ -1296,11 +1296,11 @@ void CH5xxTestPC(void* dev) {
 	uint32_t rr;
 	uint32_t port_reg = 0x400010A0;
 	uint32_t pin_mask = (1 << 8);
-	MCF.WriteReg32( dev, DMCONTROL, 0x80000001 );
-	MCF.WriteReg32( dev, DMCONTROL, 0x80000001 );
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 );
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 );
 	uint32_t delay_count = 2133 * 1000;
 	for (int i = 0; i < ch5xx_blink_bin_len; i+=4) {
-		r = MCF.WriteWord(dev, target_ram+i, *((uint32_t*)(ch5xx_blink_bin + i)));
+		r = MCF( dev ).WriteWord(dev, target_ram+i, *((uint32_t*)(ch5xx_blink_bin + i)));
 		if (r) {
 			fprintf(stderr, "Error writing to RAM at %d\n", i);
 			return;
@@ -1309,7 +1309,7 @@ void CH5xxTestPC(void* dev) {
 	}
 
 	for (int i = 0; i < 256; i+=4) {
-		r = MCF.ReadWord(dev, target_ram+i, &rr);
+		r = MCF( dev ).ReadWord(dev, target_ram+i, &rr);
 		if (r) {
 			fprintf(stderr, "Error reading to RAM at %d\n", i);
 			return;
@@ -1320,87 +1320,87 @@ void CH5xxTestPC(void* dev) {
 	//Set clock to 16MHz
 	ch5xx_write_safe(dev, 0x40001008, 0x82, 0);
 
-	MCF.ReadWord(dev, target_ram, &rr);
+	MCF( dev ).ReadWord(dev, target_ram, &rr);
 	fprintf(stderr, "%08x = %08x\n", target_ram, rr);
 		
 
-	MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+	MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
 
-	MCF.WriteReg32( dev, DMDATA0, port_reg ); //R32_PA_DIR
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00230000 | 0x100c ); // Write a2 from DATA0.
+	MCF( dev ).WriteReg32( dev, DMDATA0, port_reg ); //R32_PA_DIR
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00230000 | 0x100c ); // Write a2 from DATA0.
 
-	MCF.WriteReg32( dev, DMDATA0, delay_count );
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00230000 | 0x100d ); // Write a3 from DATA0.
+	MCF( dev ).WriteReg32( dev, DMDATA0, delay_count );
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00230000 | 0x100d ); // Write a3 from DATA0.
 
-	MCF.WriteReg32( dev, DMDATA0, pin_mask );
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00230000 | 0x100e ); // Write a4 from DATA0.
+	MCF( dev ).WriteReg32( dev, DMDATA0, pin_mask );
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00230000 | 0x100e ); // Write a4 from DATA0.
 
-	// MCF.WriteReg32( dev, DMPROGBUF0, 0x00000797 ); // auipc a5, 0
-	// MCF.WriteReg32( dev, DMPROGBUF0, 0x20000537 ); // lui a0, 0x20000
-	// MCF.WriteReg32( dev, DMPROGBUF2, 0x40f505b3 ); // sub a1, a0, a5
-	// MCF.WriteReg32( dev, DMPROGBUF1, 0x00018502 ); // c.jr a0; c.nop;
-	// MCF.WriteReg32( dev, DMPROGBUF3, 0x40b787b3 ); // sub a5, a5, a1
-	// MCF.WriteReg32( dev, DMPROGBUF3, 0x00058567 ); // jalr a0, 0(a5)
+	// MCF( dev ).WriteReg32( dev, DMPROGBUF0, 0x00000797 ); // auipc a5, 0
+	// MCF( dev ).WriteReg32( dev, DMPROGBUF0, 0x20000537 ); // lui a0, 0x20000
+	// MCF( dev ).WriteReg32( dev, DMPROGBUF2, 0x40f505b3 ); // sub a1, a0, a5
+	// MCF( dev ).WriteReg32( dev, DMPROGBUF1, 0x00018502 ); // c.jr a0; c.nop;
+	// MCF( dev ).WriteReg32( dev, DMPROGBUF3, 0x40b787b3 ); // sub a5, a5, a1
+	// MCF( dev ).WriteReg32( dev, DMPROGBUF3, 0x00058567 ); // jalr a0, 0(a5)
 
-	// MCF.WriteReg32( dev, DMPROGBUF3, 0x00100073 ); // c.ebreak
-	// MCF.WriteReg32( dev, DMCOMMAND, 0x00240000 ); // Execute.
+	// MCF( dev ).WriteReg32( dev, DMPROGBUF3, 0x00100073 ); // c.ebreak
+	// MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00240000 ); // Execute.
 
 
-	// MCF.WriteReg32( dev, DMDATA0, 0x20000000 ); //R32_PA_DIR
-	// MCF.WriteReg32( dev, DMCOMMAND, 0x002707b1 ); // Execute.
+	// MCF( dev ).WriteReg32( dev, DMDATA0, 0x20000000 ); //R32_PA_DIR
+	// MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x002707b1 ); // Execute.
 	
-	MCF.WriteReg32( dev, DMCOMMAND, 0x002207b0 ); // Read dcsr into DATA0.
-	MCF.ReadReg32( dev, DMDATA0, &rr );
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x002207b0 ); // Read dcsr into DATA0.
+	MCF( dev ).ReadReg32( dev, DMDATA0, &rr );
 	fprintf(stderr, "dcsr = %08x\n", rr);
 
-	MCF.WriteReg32( dev, DMDATA0, 0x000090c3 ); 
-	MCF.WriteReg32( dev, DMCOMMAND, 0x002307b0 );
-	MCF.WriteReg32(dev, DMDATA0, target_ram+0x3000); 
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00231002); // write sp
-	MCF.WriteReg32(dev, DMDATA0, 0); 
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00230300); // Clear mstatus
-	MCF.WriteReg32( dev, DMDATA0, target_ram ); 
-	MCF.WriteReg32( dev, DMCOMMAND, 0x002307b1 ); // Execute.
-	MCF.WriteReg32( dev, DMCONTROL, 0x40000001 );
-	// MCF.WriteReg32( dev, DMCOMMAND, 0x00240000 ); // Execute.
-	// MCF.DelayUS(dev, 2000000);
-	// MCF.WriteReg32( dev, DMCONTROL, 0x80000001 );
-	// MCF.WriteReg32( dev, DMCONTROL, 0x80000003 );
-	// MCF.WriteReg32(dev, DMDATA0, 0); 
-	// MCF.WriteReg32( dev, DMCOMMAND, 0x00230300); // Clear mstatus
+	MCF( dev ).WriteReg32( dev, DMDATA0, 0x000090c3 ); 
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x002307b0 );
+	MCF( dev ).WriteReg32(dev, DMDATA0, target_ram+0x3000); 
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00231002); // write sp
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0); 
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00230300); // Clear mstatus
+	MCF( dev ).WriteReg32( dev, DMDATA0, target_ram ); 
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x002307b1 ); // Execute.
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x40000001 );
+	// MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00240000 ); // Execute.
+	// MCF( dev ).DelayUS(dev, 2000000);
+	// MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 );
+	// MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000003 );
+	// MCF( dev ).WriteReg32(dev, DMDATA0, 0); 
+	// MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00230300); // Clear mstatus
 	// uint32_t dmdata0;
 	// do
 	// {
 	//   // if(ReadKBByte()) return 0;
-	// 	MCF.ReadReg32( dev, DMABSTRACTCS, &rr );
+	// 	MCF( dev ).ReadReg32( dev, DMABSTRACTCS, &rr );
 	//   // fprintf( stderr, "DMABSTRACTCS = %08x\n", rr);
 	//   // if (timer > 100) {
-	//   //   MCF.WriteReg32( dev, DMCOMMAND, 0x002207b1); // Read xN into DATA0.
-	//   //   MCF.ReadReg32( dev, DMDATA0, &rrv);
+	//   //   MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x002207b1); // Read xN into DATA0.
+	//   //   MCF( dev ).ReadReg32( dev, DMDATA0, &rrv);
 	//   //   fprintf(stderr, "Timeout at: %08x\n", rrv);
 	//   //   return -10;
 	//   // }
 	//   // timer++;
 	//   // fprintf(stderr, ".");
-	//   // MCF.WriteReg32( dev, DMDATA1, 0x22222222);
+	//   // MCF( dev ).WriteReg32( dev, DMDATA1, 0x22222222);
 	//   // do {
-	//     // MCF.ReadReg32(dev, DMDATA1, &dmdata0);
+	//     // MCF( dev ).ReadReg32(dev, DMDATA1, &dmdata0);
 	//     // fprintf(stderr, "%08x ", dmdata1);
 	//   // } while(dmdata0 == 0x22222222);
-	//   MCF.WriteReg32( dev, DMCOMMAND, 0x20100c); // Read xN into DATA0.
-	//   MCF.ReadReg32( dev, DMDATA0, &dmdata0);
+	//   MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x20100c); // Read xN into DATA0.
+	//   MCF( dev ).ReadReg32( dev, DMDATA0, &dmdata0);
 	//   fprintf(stderr, "%08x\n", dmdata0);
 	// }
 	// while( (rr & (1<<12)) );
 
-	MCF.WriteReg32( dev, DMCOMMAND, 0x0022100f ); // Read a5 into DATA0.
-	MCF.ReadReg32( dev, DMDATA0, &rr );
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x0022100f ); // Read a5 into DATA0.
+	MCF( dev ).ReadReg32( dev, DMDATA0, &rr );
 	fprintf(stderr, "a5 = %08x\n", rr);
-	MCF.WriteReg32( dev, DMCOMMAND, 0x0022100a ); // Read a0 into DATA0.
-	MCF.ReadReg32( dev, DMDATA0, &rr );
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x0022100a ); // Read a0 into DATA0.
+	MCF( dev ).ReadReg32( dev, DMDATA0, &rr );
 	fprintf(stderr, "a0 = %08x\n", rr);
-	MCF.WriteReg32( dev, DMCOMMAND, 0x0022100b ); // Read a1 into DATA0.
-	MCF.ReadReg32( dev, DMDATA0, &rr );
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x0022100b ); // Read a1 into DATA0.
+	MCF( dev ).ReadReg32( dev, DMDATA0, &rr );
 	fprintf(stderr, "a1 = %08x\n", rr);
 }
 
@@ -1409,9 +1409,9 @@ int CH5xxPrintInfo(void* dev) {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 	uint8_t info[8];
 
-	MCF.SetClock(dev, 0);
+	MCF( dev ).SetClock(dev, 0);
 
-	if (MCF.GetUUID(dev, info)) return -1;
+	if (MCF( dev ).GetUUID(dev, info)) return -1;
 	printf("UUID: %02x-%02x-%02x-%02x-%02x-%02x-%02x-%02x\n", info[0], info[1], info[2], info[3], info[4], info[5], info[6], info[7]);
 	printf("BLE MAC: %02x-%02x-%02x-%02x-%02x-%02x\n", info[0], info[1], info[2], info[3], info[4], info[5]);
 	// if (ch5xx_read_secret_uuid(dev, info)) return -1;
@@ -1426,13 +1426,13 @@ int CH5xxPrintInfo(void* dev) {
 	options_address = 0x7EFFC;
 	if (iss->target_chip_type == CHIP_CH570) options_address = 0x3EFFC;
 	// if (ch5xx_read_options(dev, options_address, info)) return -1;
-	MCF.ReadWord(dev, options_address, (uint32_t*)info);
+	MCF( dev ).ReadWord(dev, options_address, (uint32_t*)info);
 	printf("Options bytes: %08x:\n", ((uint32_t*)info)[0]);
 	uint32_t option_bytes = ((uint32_t*)info)[0];
 	if ((option_bytes >> 28) != 4) {
 		printf("Options signature is not valid: %02x\n", (option_bytes >> 28));
 		if (iss->target_chip_type == CHIP_CH570) {
-			MCF.ReadWord(dev, 0x40001058, &option_bytes);
+			MCF( dev ).ReadWord(dev, 0x40001058, &option_bytes);
 			printf("FLASH_HALTED = %d\n", (option_bytes&0x800000)?1:0);
 			printf("MANU_CFG_LOCK = %d\n", (option_bytes&0x400000)?1:0);
 			printf("RD_PROTECT = %d\n", (option_bytes&0x200000)?1:0);
@@ -1463,33 +1463,33 @@ int CH5xxPrintInfo(void* dev) {
 void ch5xx_special_reset_validate_options(void * dev) {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 	
-	MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-
-	MCF.WriteReg32(dev, DMDATA0, 0x40001000);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
-	MCF.WriteReg32(dev, DMDATA0, 0x57);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100e); // Write a4 from DATA0.
-	MCF.WriteReg32(dev, DMDATA0, 0xa8);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100f); // Write a5 from DATA0.
-	MCF.WriteReg32(dev, DMDATA0, 0xffff);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100c); // Write a2 from DATA0.
-	MCF.WriteReg32(dev, DMDATA0, 1);
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100b); // Write a1 from DATA0.
-
-	MCF.WriteReg32(dev, DMPROGBUF0, 0x04e68023); // sb  a4,0x40(a3)
-	MCF.WriteReg32(dev, DMPROGBUF1, 0x04f68023); // sb  a5,0x40(a3)
+	MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0x40001000);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100d); // Write a3 from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0x57);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100e); // Write a4 from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0xa8);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100f); // Write a5 from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, 0xffff);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100c); // Write a2 from DATA0.
+	MCF( dev ).WriteReg32(dev, DMDATA0, 1);
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00230000 | 0x100b); // Write a1 from DATA0.
+
+	MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x04e68023); // sb  a4,0x40(a3)
+	MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0x04f68023); // sb  a5,0x40(a3)
 	// Write 0xffff to R16_INT32K_TUNE
-	MCF.WriteReg32(dev, DMPROGBUF2, 0x02c69623); // sh  a2,0x2c(a3)
+	MCF( dev ).WriteReg32(dev, DMPROGBUF2, 0x02c69623); // sh  a2,0x2c(a3)
 	// Write 1 to R8_RST_WDOG_CTRL to reboot
-	MCF.WriteReg32(dev, DMPROGBUF3, 0x04b68323); // sb  a1,0x46(a3)
-	MCF.WriteReg32(dev, DMPROGBUF4, 0x04068023); // sb zero, 64(a3)
+	MCF( dev ).WriteReg32(dev, DMPROGBUF3, 0x04b68323); // sb  a1,0x46(a3)
+	MCF( dev ).WriteReg32(dev, DMPROGBUF4, 0x04068023); // sb zero, 64(a3)
 	// Endless loop, target should reset
-	MCF.WriteReg32(dev, DMPROGBUF5, 0x9002a001); // c.j 0; c.ebreak
+	MCF( dev ).WriteReg32(dev, DMPROGBUF5, 0x9002a001); // c.j 0; c.ebreak
 	
 	iss->statetag = STTAG( "XXXX" );
 
 	// fprintf(stderr, "Executing command\n");
-	MCF.WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
+	MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00271000); // Execute program.
 }
 
 void ch5xx_flash_powerup(void * dev) {
@@ -1530,7 +1530,7 @@ int CH5xxConfigureNRSTAsGPIO(void * dev, int one_if_yes_gpio) {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 	uint32_t options;
 
-	MCF.SetClock(dev, 0);
+	MCF( dev ).SetClock(dev, 0);
 	
 	uint32_t options_address = 0x7EFFC;
 	if (iss->target_chip_type == CHIP_CH570) options_address = 0x3EFFC;
@@ -1553,7 +1553,7 @@ int CH5xxConfigureNRSTAsGPIO(void * dev, int one_if_yes_gpio) {
 			CH5xxWriteBinaryBlob(dev, options_address - 8, 12, (uint8_t*)options_array);
 		} else {
 			uint8_t info_reg = 0;
-			MCF.ReadByte(dev, R8_GLOB_CFG_INFO, &info_reg);
+			MCF( dev ).ReadByte(dev, R8_GLOB_CFG_INFO, &info_reg);
 			if (!(info_reg & (1<<5))) {
 				fprintf(stderr, "You need to be in bootloader mode to edit OPTIONS.\n R8_GLOB_CFG_INFO = %02x\n", info_reg);
 				fprintf(stderr, "You can enter bootloader mode by prefexing -B before the command.\n");
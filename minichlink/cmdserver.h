@@ -36,6 +36,11 @@ int WSAAPI WSAPoll(struct pollfd * fdArray, ULONG fds, INT timeout );
 
 
 
+#if !defined( MINICHLINK_AS_LIBRARY ) && !defined( MINICHLINK_IMPORT )
+// In minichlink.c, runs one line of the same script language as -x.
+int MiniCHLinkRunScriptLine( void * dev, char * line );
+#endif
+
 // TODO: this is SOOOOOO Broken. Need to use select instead of bind for both servers.
 static int g_cmdServerSocket;
 static int g_cmdListenMode; // 0 for uninit.  1 for server, 2 for client.
@@ -75,7 +80,7 @@ static int CMDListen(void)
 	//Setup socket for listening address.
 	memset( &sin, 0, sizeof( sin ) );
 	sin.sin_family = AF_INET;
-	sin.sin_addr.s_addr = INADDR_ANY;
+	sin.sin_addr.s_addr = htonl( INADDR_LOOPBACK ); // Script lines can read and write files, so only take them from this machine.
 	sin.sin_port = htons( CMDSERVER_PORT );
 
 	//Actually bind to the socket
@@ -123,13 +128,13 @@ static int CMDInit(void)
 
 void CMDWrite(void *dev, uint32_t datareg, uint32_t value)
 {
-	if( MCF.WriteReg32 && MCF.FlushLLCommands )
+	if( MCF( dev ).WriteReg32 && MCF( dev ).FlushLLCommands )
 	{
 		struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 		iss->statetag = STTAG( "XXXX" );
-		MCF.FlushLLCommands( dev );
-		MCF.WriteReg32( dev, datareg, value );
-		MCF.FlushLLCommands( dev );
+		MCF( dev ).FlushLLCommands( dev );
+		MCF( dev ).WriteReg32( dev, datareg, value );
+		MCF( dev ).FlushLLCommands( dev );
 	}
 	else
 	{
@@ -140,12 +145,12 @@ void CMDWrite(void *dev, uint32_t datareg, uint32_t value)
 uint32_t CMDRead(void *dev, uint32_t datareg)
 {
 	uint32_t value = 0;
-	if( MCF.ReadReg32 && MCF.FlushLLCommands )
+	if( MCF( dev ).ReadReg32 && MCF( dev ).FlushLLCommands )
 	{
 		struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 		iss->statetag = STTAG( "XXXX" );
-		MCF.FlushLLCommands( dev );
-		int ret = MCF.ReadReg32( dev, datareg, &value );
+		MCF( dev ).FlushLLCommands( dev );
+		int ret = MCF( dev ).ReadReg32( dev, datareg, &value );
 		if( ret < 0 )
 		{
 			fprintf( stderr, "Error reading register %02x: %d\n", datareg, ret );
@@ -166,6 +171,25 @@ void CMDRequestHandler(void *dev, const char *request, size_t size, char *out, s
 	{
 		switch(*cmd)
 		{
+#if !defined( MINICHLINK_AS_LIBRARY ) && !defined( MINICHLINK_IMPORT )
+			case '!': // Script line, i.e. "!-w firmware.bin flash", replies "ok" or "error".  Not '-', that's how the old -s/-m requests start.
+			{
+				const char *end = request + size;
+				char line[4096];
+				int len = 0;
+				cmd++;
+				while( cmd < end && *cmd && *cmd != '\n' && len < (int)sizeof( line ) - 1 )
+					line[len++] = *(cmd++);
+				line[len] = 0;
+				if( cmd < end && *cmd == '\n' ) cmd++;
+				int ret = MiniCHLinkRunScriptLine( dev, line );
+				int outlen = ret ? snprintf( out, outsize, "error %d\n", ret ) : snprintf( out, outsize, "ok\n" );
+				if( outlen < 0 || outlen >= (int)outsize ) return;
+				out += outlen;
+				outsize -= outlen;
+				break;
+			}
+#endif
 			case 's': // Write command
 			{
 				uint32_t datareg = 0;
@@ -285,18 +309,19 @@ int CMDPollServer( void * dev )
 			uint8_t buffer[16384];
 			uint8_t outbuffer[16384];
 			outbuffer[0] = 0; // Null-terminate the output buffer.
-			ssize_t rx = recv( g_cmdServerSocket, (char*)buffer, sizeof( buffer ), MSG_NOSIGNAL );
+			ssize_t rx = recv( g_cmdServerSocket, (char*)buffer, sizeof( buffer ) - 1, MSG_NOSIGNAL );
 			if( rx > 0 )
 			{
+				buffer[rx] = 0;
 				// Save the current DMDATA0 register value, so we can restore it later.
 				uint32_t data0;
-				MCF.FlushLLCommands( dev );
-				(void)MCF.ReadReg32( dev, DMDATA0, &data0 );
-				MCF.FlushLLCommands( dev );
+				MCF( dev ).FlushLLCommands( dev );
+				(void)MCF( dev ).ReadReg32( dev, DMDATA0, &data0 );
+				MCF( dev ).FlushLLCommands( dev );
 
 				CMDRequestHandler( dev, (const char*)buffer, rx , (char*)outbuffer, sizeof( outbuffer ) );
 				// Restore the DMDATA0 register value.
-				MCF.WriteReg32( dev, DMDATA0, data0 );
+				MCF( dev ).WriteReg32( dev, DMDATA0, data0 );
 				int outsize = strlen( (const char*)outbuffer );
 				if( outsize > 0 )
 				{
@@ -0,0 +1,221 @@
+// Just enough of an ELF reader for minichlink: 32-bit little endian files,
+// like the ones the riscv toolchain spits out for ch32fun.  The whole file is
+// kept in memory and everything points into it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "minichlink.h"
+
+#define ELF_SHT_SYMTAB 2
+#define ELF_PT_LOAD 1
+#define ELF_STT_NOTYPE 0
+#define ELF_STT_FUNC 2
+
+struct Elf32Header
+{
+	uint8_t  e_ident[16];
+	uint16_t e_type;
+	uint16_t e_machine;
+	uint32_t e_version;
+	uint32_t e_entry;
+	uint32_t e_phoff;
+	uint32_t e_shoff;
+	uint32_t e_flags;
+	uint16_t e_ehsize;
+	uint16_t e_phentsize;
+	uint16_t e_phnum;
+	uint16_t e_shentsize;
+	uint16_t e_shnum;
+	uint16_t e_shstrndx;
+};
+
+struct Elf32ProgramHeader
+{
+	uint32_t p_type;
+	uint32_t p_offset;
+	uint32_t p_vaddr;
+	uint32_t p_paddr;
+	uint32_t p_filesz;
+	uint32_t p_memsz;
+	uint32_t p_flags;
+	uint32_t p_align;
+};
+
+struct Elf32SectionHeader
+{
+	uint32_t sh_name;
+	uint32_t sh_type;
+	uint32_t sh_flags;
+	uint32_t sh_addr;
+	uint32_t sh_offset;
+	uint32_t sh_size;
+	uint32_t sh_link;
+	uint32_t sh_info;
+	uint32_t sh_addralign;
+	uint32_t sh_entsize;
+};
+
+int IsELFFile( const char * filename )
+{
+	uint8_t ident[4];
+	FILE * f = fopen( filename, "rb" );
+	if( !f ) return 0;
+	int r = fread( ident, 4, 1, f );
+	fclose( f );
+	return r == 1 && memcmp( ident, "\x7f" "ELF", 4 ) == 0;
+}
+
+int ElfLoad( struct ElfFile * elf, const char * filename )
+{
+	memset( elf, 0, sizeof( *elf ) );
+
+	FILE * f = fopen( filename, "rb" );
+	if( !f )
+	{
+		fprintf( stderr, "Error: Could not open %s\n", filename );
+		return -1;
+	}
+	fseek( f, 0, SEEK_END );
+	long len = ftell( f );
+	fseek( f, 0, SEEK_SET );
+	if( len < (long)sizeof( struct Elf32Header ) )
+	{
+		fclose( f );
+		fprintf( stderr, "Error: %s is too small to be an ELF\n", filename );
+		return -2;
+	}
+	elf->data = malloc( len );
+	elf->len = len;
+	int r = fread( elf->data, len, 1, f );
+	fclose( f );
+	if( r != 1 )
+	{
+		fprintf( stderr, "Error: File I/O Fault.\n" );
+		ElfFree( elf );
+		return -10;
+	}
+
+	struct Elf32Header * eh = (struct Elf32Header *)elf->data;
+	if( memcmp( eh->e_ident, "\x7f" "ELF", 4 ) || eh->e_ident[4] != 1 /* ELFCLASS32 */ || eh->e_ident[5] != 1 /* Little endian */ )
+	{
+		fprintf( stderr, "Error: %s is not a 32-bit little endian ELF\n", filename );
+		ElfFree( elf );
+		return -2;
+	}
+
+	// Find the symbol table (if it wasn't stripped)
+	int i;
+	if( eh->e_shoff && eh->e_shentsize == sizeof( struct Elf32SectionHeader ) &&
+		eh->e_shoff + (uint64_t)eh->e_shnum * eh->e_shentsize <= elf->len )
+	{
+		struct Elf32SectionHeader * sh = (struct Elf32SectionHeader *)( elf->data + eh->e_shoff );
+		for( i = 0; i < eh->e_shnum; i++ )
+		{
+			if( sh[i].sh_type != ELF_SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum ) continue;
+			struct Elf32SectionHeader * strs = &sh[sh[i].sh_link];
+			if( (uint64_t)sh[i].sh_offset + sh[i].sh_size > elf->len ||
+				(uint64_t)strs->sh_offset + strs->sh_size > elf->len )
+				continue;
+			elf->symbols = (struct ElfSymbol *)( elf->data + sh[i].sh_offset );
+			elf->num_symbols = sh[i].sh_size / sizeof( struct ElfSymbol );
+			elf->strings = (const char *)( elf->data + strs->sh_offset );
+			elf->strings_len = strs->sh_size;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+void ElfFree( struct ElfFile * elf )
+{
+	free( elf->data );
+	memset( elf, 0, sizeof( *elf ) );
+}
+
+const char * ElfSymbolName( struct ElfFile * elf, struct ElfSymbol * sym )
+{
+	if( sym->st_name >= elf->strings_len ) return "";
+	return elf->strings + sym->st_name;
+}
+
+int ElfFindSymbol( struct ElfFile * elf, const char * name, uint32_t * address, uint32_t * size )
+{
+	uint32_t i;
+	for( i = 0; i < elf->num_symbols; i++ )
+	{
+		struct ElfSymbol * s = &elf->symbols[i];
+		if( s->st_shndx == 0 ) continue; // Undefined
+		if( strcmp( ElfSymbolName( elf, s ), name ) ) continue;
+		if( address ) *address = s->st_value;
+		if( size ) *size = s->st_size;
+		return 0;
+	}
+	return -1;
+}
+
+struct ElfSymbol * ElfSymbolAt( struct ElfFile * elf, uint32_t address )
+{
+	struct ElfSymbol * best = 0;
+	uint32_t i;
+	for( i = 0; i < elf->num_symbols; i++ )
+	{
+		struct ElfSymbol * s = &elf->symbols[i];
+		int type = s->st_info & 0xf;
+		if( s->st_shndx == 0 || s->st_value > address ) continue;
+		if( type != ELF_STT_FUNC && type != ELF_STT_NOTYPE ) continue;
+		if( s->st_size )
+		{
+			if( address - s->st_value < s->st_size ) return s;
+			continue;
+		}
+		// Assembly labels (like the interrupt vectors) have no size, so go with
+		// the closest one below, skipping the compiler's local labels.
+		const char * name = ElfSymbolName( elf, s );
+		if( !name[0] || name[0] == '.' || name[0] == '$' ) continue;
+		if( !best || s->st_value > best->st_value ) best = s;
+	}
+	return best;
+}
+
+int ElfGetLoadSegments( struct ElfFile * elf, struct ElfSegment * segs, int max )
+{
+	struct Elf32Header * eh = (struct Elf32Header *)elf->data;
+	int i, count = 0;
+
+	if( !eh->e_phoff || eh->e_phentsize != sizeof( struct Elf32ProgramHeader ) ||
+		eh->e_phoff + (uint64_t)eh->e_phnum * eh->e_phentsize > elf->len )
+	{
+		fprintf( stderr, "Error: ELF has no usable program headers\n" );
+		return -1;
+	}
+
+	struct Elf32ProgramHeader * ph = (struct Elf32ProgramHeader *)( elf->data + eh->e_phoff );
+	for( i = 0; i < eh->e_phnum; i++ )
+	{
+		// Things like .bss take up memory but have nothing to load.
+		if( ph[i].p_type != ELF_PT_LOAD || ph[i].p_filesz == 0 ) continue;
+		if( (uint64_t)ph[i].p_offset + ph[i].p_filesz > elf->len )
+		{
+			fprintf( stderr, "Error: ELF segment %d runs off the end of the file\n", i );
+			return -2;
+		}
+		if( count == max )
+		{
+			fprintf( stderr, "Error: Too many segments in ELF\n" );
+			return -3;
+		}
+		// Load where the segment is stored (LMA), i.e. .data's initializers go into flash.
+		segs[count].address = ph[i].p_paddr;
+		segs[count].size = ph[i].p_filesz;
+		segs[count].data = elf->data + ph[i].p_offset;
+		count++;
+	}
+	return count;
+}
+
+uint32_t ElfEntry( struct ElfFile * elf )
+{
+	return ((struct Elf32Header *)elf->data)->e_entry;
+}
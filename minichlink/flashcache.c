@@ -0,0 +1,286 @@
+// Persistent flash cache (-w --cache).
+//
+// Remembers, per chip (by UUID), a hash of every sector minichlink wrote, and
+// the CRC32 of each range it wrote.  Next time, if the on-chip CRC of those
+// ranges still matches (so nobody else has touched the flash since), only the
+// sectors whose hash changed get written.  No reading back of the flash is
+// needed, which is most of the time on slow programmers.
+//
+// Cache files live in ~/.cache/minichlink/<uuid> (%LOCALAPPDATA%\minichlink on
+// Windows), and are plain text.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "minichlink.h"
+#include "chips.h"
+
+#if defined(WINDOWS) || defined(WIN32) || defined(_WIN32)
+#include <direct.h>
+#define CACHE_MKDIR( x ) _mkdir( x )
+#else
+#define CACHE_MKDIR( x ) mkdir( x, 0755 )
+#endif
+
+#define CACHE_MAX_RANGES  32
+#define CACHE_MAX_SECTORS 8192
+
+struct CacheRange
+{
+	uint32_t address;
+	uint32_t len;
+	uint32_t crc; // Of len/4 words.
+};
+
+struct CacheSector
+{
+	uint32_t address; // Where the written part of the sector starts.
+	uint32_t len;
+	uint64_t hash;
+};
+
+struct FlashCache
+{
+	int num_ranges;
+	int num_sectors;
+	struct CacheRange ranges[CACHE_MAX_RANGES];
+	struct CacheSector sectors[CACHE_MAX_SECTORS];
+};
+
+static uint64_t CacheHash( const uint8_t * data, uint32_t len )
+{
+	// FNV-1a
+	uint64_t h = 0xcbf29ce484222325ULL;
+	uint32_t i;
+	for( i = 0; i < len; i++ )
+	{
+		h ^= data[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static int CachePath( void * dev, char * path, int maxlen )
+{
+	uint8_t uuid[8];
+	const char * base = getenv( "XDG_CACHE_HOME" );
+	const char * sub = "";
+	if( !base || !base[0] )
+	{
+#if defined(WINDOWS) || defined(WIN32) || defined(_WIN32)
+		base = getenv( "LOCALAPPDATA" );
+#else
+		base = getenv( "HOME" );
+		sub = "/.cache";
+#endif
+	}
+	if( !base || !MCF( dev ).GetUUID || MCF( dev ).GetUUID( dev, uuid ) ) return -1;
+
+	// Make the directories on the way, it's fine if they're already there.
+	snprintf( path, maxlen, "%s%s", base, sub );
+	CACHE_MKDIR( path );
+	snprintf( path, maxlen, "%s%s/minichlink", base, sub );
+	CACHE_MKDIR( path );
+	snprintf( path, maxlen, "%s%s/minichlink/%02x%02x%02x%02x%02x%02x%02x%02x", base, sub,
+		uuid[0], uuid[1], uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7] );
+	return 0;
+}
+
+static void CacheLoad( struct FlashCache * fc, const char * path, const struct RiscVChip_s * chip, uint32_t sectorsize )
+{
+	char line[256];
+	char name[32];
+	uint32_t ss = 0;
+	fc->num_ranges = fc->num_sectors = 0;
+
+	FILE * f = fopen( path, "r" );
+	if( !f ) return;
+
+	// Anything we don't understand, or from another chip type, is just ignored.
+	if( !fgets( line, sizeof( line ), f ) || strcmp( line, "minichlink-cache 1\n" ) ||
+		!fgets( line, sizeof( line ), f ) || sscanf( line, "chip %31s sector %u", name, &ss ) != 2 ||
+		strcmp( name, chip->name_str ) || ss != sectorsize )
+	{
+		fclose( f );
+		return;
+	}
+
+	while( fgets( line, sizeof( line ), f ) )
+	{
+		struct CacheRange * r = &fc->ranges[fc->num_ranges];
+		struct CacheSector * s = &fc->sectors[fc->num_sectors];
+		unsigned long long h;
+		if( fc->num_ranges < CACHE_MAX_RANGES && sscanf( line, "range %x %u %x", &r->address, &r->len, &r->crc ) == 3 )
+			fc->num_ranges++;
+		else if( fc->num_sectors < CACHE_MAX_SECTORS && sscanf( line, "sector %x %u %llx", &s->address, &s->len, &h ) == 3 )
+		{
+			s->hash = h;
+			fc->num_sectors++;
+		}
+	}
+	fclose( f );
+}
+
+static void CacheSave( struct FlashCache * fc, const char * path, const struct RiscVChip_s * chip, uint32_t sectorsize )
+{
+	int i;
+	FILE * f = fopen( path, "w" );
+	if( !f )
+	{
+		fprintf( stderr, "Warning: Could not write flash cache %s\n", path );
+		return;
+	}
+	fprintf( f, "minichlink-cache 1\n" );
+	fprintf( f, "chip %s sector %u\n", chip->name_str, sectorsize );
+	for( i = 0; i < fc->num_ranges; i++ )
+		fprintf( f, "range %08x %u %08x\n", fc->ranges[i].address, fc->ranges[i].len, fc->ranges[i].crc );
+	for( i = 0; i < fc->num_sectors; i++ )
+		fprintf( f, "sector %08x %u %016llx\n", fc->sectors[i].address, fc->sectors[i].len, (unsigned long long)fc->sectors[i].hash );
+	fclose( f );
+}
+
+static struct CacheSector * CacheFindSector( struct FlashCache * fc, uint32_t address )
+{
+	int i;
+	for( i = 0; i < fc->num_sectors; i++ )
+		if( fc->sectors[i].address == address ) return &fc->sectors[i];
+	return 0;
+}
+
+// Drops the sector hashes in first...end.
+static void CacheForgetSectors( struct FlashCache * fc, uint32_t first, uint32_t end )
+{
+	int i, o;
+	for( i = 0, o = 0; i < fc->num_sectors; i++ )
+	{
+		struct CacheSector * s = &fc->sectors[i];
+		if( s->address < end && s->address + s->len > first ) continue;
+		fc->sectors[o++] = *s;
+	}
+	fc->num_sectors = o;
+}
+
+// Forget everything about address...address+len (rounded out to sectors), then remember blob there.
+static void CacheUpdate( struct FlashCache * fc, uint32_t sectorsize, uint32_t address, uint32_t len, const uint8_t * blob )
+{
+	uint32_t first = address & ~( sectorsize - 1 );
+	uint32_t end = address + len;
+	int i, o;
+
+	for( i = 0, o = 0; i < fc->num_ranges; i++ )
+	{
+		struct CacheRange * r = &fc->ranges[i];
+		if( r->address < end && r->address + r->len > first ) continue; // Overlapping
+		fc->ranges[o++] = *r;
+	}
+	fc->num_ranges = o;
+	CacheForgetSectors( fc, first, end );
+
+	if( fc->num_ranges == CACHE_MAX_RANGES )
+	{
+		// Out of ranges, so the oldest goes.  Its sectors have to go with it, since
+		// without a range over them nothing would check they're still on the chip.
+		struct CacheRange * old = &fc->ranges[0];
+		CacheForgetSectors( fc, old->address & ~( sectorsize - 1 ), old->address + old->len );
+		memmove( fc->ranges, fc->ranges + 1, sizeof( fc->ranges[0] ) * ( CACHE_MAX_RANGES - 1 ) );
+		fc->num_ranges--;
+	}
+	struct CacheRange * r = &fc->ranges[fc->num_ranges++];
+	r->address = address;
+	r->len = len & ~3;
+	r->crc = InternalCRC32Words( blob, len / 4 );
+
+	uint32_t sector;
+	for( sector = first; sector < end && fc->num_sectors < CACHE_MAX_SECTORS; sector += sectorsize )
+	{
+		uint32_t s = ( sector < address ) ? address : sector;
+		uint32_t e = ( sector + sectorsize > end ) ? end : sector + sectorsize;
+		struct CacheSector * cs = &fc->sectors[fc->num_sectors++];
+		cs->address = s;
+		cs->len = e - s;
+		cs->hash = CacheHash( blob + ( s - address ), e - s );
+	}
+}
+
+int CachedWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob_size, const uint8_t * blob, int diff )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	char path[1024];
+	int r, i;
+
+	if( blob_size == 0 ) return 0;
+	if( !IsAddressFlash( address_to_write ) || !iss->target_chip || !iss->sector_size )
+		return MCF( dev ).WriteBinaryBlob( dev, address_to_write, blob_size, blob );
+
+	if( CachePath( dev, path, sizeof( path ) ) )
+	{
+		fprintf( stderr, "Warning: Can't use the flash cache without the chip's UUID.\n" );
+		return diff ? DiffWriteBinaryBlob( dev, address_to_write, blob_size, blob ) : MCF( dev ).WriteBinaryBlob( dev, address_to_write, blob_size, blob );
+	}
+
+	uint32_t sectorsize = iss->sector_size;
+	struct FlashCache * fc = malloc( sizeof( struct FlashCache ) );
+	CacheLoad( fc, path, iss->target_chip, sectorsize );
+
+	// Make sure what we remember about where we're writing is still what's on the chip.
+	uint32_t first = address_to_write & ~( sectorsize - 1 );
+	uint32_t end = address_to_write + blob_size;
+	int trusted = 0;
+	for( i = 0; i < fc->num_ranges; i++ )
+	{
+		struct CacheRange * cr = &fc->ranges[i];
+		if( cr->address >= end || cr->address + cr->len <= first ) continue;
+		uint32_t crc = 0;
+		r = InternalChipCRC32( dev, cr->address, cr->len / 4, &crc );
+		if( r < 0 )
+		{
+			fprintf( stderr, "Cache: Can't CRC flash on this chip/programmer, not using the cache.\n" );
+			trusted = 0;
+			break;
+		}
+		if( crc != cr->crc )
+		{
+			printf( "Cache: Flash at 0x%08x was changed outside of minichlink, not using the cache.\n", cr->address );
+			trusted = 0;
+			break;
+		}
+		trusted = 1;
+	}
+
+	if( trusted )
+	{
+		int sectors = 0, changed = 0;
+		uint8_t * dirty = malloc( ( end - first ) / sectorsize + 1 );
+		uint32_t sector;
+		for( sector = first; sector < end; sector += sectorsize )
+		{
+			uint32_t s = ( sector < address_to_write ) ? address_to_write : sector;
+			uint32_t e = ( sector + sectorsize > end ) ? end : sector + sectorsize;
+			struct CacheSector * cs = CacheFindSector( fc, s );
+			dirty[sectors] = !cs || cs->len != e - s || cs->hash != CacheHash( blob + ( s - address_to_write ), e - s );
+			changed += dirty[sectors++];
+		}
+		r = InternalWriteChangedSectors( dev, address_to_write, blob_size, blob, dirty );
+		free( dirty );
+		if( !r ) printf( "Cache: %d of %d sectors changed\n", changed, sectors );
+	}
+	else if( diff )
+		r = DiffWriteBinaryBlob( dev, address_to_write, blob_size, blob );
+	else
+		r = MCF( dev ).WriteBinaryBlob( dev, address_to_write, blob_size, blob );
+
+	if( !r )
+	{
+		CacheUpdate( fc, sectorsize, address_to_write, blob_size, blob );
+		CacheSave( fc, path, iss->target_chip, sectorsize );
+	}
+	else
+	{
+		// We don't know what's on there now, so forget it.
+		remove( path );
+	}
+
+	free( fc );
+	return r;
+}
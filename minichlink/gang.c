@@ -0,0 +1,165 @@
+// Gang programming: flash the same image with several WCH-LinkE's at once.
+//
+// Each programmer gets its own thread.  Since every programmer has its own
+// function table (see MCF), each thread can init its programmer with
+// MiniCHLinkInitAsDLL() and use it just like the single-programmer path does.
+// USB errors come back as return values, so one bad programmer only fails
+// itself.  The image buffer is shared and never written to.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "minichlink.h"
+#include "chips.h"
+#include "os_generic.h"
+
+#define GANG_MAX_PROGRAMMERS 64
+
+struct GangJob
+{
+	char * serial;
+	const uint8_t * image;
+	int len;
+	uint32_t address;
+	int diff;
+
+	og_thread_t thread;
+	const char * failure; // 0 if everything went OK.
+	double time;
+};
+
+static void * GangWorker( void * v )
+{
+	struct GangJob * job = (struct GangJob *)v;
+	double start = OGGetAbsoluteTime();
+	uint8_t * readback = 0;
+
+	init_hints_t hints;
+	memset( &hints, 0, sizeof( hints ) );
+	hints.specific_programmer = "linke";
+	hints.programmer_serial_number = job->serial;
+
+	void * dev = MiniCHLinkInitAsDLL( 0, &hints );
+	if( !dev )
+	{
+		job->failure = "could not open programmer";
+		goto done;
+	}
+
+	if( MCF( dev ).SetupInterface && MCF( dev ).SetupInterface( dev ) < 0 )
+	{
+		job->failure = "could not setup interface";
+		goto close;
+	}
+
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	if( iss->target_chip == 0 && ( !MCF( dev ).DetermineChipType || MCF( dev ).DetermineChipType( dev ) ) )
+	{
+		job->failure = "could not determine chip type";
+		goto close;
+	}
+
+	if( MCF( dev ).HaltMode ) MCF( dev ).HaltMode( dev, HALT_MODE_HALT_AND_RESET );
+
+	int r;
+	if( job->diff && IsAddressFlash( job->address ) )
+		r = DiffWriteBinaryBlob( dev, job->address, job->len, job->image );
+	else
+		r = MCF( dev ).WriteBinaryBlob( dev, job->address, job->len, job->image );
+	if( r )
+	{
+		job->failure = "fault writing image";
+		goto close;
+	}
+
+	r = InternalVerifyCRC32( dev, job->address, job->len, job->image );
+	if( r < 0 )
+	{
+		readback = malloc( job->len );
+		if( MCF( dev ).ReadBinaryBlob( dev, job->address, job->len, readback ) )
+		{
+			job->failure = "fault reading back image";
+			goto close;
+		}
+		r = memcmp( readback, job->image, job->len ) != 0;
+	}
+	if( r )
+	{
+		job->failure = "verify mismatch";
+		goto close;
+	}
+
+	if( MCF( dev ).HaltMode ) MCF( dev ).HaltMode( dev, HALT_MODE_REBOOT );
+
+close:
+	if( MCF( dev ).FlushLLCommands ) MCF( dev ).FlushLLCommands( dev );
+	if( MCF( dev ).Exit ) MCF( dev ).Exit( dev );
+done:
+	free( readback );
+	job->time = OGGetAbsoluteTime() - start;
+	return 0;
+}
+
+int MiniCHLinkGangFlash( const char * serials, const uint8_t * image, int len, uint32_t address, int diff )
+{
+	struct GangJob jobs[GANG_MAX_PROGRAMMERS];
+	char * serial_list[GANG_MAX_PROGRAMMERS];
+	int count = 0;
+	int i;
+
+	if( strcmp( serials, "all" ) == 0 )
+	{
+		count = ListWCHLinkESerials( serial_list, GANG_MAX_PROGRAMMERS );
+	}
+	else
+	{
+		const char * s = serials;
+		while( *s && count < GANG_MAX_PROGRAMMERS )
+		{
+			const char * e = strchr( s, ',' );
+			int sl = e ? e - s : strlen( s );
+			if( sl )
+			{
+				serial_list[count] = malloc( sl + 1 );
+				memcpy( serial_list[count], s, sl );
+				serial_list[count][sl] = 0;
+				count++;
+			}
+			s += sl + ( e ? 1 : 0 );
+		}
+	}
+
+	if( count == 0 )
+	{
+		fprintf( stderr, "Error: No programmers to gang flash with\n" );
+		return -32;
+	}
+
+	double start = OGGetAbsoluteTime();
+	memset( jobs, 0, sizeof( jobs ) );
+	for( i = 0; i < count; i++ )
+	{
+		jobs[i].serial = serial_list[i];
+		jobs[i].image = image;
+		jobs[i].len = len;
+		jobs[i].address = address;
+		jobs[i].diff = diff;
+		jobs[i].thread = OGCreateThread( GangWorker, &jobs[i] );
+	}
+
+	int failures = 0;
+	for( i = 0; i < count; i++ )
+		OGJoinThread( jobs[i].thread );
+
+	printf( "\nGang flash summary:\n" );
+	for( i = 0; i < count; i++ )
+	{
+		if( jobs[i].failure ) failures++;
+		printf( "  %-24s %s %7.3f s%s%s\n", jobs[i].serial, jobs[i].failure ? "FAIL" : "PASS", jobs[i].time,
+			jobs[i].failure ? "  " : "", jobs[i].failure ? jobs[i].failure : "" );
+		free( serial_list[i] );
+	}
+	printf( "%d of %d passed in %.3f s\n", count - failures, count, OGGetAbsoluteTime() - start );
+
+	return failures;
+}
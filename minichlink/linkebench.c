@@ -0,0 +1,142 @@
+// Times the WCH-LinkE doing one DMI op per USB round trip against the async
+// engine in pgm-wch-linke.c keeping several on the wire, so you can see what
+// the pipeline buys you on your programmer, hub and OS.
+//
+//   make linkebench
+//   ./linkebench [bytes of flash to read, default 16384]
+//
+// Needs a LinkE with a chip on it.  The chip is halted and the first few kB
+// of its RAM are overwritten, flash is only read.  Returns nonzero if
+// anything read back differently between runs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "minichlink.h"
+#include "chips.h"
+#include "os_generic.h"
+
+#define DMI_ROUNDS 1000
+
+struct BenchState
+{
+	void * dev;
+	struct InternalState * iss;
+	double start;
+	uint32_t roundtrips;
+	int failures;
+};
+
+static void BenchStart( struct BenchState * b )
+{
+	b->roundtrips = b->iss->roundtrips;
+	b->start = OGGetAbsoluteTime();
+}
+
+// Prints how many per second, of bytes (as kB) if unit is 0.
+static void BenchEndUnits( struct BenchState * b, const char * name, uint32_t count, const char * unit, int ok )
+{
+	double dt = OGGetAbsoluteTime() - b->start;
+	printf( "  %-20s %9.2f ms %8u round trips", name, dt * 1000.0, b->iss->roundtrips - b->roundtrips );
+	if( !unit ) printf( " %9.1f kB/s", dt > 0 ? count / dt / 1024.0 : 0.0 );
+	else printf( " %9.0f %s/s", dt > 0 ? count / dt : 0.0, unit );
+	printf( "%s\n", ok ? "" : "  FAILED" );
+	fflush( stdout );
+	if( !ok ) b->failures++;
+}
+
+static void BenchDepth( struct BenchState * b, int inflight, uint32_t flash_len, uint8_t * flash_ref, uint32_t ram_len, uint8_t * ram_image )
+{
+	void * dev = b->dev;
+	struct InternalState * iss = b->iss;
+	uint32_t * got = malloc( sizeof( uint32_t ) * DMI_ROUNDS );
+	uint8_t * readback = malloc( flash_len > ram_len ? flash_len : ram_len );
+	int i, r, ok;
+
+	WCHLinkESetInflight( dev, inflight );
+	printf( "%d in flight%s:\n", inflight, inflight == 1 ? " (synchronous)" : "" );
+
+	// Raw DMI commands, a write and a read back of DATA1 each time around.
+	BenchStart( b );
+	r = 0;
+	for( i = 0; i < DMI_ROUNDS; i++ )
+	{
+		r |= DMIQueueWrite( dev, DMDATA1, 0x5a000000 + i );
+		r |= DMIQueueRead( dev, DMDATA1, got + i );
+	}
+	r |= DMIFlush( dev );
+	for( ok = !r, i = 0; i < DMI_ROUNDS; i++ )
+		if( got[i] != 0x5a000000u + i ) ok = 0;
+	BenchEndUnits( b, "DMI commands", DMI_ROUNDS * 2, "cmds", ok );
+
+	BenchStart( b );
+	memset( readback, 0, flash_len );
+	r = MCF( dev ).ReadBinaryBlob( dev, iss->target_chip->flash_offset, flash_len, readback );
+	BenchEndUnits( b, "read flash", flash_len, 0, !r && !memcmp( readback, flash_ref, flash_len ) );
+
+	BenchStart( b );
+	r = MCF( dev ).WriteBinaryBlob( dev, iss->ram_base, ram_len, ram_image );
+	BenchEndUnits( b, "write RAM", ram_len, 0, !r );
+
+	BenchStart( b );
+	memset( readback, 0, ram_len );
+	r = MCF( dev ).ReadBinaryBlob( dev, iss->ram_base, ram_len, readback );
+	BenchEndUnits( b, "read RAM", ram_len, 0, !r && !memcmp( readback, ram_image, ram_len ) );
+
+	printf( "\n" );
+	free( got );
+	free( readback );
+}
+
+int main( int argc, char ** argv )
+{
+	struct BenchState b;
+	init_hints_t hints;
+	static const int depths[] = { 1, 2, 4, 8, 16, 32 };
+	uint32_t i;
+
+	memset( &b, 0, sizeof( b ) );
+	memset( &hints, 0, sizeof( hints ) );
+	hints.specific_programmer = "linke";
+
+	void * dev = MiniCHLinkInitAsDLL( 0, &hints );
+	if( !dev ) return 1;
+	b.dev = dev;
+	b.iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	struct InternalState * iss = b.iss;
+
+	if( MCF( dev ).SetupInterface( dev ) || MCF( dev ).DetermineChipType( dev ) || MCF( dev ).HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET ) )
+	{
+		fprintf( stderr, "Error: Could not connect to the chip\n" );
+		return 1;
+	}
+
+	uint32_t flash_len = ( argc > 1 ) ? strtoul( argv[1], 0, 0 ) : 16384;
+	if( flash_len > iss->flash_size ) flash_len = iss->flash_size;
+	flash_len &= ~3;
+	uint32_t ram_len = iss->ram_size / 2;
+	if( ram_len > 4096 ) ram_len = 4096;
+
+	// Read the flash once the slow way as the reference.
+	uint8_t * flash_ref = malloc( flash_len );
+	uint8_t * ram_image = malloc( ram_len );
+	WCHLinkESetInflight( dev, 1 );
+	if( MCF( dev ).ReadBinaryBlob( dev, iss->target_chip->flash_offset, flash_len, flash_ref ) )
+	{
+		fprintf( stderr, "Error: Could not read flash\n" );
+		return 1;
+	}
+	srand( 1 );
+	for( i = 0; i < ram_len; i++ ) ram_image[i] = rand();
+
+	printf( "%s, %u bytes of flash, %u bytes of RAM\n\n", iss->target_chip->name_str, flash_len, ram_len );
+	for( i = 0; i < sizeof( depths ) / sizeof( depths[0] ); i++ )
+		BenchDepth( &b, depths[i], flash_len, flash_ref, ram_len, ram_image );
+
+	free( flash_ref );
+	free( ram_image );
+	MCF( dev ).HaltMode( dev, HALT_MODE_REBOOT );
+	MCF( dev ).Exit( dev );
+	if( b.failures ) printf( "%d FAILURES\n", b.failures );
+	return b.failures != 0;
+}
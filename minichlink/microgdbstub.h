@@ -35,8 +35,9 @@ int RVGetNumRegisters( void * dev );
 int RVReadCPURegister( void * dev, int regno, uint32_t * regret );
 int RVWriteCPURegister( void * dev, int regno, uint32_t value );
 int RVDebugExec( void * dev, enum HaltResetResumeType halt_reset_or_resume, int resume_from_other_address, uint32_t address );
+int RVDebugRangeStep( void * dev, uint32_t start, uint32_t end ); // Step until PC leaves start...end.  Returns number of steps or negative.
 int RVReadMem( void * dev, uint32_t memaddy, uint8_t * payload, int len );
-int RVHandleBreakpoint( void * dev, int set, uint32_t address );
+int RVHandleBreakpoint( void * dev, int type, int set, uint32_t address, uint32_t length ); // type is the Z type, returns 1 if unsupported.
 int RVWriteRAM(void * dev, uint32_t memaddy, uint32_t length, uint8_t * payload );
 void RVCommandResetPart( void * dev, int mode );
 void RVHandleDisconnect( void * dev );
@@ -362,16 +363,24 @@ void HandleGDBPacket( void * dev, char * data, int len )
 	{
 		uint32_t type = 0;
 		uint32_t addr = 0;
-		uint32_t time = 0;
+		uint32_t kind = 0; // Instruction size for breakpoints, number of bytes for watchpoints.
 		if( ReadHex( &data, -1, &type ) < 0 ) goto err;
 		if( *(data++) != ',' ) goto err;
 		if( ReadHex( &data, -1, &addr ) < 0 ) goto err;
 		if( *(data++) != ',' ) goto err;
-		if( ReadHex( &data, -1, &time ) < 0 ) goto err;
-		if( RVHandleBreakpoint( dev, cmd == 'Z', addr ) == 0 )
+		if( ReadHex( &data, -1, &kind ) < 0 ) goto err;
+		if( type > 4 )
+		{
+			SendReplyFull( "" );
+			break;
+		}
+		int r = RVHandleBreakpoint( dev, type, cmd == 'Z', addr, kind );
+		if( r == 0 )
 		{
 			SendReplyFull( "OK" );
 		}
+		else if( r > 0 )
+			SendReplyFull( "" ); // Not supported, GDB will do it some other way.
 		else
 			goto err;
 		break;
@@ -443,8 +452,8 @@ void HandleGDBPacket( void * dev, char * data, int len )
 				if( de0 == '?' )
 				{
 					// Request a list of actions supported by the ‘vCont’ packet. 
-					// We don't support vCont
-					SendReplyFull( "vCont;c;C;s;S" ); //no ;t because we don't implement them.
+					// We do c, s and r (range step), but not t.
+					SendReplyFull( "vCont;c;C;s;S;r" );
 					break;
 				}
 				else if( de0 == ';' )
@@ -468,6 +477,18 @@ void HandleGDBPacket( void * dev, char * data, int len )
 							RVSendGDBHaltReason( dev );
 							fprintf( stderr, "Step.\n" );
 							break;
+						case 'r':
+						{
+							// Range step: vCont;rSTART,END
+							uint32_t range_start = 0, range_end = 0;
+							de++;
+							if( ReadHex( &de, -1, &range_start ) < 0 ) goto err;
+							if( *(de++) != ',' ) goto err;
+							if( ReadHex( &de, -1, &range_end ) < 0 ) goto err;
+							RVDebugRangeStep( dev, range_start, range_end );
+							RVSendGDBHaltReason( dev );
+							break;
+						}
 						default:
 							SendReplyFull( "E 98" );
 							break;
@@ -563,7 +584,7 @@ void HandleGDBPacket( void * dev, char * data, int len )
 	{
 		uint32_t regno;
 		// Register Read (Specific Reg)
-		if( ReadHex( &data, 2, &regno ) < 0 )
+		if( ReadHex( &data, -1, &regno ) < 0 )
 			SendReplyFull( "E 10" );
 		else
 		{
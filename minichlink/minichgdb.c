@@ -39,62 +39,128 @@ void SendReplyFull( const char * replyMessage );
 int shadow_running_state = 1;
 int last_halt_reason = 5;
 uint32_t backup_regs[33]; //0..15 + PC, or 0..32 + PC
+uint32_t backup_csrs[3]; // mepc, mcause, mtval, so a fault can be looked at without going back to the chip.
+#define GDB_CSR_REGNO( csr ) ( 65 + (csr) ) // How GDB numbers CSRs in 'p' packets.
 int gdbasserting_break = 0;
 
+// Software breakpoints only get written into (or taken out of) flash when the
+// core is about to run, all the ones in a sector at once.  GDB takes them all
+// out and puts them back every time it stops, so usually nothing changes.
 #define MAX_SOFTWARE_BREAKPOINTS 128
 int num_software_breakpoints = 0;
-uint8_t  software_breakpoint_type[MAX_SOFTWARE_BREAKPOINTS]; // 0 = not in use, 1 = 32-bit, 2 = 16-bit.
+uint8_t  software_breakpoint_type[MAX_SOFTWARE_BREAKPOINTS]; // What's on the chip now.  0 = nothing, 1 = 32-bit ebreak, 2 = 16-bit c.ebreak.
+uint8_t  software_breakpoint_wanted[MAX_SOFTWARE_BREAKPOINTS]; // If GDB wants one there.  Slot is free if this and type are 0.
 uint32_t software_breakpoint_addy[MAX_SOFTWARE_BREAKPOINTS];
 uint32_t previous_word_at_breakpoint_address[MAX_SOFTWARE_BREAKPOINTS];
 
+// Hardware breakpoints and watchpoints, using the trigger module (tselect/tdata1/tdata2).
+// Software breakpoints mean rewriting a flash sector, so these get used first.
+#define MAX_HARDWARE_TRIGGERS 16
+int num_hardware_triggers = -1; // -1 = haven't looked yet.
+uint8_t  hardware_trigger_type[MAX_HARDWARE_TRIGGERS]; // 0 = not in use, otherwise 1 + the GDB Z type (1/2 = execute, 3 = write, 4 = read, 5 = access)
+uint32_t hardware_trigger_addy[MAX_HARDWARE_TRIGGERS];
+char halt_reason_extra[32]; // i.e. "watch:20000010;" for the next stop reply.
+
+#define CSR_TSELECT 0x7a0
+#define CSR_TDATA1  0x7a1
+#define CSR_TDATA2  0x7a2
+
+// mcontrol: type 2, only the debugger can change it, enter debug mode on match, in M and U mode.
+#define MCONTROL_BASE     ( ( 2U<<28 ) | ( 1<<27 ) | ( 1<<12 ) | ( 1<<6 ) | ( 1<<3 ) )
+#define MCONTROL_HIT      ( 1<<20 )
+#define MCONTROL_NAPOT    ( 1<<7 )
+#define MCONTROL_EXECUTE  ( 1<<2 )
+#define MCONTROL_STORE    ( 1<<1 )
+#define MCONTROL_LOAD     ( 1<<0 )
+
+// Cache of what GDB reads while the core is halted, it reads the same stack and
+// code over and over.  Flash stays cached until we write or erase it, RAM until
+// the core runs again.  Peripherals are never cached.  Reads are done in whole,
+// aligned blocks.
+#define MEMCACHE_BLOCK  64
+#define MEMCACHE_BLOCKS 512
+uint32_t memcache_addy[MEMCACHE_BLOCKS]; // Block address, | 1 if valid.
+uint8_t  memcache_data[MEMCACHE_BLOCKS][MEMCACHE_BLOCK];
+
 int IsGDBServerInShadowHaltState( void * dev ) { return !shadow_running_state; }
 
-static int InternalClearFlashOfSoftwareBreakpoint( void * dev, int i );
-static int InternalWriteBreakpointIntoAddress( void * v, int i );
+static int InternalSoftwareBreakpointAt( uint32_t address );
+static void InternalMemCacheInvalidate( uint32_t address, uint32_t length );
+static void InternalMemCacheDropRAM();
+static int InternalCommitSoftwareBreakpoints( void * dev, int leave_out );
+static int InternalHardwareTriggerAt( uint32_t address );
+static int InternalWriteTrigger( void * dev, int i, uint32_t tdata1, uint32_t tdata2 );
 
 
 void RVCommandPrologue( void * dev )
 {
-	if( !MCF.ReadCPURegister )
+	if( !MCF( dev ).ReadCPURegister )
 	{
 		fprintf( stderr, "Error: Programmer does not support register reading\n" );
 		exit( -5 );
 	}
 
-	MCF.WriteReg32( dev, DMABSTRACTAUTO, 0 );     // Disable autoexec.
-	if( MCF.ReadAllCPURegisters( dev, backup_regs ) )
+	MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0 );     // Disable autoexec.
+	if( MCF( dev ).ReadAllCPURegisters( dev, backup_regs ) )
 	{
 		fprintf( stderr, "WARNING: failed to preserve registers\n" );
 	}
-	MCF.VoidHighLevelState( dev );
+	DMIQueueReadRegisters( dev, 0x341, 3, backup_csrs ); // mepc, mcause, mtval
+	DMIFlush( dev );
+	MCF( dev ).VoidHighLevelState( dev );
 }
 
 void RVCommandEpilogue( void * dev )
 {
-	MCF.WriteReg32( dev, DMABSTRACTAUTO, 0 );   // Disable autoexec.
-	MCF.WriteAllCPURegisters( dev, backup_regs );
-	MCF.VoidHighLevelState( dev );
-	MCF.WriteReg32( dev, DMDATA0, 0 );
+	MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0 );   // Disable autoexec.
+	MCF( dev ).WriteAllCPURegisters( dev, backup_regs );
+	MCF( dev ).VoidHighLevelState( dev );
+	MCF( dev ).WriteReg32( dev, DMDATA0, 0 );
 }
 
 void RVCommandResetPart( void * dev , int mode)
 {
-	MCF.HaltMode( dev, mode );
+	InternalMemCacheDropRAM();
+	MCF( dev ).HaltMode( dev, mode );
 	RVCommandPrologue( dev );
 }
 
 void RVNetConnect( void * dev )
 {
 	// ??? Should we actually halt?
-	MCF.HaltMode( dev, 5 );
-	MCF.SetEnableBreakpoints( dev, 1, 0 );
+	MCF( dev ).HaltMode( dev, 5 );
+	MCF( dev ).SetEnableBreakpoints( dev, 1, 0 );
 	RVCommandPrologue( dev );
 	shadow_running_state = 0;
+	memset( memcache_addy, 0, sizeof( memcache_addy ) ); // Could have been reflashed since last time.
+
+	if( num_hardware_triggers < 0 )
+	{
+		// See how many triggers there are.  tselect reads back as something
+		// else, or tdata1 isn't an mcontrol, once we've run out.  No trigger
+		// module at all shows up as an abstract command error.
+		num_hardware_triggers = 0;
+		while( num_hardware_triggers < MAX_HARDWARE_TRIGGERS )
+		{
+			uint32_t tselect = 0, tdata1 = 0, abstractcs = 0;
+			if( MCF( dev ).WriteCPURegister( dev, CSR_TSELECT, num_hardware_triggers ) ||
+				MCF( dev ).ReadCPURegister( dev, CSR_TSELECT, &tselect ) ||
+				MCF( dev ).ReadCPURegister( dev, CSR_TDATA1, &tdata1 ) ||
+				MCF( dev ).ReadReg32( dev, DMABSTRACTCS, &abstractcs ) || ( abstractcs & 0x700 ) ||
+				tselect != num_hardware_triggers || ( tdata1 >> 28 ) != 2 )
+				break;
+			InternalWriteTrigger( dev, num_hardware_triggers, 0, 0 ); // Something could be left over from last time.
+			num_hardware_triggers++;
+		}
+		// If reading CSRs failed, the abstract command error needs to be cleared.
+		MCF( dev ).WriteReg32( dev, DMABSTRACTCS, 0x00000700 );
+		fprintf( stderr, "Hardware breakpoints/watchpoints: %d\n", num_hardware_triggers );
+	}
 }
 
 int RVSendGDBHaltReason( void * dev )
 { 
-	char st[5];
+	char st[40];
 	if( gdbasserting_break )
 	{
 		gdbasserting_break = 0;
@@ -102,21 +168,62 @@ int RVSendGDBHaltReason( void * dev )
 		SendReplyFull( st );
 		return 0;
 	}
-	sprintf( st, "T%02x", last_halt_reason );
+	snprintf( st, sizeof( st ), "T%02x%s", last_halt_reason, halt_reason_extra );
 	SendReplyFull( st );
 	return 0;
 }
 
+// If we stopped because of a trigger, tell GDB which one, it needs to know which watchpoint it was.
+static void InternalFindHaltTrigger( void * dev )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	uint32_t dcsr = 0;
+	int i;
+
+	halt_reason_extra[0] = 0;
+	if( num_hardware_triggers <= 0 ) return;
+	if( MCF( dev ).ReadCPURegister( dev, 0x7b0, &dcsr ) || ( ( dcsr >> 6 ) & 7 ) != 2 ) return; // cause 2 = trigger
+
+	int found = InternalHardwareTriggerAt( backup_regs[iss->nr_registers_for_debug] );
+	for( i = 0; i < num_hardware_triggers; i++ )
+	{
+		uint32_t tdata1 = 0;
+		if( hardware_trigger_type[i] < 3 ) continue;
+		MCF( dev ).WriteCPURegister( dev, CSR_TSELECT, i );
+		MCF( dev ).ReadCPURegister( dev, CSR_TDATA1, &tdata1 );
+		if( !( tdata1 & MCONTROL_HIT ) ) continue;
+		MCF( dev ).WriteCPURegister( dev, CSR_TDATA1, tdata1 & ~MCONTROL_HIT );
+		found = i;
+		break;
+	}
+	if( found < 0 )
+	{
+		// Not everything sets the hit bit.  If it wasn't a breakpoint, guess the first watchpoint.
+		for( i = 0; i < num_hardware_triggers; i++ )
+			if( hardware_trigger_type[i] >= 3 ) { found = i; break; }
+		if( found < 0 ) return;
+	}
+
+	static const char * const watchnames[] = { "watch", "rwatch", "awatch" };
+	int type = hardware_trigger_type[found] - 1;
+	if( type == 0 )
+		return; // GDB asked for a software breakpoint, so it expects to see one.
+	else if( type == 1 )
+		sprintf( halt_reason_extra, "hwbreak:;" );
+	else
+		sprintf( halt_reason_extra, "%s:%08x;", watchnames[type - 2], hardware_trigger_addy[found] );
+}
+
 void RVNetPoll(void * dev )
 {
-	if( !MCF.ReadReg32 )
+	if( !MCF( dev ).ReadReg32 )
 	{
 		fprintf( stderr, "Error: Can't poll GDB because no ReadReg32 supported on this programmer\n" );
 		return;
 	}
 
 	uint32_t status;
-	if( MCF.ReadReg32( dev, DMSTATUS, &status ) )
+	if( MCF( dev ).ReadReg32( dev, DMSTATUS, &status ) )
 	{
 		fprintf( stderr, "Error: Could not get part status\n" );
 		return;
@@ -135,6 +242,7 @@ void RVNetPoll(void * dev )
 		if( statusrunning == 0 )
 		{
 			RVCommandPrologue( dev );
+			InternalFindHaltTrigger( dev );
 			last_halt_reason = 5;//((dscr>>6)&3)+5;
 			RVSendGDBHaltReason( dev );
 		}
@@ -160,11 +268,17 @@ int RVReadCPURegister( void * dev, int regno, uint32_t * regret )
 
 	if( shadow_running_state )
 	{
-		MCF.HaltMode( dev, 5 );
+		MCF( dev ).HaltMode( dev, 5 );
 		RVCommandPrologue( dev );
 		shadow_running_state = 0;
 	}
 
+	if( regno >= GDB_CSR_REGNO( 0x341 ) && regno <= GDB_CSR_REGNO( 0x343 ) )
+	{
+		*regret = backup_csrs[regno - GDB_CSR_REGNO( 0x341 )];
+		return 0;
+	}
+
 	if( nrregs == 16 )
 	{
 		if( regno == 32 ) regno = 16; // Hack - Make 32 also 16 for old GDBs.
@@ -187,7 +301,7 @@ int RVWriteCPURegister( void * dev, int regno, uint32_t value )
 
 	if( shadow_running_state )
 	{
-		MCF.HaltMode( dev, 5 );
+		MCF( dev ).HaltMode( dev, 5 );
 		RVCommandPrologue( dev );
 		shadow_running_state = 0;
 	}
@@ -204,14 +318,14 @@ int RVWriteCPURegister( void * dev, int regno, uint32_t value )
 
 	backup_regs[regno] = value;
 
-	if( !MCF.WriteAllCPURegisters )
+	if( !MCF( dev ).WriteAllCPURegisters )
 	{
 		fprintf( stderr, "ERROR: MCF.WriteAllCPURegisters is not implemented on this platform\n" );
 		return -99;
 	}
 
 	int r;
-	if( ( r = MCF.WriteAllCPURegisters( dev, backup_regs ) ) )
+	if( ( r = MCF( dev ).WriteAllCPURegisters( dev, backup_regs ) ) )
 	{
 		fprintf( stderr, "Error: WriteAllCPURegisters failed (%d)\n", r );
 		return r;
@@ -219,26 +333,44 @@ int RVWriteCPURegister( void * dev, int regno, uint32_t value )
 	return 0;
 }
 
+// Execute one instruction.  A hardware breakpoint right where we are would go
+// off before it even runs, so that one gets turned off while we step.
+static void InternalSingleStep( void * dev )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	InternalCommitSoftwareBreakpoints( dev, InternalSoftwareBreakpointAt( backup_regs[iss->nr_registers_for_debug] ) );
+	int trigger = InternalHardwareTriggerAt( backup_regs[iss->nr_registers_for_debug] );
+	if( trigger >= 0 )
+		InternalWriteTrigger( dev, trigger, 0, 0 );
+
+	MCF( dev ).SetEnableBreakpoints( dev, 1, 1 );
+	RVCommandEpilogue( dev );
+	MCF( dev ).HaltMode( dev, HALT_MODE_RESUME );
+	MCF( dev ).HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET );
+	RVCommandPrologue( dev );
+	MCF( dev ).SetEnableBreakpoints( dev, 1, 0 );
+
+	if( trigger >= 0 )
+		InternalWriteTrigger( dev, trigger, MCONTROL_BASE | MCONTROL_EXECUTE, hardware_trigger_addy[trigger] );
+	//printf( "STEP PC: %08x\n", backup_regs[iss->nr_registers_for_debug] );
+}
+
 int RVDebugExec( void * dev, enum HaltResetResumeType halt_reset_or_resume, int resume_from_other_address, uint32_t address )
 {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 	int nrregs = iss->nr_registers_for_debug;
 
-	if( !MCF.HaltMode )
+	if( !MCF( dev ).HaltMode )
 	{
 		fprintf( stderr, "Error: Can't alter halt mode with this programmer.\n" );
 		exit( -6 );
 	}
-	
+
+	halt_reason_extra[0] = 0;
+	InternalMemCacheDropRAM();
 	if( halt_reset_or_resume == HALT_TYPE_SINGLE_STEP )
 	{
-		MCF.SetEnableBreakpoints( dev, 1, 1 );
-		RVCommandEpilogue( dev );
-		MCF.HaltMode( dev, HALT_MODE_RESUME );
-		MCF.HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET );
-		RVCommandPrologue( dev );
-		MCF.SetEnableBreakpoints( dev, 1, 0 );
-		//printf( "STEP PC: %08x\n", backup_regs[iss->nr_registers_for_debug] );
+		InternalSingleStep( dev );
 		return 0;
 	}
 
@@ -246,26 +378,24 @@ int RVDebugExec( void * dev, enum HaltResetResumeType halt_reset_or_resume, int
 	if( halt_reset_or_resume == HALT_TYPE_CONTINUE_WITH_SIGNAL || halt_reset_or_resume == HALT_TYPE_CONTINUE )
 	{
 		// First see if we already know about this breakpoint
-		int matchingbreakpoint = -1;
 		// For this we want to advance PC.
 		uint32_t exceptionptr = backup_regs[nrregs];
 		uint32_t instruction = 0;
+		int matchingbreakpoint = InternalSoftwareBreakpointAt( exceptionptr );
 
-		int i;
-		for( i = 0; i < MAX_SOFTWARE_BREAKPOINTS; i++ )
-		{
-			if( exceptionptr == software_breakpoint_addy[i] && software_breakpoint_type[i] )
-			{
-				matchingbreakpoint = i;
-			}
-		}
+		// Get the flash to how GDB wants it, so whatever is at PC now is real.
+		InternalCommitSoftwareBreakpoints( dev, matchingbreakpoint );
 
 		if( matchingbreakpoint >= 0 )
 		{
-			// This is a known breakpoint.  Need to set it back.  Single Step.  Then continue.
-			InternalClearFlashOfSoftwareBreakpoint( dev, matchingbreakpoint );
-			MCF.SetEnableBreakpoints( dev, 1, 1 );
-			InternalWriteBreakpointIntoAddress( dev, matchingbreakpoint );
+			// This is a known breakpoint.  It's out for now.  Single Step.  Put it back.  Then continue.
+			InternalSingleStep( dev );
+			InternalCommitSoftwareBreakpoints( dev, -1 );
+		}
+		else if( InternalHardwareTriggerAt( exceptionptr ) >= 0 )
+		{
+			// Sitting on a hardware breakpoint, get past it first or it would just go off again.
+			InternalSingleStep( dev );
 		}
 		else
 		{
@@ -274,13 +404,13 @@ int RVDebugExec( void * dev, enum HaltResetResumeType halt_reset_or_resume, int
 			if( exceptionptr & 2 )
 			{
 				uint32_t part1, part2;
-				MCF.ReadWord( dev, exceptionptr & ~3, &part1 );
-				MCF.ReadWord( dev, (exceptionptr & ~3)+4, &part2 );
+				MCF( dev ).ReadWord( dev, exceptionptr & ~3, &part1 );
+				MCF( dev ).ReadWord( dev, (exceptionptr & ~3)+4, &part2 );
 				instruction = (part1 >> 16) | (part2 << 16);
 			}
 			else
 			{
-				MCF.ReadWord( dev, exceptionptr, &instruction );
+				MCF( dev ).ReadWord( dev, exceptionptr, &instruction );
 			}
 			if( instruction == 0x00100073 )
 				backup_regs[nrregs]+=4;
@@ -291,7 +421,7 @@ int RVDebugExec( void * dev, enum HaltResetResumeType halt_reset_or_resume, int
 
 			if( halt_reset_or_resume == HALT_TYPE_CONTINUE_WITH_SIGNAL )
 			{
-				MCF.SetEnableBreakpoints( dev, 1, 1 );
+				MCF( dev ).SetEnableBreakpoints( dev, 1, 1 );
 			}
 		}
 
@@ -309,21 +439,176 @@ int RVDebugExec( void * dev, enum HaltResetResumeType halt_reset_or_resume, int
 			RVCommandEpilogue( dev );
 		}
 
-		MCF.HaltMode( dev, halt_reset_or_resume );
+		MCF( dev ).HaltMode( dev, halt_reset_or_resume );
 	}
 
 	shadow_running_state = halt_reset_or_resume >= HALT_TYPE_CONTINUE;
 	return 0;
 }
 
+static int InternalMemCacheable( void * dev, uint32_t block )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	if( IsAddressFlash( block ) ) return 1;
+	return block >= iss->ram_base && block + MEMCACHE_BLOCK <= iss->ram_base + iss->ram_size;
+}
+
+static void InternalMemCacheInvalidate( uint32_t address, uint32_t length )
+{
+	int i;
+	for( i = 0; i < MEMCACHE_BLOCKS; i++ )
+	{
+		uint32_t block = memcache_addy[i] & ~1;
+		if( !( memcache_addy[i] & 1 ) ) continue;
+		// Flash shows up at more than one address, so any flash write loses all of it.
+		if( ( IsAddressFlash( address ) && IsAddressFlash( block ) ) ||
+			( block < address + length && block + MEMCACHE_BLOCK > address ) )
+			memcache_addy[i] = 0;
+	}
+}
+
+static void InternalMemCacheDropRAM()
+{
+	int i;
+	for( i = 0; i < MEMCACHE_BLOCKS; i++ )
+		if( !IsAddressFlash( memcache_addy[i] ) ) memcache_addy[i] = 0;
+}
+
+static int InternalCachedRead( void * dev, uint32_t memaddy, uint8_t * payload, int len )
+{
+	uint32_t first = memaddy & ~( MEMCACHE_BLOCK - 1 );
+	uint32_t end = ( memaddy + len + MEMCACHE_BLOCK - 1 ) & ~( MEMCACHE_BLOCK - 1 );
+	uint32_t block;
+
+	if( shadow_running_state || end < first || end - first > MEMCACHE_BLOCKS / 2 * MEMCACHE_BLOCK )
+		return MCF( dev ).ReadBinaryBlob( dev, memaddy, len, payload );
+	for( block = first; block < end; block += MEMCACHE_BLOCK )
+		if( !InternalMemCacheable( dev, block ) )
+			return MCF( dev ).ReadBinaryBlob( dev, memaddy, len, payload );
+
+	block = first;
+	while( block < end )
+	{
+		int slot = ( block / MEMCACHE_BLOCK ) % MEMCACHE_BLOCKS;
+		if( memcache_addy[slot] == ( block | 1 ) )
+		{
+			uint32_t s = ( block < memaddy ) ? memaddy : block;
+			uint32_t e = ( block + MEMCACHE_BLOCK > memaddy + len ) ? memaddy + len : block + MEMCACHE_BLOCK;
+			memcpy( payload + ( s - memaddy ), memcache_data[slot] + ( s - block ), e - s );
+			block += MEMCACHE_BLOCK;
+			continue;
+		}
+
+		// Read the whole run of blocks we don't have in one go.
+		uint32_t run_end = block + MEMCACHE_BLOCK;
+		while( run_end < end && memcache_addy[( run_end / MEMCACHE_BLOCK ) % MEMCACHE_BLOCKS] != ( run_end | 1 ) )
+			run_end += MEMCACHE_BLOCK;
+		uint32_t run_start = block;
+		uint8_t * run = malloc( run_end - run_start );
+		int r = MCF( dev ).ReadBinaryBlob( dev, run_start, run_end - run_start, run );
+		if( r < 0 )
+		{
+			// Maybe we went past the end of something, just try what was asked for.
+			free( run );
+			return MCF( dev ).ReadBinaryBlob( dev, memaddy, len, payload );
+		}
+		uint32_t s = ( run_start < memaddy ) ? memaddy : run_start;
+		uint32_t e = ( run_end > memaddy + len ) ? memaddy + len : run_end;
+		memcpy( payload + ( s - memaddy ), run + ( s - run_start ), e - s );
+		for( ; block < run_end; block += MEMCACHE_BLOCK )
+		{
+			slot = ( block / MEMCACHE_BLOCK ) % MEMCACHE_BLOCKS;
+			memcache_addy[slot] = block | 1;
+			memcpy( memcache_data[slot], run + ( block - run_start ), MEMCACHE_BLOCK );
+		}
+		free( run );
+	}
+	return 0;
+}
+
+// vCont;r: Keep stepping while PC is in start...end, without going back to GDB
+// every instruction.  Each step is just a resume (with dcsr.step set) and a
+// read of dpc, all in one DMI queue.  Stops early at breakpoints, or if PC
+// didn't move (ebreak, triggers, jumps to self), and every so often anyway so
+// GDB can get a word in.
+#define RANGE_STEP_LIMIT 20000
+
+int RVDebugRangeStep( void * dev, uint32_t start, uint32_t end )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	int nrregs = iss->nr_registers_for_debug;
+	uint32_t pc, before, status = 0, abstractcs = 0;
+	int steps = 1;
+
+	halt_reason_extra[0] = 0;
+	InternalMemCacheDropRAM();
+
+	// The first one might have to get off of a breakpoint.
+	InternalSingleStep( dev );
+	pc = backup_regs[nrregs];
+	if( pc < start || pc >= end || InternalSoftwareBreakpointAt( pc ) >= 0 || InternalHardwareTriggerAt( pc ) >= 0 )
+		return steps;
+
+	InternalCommitSoftwareBreakpoints( dev, -1 );
+	MCF( dev ).SetEnableBreakpoints( dev, 1, 1 );
+	RVCommandEpilogue( dev );
+
+	while( steps < RANGE_STEP_LIMIT )
+	{
+		before = pc;
+		DMIQueueWrite( dev, DMCONTROL, 0x40000001 ); // resumereq, which only goes one instruction.
+		DMIQueueRead( dev, DMSTATUS, &status );
+		DMIQueueWrite( dev, DMCOMMAND, 0x00220000 | 0x7b1 ); // Read dpc into DATA0.
+		DMIQueueRead( dev, DMDATA0, &pc );
+		DMIQueueRead( dev, DMABSTRACTCS, &abstractcs );
+		if( DMIFlush( dev ) ) break;
+
+		if( !( status & ( 1<<9 ) ) || ( abstractcs & 0x700 ) )
+		{
+			// It hadn't stopped again by the time we asked (WFI, or a slow flash access).
+			int tries;
+			MCF( dev ).WriteReg32( dev, DMABSTRACTCS, 0x00000700 ); // Clear cmderr.
+			for( tries = 0; tries < 100; tries++ )
+				if( MCF( dev ).ReadReg32( dev, DMSTATUS, &status ) || ( status & ( 1<<9 ) ) ) break;
+			if( !( status & ( 1<<9 ) ) )
+				MCF( dev ).HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET );
+			if( MCF( dev ).ReadCPURegister( dev, 0x7b1, &pc ) ) break;
+		}
+		steps++;
+
+		if( pc < start || pc >= end || pc == before ||
+			InternalSoftwareBreakpointAt( pc ) >= 0 || InternalHardwareTriggerAt( pc ) >= 0 )
+			break;
+	}
+
+	RVCommandPrologue( dev );
+	MCF( dev ).SetEnableBreakpoints( dev, 1, 0 );
+	InternalFindHaltTrigger( dev );
+	return steps;
+}
+
 int RVReadMem( void * dev, uint32_t memaddy, uint8_t * payload, int len )
 {
-	if( !MCF.ReadBinaryBlob )
+	if( !MCF( dev ).ReadBinaryBlob )
 	{
 		fprintf( stderr, "Error: Can't alter halt mode with this programmer.\n" );
 		exit( -6 );
 	}
-	int ret = MCF.ReadBinaryBlob( dev, memaddy, len, payload );
+	int ret = InternalCachedRead( dev, memaddy, payload, len );
+
+	// Show what's really there under breakpoints still on the chip.
+	int i, j;
+	for( i = 0; i < MAX_SOFTWARE_BREAKPOINTS && ret >= 0; i++ )
+	{
+		if( !software_breakpoint_type[i] ) continue;
+		int size = ( software_breakpoint_type[i] == 1 ) ? 4 : 2;
+		for( j = 0; j < size; j++ )
+		{
+			uint32_t a = software_breakpoint_addy[i] + j;
+			if( a >= memaddy && a < memaddy + len )
+				payload[a - memaddy] = previous_word_at_breakpoint_address[i] >> ( j * 8 );
+		}
+	}
 	//printf( "Read Mem: %08x %d\n", memaddy, len );
 	//int i;
 	//for( i = 0; i < len; i++ )
@@ -338,109 +623,242 @@ int RVReadMem( void * dev, uint32_t memaddy, uint8_t * payload, int len )
 	return ret;
 }
 
-static int InternalClearFlashOfSoftwareBreakpoint( void * dev, int i )
+static int InternalSoftwareBreakpointAt( uint32_t address )
 {
-	int r;
-	if( software_breakpoint_type[i] == 1 )
+	int i;
+	for( i = 0; i < MAX_SOFTWARE_BREAKPOINTS; i++ )
+		if( software_breakpoint_wanted[i] && software_breakpoint_addy[i] == address )
+			return i;
+	return -1;
+}
+
+static int InternalSoftwareBreakpointNeedsWrite( int i, int leave_out )
+{
+	int want = software_breakpoint_wanted[i] && i != leave_out;
+	return want != ( software_breakpoint_type[i] != 0 );
+}
+
+// Something else wrote over address...address+length, so any breakpoints there are gone.
+static void InternalForgetSoftwareBreakpoints( uint32_t address, uint32_t length )
+{
+	int i;
+	for( i = 0; i < MAX_SOFTWARE_BREAKPOINTS; i++ )
 	{
-		//32-bit instruction
-		r = MCF.WriteBinaryBlob( dev, software_breakpoint_addy[i], 4, (uint8_t*)&previous_word_at_breakpoint_address[i] );
+		uint32_t a = software_breakpoint_addy[i];
+		if( !software_breakpoint_type[i] || a + 4 <= address || a >= address + length ) continue;
+		software_breakpoint_type[i] = 0;
+		if( !software_breakpoint_wanted[i] ) software_breakpoint_addy[i] = 0;
 	}
-	else
+}
+
+// Make the chip match software_breakpoint_wanted[], except leave_out (-1 for
+// none) is left out.  Every flash sector that needs changing is read, patched
+// and written once.
+static int InternalCommitSoftwareBreakpoints( void * dev, int leave_out )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	uint32_t sectorsize = iss->sector_size ? iss->sector_size : 64;
+	uint8_t * buffer = 0;
+	int i, j, ret = 0;
+
+	for( i = 0; i < MAX_SOFTWARE_BREAKPOINTS; i++ )
 	{
-		//16-bit instruction
-		r = MCF.WriteBinaryBlob( dev, software_breakpoint_addy[i], 2, (uint8_t*)&previous_word_at_breakpoint_address[i] );
+		if( !InternalSoftwareBreakpointNeedsWrite( i, leave_out ) ) continue;
+
+		uint32_t address = software_breakpoint_addy[i];
+		uint32_t start, len;
+		if( IsAddressFlash( address ) )
+		{
+			start = address & ~( sectorsize - 1 );
+			len = sectorsize;
+			if( address + 4 > start + len ) len += sectorsize; // A 32-bit instruction could run into the next sector.
+		}
+		else
+		{
+			// In RAM, just write the instruction.
+			start = address & ~3;
+			len = 8;
+		}
+
+		buffer = realloc( buffer, len );
+		if( MCF( dev ).ReadBinaryBlob( dev, start, len, buffer ) )
+		{
+			fprintf( stderr, "Error: Could not read %08x to set breakpoints\n", start );
+			ret = -5;
+			break;
+		}
+
+		for( j = i; j < MAX_SOFTWARE_BREAKPOINTS; j++ )
+		{
+			uint32_t a = software_breakpoint_addy[j];
+			if( !InternalSoftwareBreakpointNeedsWrite( j, leave_out ) || a < start || a + 2 > start + len ) continue;
+			uint8_t * p = buffer + ( a - start );
+			if( software_breakpoint_type[j] )
+			{
+				// Put back what was there.
+				if( software_breakpoint_type[j] == 1 && a + 4 > start + len ) continue; // Gets its own turn.
+				memcpy( p, &previous_word_at_breakpoint_address[j], ( software_breakpoint_type[j] == 1 ) ? 4 : 2 );
+				software_breakpoint_type[j] = 0;
+				if( !software_breakpoint_wanted[j] ) software_breakpoint_addy[j] = 0;
+			}
+			else if( ( p[0] & 3 ) == 3 ) // Check opcode LSB's.
+			{
+				// 32-bit instruction.
+				if( a + 4 > start + len ) continue; // Gets its own turn.
+				uint32_t ebreak = 0x00100073; // ebreak
+				memcpy( &previous_word_at_breakpoint_address[j], p, 4 );
+				memcpy( p, &ebreak, 4 );
+				software_breakpoint_type[j] = 1;
+			}
+			else
+			{
+				// 16-bit instructions
+				uint16_t ebreak = 0x9002; // c.ebreak
+				previous_word_at_breakpoint_address[j] = p[0] | ( p[1] << 8 );
+				memcpy( p, &ebreak, 2 );
+				software_breakpoint_type[j] = 2;
+			}
+		}
+
+		InternalMemCacheInvalidate( start, len );
+		if( MCF( dev ).WriteBinaryBlob( dev, start, len, buffer ) )
+		{
+			fprintf( stderr, "Error: Could not write breakpoints at %08x\n", start );
+			ret = -5;
+			break;
+		}
 	}
+	free( buffer );
+	return ret;
+}
 
-	return r;
+static int InternalHardwareTriggerAt( uint32_t address )
+{
+	int i;
+	for( i = 0; i < num_hardware_triggers; i++ )
+		if( hardware_trigger_type[i] && hardware_trigger_type[i] < 3 && hardware_trigger_addy[i] == address )
+			return i;
+	return -1;
 }
 
-static int InternalWriteBreakpointIntoAddress( void * dev, int i )
+// Writing tdata1 = 0 turns the trigger off.  Returns nonzero if the trigger
+// didn't take all the bits we asked for (tdata1 is WARL).
+static int InternalWriteTrigger( void * dev, int i, uint32_t tdata1, uint32_t tdata2 )
 {
-	int r;
-	uint32_t address = software_breakpoint_addy[i];
-	if( software_breakpoint_type[i] == 1 )
+	uint32_t readback = 0;
+	const uint32_t needed = MCONTROL_EXECUTE | MCONTROL_STORE | MCONTROL_LOAD | MCONTROL_NAPOT | ( 1<<12 );
+	if( MCF( dev ).WriteCPURegister( dev, CSR_TSELECT, i ) ) return -1;
+	if( MCF( dev ).WriteCPURegister( dev, CSR_TDATA1, 0 ) ) return -1; // So it can't go off halfway through.
+	if( !tdata1 ) return 0;
+	if( MCF( dev ).WriteCPURegister( dev, CSR_TDATA2, tdata2 ) ) return -1;
+	if( MCF( dev ).WriteCPURegister( dev, CSR_TDATA1, tdata1 ) ) return -1;
+	if( MCF( dev ).ReadCPURegister( dev, CSR_TDATA1, &readback ) ) return -1;
+	if( ( readback & needed ) != ( tdata1 & needed ) )
+	{
+		MCF( dev ).WriteCPURegister( dev, CSR_TDATA1, 0 );
+		return 1;
+	}
+	return 0;
+}
+
+// Set or clear a hardware breakpoint (type 0/1) or watchpoint (type 2..4).
+// Returns 0 if ok, 1 if there's no trigger free, negative if it didn't work.
+static int InternalHandleHardwareTrigger( void * dev, int type, int set, uint32_t address, uint32_t length )
+{
+	int i;
+	int first_free = -1;
+	int is_watch = type >= 2;
+
+	for( i = 0; i < num_hardware_triggers; i++ )
 	{
-		//32-bit instruction
-		uint32_t ebreak = 0x00100073; // ebreak
-		r = MCF.WriteBinaryBlob( dev, address, 4, (uint8_t*)&ebreak );
+		if( hardware_trigger_type[i] == type + 1 && hardware_trigger_addy[i] == address )
+			break;
+		if( first_free < 0 && hardware_trigger_type[i] == 0 )
+			first_free = i;
 	}
-	else
+
+	if( !set )
 	{
-		//16-bit instruction
-		uint32_t ebreak = 0x9002; // c.ebreak
-		r = MCF.WriteBinaryBlob( dev, address, 2, (uint8_t*)&ebreak );
+		if( i == num_hardware_triggers ) return 1;
+		hardware_trigger_type[i] = 0;
+		return InternalWriteTrigger( dev, i, 0, 0 ) ? -5 : 0;
 	}
-	return r;
-}
 
-static int InternalDisableBreakpoint( void * dev, int i )
-{
-	int r;
-	r = InternalClearFlashOfSoftwareBreakpoint( dev, i );
-	previous_word_at_breakpoint_address[i] = 0;
-	software_breakpoint_type[i] = 0;
-	software_breakpoint_addy[i] = 0;
-	return r;
+	if( i != num_hardware_triggers ) return 0; // Already set.
+	if( first_free < 0 ) return 1;
+
+	uint32_t tdata1 = MCONTROL_BASE;
+	uint32_t tdata2 = address;
+	if( type < 2 ) tdata1 |= MCONTROL_EXECUTE;
+	if( type == 2 || type == 4 ) tdata1 |= MCONTROL_STORE;
+	if( type == 3 || type == 4 ) tdata1 |= MCONTROL_LOAD;
+
+	if( is_watch && length > 1 )
+	{
+		// Match a naturally aligned power of two sized block that covers everything.
+		uint32_t size = 2;
+		while( size && ( address & ~( size - 1 ) ) != ( ( address + length - 1 ) & ~( size - 1 ) ) )
+			size <<= 1;
+		if( !size ) return -1;
+		tdata1 |= MCONTROL_NAPOT;
+		tdata2 = ( address & ~( size - 1 ) ) | ( size / 2 - 1 );
+	}
+
+	int r = InternalWriteTrigger( dev, first_free, tdata1, tdata2 );
+	if( r > 0 && ( tdata1 & MCONTROL_NAPOT ) )
+	{
+		// This trigger can only match one address.  Word accesses to the start of it are the usual case.
+		fprintf( stderr, "Warning: Watchpoint can only match address %08x, not %d bytes\n", address, length );
+		r = InternalWriteTrigger( dev, first_free, tdata1 & ~MCONTROL_NAPOT, address );
+	}
+	if( r ) return ( r > 0 ) ? 1 : -5;
+
+	hardware_trigger_type[first_free] = type + 1;
+	hardware_trigger_addy[first_free] = address;
+	return 0;
 }
 
-int RVHandleBreakpoint( void * dev, int set, uint32_t address )
+int RVHandleBreakpoint( void * dev, int type, int set, uint32_t address, uint32_t length )
 {
 	int i;
 	int first_free = -1;
+
+	if( type >= 1 )
+	{
+		// Explicitly hardware.  If there aren't any triggers, let GDB know it has to do without.
+		if( num_hardware_triggers <= 0 ) return 1;
+		int r = InternalHandleHardwareTrigger( dev, type, set, address, length );
+		if( r > 0 && set ) fprintf( stderr, "Error: Out of hardware breakpoints/watchpoints\n" );
+		return ( r > 0 ) ? ( set ? -1 : 0 ) : r;
+	}
+
+	// Software breakpoints go into a trigger if we can, and only into flash if we run out.
+	if( InternalHandleHardwareTrigger( dev, 0, set, address, length ) == 0 )
+		return 0;
+
+	// Nothing touches the chip here, InternalCommitSoftwareBreakpoints does it when we resume.
 	for( i = 0; i < MAX_SOFTWARE_BREAKPOINTS; i++ )
 	{
-		if( software_breakpoint_type[i] && software_breakpoint_addy[i] == address )
+		if( ( software_breakpoint_wanted[i] || software_breakpoint_type[i] ) && software_breakpoint_addy[i] == address )
 			break;
-		if( first_free < 0 && software_breakpoint_type[i] == 0 )
+		if( first_free < 0 && !software_breakpoint_wanted[i] && !software_breakpoint_type[i] )
 			first_free = i;
 	}
 
 	if( i != MAX_SOFTWARE_BREAKPOINTS )
 	{
-		// There is already a break slot here.
-		if( !set )
-		{
-			InternalDisableBreakpoint( dev, i );
-		}
-		else
-		{
-			// Already set.
-		}
+		// There is already a break slot here (maybe on its way out).
+		software_breakpoint_wanted[i] = set;
 	}
-	else
+	else if( set )
 	{
 		if( first_free == -1 )
 		{
 			fprintf( stderr, "Error: Too many breakpoints\n" );
 			return -1;
 		}
-		if( set )
-		{
-			i = first_free;
-			uint32_t readval_at_addy;
-			int r = MCF.ReadBinaryBlob( dev, address, 4, (uint8_t*)&readval_at_addy );
-			if( r ) return -5;
-			if( ( readval_at_addy & 3 ) == 3 ) // Check opcode LSB's.
-			{
-				// 32-bit instruction.
-				software_breakpoint_type[i] = 1;
-				software_breakpoint_addy[i] = address;
-				previous_word_at_breakpoint_address[i] = readval_at_addy;
-			}
-			else
-			{
-				// 16-bit instructions
-				software_breakpoint_type[i] = 2;
-				software_breakpoint_addy[i] = address;
-				previous_word_at_breakpoint_address[i] = readval_at_addy & 0xffff;
-			}
-			InternalWriteBreakpointIntoAddress( dev, i );
-		}
-		else
-		{
-			// Already unset.
-		}
+		software_breakpoint_wanted[first_free] = 1;
+		software_breakpoint_addy[first_free] = address;
 	}
 
 	return 0;
@@ -448,13 +866,15 @@ int RVHandleBreakpoint( void * dev, int set, uint32_t address )
 
 int RVWriteRAM(void * dev, uint32_t memaddy, uint32_t length, uint8_t * payload )
 {
-	if( !MCF.WriteBinaryBlob )
+	if( !MCF( dev ).WriteBinaryBlob )
 	{
 		fprintf( stderr, "Error: Can't alter halt mode with this programmer.\n" );
 		exit( -6 );
 	}
 
-	int r = MCF.WriteBinaryBlob( dev, memaddy, length, payload );
+	InternalForgetSoftwareBreakpoints( memaddy, length );
+	InternalMemCacheInvalidate( memaddy, length );
+	int r = MCF( dev ).WriteBinaryBlob( dev, memaddy, length, payload );
 
 	return r;
 }
@@ -463,6 +883,7 @@ int RVWriteFlash(void * dev, uint32_t memaddy, uint32_t length, uint8_t * payloa
 {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 
+	InternalForgetSoftwareBreakpoints( memaddy, length );
 	if( iss->target_chip && (iss->target_chip->protocol == PROTOCOL_DEFAULT) && (( memaddy & 0xff000000 ) == 0) )
 	{
 		memaddy |= 0x08000000; // Only applies to CH32 chips
@@ -472,27 +893,33 @@ int RVWriteFlash(void * dev, uint32_t memaddy, uint32_t length, uint8_t * payloa
 
 int RVErase( void * dev, uint32_t memaddy, uint32_t length )
 {
-	if( !MCF.Erase )
+	if( !MCF( dev ).Erase )
 	{
 		fprintf( stderr, "Error: Can't alter halt mode with this programmer.\n" );
 		exit( -6 );
 	}
 
-	int r = MCF.Erase( dev, memaddy, length, 0 ); // 0 = not whole chip.
+	InternalForgetSoftwareBreakpoints( memaddy, length );
+	InternalMemCacheInvalidate( memaddy, length );
+	int r = MCF( dev ).Erase( dev, memaddy, length, 0 ); // 0 = not whole chip.
 	return r;
 }
 
 void RVHandleDisconnect( void * dev )
 {
-	MCF.HaltMode( dev, 5 );
-	MCF.SetEnableBreakpoints( dev, 0, 0 );
+	MCF( dev ).HaltMode( dev, 5 );
+	MCF( dev ).SetEnableBreakpoints( dev, 0, 0 );
 
 	int i;
 	for( i = 0; i < MAX_SOFTWARE_BREAKPOINTS; i++ )
+		software_breakpoint_wanted[i] = 0;
+	InternalCommitSoftwareBreakpoints( dev, -1 );
+	for( i = 0; i < num_hardware_triggers; i++ )
 	{
-		if( software_breakpoint_type[i]  )
+		if( hardware_trigger_type[i] )
 		{
-			InternalDisableBreakpoint( dev, i );
+			hardware_trigger_type[i] = 0;
+			InternalWriteTrigger( dev, i, 0, 0 );
 		}
 	}
 
@@ -500,19 +927,19 @@ void RVHandleDisconnect( void * dev )
 	{
 		RVCommandEpilogue( dev );
 	}
-	MCF.HaltMode( dev, 2 );
+	MCF( dev ).HaltMode( dev, 2 );
 	shadow_running_state = 1;
 }
 
 void RVHandleGDBBreakRequest( void * dev )
 {
-	MCF.HaltMode( dev, 5 );
+	MCF( dev ).HaltMode( dev, 5 );
 }
 
 void RVHandleUnsolicitedGDBBreakRequest( void * dev )
 {
 	fprintf( stderr, "Invoke Unsolicited Break\n" );
-	MCF.HaltMode( dev, 5 );
+	MCF( dev ).HaltMode( dev, 5 );
 	gdbasserting_break = 1;
 }
 
@@ -9,11 +9,14 @@
 #include <stdlib.h>
 #include <getopt.h>
 #include "cmdserver.h"
+#include "os_generic.h"
 #include "terminalhelp.h"
 #include "minichlink.h"
 #include "../ch32fun/ch32fun.h"
 #include "chips.h"
 #include "ch5xx.h"
+#include "./stubs/crc32/crc32.h"
+#include "./stubs/flashloader/flashloader.h"
 
 #if defined(WINDOWS) || defined(WIN32) || defined(_WIN32)
 extern int isatty(int);
@@ -29,18 +32,28 @@ void Sleep(uint32_t dwMilliseconds);
 static int64_t StringToMemoryAddress( void * dev, const char * number ) __attribute__((used));
 static void StaticUpdatePROGBUFRegs( void * dev ) __attribute__((used));
 int DefaultReadBinaryBlob( void * dev, uint32_t address_to_read_from, uint32_t read_size, uint8_t * blob );
+int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob_size, const uint8_t * blob );
 int DefaultDelayUS( void * dev, int us );
 void PostSetupConfigureInterface( void * dev );
 int DefaultConfigureReadProtection( void * dev, int one_if_yes_protect );
 void TestFunction(void * v );
 static void readCSR( void * dev, uint32_t csr );
 static int DefaultRebootIntoBootloader( void * dev );
-struct MiniChlinkFunctions MCF;
+static int InternalVerifyWrite( void * dev, uint32_t address, uint32_t len, const uint8_t * image );
+struct MiniChlinkFunctions * MiniCHLinkFunctions( void * dev )
+{
+	return &MCF( dev );
+}
 
 void * MiniCHLinkInitAsDLL( struct MiniChlinkFunctions ** MCFO, const init_hints_t* init_hints )
 {
 	void * dev = 0;
-	
+
+	// The programmer fills in its functions before it has a device to hang
+	// them off of, so the state is set up first and attached on success.
+	struct InternalState * iss = calloc( 1, sizeof( struct InternalState ) );
+	struct MiniChlinkFunctions * mcf = &iss->mcf;
+
 #ifdef VERSION
 	char * version = VERSION;
 	fprintf(stderr, "minichlink version - %s\n", version);
@@ -49,42 +62,44 @@ void * MiniCHLinkInitAsDLL( struct MiniChlinkFunctions ** MCFO, const init_hints
 	if( specpgm )
 	{
 		if( strcmp( specpgm, "linke" ) == 0 )
-			dev = TryInit_WCHLinkE(init_hints);
+			dev = TryInit_WCHLinkE(mcf, init_hints);
 		else if( strcmp( specpgm, "isp" ) == 0 )
-			dev = TryInit_WCHISP();
+			dev = TryInit_WCHISP(mcf);
 		else if( !strcmp( specpgm, "esp32s2chfun" ) || !strcmp( specpgm, "funprog" ) )
-			dev = TryInit_ESP32S2CHFUN(SimpleReadNumberInt(init_hints->serial_port, 0x12065d10));
+			dev = TryInit_ESP32S2CHFUN(mcf, SimpleReadNumberInt(init_hints->serial_port, 0x12065d10));
 		else if( strcmp( specpgm, "nchlink" ) == 0 )
-			dev = TryInit_NHCLink042();
+			dev = TryInit_NHCLink042(mcf);
 		else if( strcmp( specpgm, "b003boot" ) == 0 )
-			dev = TryInit_B003Fun(SimpleReadNumberInt(init_hints->serial_port, 0x1209b003));
+			dev = TryInit_B003Fun(mcf, SimpleReadNumberInt(init_hints->serial_port, 0x1209b003));
 		else if( strcmp( specpgm, "ardulink" ) == 0 )
-			dev = TryInit_Ardulink(init_hints);
+			dev = TryInit_Ardulink(mcf, init_hints);
+		else if( strcmp( specpgm, "mock" ) == 0 )
+			dev = TryInit_Mock(mcf, init_hints);
 	}
 	else
 	{
-		if( (dev = TryInit_WCHISP()) )
+		if( (dev = TryInit_WCHISP(mcf)) )
 		{
 			fprintf( stderr, "Found MCU in bootloader mode\n" );
 		}
-		else if( (dev = TryInit_WCHLinkE(init_hints)) )
+		else if( (dev = TryInit_WCHLinkE(mcf, init_hints)) )
 		{
 			fprintf( stderr, "Found WCH Link\n" );
 		}
-		else if( (dev = TryInit_ESP32S2CHFUN(SimpleReadNumberInt(init_hints->serial_port, 0x12065d10))) )
+		else if( (dev = TryInit_ESP32S2CHFUN(mcf, SimpleReadNumberInt(init_hints->serial_port, 0x12065d10))) )
 		{
 			// Will print the exact programmer type in init
 			// fprintf( stderr, "Found ESP32S2-Style Programmer\n" );
 		}
-		else if ((dev = TryInit_NHCLink042()))
+		else if ((dev = TryInit_NHCLink042(mcf)))
 		{
 			fprintf( stderr, "Found NHC-Link042 Programmer\n" );
 		}
-		else if ((dev = TryInit_B003Fun(SimpleReadNumberInt(init_hints->serial_port, 0x1209b003))))
+		else if ((dev = TryInit_B003Fun(mcf, SimpleReadNumberInt(init_hints->serial_port, 0x1209b003))))
 		{
 			fprintf( stderr, "Found B003Fun Bootloader\n" );
 		}
-		else if ( init_hints->serial_port && strncmp( init_hints->serial_port, "0x", 2 ) && (dev = TryInit_Ardulink(init_hints)))
+		else if ( init_hints->serial_port && strncmp( init_hints->serial_port, "0x", 2 ) && (dev = TryInit_Ardulink(mcf, init_hints)))
 		{
 			fprintf( stderr, "Found Ardulink Programmer\n" );
 		}
@@ -99,10 +114,10 @@ void * MiniCHLinkInitAsDLL( struct MiniChlinkFunctions ** MCFO, const init_hints
 		{
 			fprintf( stderr, "Error: Could not initialize any supported programmers\n" );
 		}
+		free( iss );
 		return 0;
 	}
 
-	struct InternalState * iss = calloc( 1, sizeof( struct InternalState ) );
 	((struct ProgrammerStructBase*)dev)->internal = iss;
 	iss->ram_base = 0x20000000;
 	iss->ram_size = 2048;
@@ -114,12 +129,16 @@ void * MiniCHLinkInitAsDLL( struct MiniChlinkFunctions ** MCFO, const init_hints
 
 	if( MCFO )
 	{
-		*MCFO = &MCF;
+		*MCFO = mcf;
 	}
 	return dev;
 }
 
 #if !defined( MINICHLINK_AS_LIBRARY ) && !defined( MINICHLINK_IMPORT )
+static int RunCommands( void * dev, int argc, char ** argv );
+static int RunScript( void * dev, const char * filename );
+static void PrintHelp( void );
+
 int main( int argc, char ** argv )
 {
 	int i;
@@ -128,6 +147,40 @@ int main( int argc, char ** argv )
 	{
 		goto help;
 	}
+
+	if( argc > 1 && strcmp( argv[1], "--gang" ) == 0 )
+	{
+		// --gang [serial,serial,...|all] [--diff] [binary image to write] [address]
+		int a = 2;
+		int diff = 0;
+		if( a < argc && strcmp( argv[a], "--diff" ) == 0 ) { diff = 1; a++; }
+		if( a + 2 >= argc ) goto help;
+		const char * serials = argv[a++];
+		if( strcmp( argv[a], "--diff" ) == 0 ) { diff = 1; a++; }
+		if( a + 1 >= argc ) goto help;
+
+		FILE * f = fopen( argv[a], "rb" );
+		if( !f )
+		{
+			fprintf( stderr, "Error: Could not open %s\n", argv[a] );
+			return -55;
+		}
+		fseek( f, 0, SEEK_END );
+		int len = ftell( f );
+		fseek( f, 0, SEEK_SET );
+		uint8_t * image = malloc( len );
+		int status = fread( image, len, 1, f );
+		fclose( f );
+		if( status != 1 )
+		{
+			fprintf( stderr, "Error: File I/O Fault.\n" );
+			return -10;
+		}
+
+		int failures = MiniCHLinkGangFlash( serials, image, len, SimpleReadNumberInt( argv[a+1], 0x08000000 ), diff );
+		free( image );
+		return failures ? -1 : 0;
+	}
 	init_hints_t hints;
 	memset(&hints, 0, sizeof(hints));
 
@@ -201,8 +254,6 @@ int main( int argc, char ** argv )
 		return -32;
 	}
 
-	int status;
-	int must_be_end = 0;
 
 	int skip_startup = 
 		(argc > 1 && argv[1][0] == '-' && argv[1][1] == 'k' ) |
@@ -214,9 +265,9 @@ int main( int argc, char ** argv )
 		(argc > 1 && argv[1][0] == '-' && argv[1][1] == 'f' ) |
 		(argc > 1 && argv[1][0] == '-' && argv[1][1] == 'X' );
 
-	if( !skip_startup && MCF.SetupInterface )
+	if( !skip_startup && MCF( dev ).SetupInterface )
 	{
-		if( MCF.SetupInterface( dev ) < 0 )
+		if( MCF( dev ).SetupInterface( dev ) < 0 )
 		{
 			fprintf( stderr, "Could not setup interface.\n" );
 			return -33;
@@ -228,12 +279,142 @@ int main( int argc, char ** argv )
 	if( iss->target_chip == 0 && !skip_startup )
 	{
 		int ret = 1;
-		if( MCF.DetermineChipType ) ret = MCF.DetermineChipType( dev );
+		if( MCF( dev ).DetermineChipType ) ret = MCF( dev ).DetermineChipType( dev );
 		if( ret ) return ret;
 	}
 
 	// PostSetupConfigureInterface( dev );
 
+	int r = RunCommands( dev, argc, argv );
+	if( r ) return r;
+
+	if( MCF( dev ).FlushLLCommands )
+		MCF( dev ).FlushLLCommands( dev );
+
+	if( MCF( dev ).Exit && !skip_startup )
+		MCF( dev ).Exit( dev );
+
+	return 0;
+
+help:
+	PrintHelp();
+	return -1;
+}
+
+// Splits a script line into arguments, in place.  Arguments are separated by
+// whitespace, "double quotes" keep spaces in one, and # starts a comment.
+static int SplitScriptLine( char * line, char ** args, int maxargs )
+{
+	int n = 0;
+	char * c = line;
+	while( 1 )
+	{
+		while( *c == ' ' || *c == '\t' || *c == '\r' || *c == '\n' ) c++;
+		if( !*c || *c == '#' ) break;
+		if( n == maxargs ) return -1;
+		if( *c == '"' )
+		{
+			args[n++] = ++c;
+			while( *c && *c != '"' ) c++;
+		}
+		else
+		{
+			args[n++] = c;
+			while( *c && *c != ' ' && *c != '\t' && *c != '\r' && *c != '\n' ) c++;
+		}
+		if( !*c ) break;
+		*(c++) = 0;
+	}
+	return n;
+}
+
+static int script_depth;
+
+static int RunScriptLine( void * dev, char * line )
+{
+	char * args[65];
+	args[0] = "minichlink";
+	int n = SplitScriptLine( line, args + 1, 64 );
+	if( n < 0 )
+	{
+		fprintf( stderr, "Error: Too many arguments on one line\n" );
+		return -1;
+	}
+	if( n == 0 ) return 0;
+	return RunCommands( dev, n + 1, args );
+}
+
+// For the command server (cmdserver.h).
+int MiniCHLinkRunScriptLine( void * dev, char * line )
+{
+	// i.e. -T in the middle of a script, polling the command server.
+	if( script_depth )
+	{
+		fprintf( stderr, "Error: Can't take commands while a script is running\n" );
+		return -1;
+	}
+	script_depth++;
+	int r = RunScriptLine( dev, line );
+	script_depth--;
+	return r;
+}
+
+// Runs a script of the same commands as the command line, i.e.
+//   -a
+//   -w --verify firmware.bin flash
+//   -i -b
+// one after the other on the one connection, so the programmer is only set up
+// and the chip only detected once.  Stops at the first command that fails.
+static int RunScript( void * dev, const char * filename )
+{
+	if( script_depth )
+	{
+		fprintf( stderr, "Error: Scripts can't run other scripts\n" );
+		return -1;
+	}
+	FILE * f = strcmp( filename, "-" ) ? fopen( filename, "r" ) : stdin;
+	if( !f )
+	{
+		fprintf( stderr, "Error: Could not open %s\n", filename );
+		return -9;
+	}
+	script_depth++;
+
+	char line[4096];
+	int lineno = 0;
+	int r = 0;
+	double start = OGGetAbsoluteTime();
+	while( fgets( line, sizeof( line ), f ) )
+	{
+		lineno++;
+		r = RunScriptLine( dev, line );
+		if( r )
+		{
+			fprintf( stderr, "Error: %s:%d failed (%d)\n", filename, lineno, r );
+			break;
+		}
+	}
+	script_depth--;
+	if( f != stdin ) fclose( f );
+	if( !r ) fprintf( stderr, "Script done, %d lines in %.3f s\n", lineno, OGGetAbsoluteTime() - start );
+	return r;
+}
+
+// Runs command line style arguments (argv[0] is skipped) against a programmer
+// that's already been set up.  Both the command line and every line of a
+// script (-x) go through here.
+static int RunCommands( void * dev, int argc, char ** argv )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	int status;
+	int must_be_end = 0;
+
+	// Set MINICHLINK_STATS=1 to see how many times each command waits on the programmer.
+	const char * env_stats = getenv( "MINICHLINK_STATS" );
+	int show_stats = env_stats && atoi( env_stats );
+	uint32_t roundtrips_before = 0;
+	char command_char = 0;
+
 	int iarg = 1;
 	const char * lastcommand = 0;
 	for( ; iarg < argc; iarg++ )
@@ -253,6 +434,8 @@ int main( int argc, char ** argv )
 		}
 		
 keep_going:
+		roundtrips_before = iss->roundtrips;
+		command_char = argchar[1];
 		switch( argchar[1] )
 		{
 			default:
@@ -265,26 +448,26 @@ keep_going:
 				argchar++;
 				goto keep_going;
 			case '3':
-				if( MCF.Control3v3 )
-					MCF.Control3v3( dev, 1 );
+				if( MCF( dev ).Control3v3 )
+					MCF( dev ).Control3v3( dev, 1 );
 				else
 					goto unimplemented;
 				break;
 			case '5':
-				if( MCF.Control5v )
-					MCF.Control5v( dev, 1 );
+				if( MCF( dev ).Control5v )
+					MCF( dev ).Control5v( dev, 1 );
 				else
 					goto unimplemented;
 				break;
 			case 't':
-				if( MCF.Control3v3 )
-					MCF.Control3v3( dev, 0 );
+				if( MCF( dev ).Control3v3 )
+					MCF( dev ).Control3v3( dev, 0 );
 				else
 					goto unimplemented;
 				break;
 			case 'f':
-				if( MCF.Control5v )
-					MCF.Control5v( dev, 0 );
+				if( MCF( dev ).Control5v )
+					MCF( dev ).Control5v( dev, 0 );
 				else
 					goto unimplemented;
 				break;
@@ -301,8 +484,8 @@ keep_going:
 				}
 				break;
 			case 'u':
-				if( MCF.Unbrick )
-					MCF.Unbrick( dev );
+				if( MCF( dev ).Unbrick )
+					MCF( dev ).Unbrick( dev );
 				else
 					goto unimplemented;
 				break;
@@ -312,7 +495,7 @@ keep_going:
 					goto unimplemented;
 				break;
 			case 'b':  //reBoot
-				if( !MCF.HaltMode || MCF.HaltMode( dev, HALT_MODE_REBOOT ) )
+				if( !MCF( dev ).HaltMode || MCF( dev ).HaltMode( dev, HALT_MODE_REBOOT ) )
 					goto unimplemented;
 				break;
 			case 'B':  //reBoot into Bootloader
@@ -321,30 +504,30 @@ keep_going:
 				  && iss->target_chip_type != CHIP_CH641
 				  && iss->target_chip_type != CHIP_CH643
 				  && iss->target_chip_type != CHIP_CH32X03x ) DefaultRebootIntoBootloader( dev );
-				else if( !MCF.HaltMode || MCF.HaltMode( dev, HALT_MODE_GO_TO_BOOTLOADER ) )
+				else if( !MCF( dev ).HaltMode || MCF( dev ).HaltMode( dev, HALT_MODE_GO_TO_BOOTLOADER ) )
 					goto unimplemented;
 				break;
 			case 'e':  //rEsume
-				if( !MCF.HaltMode || MCF.HaltMode( dev, HALT_MODE_RESUME ) )
+				if( !MCF( dev ).HaltMode || MCF( dev ).HaltMode( dev, HALT_MODE_RESUME ) )
 					goto unimplemented;
 				break;
 			case 'E':  //Erase whole chip.
-				if( MCF.HaltMode ) MCF.HaltMode( dev, HALT_MODE_HALT_AND_RESET );
-				if( !MCF.Erase || MCF.Erase( dev, 0, 0, 1 ) )
+				if( MCF( dev ).HaltMode ) MCF( dev ).HaltMode( dev, HALT_MODE_HALT_AND_RESET );
+				if( !MCF( dev ).Erase || MCF( dev ).Erase( dev, 0, 0, 1 ) )
 					goto unimplemented;
 				break;
 			case 'a':
-				if( !MCF.HaltMode || MCF.HaltMode( dev, HALT_MODE_HALT_AND_RESET ) )
+				if( !MCF( dev ).HaltMode || MCF( dev ).HaltMode( dev, HALT_MODE_HALT_AND_RESET ) )
 					goto unimplemented;
 				break;
 			case 'A':  // Halt without reboot
-				if( !MCF.HaltMode || MCF.HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET ) )
+				if( !MCF( dev ).HaltMode || MCF( dev ).HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET ) )
 					goto unimplemented;
 				break;
 
 			// disable NRST pin (turn it into a GPIO)
 			case 'd':  // see "RSTMODE" in datasheet
-				if( MCF.HaltMode ) MCF.HaltMode( dev, HALT_MODE_HALT_AND_RESET );
+				if( MCF( dev ).HaltMode ) MCF( dev ).HaltMode( dev, HALT_MODE_HALT_AND_RESET );
 				if( iss->target_chip_type == CHIP_CH32L103 ||
 						iss->target_chip_type == CHIP_CH32V10x ||
 						iss->target_chip_type == CHIP_CH32V20x ||
@@ -355,13 +538,13 @@ keep_going:
 					fprintf( stderr, "Warning. This chip can't use NRST as GPIO.\n" );
 					break;
 				}
-				if( MCF.ConfigureNRSTAsGPIO )
-					MCF.ConfigureNRSTAsGPIO( dev, 0 );
+				if( MCF( dev ).ConfigureNRSTAsGPIO )
+					MCF( dev ).ConfigureNRSTAsGPIO( dev, 0 );
 				else
 					goto unimplemented;
 				break;
 			case 'D': // see "RSTMODE" in datasheet
-				if( MCF.HaltMode ) MCF.HaltMode( dev, HALT_MODE_HALT_AND_RESET );
+				if( MCF( dev ).HaltMode ) MCF( dev ).HaltMode( dev, HALT_MODE_HALT_AND_RESET );
 				if( iss->target_chip_type == CHIP_CH32L103 ||
 						iss->target_chip_type == CHIP_CH32V10x ||
 						iss->target_chip_type == CHIP_CH32V20x ||
@@ -372,35 +555,35 @@ keep_going:
 					fprintf( stderr, "ERROR. This chip can't use NRST as GPIO.\n" );
 					break;
 				}
-				if( MCF.ConfigureNRSTAsGPIO )
-					MCF.ConfigureNRSTAsGPIO( dev, 1 );
+				if( MCF( dev ).ConfigureNRSTAsGPIO )
+					MCF( dev ).ConfigureNRSTAsGPIO( dev, 1 );
 				else
 					goto unimplemented;
 				break;
 			case 'p': 
-				if( MCF.HaltMode ) MCF.HaltMode( dev, HALT_MODE_HALT_AND_RESET );
-				if( MCF.ConfigureReadProtection )
+				if( MCF( dev ).HaltMode ) MCF( dev ).HaltMode( dev, HALT_MODE_HALT_AND_RESET );
+				if( MCF( dev ).ConfigureReadProtection )
 				{
 					fprintf(stderr, "This will erase the flash entirely!\n");
 					fprintf(stderr, "Press Enter to proceed, Ctrl+C to abort.");
 					while(!IsKBHit());
 					// TODO: revert after testing
-					MCF.ConfigureReadProtection( dev, 0 );
+					MCF( dev ).ConfigureReadProtection( dev, 0 );
 				}
 				else
 					goto unimplemented;
 
 				break;
 			case 'P':
-				if( MCF.HaltMode ) MCF.HaltMode( dev, HALT_MODE_HALT_AND_RESET );
-				if( MCF.ConfigureReadProtection )
-					MCF.ConfigureReadProtection( dev, 1 );
+				if( MCF( dev ).HaltMode ) MCF( dev ).HaltMode( dev, HALT_MODE_HALT_AND_RESET );
+				if( MCF( dev ).ConfigureReadProtection )
+					MCF( dev ).ConfigureReadProtection( dev, 1 );
 				else
 					goto unimplemented;
 				break;
 			case 'S':  // Set FLASH/RAM split in option bytes
 			{	
-				if( !MCF.SetSplit )
+				if( !MCF( dev ).SetSplit )
 					goto unimplemented;
 				enum RAMSplit split = FLASH_DEFAULT;
 
@@ -435,13 +618,13 @@ keep_going:
 					goto unimplemented;
 				}
 
-				MCF.SetSplit(dev, split);
+				MCF( dev ).SetSplit(dev, split);
 				break;
 			}
 			case 'G':
 			case 'T':
 			{
-				if( !MCF.PollTerminal )
+				if( !MCF( dev ).PollTerminal )
 					goto unimplemented;
 
 				if( argchar[1] == 'G' && SetupGDBServer( dev ) )
@@ -457,8 +640,8 @@ keep_going:
 				else if( argchar[1] == 'T' )
 				{
 					// In case we aren't running already.
-					if( iss->target_chip_type == CHIP_CH57x || iss->target_chip_type == CHIP_CH58x || iss->target_chip_type == CHIP_CH32V10x || iss->init_skip ) MCF.HaltMode( dev, HALT_MODE_RESUME );
-					else MCF.HaltMode( dev, HALT_MODE_REBOOT );
+					if( iss->target_chip_type == CHIP_CH57x || iss->target_chip_type == CHIP_CH58x || iss->target_chip_type == CHIP_CH32V10x || iss->init_skip ) MCF( dev ).HaltMode( dev, HALT_MODE_RESUME );
+					else MCF( dev ).HaltMode( dev, HALT_MODE_REBOOT );
 				}
 
 				CaptureKeyboardInput();
@@ -502,6 +685,19 @@ keep_going:
 #endif
 #endif
 				uint32_t appendword = 0;
+
+				// If the firmware uses FUNCONF_DEBUGPRINTF_RING, we pull printf's out of RAM instead.
+				uint32_t debug_ring = InternalProbeDebugRing( dev );
+				uint32_t ring_dropped = 0;
+				uint32_t ring_burst_bytes = 0;
+				double ring_burst_start = 0;
+				double ring_last_data = 0;
+				double ring_next_poll = 0;
+				double ring_halt_total = 0;
+				double ring_halt_max = 0;
+				uint32_t ring_halts = 0;
+				if( debug_ring ) fprintf( stderr, "Debug printf ring at 0x%08x\n", debug_ring );
+
 				do
 				{
 					uint8_t buffer[256];
@@ -590,7 +786,13 @@ keep_going:
 								appendword |= i+4; // Will go into DATA0.
 						}
 #endif
-						int r = MCF.PollTerminal( dev, buffer, sizeof( buffer ), appendword, 0 );
+						int r = MCF( dev ).PollTerminal( dev, buffer, sizeof( buffer ), appendword, 0 );
+						if( r == -3 && !debug_ring )
+						{
+							// Status 0x82: The firmware is advertising a printf ring in DATA1.
+							debug_ring = InternalProbeDebugRing( dev );
+							if( debug_ring ) fprintf( stderr, "Debug printf ring at 0x%08x\n", debug_ring );
+						}
 #if TERMINAL_INPUT_BUFFER
 						if( (nice_terminal > 0) && ( r == -1 || r == 0 ) && update > 0 )
 						{
@@ -668,6 +870,52 @@ keep_going:
 						}
 					}
 
+					double now = OGGetAbsoluteTime();
+					if( debug_ring && now >= ring_next_poll && !IsGDBServerInShadowHaltState( dev ) )
+					{
+						// Keep each halt short, the firmware can't run while we read.
+						static uint8_t ringdata[DEBUGPRINTF_RING_POLL_MAX];
+						uint32_t dropped = ring_dropped;
+						int r = InternalPollDebugRing( dev, debug_ring, ringdata, sizeof( ringdata ), &dropped );
+						double halted = OGGetAbsoluteTime() - now;
+						now += halted;
+						ring_halt_total += halted;
+						if( halted > ring_halt_max ) ring_halt_max = halted;
+						ring_halts++;
+						if( r > 0 )
+						{
+							fwrite( ringdata, r, 1, stdout );
+							fflush( stdout );
+							if( ring_burst_bytes == 0 ) ring_burst_start = now;
+							ring_burst_bytes += r;
+							ring_last_data = now;
+						}
+						else if( r < 0 )
+						{
+							fprintf( stderr, "Debug printf ring went away (%d)\n", r );
+							debug_ring = 0;
+						}
+
+						// Report throughput once the output goes quiet, or every 10s if it never does.
+						if( ring_burst_bytes && ( now - ring_last_data > 1.0 || now - ring_burst_start > 10.0 ) )
+						{
+							double dt = ring_last_data - ring_burst_start;
+							fprintf( stderr, "\n[Debug ring: %u bytes in %.3f s (%.1f kB/s)", ring_burst_bytes, dt,
+								( dt > 0 ) ? ring_burst_bytes / dt / 1024.0 : 0.0 );
+							if( dropped != ring_dropped ) fprintf( stderr, ", %u dropped", dropped - ring_dropped );
+							fprintf( stderr, ", core halted %.2f ms avg %.2f ms max over %u polls]\n",
+								ring_halt_total * 1000.0 / ring_halts, ring_halt_max * 1000.0, ring_halts );
+							ring_dropped = dropped;
+							ring_burst_bytes = 0;
+							ring_halt_total = ring_halt_max = 0;
+							ring_halts = 0;
+						}
+
+						// Every poll stops the core for a moment, so even while data is flowing, leave it
+						// running most of the time.  When there's nothing to read, back off further.
+						ring_next_poll = now + ( ( r > 0 ) ? DEBUGPRINTF_RING_POLL_INTERVAL : 0.05 );
+					}
+
 					if( argchar[1] == 'G' )
 					{
 						PollGDBServer( dev );
@@ -697,11 +945,11 @@ keep_going:
 				uint32_t datareg = SimpleReadNumberInt( argv[iarg-1], DMDATA0 );
 				uint32_t value = SimpleReadNumberInt( argv[iarg], 0 ); 
 
-				if( MCF.WriteReg32 && MCF.FlushLLCommands )
+				if( MCF( dev ).WriteReg32 && MCF( dev ).FlushLLCommands )
 				{
-					MCF.FlushLLCommands( dev );	
-					MCF.WriteReg32( dev, datareg, value );
-					MCF.FlushLLCommands( dev );
+					MCF( dev ).FlushLLCommands( dev );	
+					MCF( dev ).WriteReg32( dev, datareg, value );
+					MCF( dev ).FlushLLCommands( dev );
 				}
 				else
 					goto unimplemented;
@@ -739,12 +987,12 @@ keep_going:
 
 				uint32_t datareg = SimpleReadNumberInt( argv[iarg], DMDATA0 );
 
-				if( MCF.ReadReg32 && MCF.FlushLLCommands )
+				if( MCF( dev ).ReadReg32 && MCF( dev ).FlushLLCommands )
 				{
 					uint32_t value = 0;
-					int ret = MCF.ReadReg32( dev, datareg, &value );
+					int ret = MCF( dev ).ReadReg32( dev, datareg, &value );
 					printf( "REGISTER %02x: %08x, %d\n", datareg, value, ret );
-					ret = MCF.DetermineChipType( dev );
+					ret = MCF( dev ).DetermineChipType( dev );
 					if( ret ) return ret;
 				}
 				else
@@ -753,8 +1001,8 @@ keep_going:
 			}
 			case 'i':
 			{
-				if( MCF.PrintChipInfo )
-					MCF.PrintChipInfo( dev ); 
+				if( MCF( dev ).PrintChipInfo )
+					MCF( dev ).PrintChipInfo( dev ); 
 				else
 					goto unimplemented;
 				break;
@@ -767,11 +1015,51 @@ keep_going:
 					fprintf( stderr, "Vendor command requires an actual command\n" );
 					goto unimplemented;
 				}
-				if( MCF.VendorCommand )
-					if( MCF.VendorCommand( dev, argv[iarg++] ) )
+				if( MCF( dev ).VendorCommand )
+					if( MCF( dev ).VendorCommand( dev, argv[iarg++] ) )
 						goto unimplemented;
 				break;
 			}
+			case 'L':
+			{
+				// -L [output] [rate] [samples] [elf] [var[:bytes],...]
+				if( argchar[2] != 0 )
+				{
+					fprintf( stderr, "Error: can't have char after paramter field\n" );
+					goto help;
+				}
+				argchar = 0; // Stop advancing
+				if( iarg + 5 >= argc )
+				{
+					fprintf( stderr, "Error: -L needs output, rate, samples, elf and a list of variables.\n" );
+					goto help;
+				}
+				must_be_end = 'L';
+				if( LiveSample( dev, argv[iarg+1], atof( argv[iarg+2] ), SimpleReadNumberInt( argv[iarg+3], 0 ), argv[iarg+4], argv[iarg+5] ) )
+					return -1;
+				iarg += 5;
+				break;
+			}
+			case 'O':
+			{
+				// -O [folded output] [rate] [samples] [elf]
+				if( argchar[2] != 0 )
+				{
+					fprintf( stderr, "Error: can't have char after paramter field\n" );
+					goto help;
+				}
+				argchar = 0; // Stop advancing
+				if( iarg + 4 >= argc )
+				{
+					fprintf( stderr, "Error: -O needs folded output, rate, samples and elf.\n" );
+					goto help;
+				}
+				must_be_end = 'O';
+				if( ProfilePC( dev, argv[iarg+1], atof( argv[iarg+2] ), SimpleReadNumberInt( argv[iarg+3], 0 ), argv[iarg+4] ) )
+					return -1;
+				iarg += 4;
+				break;
+			}
 			case 'r':
 			{
 				if( argchar[2] != 0 )
@@ -810,11 +1098,11 @@ keep_going:
 
 				if( iss->target_chip_type != CHIP_CH570 || iss->current_area == RAM_AREA )
 				{
-					if( MCF.HaltMode ) MCF.HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET ); //No need to reboot.
+					if( MCF( dev ).HaltMode ) MCF( dev ).HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET ); //No need to reboot.
 				}
 				else
 				{
-					if( MCF.HaltMode ) MCF.HaltMode( dev, HALT_MODE_HALT_AND_RESET ); //Need to reboot.
+					if( MCF( dev ).HaltMode ) MCF( dev ).HaltMode( dev, HALT_MODE_HALT_AND_RESET ); //Need to reboot.
 				}
 
 				FILE * f = 0;
@@ -831,10 +1119,11 @@ keep_going:
 					return -9;
 				}
 				uint8_t * readbuff = malloc( amount );
+				double read_start = OGGetAbsoluteTime();
 
-				if( MCF.ReadBinaryBlob )
+				if( MCF( dev ).ReadBinaryBlob )
 				{
-					if( MCF.ReadBinaryBlob( dev, offset, amount, readbuff ) < 0 )
+					if( MCF( dev ).ReadBinaryBlob( dev, offset, amount, readbuff ) < 0 )
 					{
 						fprintf( stderr, "Fault reading device\n" );
 						return -12;
@@ -845,7 +1134,8 @@ keep_going:
 					goto unimplemented;
 				}
 
-				printf( "Read %d bytes\n", (int)amount );
+				double read_time = OGGetAbsoluteTime() - read_start;
+				printf( "Read %d bytes in %.3f s (%.1f kB/s)\n", (int)amount, read_time, ( read_time > 0 ) ? amount / read_time / 1024.0 : 0.0 );
 
 				if( hex )
 				{
@@ -875,6 +1165,38 @@ keep_going:
 				if( argchar[2] != 0 ) goto help;
 				iarg++;
 				argchar = 0; // Stop advancing
+
+				int diff = 0;
+				int verify = 0;
+				int cache = 0;
+				int compress = 0;
+				for( ; iarg < argc && strncmp( argv[iarg], "--", 2 ) == 0; iarg++ )
+				{
+					if( strcmp( argv[iarg], "--diff" ) == 0 ) diff = 1;
+					else if( strcmp( argv[iarg], "--verify" ) == 0 ) verify = 1;
+					else if( strcmp( argv[iarg], "--cache" ) == 0 ) cache = 1;
+					else if( strcmp( argv[iarg], "--compress" ) == 0 ) compress = 1;
+					else
+					{
+						fprintf( stderr, "Error: Unknown option %s for -w\n", argv[iarg] );
+						goto help;
+					}
+				}
+				if( iarg >= argc ) goto help;
+				if( compress && MCF( dev ).WriteBinaryBlob != DefaultWriteBinaryBlob )
+					fprintf( stderr, "Warning: This programmer writes flash its own way, --compress won't do anything.\n" );
+
+				// ELF files know where everything goes, so there's no address.
+				if( argv[iarg][0] != '-' && argv[iarg][0] != '+' && IsELFFile( argv[iarg] ) )
+				{
+					printf( "Writing ELF\n" );
+					iss->compress_flash = compress;
+					int r = WriteELFImage( dev, argv[iarg], diff, verify, cache );
+					iss->compress_flash = 0;
+					if( r ) return r;
+					printf( "\nImage written.\n" );
+					break;
+				}
 				if( iarg + 1 >= argc ) goto help;
 
 				// Write binary.
@@ -942,7 +1264,7 @@ keep_going:
 				}
 				if( strlen(fname) < 5 || strncmp((char*)(fname+strlen(fname)-4), ".bin", 4))
 				{
-					fprintf(stderr, "Warning: Make sure you're using a raw binary file. Minichlink can't flash elf or hex files.\n");
+					fprintf(stderr, "Warning: Make sure you're using a raw binary (or ELF) file. Minichlink can't flash hex files.\n");
 				}
 
 				uint64_t offset = StringToMemoryAddress( dev, argv[iarg] );
@@ -965,34 +1287,56 @@ keep_going:
 
 				int is_flash = IsAddressFlash( offset );
 				
-				if( MCF.HaltMode && is_flash )
+				if( MCF( dev ).HaltMode && is_flash )
 				{
 					if( offset == 0x1ffff000 || iss->current_area == BOOTLOADER_AREA ) // The same thing for v003, maybe remove redundant condition?
 					{
-						MCF.HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET ); // do not reset if writing bootloader, even if it is considered flash memory
+						MCF( dev ).HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET ); // do not reset if writing bootloader, even if it is considered flash memory
 					}
-					else MCF.HaltMode( dev, HALT_MODE_HALT_AND_RESET );
+					else MCF( dev ).HaltMode( dev, HALT_MODE_HALT_AND_RESET );
 				}
-				else if( MCF.HaltMode )
+				else if( MCF( dev ).HaltMode )
 				{
-					MCF.HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET );
+					MCF( dev ).HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET );
 				}
 				
-				if( MCF.WriteBinaryBlob )
+				if( MCF( dev ).WriteBinaryBlob )
 				{
 					if( (iss->target_chip_type == CHIP_CH32V20x || iss->target_chip_type == CHIP_CH32V30x) && iss->current_area == BOOTLOADER_AREA )
 					{
 						fprintf( stderr, "Curent data in BOOTLOADER will be rewritten.\nPress Enter to continue\n");
 						while(!IsKBHit());
 						ReadKBByte();
-						MCF.Erase( dev, iss->target_chip->bootloader_offset, iss->target_chip->bootloader_size, 2 );
+						MCF( dev ).Erase( dev, iss->target_chip->bootloader_offset, iss->target_chip->bootloader_size, 2 );
 					}
 					printf("Writing image\n");
-					if( MCF.WriteBinaryBlob( dev, offset, len, image ) )
+					double write_start = OGGetAbsoluteTime();
+					int r;
+					iss->compress_flash = compress;
+					if( cache && is_flash )
+						r = CachedWriteBinaryBlob( dev, offset, len, image, diff );
+					else if( diff && is_flash )
+						r = DiffWriteBinaryBlob( dev, offset, len, image );
+					else
+						r = MCF( dev ).WriteBinaryBlob( dev, offset, len, image );
+					iss->compress_flash = 0; // Only for this -w, not breakpoints or whatever else writes flash later.
+					if( r )
 					{
 						fprintf( stderr, "Error: Fault writing image.\n" );
 						return -13;
 					}
+					printf( "Wrote %d bytes in %.3f s\n", len, OGGetAbsoluteTime() - write_start );
+					if( verify )
+					{
+						double verify_start = OGGetAbsoluteTime();
+						r = InternalVerifyWrite( dev, offset, len, image );
+						if( r )
+						{
+							fprintf( stderr, "Error: Verify failed.\n" );
+							return -14;
+						}
+						printf( "Verified in %.3f s\n", OGGetAbsoluteTime() - verify_start );
+					}
 				}
 				else
 				{
@@ -1006,10 +1350,10 @@ keep_going:
 			}
 			case 'N':
 			{
-				if( MCF.EnableDebug )
+				if( MCF( dev ).EnableDebug )
 				{
 					printf("Enabling debug\n");
-					if( MCF.EnableDebug( dev, 0 ) )
+					if( MCF( dev ).EnableDebug( dev, 0 ) )
 					{
 						return -13;
 					}
@@ -1018,14 +1362,14 @@ keep_going:
 			}
 			case 'n':
 			{
-				if( MCF.EnableDebug )
+				if( MCF( dev ).EnableDebug )
 				{
 					fprintf( stderr, "This will disable debug module. And you will be only able to program the chip using the bootloader.\nPress Enter to continue\n");
 					while(!IsKBHit());
 					ReadKBByte();
 					fprintf( stderr, "Are you absolutely sure about it?\nPress Enter to continue, or Ctrl+C to cancel\n");
 					while(!IsKBHit());
-					if( MCF.EnableDebug( dev, 1 ) )
+					if( MCF( dev ).EnableDebug( dev, 1 ) )
 					{
 						return -13;
 					}
@@ -1047,20 +1391,34 @@ keep_going:
 				readCSR( dev, 0x300 );
 				break;
 			}
+			case 'x':
+			{
+				iarg++;
+				if( iarg >= argc ) goto help;
+				int r = RunScript( dev, argv[iarg] );
+				if( r ) return r;
+				break;
+			}
 			
 		}
+		if( show_stats )
+			fprintf( stderr, "-%c: %u programmer round trips\n", command_char, iss->roundtrips - roundtrips_before );
 		if( argchar && argchar[2] != 0 ) { argchar++; goto keep_going; }
 	}
 
-	if( MCF.FlushLLCommands )
-		MCF.FlushLLCommands( dev );
-
-	if( MCF.Exit && !skip_startup )
-		MCF.Exit( dev );
-
 	return 0;
 
 help:
+	PrintHelp();
+	return -1;
+
+unimplemented:
+	fprintf( stderr, "Error: Command '%s' unimplemented on this programmer.\n", lastcommand );
+	return -1;
+}
+
+static void PrintHelp( void )
+{
 	fprintf( stderr, "Usage: minichlink [args]\n" );
 	fprintf( stderr, " single-letter args may be combined, i.e. -3r\n" );
 	fprintf( stderr, " multi-part args cannot.\n" );
@@ -1070,7 +1428,7 @@ help:
 	fprintf( stderr, " -f Disable 5V\n" );
 	fprintf( stderr, " -k Skip programmer initialization\n" );
 	fprintf( stderr, " -c [serial port for Ardulink, try /dev/ttyACM0 or COM11 etc] or [VID+PID of USB for b003boot, try 0x1209b003]\n" );
-	fprintf( stderr, " -C [specified programmer, eg. b003boot, ardulink, esp32s2chfun, funprog, isp, linke]\n" );
+	fprintf( stderr, " -C [specified programmer, eg. b003boot, ardulink, esp32s2chfun, funprog, isp, linke, mock]\n" );
 	fprintf( stderr, " -l [programmer USB serial; omit for default device selection]\n" );
 	fprintf( stderr, " -u Clear all code flash - by power off (also can unbrick)\n" );
 	fprintf( stderr, " -a Reboot into Halt\n" );
@@ -1092,16 +1450,21 @@ help:
 	fprintf( stderr, " -n Disable Debug Module\n" );
 	fprintf( stderr, " -S set FLASH/SRAM split [FLASH kbytes] [SRAM kbytes]\n" );
 	fprintf( stderr, " -w [binary image to write] [address, decimal or 0x, try0x08000000]\n" );
+	fprintf( stderr, " -w [firmware.elf] Write the loadable segments of an ELF to wherever they go (flash and/or RAM).\n" );
+	fprintf( stderr, "   Use -w --diff [image] [address] to only write the flash sectors that changed.\n" );
+	fprintf( stderr, "   Use -w --verify [image] [address] to check it afterwards (by CRC on the chip where possible).\n" );
+	fprintf( stderr, "   Use -w --compress [image] [address] to send flash compressed and unpack it on the chip (helps on slow programmers).\n" );
+	fprintf( stderr, "   Use -w --cache [image] [address] to remember what was written to this chip (in ~/.cache/minichlink) and skip unchanged sectors next time.\n" );
+	fprintf( stderr, " --gang [serial,serial,...|all] [--diff] [binary image] [address] Flash and verify with several WCH-LinkE's at once (must be the only command)\n" );
 	fprintf( stderr, " -r [output binary image] [memory address, decimal or 0x, try 0x08000000] [size, decimal or 0x, try 16384]\n" );
 	fprintf( stderr, "   Note: for memory addresses, you can use 'flash' 'bootloader' 'option' 'eeprom' 'ram' and say \"ram+0x10\" for instance\n" );
 	fprintf( stderr, "   For filename, you can use - for raw (terminal) or + for hex (inline).\n" );
+	fprintf( stderr, " -L [output, - for stdout] [rate Hz, 0 for max] [samples, 0 for forever] [firmware.elf or -] [var[:bytes],...]\n" );
+	fprintf( stderr, "   Sample variables while the core runs.  Vars are symbols or addresses.  CSV out, or binary if output ends in .bin.\n" );
+	fprintf( stderr, " -O [folded stacks output, - for none] [rate Hz, 0 for max] [samples, 0 for forever] [firmware.elf or -]\n" );
+	fprintf( stderr, "   Profile where the running core spends its time.  Prints a flat profile, folded stacks are for flamegraph.pl.\n" );
+	fprintf( stderr, " -x [script file, - for stdin] Run the commands in a script, any number per line, all on this one connection\n" );
 	fprintf( stderr, " -X [programmer-specific command, for esp32-s2 programmer, -X ECLK:1:0:0:8:3 for 24MHz clock out]\n" );
-
-	return -1;	
-
-unimplemented:
-	fprintf( stderr, "Error: Command '%s' unimplemented on this programmer.\n", lastcommand );
-	return -1;
 }
 #endif
 
@@ -1198,13 +1561,71 @@ static int64_t StringToMemoryAddress( void * dev, const char * number )
 	return SimpleReadNumberInt( number, -1 );
 }
 
+int DMIQueueWrite( void * dev, uint8_t reg_7_bit, uint32_t value )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	int r = 0;
+	if( iss->dmi_queue_len >= DMI_QUEUE_MAX ) r = DMIFlush( dev );
+	struct DMIOp * op = &iss->dmi_queue[iss->dmi_queue_len++];
+	op->reg_7_bit = reg_7_bit;
+	op->is_read = 0;
+	op->value = value;
+	op->result = 0;
+	return r;
+}
+
+int DMIQueueRead( void * dev, uint8_t reg_7_bit, uint32_t * result )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	int r = 0;
+	if( iss->dmi_queue_len >= DMI_QUEUE_MAX ) r = DMIFlush( dev );
+	struct DMIOp * op = &iss->dmi_queue[iss->dmi_queue_len++];
+	op->reg_7_bit = reg_7_bit;
+	op->is_read = 1;
+	op->value = 0;
+	op->result = result;
+	return r;
+}
+
+int DMIFlush( void * dev )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	int count = iss->dmi_queue_len;
+	int r = 0;
+	if( count == 0 ) return 0;
+	iss->dmi_queue_len = 0;
+
+	if( MCF( dev ).ExecuteDMIQueue )
+		return MCF( dev ).ExecuteDMIQueue( dev, iss->dmi_queue, count );
+
+	int i;
+	for( i = 0; i < count && !r; i++ )
+	{
+		struct DMIOp * op = &iss->dmi_queue[i];
+		if( op->is_read )
+			r = MCF( dev ).ReadReg32( dev, op->reg_7_bit, op->result );
+		else
+			r = MCF( dev ).WriteReg32( dev, op->reg_7_bit, op->value );
+	}
+	return r;
+}
+
+// If an ABSTRACTCS value read back in a batch shows the op is still busy, or
+// failed, go the long way around so we wait / report / clear it.
+static int DMICheckDoneOp( void * dev, uint32_t abstractcs, int ignore )
+{
+	if( ( abstractcs & ( 1<<12 ) ) || ( ( abstractcs >> 8 ) & 7 ) )
+		return MCF( dev ).WaitForDoneOp( dev, ignore );
+	return 0;
+}
+
 static int DefaultWaitForFlash( void * dev )
 {
 	uint32_t rw, timeout = 0;
 	do
 	{
 		rw = 0;
-		MCF.ReadWord( dev, (intptr_t)&FLASH->STATR, &rw ); // FLASH_STATR => 0x4002200C
+		MCF( dev ).ReadWord( dev, (intptr_t)&FLASH->STATR, &rw ); // FLASH_STATR => 0x4002200C
 		if( timeout++ > 1000 )
 		{
 			fprintf( stderr, "Warning: Flash timed out. STATR = %08x\n", rw );
@@ -1217,7 +1638,7 @@ static int DefaultWaitForFlash( void * dev )
 	// if( rw & 0x20 )
 	// {
 	// 	// On non-003-processors, clear done op.
-	// 	MCF.WriteWord( dev, (intptr_t)&FLASH->STATR, 0x20 );
+	// 	MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->STATR, 0x20 );
 	// }
 
 	if( rw & FLASH_STATR_WRPRTERR )
@@ -1237,7 +1658,7 @@ static int DefaultWaitForDoneOp( void * dev, int ignore )
 
 	do
 	{
-		r = MCF.ReadReg32( dev, DMABSTRACTCS, &rrv );
+		r = MCF( dev ).ReadReg32( dev, DMABSTRACTCS, &rrv );
 		if( r ) return r;
 	}
 	while( (rrv & (1<<12)) && timeout-- );
@@ -1259,10 +1680,10 @@ static int DefaultWaitForDoneOp( void * dev, int ignore )
 			}
 
 			uint32_t temp;
-			MCF.ReadReg32( dev, DMSTATUS, &temp );
+			MCF( dev ).ReadReg32( dev, DMSTATUS, &temp );
 			fprintf( stderr, "Fault on op (DMABSTRACTS = %08x) (%d) (%s) DMSTATUS: %08x\n", rrv, timeout, errortext, temp );
 		}
-		MCF.WriteReg32( dev, DMABSTRACTCS, 0x00000700 );
+		MCF( dev ).WriteReg32( dev, DMABSTRACTCS, 0x00000700 );
 		return -9;
 	}
 	return 0;
@@ -1273,22 +1694,22 @@ int DefaultSetupInterface( void * dev )
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 	int retries = MINICHLINK_SETUP_MAX_RETRIES;
 
-	if( MCF.Control3v3 ) MCF.Control3v3( dev, 1 );
+	if( MCF( dev ).Control3v3 ) MCF( dev ).Control3v3( dev, 1 );
 retry:
-	MCF.DelayUS( dev, 16000 );
-	MCF.WriteReg32( dev, DMSHDWCFGR, 0x5aa50000 | (1<<10) ); // Shadow Config Reg
-	MCF.WriteReg32( dev, DMCFGR, 0x5aa50000 | (1<<10) ); // CFGR (1<<10 == Allow output from slave)
-	MCF.WriteReg32( dev, DMSHDWCFGR, 0x5aa50000 | (1<<10) ); // sometimes doing this just once isn't enough
-	MCF.WriteReg32( dev, DMCFGR, 0x5aa50000 | (1<<10) ); // And this is about as fast as checking, so why not.  
-	MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
-	MCF.WriteReg32( dev, DMCONTROL, 0x80000001 );
-	MCF.WriteReg32( dev, DMCONTROL, 0x80000001 );
+	MCF( dev ).DelayUS( dev, 16000 );
+	MCF( dev ).WriteReg32( dev, DMSHDWCFGR, 0x5aa50000 | (1<<10) ); // Shadow Config Reg
+	MCF( dev ).WriteReg32( dev, DMCFGR, 0x5aa50000 | (1<<10) ); // CFGR (1<<10 == Allow output from slave)
+	MCF( dev ).WriteReg32( dev, DMSHDWCFGR, 0x5aa50000 | (1<<10) ); // sometimes doing this just once isn't enough
+	MCF( dev ).WriteReg32( dev, DMCFGR, 0x5aa50000 | (1<<10) ); // And this is about as fast as checking, so why not.  
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 );
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 );
 	// Why do we repeat this commands? Because in some cases they can be lost, if debug module is still starting
 	// and it's better to be send these crucial commands twice fot better chance for success.
 
 	// Read back chip status.  This is really basic.
 	uint32_t reg = 0;
-	int r = MCF.ReadReg32( dev, DMSTATUS, &reg );
+	int r = MCF( dev ).ReadReg32( dev, DMSTATUS, &reg );
 	if( r >= 0 )
 	{
 		// Valid R.
@@ -1315,7 +1736,7 @@ static int DefaultGetUUID( void * dev, uint8_t * buffer )
 	int ret = 0;
 	if( iss->target_chip == NULL)
 	{
-		ret = MCF.DetermineChipType( dev );
+		ret = MCF( dev ).DetermineChipType( dev );
 		if( ret ) return ret;
 	}
 	uint8_t local_buffer[8] = {0, 0, 0, 0, 0, 0, 0, 0};
@@ -1323,20 +1744,20 @@ static int DefaultGetUUID( void * dev, uint8_t * buffer )
 
 	if( iss->target_chip->protocol == PROTOCOL_DEFAULT )
 	{
-		MCF.WriteReg32( dev, DMABSTRACTAUTO, 0 );
-		MCF.WriteReg32( dev, DMPROGBUF0, 0x90024000 ); // c.ebreak <<== c.lw x8, 0(x8)
-		if( chip == CHIP_CH32M030 ) MCF.WriteReg32( dev, DMDATA0, 0x1ffff3a8 );
-		else MCF.WriteReg32( dev, DMDATA0, 0x1ffff7e8 );
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-		MCF.WaitForDoneOp( dev, 0 );
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-		MCF.ReadReg32( dev, DMDATA0, (uint32_t*)local_buffer );
-		if( chip == CHIP_CH32M030 ) MCF.WriteReg32( dev, DMDATA0, 0x1ffff3ac );
-		else MCF.WriteReg32( dev, DMDATA0, 0x1ffff7ec );
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-		MCF.WaitForDoneOp( dev, 0 );
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-		MCF.ReadReg32( dev, DMDATA0, (uint32_t*)(local_buffer + 4) );
+		MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0 );
+		MCF( dev ).WriteReg32( dev, DMPROGBUF0, 0x90024000 ); // c.ebreak <<== c.lw x8, 0(x8)
+		if( chip == CHIP_CH32M030 ) MCF( dev ).WriteReg32( dev, DMDATA0, 0x1ffff3a8 );
+		else MCF( dev ).WriteReg32( dev, DMDATA0, 0x1ffff7e8 );
+		MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+		MCF( dev ).WaitForDoneOp( dev, 0 );
+		MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+		MCF( dev ).ReadReg32( dev, DMDATA0, (uint32_t*)local_buffer );
+		if( chip == CHIP_CH32M030 ) MCF( dev ).WriteReg32( dev, DMDATA0, 0x1ffff3ac );
+		else MCF( dev ).WriteReg32( dev, DMDATA0, 0x1ffff7ec );
+		MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+		MCF( dev ).WaitForDoneOp( dev, 0 );
+		MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+		MCF( dev ).ReadReg32( dev, DMDATA0, (uint32_t*)(local_buffer + 4) );
 		*((uint32_t*)buffer) = local_buffer[0]<<24|local_buffer[1]<<16|local_buffer[2]<<8|local_buffer[3];
 		*(((uint32_t*)buffer)+1) = local_buffer[4]<<24|local_buffer[5]<<16|local_buffer[6]<<8|local_buffer[7];
 	}
@@ -1354,65 +1775,65 @@ static int DefaultDetermineChipType( void * dev )
 	if( iss->target_chip == NULL )
 	{
 		uint32_t rr;
-		if( MCF.ReadReg32( dev, DMHARTINFO, &rr ) )
+		if( MCF( dev ).ReadReg32( dev, DMHARTINFO, &rr ) )
 		{
 			fprintf( stderr, "Error: Could not get hart info.\n" );
 			return -1;
 		}
 
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate halt request.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate halt request.
 
 		// Tricky, this function needs to clean everything up because it may be used entering debugger.
 		uint32_t old_data0;
-		MCF.ReadReg32( dev, DMDATA0, &old_data0 );
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+		MCF( dev ).ReadReg32( dev, DMDATA0, &old_data0 );
+		MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
 		uint32_t old_x8;
-		MCF.ReadReg32( dev, DMDATA0, &old_x8 );
+		MCF( dev ).ReadReg32( dev, DMDATA0, &old_x8 );
 
 		uint32_t marchid = 0;
 
-		MCF.WriteReg32( dev, DMABSTRACTCS, 0x08000700 ); // Clear out any dmabstractcs errors.
+		MCF( dev ).WriteReg32( dev, DMABSTRACTCS, 0x08000700 ); // Clear out any dmabstractcs errors.
 
-		MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 );
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00220000 | 0xf12 );
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00220000 | 0xf12 );  // Need to double-read, not sure why.
-		MCF.ReadReg32( dev, DMDATA0, &marchid );
-		MCF.WriteReg32( dev, DMPROGBUF0, 0x90024000 ); // c.ebreak <<== c.lw x8, 0(x8)
-		MCF.FlushLLCommands(dev);
+		MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 );
+		MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00220000 | 0xf12 );
+		MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00220000 | 0xf12 );  // Need to double-read, not sure why.
+		MCF( dev ).ReadReg32( dev, DMDATA0, &marchid );
+		MCF( dev ).WriteReg32( dev, DMPROGBUF0, 0x90024000 ); // c.ebreak <<== c.lw x8, 0(x8)
+		MCF( dev ).FlushLLCommands(dev);
 
 		uint32_t chip_id = 0;
 		uint32_t vendor_bytes = 0;
 		uint32_t sevenf_id = 0;
 		int read_protection = 0;
-		MCF.ReadReg32( dev, 0x7f, &sevenf_id );
+		MCF( dev ).ReadReg32( dev, 0x7f, &sevenf_id );
 
 		if( sevenf_id == 0 )
 		{
 			// Need to load new progbuf because we're reading 1 byte now
-			MCF.WriteReg32( dev, DMPROGBUF0, 0x00040403 ); // lb x8, 0(x8)
-			MCF.WriteReg32( dev, DMPROGBUF1, 0x00100073 ); // c.ebreak
-			MCF.WriteReg32( dev, DMDATA0, 0x40001041 ); // Special chip ID location.
-			MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-			MCF.WaitForDoneOp( dev, 0 );
-			MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-			MCF.ReadReg32( dev, DMDATA0, &chip_id );
+			MCF( dev ).WriteReg32( dev, DMPROGBUF0, 0x00040403 ); // lb x8, 0(x8)
+			MCF( dev ).WriteReg32( dev, DMPROGBUF1, 0x00100073 ); // c.ebreak
+			MCF( dev ).WriteReg32( dev, DMDATA0, 0x40001041 ); // Special chip ID location.
+			MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+			MCF( dev ).WaitForDoneOp( dev, 0 );
+			MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+			MCF( dev ).ReadReg32( dev, DMDATA0, &chip_id );
 			chip_id = chip_id & 0xff;
 
 			// Looks like a CH32V103 or a CH56x
 			if( chip_id == 0 )
 			{
 				// First check for CH56x
-				MCF.WriteReg32( dev, DMDATA0, 0x40001001 );			
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-				MCF.WaitForDoneOp( dev, 1 );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-				MCF.ReadReg32( dev, DMDATA0, &chip_id );
-				MCF.WriteReg32( dev, DMDATA0, 0x40001002 ); // Special chip ID location.
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-				MCF.WaitForDoneOp( dev, 1 );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-				MCF.ReadReg32( dev, DMDATA0, &vendor_bytes );
+				MCF( dev ).WriteReg32( dev, DMDATA0, 0x40001001 );			
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+				MCF( dev ).WaitForDoneOp( dev, 1 );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+				MCF( dev ).ReadReg32( dev, DMDATA0, &chip_id );
+				MCF( dev ).WriteReg32( dev, DMDATA0, 0x40001002 ); // Special chip ID location.
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+				MCF( dev ).WaitForDoneOp( dev, 1 );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+				MCF( dev ).ReadReg32( dev, DMDATA0, &vendor_bytes );
 
 				if( (vendor_bytes & 0xff) == 2 && ((chip_id & 0xff) == 65 || (chip_id & 0xff) == 69) )
 				{
@@ -1424,26 +1845,26 @@ static int DefaultDetermineChipType( void * dev )
 				}
 
 				// Now actually check for CH32V103
-				MCF.WriteReg32( dev, DMPROGBUF0, 0x90024000 ); // c.ebreak <<== c.lw x8, 0(x8)
-				MCF.WriteReg32( dev, DMDATA0, 0x1ffff880 ); // Special chip ID location.
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-				MCF.WaitForDoneOp( dev, 1 );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-				MCF.ReadReg32( dev, DMDATA0, &chip_id );
-				MCF.WriteReg32( dev, DMDATA0, 0x1ffff884 ); // Special chip ID location.
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-				MCF.WaitForDoneOp( dev, 1 );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-				MCF.ReadReg32( dev, DMDATA0, &vendor_bytes );
+				MCF( dev ).WriteReg32( dev, DMPROGBUF0, 0x90024000 ); // c.ebreak <<== c.lw x8, 0(x8)
+				MCF( dev ).WriteReg32( dev, DMDATA0, 0x1ffff880 ); // Special chip ID location.
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+				MCF( dev ).WaitForDoneOp( dev, 1 );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+				MCF( dev ).ReadReg32( dev, DMDATA0, &chip_id );
+				MCF( dev ).WriteReg32( dev, DMDATA0, 0x1ffff884 ); // Special chip ID location.
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+				MCF( dev ).WaitForDoneOp( dev, 1 );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+				MCF( dev ).ReadReg32( dev, DMDATA0, &vendor_bytes );
 				
 				if( ((((vendor_bytes >> 16) & 0xff00) != 0x2500) && (((vendor_bytes >> 16) & 0xdf00) != 0x1500)) || chip_id != 0xdc78fe34 )
 				{
 					uint32_t flash_obr = 0;
-					MCF.WriteReg32( dev, DMDATA0, 0x4002201c ); // Special chip ID location.
-					MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-					MCF.WaitForDoneOp( dev, 1 );
-					MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-					MCF.ReadReg32( dev, DMDATA0, &flash_obr );
+					MCF( dev ).WriteReg32( dev, DMDATA0, 0x4002201c ); // Special chip ID location.
+					MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+					MCF( dev ).WaitForDoneOp( dev, 1 );
+					MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+					MCF( dev ).ReadReg32( dev, DMDATA0, &flash_obr );
 						
 					if( (flash_obr & 3) == 2 )
 					{
@@ -1465,7 +1886,7 @@ static int DefaultDetermineChipType( void * dev )
 				if( (chip_id & 0xf0) == 0x90 )
 				{
 					uint32_t sevenc = 0;
-					MCF.ReadReg32( dev, DMCPBR, &sevenc );
+					MCF( dev ).ReadReg32( dev, DMCPBR, &sevenc );
 					if((sevenc & 0x30000) == 0)
 					{
 						if( chip_id == 0x91 )iss->target_chip = &ch591;
@@ -1656,21 +2077,21 @@ static int DefaultDetermineChipType( void * dev )
 			}
 			if( iss-> target_chip  && !iss->target_chip_id )
 			{
-				MCF.WriteReg32( dev, DMDATA0, chip_id_address );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-				MCF.WaitForDoneOp( dev, 1 );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-				MCF.ReadReg32( dev, DMDATA0, &chip_id );
+				MCF( dev ).WriteReg32( dev, DMDATA0, chip_id_address );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+				MCF( dev ).WaitForDoneOp( dev, 1 );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+				MCF( dev ).ReadReg32( dev, DMDATA0, &chip_id );
 
 				iss->target_chip_id = chip_id;
 			}
 			if( iss-> target_chip && flash_size_address )
 			{
-				MCF.WriteReg32( dev, DMDATA0, flash_size_address );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-				MCF.WaitForDoneOp( dev, 1 );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-				MCF.ReadReg32( dev, DMDATA0, &vendor_bytes );
+				MCF( dev ).WriteReg32( dev, DMDATA0, flash_size_address );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+				MCF( dev ).WaitForDoneOp( dev, 1 );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+				MCF( dev ).ReadReg32( dev, DMDATA0, &vendor_bytes );
 
 				iss->flash_size = (vendor_bytes & 0xFFFF) * 1024;
 			}
@@ -1696,23 +2117,23 @@ chip_identified:
 			if( iss->target_chip_type == CHIP_CH570 )
 			{
 				uint32_t options;
-				MCF.ReadWord( dev, 0x40001058, &options );
+				MCF( dev ).ReadWord( dev, 0x40001058, &options );
 				if( (options&0x800000) || (options&0x200000) ) read_protection = 1;
 			}
 			else if( read_protection == 0 )
 			{
 				uint32_t one;
 				int two;
-				MCF.WriteReg32( dev, DMDATA0, 0x4002201c );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-				MCF.WaitForDoneOp( dev, 1 );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-				MCF.ReadReg32( dev, DMDATA0, &one );
-				MCF.WriteReg32( dev, DMDATA0, 0x40022020 );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-				MCF.WaitForDoneOp( dev, 1 );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-				MCF.ReadReg32( dev, DMDATA0, (uint32_t*)&two );
+				MCF( dev ).WriteReg32( dev, DMDATA0, 0x4002201c );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+				MCF( dev ).WaitForDoneOp( dev, 1 );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+				MCF( dev ).ReadReg32( dev, DMDATA0, &one );
+				MCF( dev ).WriteReg32( dev, DMDATA0, 0x40022020 );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+				MCF( dev ).WaitForDoneOp( dev, 1 );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+				MCF( dev ).ReadReg32( dev, DMDATA0, (uint32_t*)&two );
 				
 				if( (one & 2) || two != -1 ) read_protection = 1;
 			}
@@ -1731,18 +2152,18 @@ chip_identified:
 			}
 			if( iss->target_chip->protocol == PROTOCOL_CH5xx )
 			{
-				MCF.ReadBinaryBlob = CH5xxReadBinaryBlob;
-				MCF.WriteBinaryBlob = CH5xxWriteBinaryBlob;
-				MCF.Erase = CH5xxErase;
-				MCF.SetClock = CH5xxSetClock;
-				MCF.GetUUID = CH5xxReadUUID;
-				MCF.ConfigureNRSTAsGPIO = CH5xxConfigureNRSTAsGPIO;
-				if( iss->target_chip_type == CHIP_CH570 ) MCF.ConfigureReadProtection = DefaultConfigureReadProtection;
+				MCF( dev ).ReadBinaryBlob = CH5xxReadBinaryBlob;
+				MCF( dev ).WriteBinaryBlob = CH5xxWriteBinaryBlob;
+				MCF( dev ).Erase = CH5xxErase;
+				MCF( dev ).SetClock = CH5xxSetClock;
+				MCF( dev ).GetUUID = CH5xxReadUUID;
+				MCF( dev ).ConfigureNRSTAsGPIO = CH5xxConfigureNRSTAsGPIO;
+				if( iss->target_chip_type == CHIP_CH570 ) MCF( dev ).ConfigureReadProtection = DefaultConfigureReadProtection;
 			}
 
 			uint8_t * part_type = (uint8_t*)&iss->target_chip_id;
 			uint8_t uuid[8];
-			if( MCF.GetUUID( dev, uuid ) ) fprintf( stderr, "Couldn't read UUID\n" );
+			if( MCF( dev ).GetUUID( dev, uuid ) ) fprintf( stderr, "Couldn't read UUID\n" );
 			fprintf( stderr, "Detected %s\n", iss->target_chip->name_str );
 			fprintf( stderr, "Flash Storage: %d kB\n", iss->flash_size/1024 );
 			fprintf( stderr, "Part UUID: %02x-%02x-%02x-%02x-%02x-%02x-%02x-%02x\n", uuid[0], uuid[1], uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7] );
@@ -1750,9 +2171,9 @@ chip_identified:
 			fprintf( stderr, "Read protection: %s\n", (read_protection > 0)?"enabled":"disabled" );
 		}
 		// Cleanup
-		MCF.WriteReg32( dev, DMDATA0, old_x8 );
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00231008 ); // Copy data to x8
-		MCF.WriteReg32( dev, DMDATA0, old_data0 );
+		MCF( dev ).WriteReg32( dev, DMDATA0, old_x8 );
+		MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00231008 ); // Copy data to x8
+		MCF( dev ).WriteReg32( dev, DMDATA0, old_data0 );
 
 		iss->statetag = STTAG( "XXXX" );
 	}
@@ -1764,7 +2185,8 @@ static void StaticUpdatePROGBUFRegs( void * dev )
 {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 	uint32_t rr;
-	if( MCF.ReadReg32( dev, DMHARTINFO, &rr ) )
+	DMIQueueRead( dev, DMHARTINFO, &rr );
+	if( DMIFlush( dev ) )
 	{
 		fprintf( stderr, "Error: Could not get hart info.\n" );
 		return;
@@ -1773,37 +2195,37 @@ static void StaticUpdatePROGBUFRegs( void * dev )
 		int ret = 0;
 		if( iss->target_chip == NULL )
 		{
-			ret = MCF.DetermineChipType( dev );
+			ret = MCF( dev ).DetermineChipType( dev );
 			if( ret ) return;
 		}
 
 	uint32_t data0offset = 0xe0000000 | ( rr & 0x7ff );
 
 	// Putting DATA0's location into x10, and DATA1's location into x11 is universal for all continued code.
-	MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
-	MCF.WriteReg32( dev, DMDATA0, data0offset );       // DATA0's location in memory.
-	MCF.WriteReg32( dev, DMCOMMAND, 0x0023100a );      // Copy data to x10
-	MCF.WriteReg32( dev, DMDATA0, data0offset + 4 );   // DATA1's location in memory.
-	MCF.WriteReg32( dev, DMCOMMAND, 0x0023100b );      // Copy data to x11
-	MCF.WriteReg32( dev, DMDATA0, 0x4002200c );        // FLASH->STATR, add 4 to get FLASH->CTLR
-	MCF.WriteReg32( dev, DMCOMMAND, 0x0023100c );      // Copy data to x12
+	DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+	DMIQueueWrite( dev, DMDATA0, data0offset );       // DATA0's location in memory.
+	DMIQueueWrite( dev, DMCOMMAND, 0x0023100a );      // Copy data to x10
+	DMIQueueWrite( dev, DMDATA0, data0offset + 4 );   // DATA1's location in memory.
+	DMIQueueWrite( dev, DMCOMMAND, 0x0023100b );      // Copy data to x11
+	DMIQueueWrite( dev, DMDATA0, 0x4002200c );        // FLASH->STATR, add 4 to get FLASH->CTLR
+	DMIQueueWrite( dev, DMCOMMAND, 0x0023100c );      // Copy data to x12
 
 	// v003 requires bufload every word.
 	// x035 requires bufload every word in spite of what the datasheet says.
 	// CR_PAGE_PG = FTPG = 0x00010000 | CR_BUF_LOAD = 0x00040000
 	// We just don't do the write on the v20x/v30x.
-	MCF.WriteReg32( dev, DMDATA0, 0x00010000|0x00040000 );
-	MCF.WriteReg32( dev, DMCOMMAND, 0x0023100d );      // Copy data to x13
+	DMIQueueWrite( dev, DMDATA0, 0x00010000|0x00040000 );
+	DMIQueueWrite( dev, DMCOMMAND, 0x0023100d );      // Copy data to x13
 }
 
 int InternalUnlockBootloader( void * dev )
 {
-	if( !MCF.WriteWord ) return -99;
+	if( !MCF( dev ).WriteWord ) return -99;
 	int ret = 0;
 	uint32_t STATR;
-	ret |= MCF.WriteWord( dev, 0x40022028, 0x45670123 ); //(FLASH_BOOT_MODEKEYP)
-	ret |= MCF.WriteWord( dev, 0x40022028, 0xCDEF89AB ); //(FLASH_BOOT_MODEKEYP)
-	ret |= MCF.ReadWord( dev, 0x4002200C, &STATR ); //(FLASH_OBTKEYR)
+	ret |= MCF( dev ).WriteWord( dev, 0x40022028, 0x45670123 ); //(FLASH_BOOT_MODEKEYP)
+	ret |= MCF( dev ).WriteWord( dev, 0x40022028, 0xCDEF89AB ); //(FLASH_BOOT_MODEKEYP)
+	ret |= MCF( dev ).ReadWord( dev, 0x4002200C, &STATR ); //(FLASH_OBTKEYR)
 	if( ret )
 	{
 		fprintf( stderr, "Error operating with OBTKEYR\n" );
@@ -1814,8 +2236,8 @@ int InternalUnlockBootloader( void * dev )
 		fprintf( stderr, "Error: Could not unlock boot section (%08x)\n", STATR );
 	}
 	STATR |= (1<<14); // Configure for boot-to-bootload.
-	ret |= MCF.WriteWord( dev, 0x4002200C, STATR );
-	ret |= MCF.ReadWord( dev, 0x4002200C, &STATR ); //(FLASH_OBTKEYR)
+	ret |= MCF( dev ).WriteWord( dev, 0x4002200C, STATR );
+	ret |= MCF( dev ).ReadWord( dev, 0x4002200C, &STATR ); //(FLASH_OBTKEYR)
 
 	// Need to flush state.
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
@@ -1847,22 +2269,22 @@ static int DefaultWriteHalfWord( void * dev, uint32_t address_to_write, uint16_t
 {
 	int ret = 0;
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
-	if( MCF.VoidHighLevelState ) MCF.VoidHighLevelState( dev );
+	if( MCF( dev ).VoidHighLevelState ) MCF( dev ).VoidHighLevelState( dev );
 	iss->statetag = STTAG( "XXXX" );
 
-	MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+	MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
 
 	// Different address, so we don't need to re-write all the program regs.
 	// sh x8,0(x9)  // Write to the address.
-	MCF.WriteReg32( dev, DMPROGBUF0, 0x00849023 );
-	MCF.WriteReg32( dev, DMPROGBUF1, 0x00100073 ); // c.ebreak
+	MCF( dev ).WriteReg32( dev, DMPROGBUF0, 0x00849023 );
+	MCF( dev ).WriteReg32( dev, DMPROGBUF1, 0x00100073 ); // c.ebreak
 
-	MCF.WriteReg32( dev, DMDATA0, address_to_write );
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00231009 ); // Copy data to x9
-	MCF.WriteReg32( dev, DMDATA0, data );
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute program.
+	MCF( dev ).WriteReg32( dev, DMDATA0, address_to_write );
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00231009 ); // Copy data to x9
+	MCF( dev ).WriteReg32( dev, DMDATA0, data );
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute program.
 
-	ret |= MCF.WaitForDoneOp( dev, 0 );
+	ret |= MCF( dev ).WaitForDoneOp( dev, 0 );
 	iss->currentstateval = -1;
 
 	if( ret ) fprintf( stderr, "Fault on DefaultWriteHalfWord\n" );
@@ -1873,28 +2295,28 @@ static int DefaultReadHalfWord( void * dev, uint32_t address_to_write, uint16_t
 {
 	int ret = 0;
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
-	if( MCF.VoidHighLevelState ) MCF.VoidHighLevelState( dev );
+	if( MCF( dev ).VoidHighLevelState ) MCF( dev ).VoidHighLevelState( dev );
 	iss->statetag = STTAG( "XXXX" );
 
-	MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+	MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
 
 	// Different address, so we don't need to re-write all the program regs.
 	// lh x8,0(x9)  // Write to the address.
-	MCF.WriteReg32( dev, DMPROGBUF0, 0x00049403 ); // lh x8, 0(x9)
-	MCF.WriteReg32( dev, DMPROGBUF1, 0x00100073 ); // c.ebreak
+	MCF( dev ).WriteReg32( dev, DMPROGBUF0, 0x00049403 ); // lh x8, 0(x9)
+	MCF( dev ).WriteReg32( dev, DMPROGBUF1, 0x00100073 ); // c.ebreak
 
-	MCF.WriteReg32( dev, DMDATA0, address_to_write );
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00231009 ); // Copy data to x9
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00241000 ); // Only execute.
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Read x8 into DATA0.
+	MCF( dev ).WriteReg32( dev, DMDATA0, address_to_write );
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00231009 ); // Copy data to x9
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00241000 ); // Only execute.
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Read x8 into DATA0.
 
-	ret |= MCF.WaitForDoneOp( dev, 0 );
+	ret |= MCF( dev ).WaitForDoneOp( dev, 0 );
 	iss->currentstateval = -1;
 
 	if( ret ) fprintf( stderr, "Fault on DefaultReadHalfWord\n" );
 
 	uint32_t rr;
-	ret |= MCF.ReadReg32( dev, DMDATA0, &rr );
+	ret |= MCF( dev ).ReadReg32( dev, DMDATA0, &rr );
 	*data = rr;
 	return ret;
 }
@@ -1903,22 +2325,22 @@ static int DefaultWriteByte( void * dev, uint32_t address_to_write, uint8_t data
 {
 	int ret = 0;
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
-	if( MCF.VoidHighLevelState ) MCF.VoidHighLevelState( dev );
+	if( MCF( dev ).VoidHighLevelState ) MCF( dev ).VoidHighLevelState( dev );
 	iss->statetag = STTAG( "XXXX" );
 
-	MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+	MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
 
 	// Different address, so we don't need to re-write all the program regs.
 	// sh x8,0(x9)  // Write to the address.
-	MCF.WriteReg32( dev, DMPROGBUF0, 0x00848023 ); // sb x8, 0(x9)
-	MCF.WriteReg32( dev, DMPROGBUF1, 0x00100073 ); // c.ebreak
+	MCF( dev ).WriteReg32( dev, DMPROGBUF0, 0x00848023 ); // sb x8, 0(x9)
+	MCF( dev ).WriteReg32( dev, DMPROGBUF1, 0x00100073 ); // c.ebreak
 
-	MCF.WriteReg32( dev, DMDATA0, address_to_write );
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00231009 ); // Copy data to x9
-	MCF.WriteReg32( dev, DMDATA0, data );
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute program.
+	MCF( dev ).WriteReg32( dev, DMDATA0, address_to_write );
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00231009 ); // Copy data to x9
+	MCF( dev ).WriteReg32( dev, DMDATA0, data );
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute program.
 
-	ret |= MCF.WaitForDoneOp( dev, 0 );
+	ret |= MCF( dev ).WaitForDoneOp( dev, 0 );
 	if( ret ) fprintf( stderr, "Fault on DefaultWriteByte\n" );
 	iss->currentstateval = -1;
 	return ret;
@@ -1928,27 +2350,27 @@ static int DefaultReadByte( void * dev, uint32_t address_to_read, uint8_t * data
 {
 	int ret = 0;
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
-	if( MCF.VoidHighLevelState ) MCF.VoidHighLevelState( dev );
+	if( MCF( dev ).VoidHighLevelState ) MCF( dev ).VoidHighLevelState( dev );
 	iss->statetag = STTAG( "XXXX" );
 
-	MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+	MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
 
 	// Different address, so we don't need to re-write all the program regs.
 	// lb x8,0(x9)  // Read from the address.
-	MCF.WriteReg32( dev, DMPROGBUF0, 0x00048403 ); // lb x8, 0(x9)
-	MCF.WriteReg32( dev, DMPROGBUF1, 0x00100073 ); // c.ebreak
+	MCF( dev ).WriteReg32( dev, DMPROGBUF0, 0x00048403 ); // lb x8, 0(x9)
+	MCF( dev ).WriteReg32( dev, DMPROGBUF1, 0x00100073 ); // c.ebreak
 
-	MCF.WriteReg32( dev, DMDATA0, address_to_read );
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00231009 ); // Copy data to x9
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00241000 ); // Only execute.
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Read x8 into DATA0.
+	MCF( dev ).WriteReg32( dev, DMDATA0, address_to_read );
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00231009 ); // Copy data to x9
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00241000 ); // Only execute.
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Read x8 into DATA0.
 
-	ret |= MCF.WaitForDoneOp( dev, 0 );
+	ret |= MCF( dev ).WaitForDoneOp( dev, 0 );
 	if( ret ) fprintf( stderr, "Fault on DefaultReadByte\n" );
 	iss->currentstateval = -1;
 
 	uint32_t rr;
-	ret |= MCF.ReadReg32( dev, DMDATA0, &rr );
+	ret |= MCF( dev ).ReadReg32( dev, DMDATA0, &rr );
 	*data = rr;
 	return ret;
 }
@@ -1966,7 +2388,7 @@ static int DefaultWriteWord( void * dev, uint32_t address_to_write, uint32_t dat
 		int did_disable_req = 0;
 		if( iss->statetag != STTAG( "WRSQ" ) )
 		{
-			MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+			DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
 			did_disable_req = 1;
 
 			if( iss->statetag != STTAG( "RDSQ" ) )
@@ -1977,20 +2399,20 @@ static int DefaultWriteWord( void * dev, uint32_t address_to_write, uint32_t dat
 			// Different address, so we don't need to re-write all the program regs.
 			// c.lw x8,0(x10) // Get the value to write.
 			// c.lw x9,0(x11) // Get the address to write to. 
-			MCF.WriteReg32( dev, DMPROGBUF0, 0x41844100 );
+			DMIQueueWrite( dev, DMPROGBUF0, 0x41844100 );
 			// c.sw x8,0(x9)  // Write to the address.
 			// c.addi x9, 4
-			MCF.WriteReg32( dev, DMPROGBUF1, 0x0491c080 );
+			DMIQueueWrite( dev, DMPROGBUF1, 0x0491c080 );
 		}
 
 		if( is_flash && iss->target_chip_type == CHIP_CH32V10x)
 		{
 			// Special 16 bytes buffer write sequence for CH32V103
-			MCF.WriteReg32( dev, DMPROGBUF2, 0x0001c184 ); // c.sw x9,0(x11); c.nop;
-			MCF.WriteReg32( dev, DMPROGBUF3, 0x9002e391 ); // c.bnez x15, 4; c.ebreak;
-			MCF.WriteReg32( dev, DMPROGBUF4, 0x4200c254 ); // c.sw x13,4(x12); c.lw x8,0(x12);
-			MCF.WriteReg32( dev, DMPROGBUF5, 0xfc758805 ); // c.andi x8, 1; c.bnez x8, -4;
-			MCF.WriteReg32( dev, DMPROGBUF6, 0x90024781 ); // c.li x15, 0; c.ebreak;
+			DMIQueueWrite( dev, DMPROGBUF2, 0x0001c184 ); // c.sw x9,0(x11); c.nop;
+			DMIQueueWrite( dev, DMPROGBUF3, 0x9002e391 ); // c.bnez x15, 4; c.ebreak;
+			DMIQueueWrite( dev, DMPROGBUF4, 0x4200c254 ); // c.sw x13,4(x12); c.lw x8,0(x12);
+			DMIQueueWrite( dev, DMPROGBUF5, 0xfc758805 ); // c.andi x8, 1; c.bnez x8, -4;
+			DMIQueueWrite( dev, DMPROGBUF6, 0x90024781 ); // c.li x15, 0; c.ebreak;
 		}
 		else if( is_flash )
 		{
@@ -2004,38 +2426,38 @@ static int DefaultWriteWord( void * dev, uint32_t address_to_write, uint32_t dat
 			// /8805 c.andi x8, 1    // Only look at BSY if we're not on a v30x / v20x
 			// fc75 c.bnez x8, -4
 			// c.ebreak
-			MCF.WriteReg32( dev, DMPROGBUF2, 0x0001c184 );
-			MCF.WriteReg32( dev, DMPROGBUF3, 
+			DMIQueueWrite( dev, DMPROGBUF2, 0x0001c184 );
+			DMIQueueWrite( dev, DMPROGBUF3, 
 				(iss->target_chip_type == CHIP_CH32V003 || iss->target_chip_type == CHIP_CH32V00x
 				 || iss->target_chip_type == CHIP_CH32X03x || iss->target_chip_type == CHIP_CH32L103
 				 || iss->target_chip_type == CHIP_CH641 || iss->target_chip_type == CHIP_CH643) ?
 				0x4200c254 : 0x42000001  );
 
-			MCF.WriteReg32( dev, DMPROGBUF4,
+			DMIQueueWrite( dev, DMPROGBUF4,
 				(iss->target_chip_type == CHIP_CH32V20x || iss->target_chip_type == CHIP_CH32V30x  || iss->target_chip_type == CHIP_CH32H41x) ?
 				0xfc758809 : 0xfc758805 );
 
-			MCF.WriteReg32( dev, DMPROGBUF5, 0x90029002 );
+			DMIQueueWrite( dev, DMPROGBUF5, 0x90029002 );
 		}
 		else
 		{
 			// c.sw x9,0(x11)
 			// c.ebreak
-			MCF.WriteReg32( dev, DMPROGBUF2, 0x9002c184 );
-			// MCF.WriteReg32( dev, DMPROGBUF3, 0x90029002 ); // c.ebreak (nothing needs to be done if not flash)
+			DMIQueueWrite( dev, DMPROGBUF2, 0x9002c184 );
+			// DMIQueueWrite( dev, DMPROGBUF3, 0x90029002 ); // c.ebreak (nothing needs to be done if not flash)
 		}
 
-		MCF.WriteReg32( dev, DMDATA1, address_to_write );
-		MCF.WriteReg32( dev, DMDATA0, data );
+		DMIQueueWrite( dev, DMDATA1, address_to_write );
+		DMIQueueWrite( dev, DMDATA0, data );
 
 		if( iss->target_chip->no_autoexec )
 		{
-			ret |= MCF.WriteReg32( dev, DMCOMMAND, 0x00240000 ); // Execute.
+			ret |= DMIQueueWrite( dev, DMCOMMAND, 0x00240000 ); // Execute.
 		}
 		else if( did_disable_req )
 		{
-			MCF.WriteReg32( dev, DMCOMMAND, 0x00240000 ); // Execute.
-			MCF.WriteReg32( dev, DMABSTRACTAUTO, 1 ); // Enable Autoexec.
+			DMIQueueWrite( dev, DMCOMMAND, 0x00240000 ); // Execute.
+			DMIQueueWrite( dev, DMABSTRACTAUTO, 1 ); // Enable Autoexec.
 		}
 
 		iss->lastwriteflags = is_flash;
@@ -2047,19 +2469,29 @@ static int DefaultWriteWord( void * dev, uint32_t address_to_write, uint32_t dat
 	{
 		if( address_to_write != iss->currentstateval )
 		{
-			MCF.WriteReg32( dev, DMDATA1, address_to_write );
+			DMIQueueWrite( dev, DMDATA1, address_to_write );
 		}
 
-		MCF.WriteReg32( dev, DMDATA0, data );
+		DMIQueueWrite( dev, DMDATA0, data );
 
 		if( iss->target_chip->no_autoexec )
 		{
-			ret |= MCF.WriteReg32( dev, DMCOMMAND, 0x00240000 ); // Execute.
+			ret |= DMIQueueWrite( dev, DMCOMMAND, 0x00240000 ); // Execute.
 		}
 	}
 
 	if( is_flash )
-		ret |= MCF.WaitForDoneOp( dev, 0 );
+	{
+		// Check on the flash op in the same transaction.
+		uint32_t abstractcs = 0;
+		DMIQueueRead( dev, DMABSTRACTCS, &abstractcs );
+		ret |= DMIFlush( dev );
+		ret |= DMICheckDoneOp( dev, abstractcs, 0 );
+	}
+	else
+	{
+		ret |= DMIFlush( dev );
+	}
 
 
 	iss->currentstateval += 4;
@@ -2094,7 +2526,7 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 	// Special: For user data, need to write to it very carefully.
 	if( address_to_write > 0x1ffff7c0 && address_to_write < 0x20000000 )
 	{
-		if( !MCF.WriteHalfWord )
+		if( !MCF( dev ).WriteHalfWord )
 		{
 			fprintf( stderr, "Error: to write this type of memory, half-word-writing is required\n" );
 			return -5;
@@ -2109,35 +2541,35 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 			return -9;
 		}
 
-		MCF.ReadBinaryBlob( dev, base, 64, block );
+		MCF( dev ).ReadBinaryBlob( dev, base, 64, block );
 
 		uint32_t offset = address_to_write - base;
 		memcpy( block + offset, blob, blob_size );
 
 		uint32_t temp;
-		MCF.ReadWord( dev, 0x4002200c, &temp );
+		MCF( dev ).ReadWord( dev, 0x4002200c, &temp );
 		//STATR & BOOT only exists on the 003 and x03x
 		// No issue if we force an unlock anyway.
 		//if( temp & 0x8000 )
 		{
-			MCF.WriteWord( dev, 0x40022004, 0x45670123 ); // KEYR
-			MCF.WriteWord( dev, 0x40022004, 0xCDEF89AB );
+			MCF( dev ).WriteWord( dev, 0x40022004, 0x45670123 ); // KEYR
+			MCF( dev ).WriteWord( dev, 0x40022004, 0xCDEF89AB );
 
 			// These registers are not on or required on the v20x / v30x, but no harm in writing.
-			MCF.WriteWord( dev, 0x40022008, 0x45670123 ); // OBWRE
-			MCF.WriteWord( dev, 0x40022008, 0xCDEF89AB );
-			MCF.WriteWord( dev, 0x40022028, 0x45670123 ); //(FLASH_BOOT_MODEKEYP)
-			MCF.WriteWord( dev, 0x40022028, 0xCDEF89AB ); //(FLASH_BOOT_MODEKEYP)
+			MCF( dev ).WriteWord( dev, 0x40022008, 0x45670123 ); // OBWRE
+			MCF( dev ).WriteWord( dev, 0x40022008, 0xCDEF89AB );
+			MCF( dev ).WriteWord( dev, 0x40022028, 0x45670123 ); //(FLASH_BOOT_MODEKEYP)
+			MCF( dev ).WriteWord( dev, 0x40022028, 0xCDEF89AB ); //(FLASH_BOOT_MODEKEYP)
 		}
 
-		MCF.ReadWord( dev, 0x4002200c, &temp );
+		MCF( dev ).ReadWord( dev, 0x4002200c, &temp );
 		if( temp & 0x8000 )
 		{
 			fprintf( stderr, "Error: Critical memory zone is still locked out\n" );
 		}
-		if( MCF.WaitForFlash ) MCF.WaitForFlash( dev );
+		if( MCF( dev ).WaitForFlash ) MCF( dev ).WaitForFlash( dev );
 
-		MCF.ReadWord( dev, (intptr_t)&FLASH->CTLR, &temp );
+		MCF( dev ).ReadWord( dev, (intptr_t)&FLASH->CTLR, &temp );
 
 		if( !(temp & (1<<9)) ) // Check OBWRE
 		{
@@ -2145,12 +2577,12 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 		}
 
 		// Perform erase.
-		MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTER | FLASH_CTLR_OPTWRE );
-		MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTER | FLASH_CTLR_OPTWRE | FLASH_CTLR_STRT );
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTER | FLASH_CTLR_OPTWRE );
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTER | FLASH_CTLR_OPTWRE | FLASH_CTLR_STRT );
 
-		if( MCF.WaitForFlash ) MCF.WaitForFlash( dev );
+		if( MCF( dev ).WaitForFlash ) MCF( dev ).WaitForFlash( dev );
 
-		MCF.ReadWord( dev, 0x4002200c, &temp );
+		MCF( dev ).ReadWord( dev, 0x4002200c, &temp );
 		if( temp & 0x10 )
 		{
 			fprintf( stderr, "WRPTRERR is set.  Write failed\n" );
@@ -2161,19 +2593,19 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 		for( i = 0; i < 8; i++ )
 		{
 			// OBPG = FLASH_CTLR_OPTPG
-			MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTPG | FLASH_CTLR_OPTWRE );
-			MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTPG | FLASH_CTLR_STRT | FLASH_CTLR_OPTWRE );
+			MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTPG | FLASH_CTLR_OPTWRE );
+			MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTPG | FLASH_CTLR_STRT | FLASH_CTLR_OPTWRE );
 			uint32_t writeaddy = i*2+base;
 			uint16_t writeword = block[i*2+0] | (block[i*2+1]<<8);
-			MCF.WriteHalfWord( dev, writeaddy, writeword );
-			if( MCF.WaitForFlash ) MCF.WaitForFlash( dev );
+			MCF( dev ).WriteHalfWord( dev, writeaddy, writeword );
+			if( MCF( dev ).WaitForFlash ) MCF( dev ).WaitForFlash( dev );
 			uint16_t verify = 0;
-			MCF.ReadHalfWord( dev, writeaddy, &verify );
+			MCF( dev ).ReadHalfWord( dev, writeaddy, &verify );
 			if( verify != writeword )
 			{
 				fprintf( stderr, "Warning when writing option bytes at %08x, %04x != %04x\n", writeaddy, writeword, verify );
 			}
-			MCF.ReadWord( dev, 0x4002200c, &temp );
+			MCF( dev ).ReadWord( dev, 0x4002200c, &temp );
 			if( temp & 0x10 )
 			{
 				fprintf( stderr, "WRPTRERR is set.  Write failed\n" );
@@ -2181,8 +2613,8 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 			}
 		}
 		// Turn off OPTPG, OPTWRE.
-		MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, 0 );
-		if( MCF.WaitForFlash ) MCF.WaitForFlash( dev );
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, 0 );
+		if( MCF( dev ).WaitForFlash ) MCF( dev ).WaitForFlash( dev );
 
 		return 0;
 	}
@@ -2191,8 +2623,23 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 	int blocks_per_sector = sectorsize / 64;
 	int sectorsizemask = sectorsize-1;
 
+	// Whole pages go through the RAM flash loader, where the chip can use it.  Whatever's left over is done here.
+	if( is_flash && !MCF( dev ).BlockWrite64 && ( address_to_write & sectorsizemask ) == 0 && blob_size >= sectorsize )
+	{
+		uint32_t whole = blob_size & ~sectorsizemask;
+		ret = InternalLoaderWriteFlash( dev, address_to_write, whole, blob );
+		if( ret <= 0 )
+		{
+			if( ret < 0 || whole == blob_size ) return ret;
+			address_to_write += whole;
+			blob += whole;
+			blob_size -= whole;
+		}
+		ret = 0;
+	}
+
 	// Regardless of sector size, allow block write to do its thing if it can.
-	if( is_flash && MCF.BlockWrite64 && ( address_to_write & sectorsizemask ) == 0 &&
+	if( is_flash && MCF( dev ).BlockWrite64 && ( address_to_write & sectorsizemask ) == 0 &&
 	    ( blob_size & sectorsizemask ) == 0  && iss->target_chip_type != CHIP_CH32V10x )
 	{
 		int i, j;
@@ -2201,7 +2648,7 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 			for( j = 0; j < blocks_per_sector; j++ )
 			{
 				// When doing block writes, you MUST write a full sector.
-				ret = MCF.BlockWrite64( dev, address_to_write + i, blob + i );
+				ret = MCF( dev ).BlockWrite64( dev, address_to_write + i, blob + i );
 				i += 64;
 				if( ret )
 				{
@@ -2239,12 +2686,12 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 
 		if( offset_in_block == 0 && end_o_plus_one_in_block == sectorsize )
 		{
-			if( MCF.BlockWrite64 && iss->target_chip_type != CHIP_CH32V10x)
+			if( MCF( dev ).BlockWrite64 && iss->target_chip_type != CHIP_CH32V10x)
 			{
 				int i;
 				for( i = 0; i < sectorsize/64; i++ )
 				{
-					ret = MCF.BlockWrite64( dev, base + i*64, blob + rsofar+i*64 );
+					ret = MCF( dev ).BlockWrite64( dev, base + i*64, blob + rsofar+i*64 );
 					if( ret )
 					{
 						fprintf( stderr, "Error writing block at memory %08x (error = %d)\n", base, ret );
@@ -2258,21 +2705,21 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 				if( is_flash )
 				{
 					if( !skip_erase && !InternalIsMemoryErased( iss, base ) )
-						MCF.Erase( dev, base, sectorsize, 0 );
+						MCF( dev ).Erase( dev, base, sectorsize, 0 );
 					if( iss->target_chip_type != CHIP_CH32V20x && iss->target_chip_type != CHIP_CH32V30x && iss->target_chip_type != CHIP_CH32H41x )
 					{
 						// V003, x035, maybe more.
-						MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_PAGE_PG ); // THIS IS REQUIRED, (intptr_t)&FLASH->CTLR = 0x40022010
-						MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_BUF_RST | CR_PAGE_PG );  // (intptr_t)&FLASH->CTLR = 0x40022010
+						MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_PAGE_PG ); // THIS IS REQUIRED, (intptr_t)&FLASH->CTLR = 0x40022010
+						MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_BUF_RST | CR_PAGE_PG );  // (intptr_t)&FLASH->CTLR = 0x40022010
 					}
 					else
 					{
 						// No bufrst on v20x, v30x
-						if( MCF.WaitForFlash ) MCF.WaitForFlash( dev );
-						MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, write_cmd ); // THIS IS REQUIRED, (intptr_t)&FLASH->CTLR = 0x40022010
+						if( MCF( dev ).WaitForFlash ) MCF( dev ).WaitForFlash( dev );
+						MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, write_cmd ); // THIS IS REQUIRED, (intptr_t)&FLASH->CTLR = 0x40022010
 						//FTPG ==  CR_PAGE_PG   == ((uint32_t)0x00010000)
 					}
-					if( MCF.WaitForFlash ) MCF.WaitForFlash( dev );
+					if( MCF( dev ).WaitForFlash ) MCF( dev ).WaitForFlash( dev );
 				}
 
 				int j;
@@ -2286,10 +2733,10 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 					if( is_flash && iss->target_chip_type == CHIP_CH32V10x && !((j+1)&3) )
 					{
 						// Signal to WriteWord that we need to do a buffer load
-						MCF.WriteReg32( dev, DMDATA0, 1 );
-						MCF.WriteReg32( dev, DMCOMMAND, 0x0023100f );
+						MCF( dev ).WriteReg32( dev, DMDATA0, 1 );
+						MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x0023100f );
 					}
-					ret = MCF.WriteWord( dev, j*4+base, writeword );
+					ret = MCF( dev ).WriteWord( dev, j*4+base, writeword );
 					if( ret )
 					{
 						fprintf( stderr, "Error writing block at memory %08x (error = %d)\n", j*4+base, ret );
@@ -2304,15 +2751,15 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 				{
 					if( iss->target_chip_type == CHIP_CH32V20x || iss->target_chip_type == CHIP_CH32V30x || iss->target_chip_type == CHIP_CH32H41x )
 					{
-						MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, page_cmd ); // Page Start
+						MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, page_cmd ); // Page Start
 					}
 					else
 					{
-						MCF.WriteWord( dev, (intptr_t)&FLASH->ADDR, base );  //0x40022014 -> FLASH->ADDR
-						if( MCF.PrepForLongOp ) MCF.PrepForLongOp( dev );  // Give the programmer a headsup this next operation could take a while.
-						MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_PAGE_PG|CR_STRT_Set ); // 0x40022010 -> FLASH->CTLR
+						MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->ADDR, base );  //0x40022014 -> FLASH->ADDR
+						if( MCF( dev ).PrepForLongOp ) MCF( dev ).PrepForLongOp( dev );  // Give the programmer a headsup this next operation could take a while.
+						MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_PAGE_PG|CR_STRT_Set ); // 0x40022010 -> FLASH->CTLR
 					}
-					if( MCF.WaitForFlash ) MCF.WaitForFlash( dev );
+					if( MCF( dev ).WaitForFlash ) MCF( dev ).WaitForFlash( dev );
 					InternalMarkMemoryNotErased( iss, base );
 				}
 			}
@@ -2322,19 +2769,19 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 			//Ok, we have to do something wacky.
 			if( is_flash )
 			{
-				MCF.ReadBinaryBlob( dev, base, sectorsize, tempblock );
+				MCF( dev ).ReadBinaryBlob( dev, base, sectorsize, tempblock );
 
 				// Permute tempblock
 				int tocopy = end_o_plus_one_in_block - offset_in_block;
 				memcpy( tempblock + offset_in_block, blob + rsofar, tocopy );
 				rsofar += tocopy;
 
-				if( MCF.BlockWrite64 ) 
+				if( MCF( dev ).BlockWrite64 ) 
 				{
 					int i;
 					for( i = 0; i < sectorsize/64; i++ )
 					{
-						ret = MCF.BlockWrite64( dev, base+i*64, tempblock+i*64 );
+						ret = MCF( dev ).BlockWrite64( dev, base+i*64, tempblock+i*64 );
 						if( ret )
 						{
 							fprintf( stderr, "Error writing block at memory %08x (error = %d)\n", base+i*64, ret );
@@ -2344,22 +2791,22 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 				}
 				else
 				{
-					if( !InternalIsMemoryErased( iss, base ) ) MCF.Erase( dev, base, sectorsize, 0 );
+					if( !InternalIsMemoryErased( iss, base ) ) MCF( dev ).Erase( dev, base, sectorsize, 0 );
 
 					if( iss->target_chip_type != CHIP_CH32V20x && iss->target_chip_type != CHIP_CH32V30x && iss->target_chip_type != CHIP_CH32H41x )
 					{
 						// V003, x035, maybe more.
-						MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_PAGE_PG ); // THIS IS REQUIRED, (intptr_t)&FLASH->CTLR = 0x40022010
-						MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_BUF_RST | CR_PAGE_PG );  // (intptr_t)&FLASH->CTLR = 0x40022010
+						MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_PAGE_PG ); // THIS IS REQUIRED, (intptr_t)&FLASH->CTLR = 0x40022010
+						MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_BUF_RST | CR_PAGE_PG );  // (intptr_t)&FLASH->CTLR = 0x40022010
 					}
 					else
 					{
 						// No bufrst on v20x, v30x
-						if( MCF.WaitForFlash ) MCF.WaitForFlash( dev );
-						MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, write_cmd ); // THIS IS REQUIRED, (intptr_t)&FLASH->CTLR = 0x40022010
+						if( MCF( dev ).WaitForFlash ) MCF( dev ).WaitForFlash( dev );
+						MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, write_cmd ); // THIS IS REQUIRED, (intptr_t)&FLASH->CTLR = 0x40022010
 						//FTPG ==  CR_PAGE_PG   == ((uint32_t)0x00010000)
 					}
-					if( MCF.WaitForFlash ) MCF.WaitForFlash( dev );
+					if( MCF( dev ).WaitForFlash ) MCF( dev ).WaitForFlash( dev );
 
 					int j;
 					for( j = 0; j < sectorsize/4; j++ )
@@ -2369,10 +2816,10 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 						if( iss->target_chip_type == CHIP_CH32V10x && !((j+1)&3) )
 						{
 							// Signal to WriteWord that we need to do a buffer load
-							MCF.WriteReg32( dev, DMDATA0, 1 );
-							MCF.WriteReg32( dev, DMCOMMAND, 0x0023100f );
+							MCF( dev ).WriteReg32( dev, DMDATA0, 1 );
+							MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x0023100f );
 						}
-						ret = MCF.WriteWord( dev, j*4+base, *(uint32_t*)(tempblock + j * 4) );
+						ret = MCF( dev ).WriteWord( dev, j*4+base, *(uint32_t*)(tempblock + j * 4) );
 						if( ret )
 						{
 							fprintf( stderr, "Error writing block at memory %08x (error = %d)\n", j*4+base, ret );
@@ -2383,17 +2830,17 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 
 					if( iss->target_chip_type == CHIP_CH32V20x || iss->target_chip_type == CHIP_CH32V30x || iss->target_chip_type == CHIP_CH32H41x )
 					{
-						MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, page_cmd ); // Page Start
+						MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, page_cmd ); // Page Start
 					}
 					else
 					{
-						MCF.WriteWord( dev, (intptr_t)&FLASH->ADDR, base );  //0x40022014 -> FLASH->ADDR
-						MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_PAGE_PG|CR_STRT_Set ); // 0x40022010 -> FLASH->CTLR
+						MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->ADDR, base );  //0x40022014 -> FLASH->ADDR
+						MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_PAGE_PG|CR_STRT_Set ); // 0x40022010 -> FLASH->CTLR
 					}
-					if( MCF.WaitForFlash ) MCF.WaitForFlash( dev );
+					if( MCF( dev ).WaitForFlash ) MCF( dev ).WaitForFlash( dev );
 					InternalMarkMemoryNotErased( iss, base );
 				}
-				if( MCF.WaitForFlash && MCF.WaitForFlash( dev ) ) goto timedout;
+				if( MCF( dev ).WaitForFlash && MCF( dev ).WaitForFlash( dev ) ) goto timedout;
 			}
 			else
 			{
@@ -2404,7 +2851,7 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 					uint32_t taddy = j*4;
 					if( offset_in_block <= taddy && end_o_plus_one_in_block >= taddy + 4 )
 					{
-						MCF.WriteWord( dev, taddy + base, *(uint32_t*)(blob + rsofar) );
+						MCF( dev ).WriteWord( dev, taddy + base, *(uint32_t*)(blob + rsofar) );
 						rsofar += 4;
 					}
 					else if( ( offset_in_block & 1 ) || ( end_o_plus_one_in_block & 1 ) )
@@ -2415,7 +2862,7 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 						{
 							if( taddy >= offset_in_block && taddy < end_o_plus_one_in_block )
 							{
-								ret = MCF.WriteByte( dev, taddy + base, *(uint32_t*)(blob + rsofar) );
+								ret = MCF( dev ).WriteByte( dev, taddy + base, *(uint32_t*)(blob + rsofar) );
 								if( ret )
 								{
 									fprintf( stderr, "Error writing block at memory %08x (error = %d)\n", taddy + base, ret );
@@ -2434,7 +2881,7 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 						{
 							if( taddy >= offset_in_block && taddy < end_o_plus_one_in_block )
 							{
-								ret = MCF.WriteHalfWord( dev, taddy + base, *(uint32_t*)(blob + rsofar) );
+								ret = MCF( dev ).WriteHalfWord( dev, taddy + base, *(uint32_t*)(blob + rsofar) );
 								if( ret )
 								{
 									fprintf( stderr, "Error writing block at memory %08x (error = %d)\n", taddy + base, ret );
@@ -2450,7 +2897,7 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 		}
 	}
 
-	MCF.FlushLLCommands( dev );
+	MCF( dev ).FlushLLCommands( dev );
 
 #if 0
 	{
@@ -2476,10 +2923,537 @@ timedout:
 	return -5;
 }
 
+// Writes the runs of sectors marked in dirty[], one entry per sector starting
+// from the one address_to_write is in.
+int InternalWriteChangedSectors( void * dev, uint32_t address_to_write, uint32_t blob_size, const uint8_t * blob, const uint8_t * dirty )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	uint32_t sectorsize = iss->sector_size;
+	uint32_t end = address_to_write + blob_size;
+	uint32_t sector = address_to_write & ~( sectorsize - 1 );
+	uint32_t run_start = 0;
+	int in_run = 0;
+	int i;
+
+	for( i = 0; ; i++, sector += sectorsize )
+	{
+		int d = ( sector < end ) && dirty[i];
+		if( d && !in_run )
+		{
+			run_start = ( sector < address_to_write ) ? address_to_write : sector;
+			in_run = 1;
+		}
+		else if( !d && in_run )
+		{
+			uint32_t run_end = ( sector > end ) ? end : sector;
+			int ret = MCF( dev ).WriteBinaryBlob( dev, run_start, run_end - run_start, blob + ( run_start - address_to_write ) );
+			if( ret ) return ret;
+			in_run = 0;
+		}
+		if( sector >= end ) break;
+	}
+	return 0;
+}
+
+// Reads back what's in flash now, and only rewrites the sectors where it differs
+// from the image.  Runs of changed sectors are handed to WriteBinaryBlob together.
+int DiffWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob_size, const uint8_t * blob )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	int ret = 0;
+
+	if( blob_size == 0 ) return 0;
+	if( !MCF( dev ).ReadBinaryBlob )
+		return MCF( dev ).WriteBinaryBlob( dev, address_to_write, blob_size, blob );
+
+	uint8_t * current = malloc( blob_size );
+	if( MCF( dev ).ReadBinaryBlob( dev, address_to_write, blob_size, current ) )
+	{
+		fprintf( stderr, "Warning: Could not read back flash, writing the whole image.\n" );
+		free( current );
+		return MCF( dev ).WriteBinaryBlob( dev, address_to_write, blob_size, blob );
+	}
+
+	uint32_t sectorsize = iss->sector_size;
+	uint32_t end = address_to_write + blob_size;
+	uint32_t sector = address_to_write & ~( sectorsize - 1 );
+	int sectors = 0;
+	int changed = 0;
+	uint8_t * dirty = malloc( ( end - sector ) / sectorsize + 1 );
+
+	for( ; sector < end; sector += sectorsize )
+	{
+		uint32_t s = ( sector < address_to_write ) ? address_to_write : sector;
+		uint32_t e = ( sector + sectorsize > end ) ? end : sector + sectorsize;
+		dirty[sectors] = memcmp( current + ( s - address_to_write ), blob + ( s - address_to_write ), e - s ) != 0;
+		changed += dirty[sectors++];
+	}
+
+	ret = InternalWriteChangedSectors( dev, address_to_write, blob_size, blob, dirty );
+	free( dirty );
+	free( current );
+	if( !ret ) printf( "Diff: %d of %d sectors changed\n", changed, sectors );
+	return ret;
+}
+
+// Returns 0 if what's on the chip matches image, by reading all of it back.
+static int InternalVerifyReadBack( void * dev, uint32_t address, uint32_t len, const uint8_t * image )
+{
+	uint8_t * readback = malloc( len );
+	int r = MCF( dev ).ReadBinaryBlob( dev, address, len, readback ) ? -1 : !!memcmp( readback, image, len );
+	free( readback );
+	return r;
+}
+
+// Returns 0 if what's on the chip matches image.
+static int InternalVerifyWrite( void * dev, uint32_t address, uint32_t len, const uint8_t * image )
+{
+	int r = InternalVerifyCRC32( dev, address, len, image );
+	if( r < 0 )
+	{
+		// Can't CRC it on this chip, so read it all back.
+		r = InternalVerifyReadBack( dev, address, len, image );
+	}
+	return r;
+}
+
+#define ELF_MAX_SEGMENTS 32
+
+int WriteELFImage( void * dev, const char * filename, int diff, int verify, int cache )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	struct ElfFile elf;
+	struct ElfSegment segs[ELF_MAX_SEGMENTS];
+	int i, j, r = 0;
+
+	if( !MCF( dev ).WriteBinaryBlob ) return -5;
+	if( ElfLoad( &elf, filename ) ) return -55;
+
+	int nsegs = ElfGetLoadSegments( &elf, segs, ELF_MAX_SEGMENTS );
+	if( nsegs <= 0 )
+	{
+		if( nsegs == 0 ) fprintf( stderr, "Error: Nothing to load in %s\n", filename );
+		ElfFree( &elf );
+		return -10;
+	}
+
+	const struct RiscVChip_s * chip = iss->target_chip;
+	uint32_t sectorsize = iss->sector_size ? iss->sector_size : chip->sector_size;
+	int has_flash = 0;
+	for( i = 0; i < nsegs; i++ )
+	{
+		// ch32fun.ld links flash at 0, which is aliased to where the chip really has it.
+		if( chip->flash_offset && segs[i].address < chip->flash_size )
+			segs[i].address += chip->flash_offset;
+		has_flash |= IsAddressFlash( segs[i].address );
+	}
+
+	// Sort by address, there are only ever a handful.
+	for( i = 1; i < nsegs; i++ )
+	{
+		struct ElfSegment t = segs[i];
+		for( j = i; j > 0 && segs[j-1].address > t.address; j-- )
+			segs[j] = segs[j-1];
+		segs[j] = t;
+	}
+
+	if( MCF( dev ).HaltMode ) MCF( dev ).HaltMode( dev, has_flash ? HALT_MODE_HALT_AND_RESET : HALT_MODE_HALT_BUT_NO_RESET );
+
+	double start = OGGetAbsoluteTime();
+	uint32_t total = 0;
+	for( i = 0; i < nsegs && !r; i = j )
+	{
+		uint32_t base = segs[i].address;
+		uint32_t end = base + segs[i].size;
+		int is_flash = IsAddressFlash( base );
+
+		// Flash segments that share a sector get written together, so that sector
+		// is only erased once.  Anything in between is left erased.
+		for( j = i + 1; j < nsegs; j++ )
+		{
+			if( !is_flash || !IsAddressFlash( segs[j].address ) ) break;
+			if( segs[j].address > ( ( end - 1 ) | ( sectorsize - 1 ) ) ) break;
+			if( segs[j].address + segs[j].size > end ) end = segs[j].address + segs[j].size;
+		}
+
+		uint32_t len = end - base;
+		uint8_t * blob = malloc( len );
+		memset( blob, 0xff, len );
+		int k;
+		for( k = i; k < j; k++ )
+			memcpy( blob + ( segs[k].address - base ), segs[k].data, segs[k].size );
+
+		iss->current_area = 0; // Segments can be in different areas.
+		if( !CheckMemoryLocation( dev, DEFAULT_AREA, base, len ) )
+		{
+			fprintf( stderr, "Error: ELF segment at 0x%08x (%u bytes) doesn't fit into this chip\n", base, len );
+			r = -44;
+		}
+		else
+		{
+			printf( "Writing %u bytes at 0x%08x\n", len, base );
+			if( cache && is_flash )
+				r = CachedWriteBinaryBlob( dev, base, len, blob, diff );
+			else if( diff && is_flash )
+				r = DiffWriteBinaryBlob( dev, base, len, blob );
+			else
+				r = MCF( dev ).WriteBinaryBlob( dev, base, len, blob );
+			// The CRC stub runs out of the start of RAM, so RAM segments are just
+			// read back.
+			if( r )
+				fprintf( stderr, "Error: Fault writing image.\n" );
+			else if( verify && ( is_flash ? InternalVerifyWrite( dev, base, len, blob ) :
+				InternalVerifyReadBack( dev, base, len, blob ) ) )
+			{
+				fprintf( stderr, "Error: Verify failed at 0x%08x.\n", base );
+				r = -14;
+			}
+		}
+		total += len;
+		free( blob );
+	}
+
+	if( !r )
+	{
+		printf( "Wrote %u bytes in %d segments in %.3f s%s\n", total, nsegs, OGGetAbsoluteTime() - start, verify ? " (verified)" : "" );
+
+		// Nothing in flash, so it's meant to run from RAM.  Point the core at it.
+		if( !has_flash && MCF( dev ).WriteCPURegister )
+		{
+			MCF( dev ).WriteCPURegister( dev, 0x7b1, ElfEntry( &elf ) ); // dpc
+			printf( "Entry point 0x%08x set, resume (-e) to run it\n", ElfEntry( &elf ) );
+		}
+	}
+
+	ElfFree( &elf );
+	return r;
+}
+
+// Same CRC the v10x/v20x/v30x CRC peripheral (and the crc32 stub) computes.
+uint32_t InternalCRC32Words( const uint8_t * data, uint32_t words )
+{
+	uint32_t crc = 0xffffffff;
+	uint32_t i;
+	int b;
+	for( i = 0; i < words; i++ )
+	{
+		crc ^= data[i*4+0] | (data[i*4+1]<<8) | (data[i*4+2]<<16) | ((uint32_t)data[i*4+3]<<24);
+		for( b = 0; b < 32; b++ )
+			crc = ( crc & 0x80000000 ) ? ( crc << 1 ) ^ 0x04C11DB7 : ( crc << 1 );
+	}
+	return crc;
+}
+
+// Computes the CRC32 of words words of memory at address by running
+// stubs/crc32 out of the start of RAM, so only 4 bytes have to come back
+// instead of all of it.  The processor must be halted.  The RAM and registers
+// it touches are put back.
+// Returns 0 if ok, negative if it couldn't be done this way.
+int InternalChipCRC32( void * dev, uint32_t address, uint32_t words, uint32_t * crc )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	static const uint16_t saveregs[] = { 0x1005, 0x100a, 0x100b, 0x100c, 0x100d, 0x100e, 0x100f, 0x300, 0x7b0, 0x7b1 };
+	uint32_t saved[sizeof(saveregs)/sizeof(saveregs[0])];
+	int nsave = sizeof(saveregs)/sizeof(saveregs[0]);
+	int i, r = 0;
+
+	if( !iss->target_chip || iss->target_chip->protocol != PROTOCOL_DEFAULT || ( address & 3 ) ||
+		!MCF( dev ).WriteReg32 || !MCF( dev ).ReadReg32 || !MCF( dev ).ReadCPURegister || !MCF( dev ).WriteCPURegister )
+		return -5;
+
+	uint32_t stub_base = iss->target_chip->ram_base;
+	if( address < stub_base + sizeof( crc32_bin ) && address + words*4 > stub_base ) return -5;
+
+	int use_hw = iss->target_chip_type == CHIP_CH32V10x || iss->target_chip_type == CHIP_CH32V20x ||
+		iss->target_chip_type == CHIP_CH32V30x;
+
+	for( i = 0; i < nsave; i++ )
+		if( MCF( dev ).ReadCPURegister( dev, saveregs[i], &saved[i] ) ) return -5;
+
+	// Whatever the firmware had where the stub goes.
+	uint8_t ramsave[( sizeof( crc32_bin ) + 3 ) & ~3];
+	if( MCF( dev ).ReadBinaryBlob( dev, stub_base, sizeof( ramsave ), ramsave ) ) return -5;
+
+	if( MCF( dev ).WriteBinaryBlob( dev, stub_base, sizeof( crc32_bin ), crc32_bin ) ) return -5;
+
+	MCF( dev ).WriteCPURegister( dev, 0x100a, address );          // a0 = start
+	MCF( dev ).WriteCPURegister( dev, 0x100b, address + words*4 ); // a1 = end
+	MCF( dev ).WriteCPURegister( dev, 0x100c, use_hw );           // a2 = use CRC peripheral
+	MCF( dev ).WriteCPURegister( dev, 0x300, 0 );                 // mstatus: No interrupts while it runs.
+	MCF( dev ).WriteCPURegister( dev, 0x7b0, ( saved[8] | 0x8000 ) & ~4 ); // dcsr: ebreakm so the ebreak lands back here, no stepping.
+	MCF( dev ).WriteCPURegister( dev, 0x7b1, stub_base );         // dpc
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x40000001 );          // resumereq
+
+	double start = OGGetAbsoluteTime();
+	uint32_t dmstatus = 0;
+	do
+	{
+		if( OGGetAbsoluteTime() - start > 2.0 )
+		{
+			fprintf( stderr, "Error: CRC stub timed out (DMSTATUS = %08x)\n", dmstatus );
+			r = -9;
+			break;
+		}
+		MCF( dev ).DelayUS( dev, 1000 );
+		MCF( dev ).ReadReg32( dev, DMSTATUS, &dmstatus );
+	} while( !( dmstatus & (1<<9) ) ); // allhalted
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make sure we stay halted.
+
+	if( !r ) r = MCF( dev ).ReadCPURegister( dev, 0x100a, crc );
+
+	// The stub went through the registers the memory access code keeps its state in.
+	if( MCF( dev ).VoidHighLevelState ) MCF( dev ).VoidHighLevelState( dev );
+	else iss->statetag = STTAG( "VOID" );
+	if( MCF( dev ).WriteBinaryBlob( dev, stub_base, sizeof( ramsave ), ramsave ) && !r ) r = -5;
+
+	for( i = 0; i < nsave; i++ )
+		MCF( dev ).WriteCPURegister( dev, saveregs[i], saved[i] );
+	if( MCF( dev ).VoidHighLevelState ) MCF( dev ).VoidHighLevelState( dev );
+	else iss->statetag = STTAG( "VOID" );
+	return r;
+}
+
+// Verifies memory against an image with InternalChipCRC32.
+// Returns 0 if it matches, 1 if it doesn't, negative if it couldn't be checked
+// this way (in which case, read it back).
+int InternalVerifyCRC32( void * dev, uint32_t address, uint32_t len, const uint8_t * image )
+{
+	uint32_t words = len / 4;
+	uint32_t crc = 0;
+	int r = InternalChipCRC32( dev, address, words, &crc );
+	if( r ) return r;
+
+	if( crc != InternalCRC32Words( image, words ) ) return 1;
+
+	// Any leftover bytes at the end just get read.
+	if( len & 3 )
+	{
+		uint8_t tail[4];
+		if( MCF( dev ).ReadBinaryBlob( dev, address + words*4, len & 3, tail ) ) return -5;
+		if( memcmp( tail, image + words*4, len & 3 ) ) return 1;
+	}
+	return 0;
+}
+
+// Packs a page in the format stubs/flashloader unpacks (see flashloader.S),
+// going for whatever is longest at each point: a run of one byte, a copy from
+// earlier in the page, or else literals.  Returns the packed size, or -1 if
+// it won't fit in maxout.
+static int LoaderCompressPage( const uint8_t * in, int len, uint8_t * out, int maxout )
+{
+	int i = 0, o = 0;
+	int lit = -1; // Where the control byte of the current run of literals is.
+	while( i < len )
+	{
+		int run = 1, best = 0, bestd = 0, d;
+		while( i + run < len && run < 66 && in[i+run] == in[i] ) run++;
+		for( d = 1; d <= 256 && d <= i; d++ )
+		{
+			int l = 0;
+			while( i + l < len && l < 66 && in[i+l] == in[i+l-d] ) l++;
+			if( l > best ) { best = l; bestd = d; }
+		}
+
+		if( o + 2 > maxout ) return -1;
+		if( run >= 3 && run >= best )
+		{
+			out[o++] = 0x80 | ( run - 3 );
+			out[o++] = in[i];
+			i += run;
+			lit = -1;
+		}
+		else if( best >= 3 )
+		{
+			out[o++] = 0xc0 | ( best - 3 );
+			out[o++] = bestd - 1;
+			i += best;
+			lit = -1;
+		}
+		else
+		{
+			if( lit < 0 || out[lit] == 0x7f )
+			{
+				lit = o++;
+				out[lit] = 0;
+			}
+			else
+				out[lit]++;
+			out[o++] = in[i++];
+		}
+	}
+	return o;
+}
+
+// Writes whole pages of flash by running stubs/flashloader out of the start
+// of RAM, which is put back afterwards.  Each page goes into RAM right behind the stub while the core is
+// halted, then the stub copies it into the flash controller's page buffer and
+// starts programming, and ebreaks without waiting.  So the flash controller
+// works on page N while page N+1 is on its way over, and the page buffer is
+// the second half of the double buffer (the debug module can only get at RAM
+// with the core halted, so there's no point in a second RAM buffer).  The
+// stub leaves its status in a0.
+// With -w --compress (iss->compress_flash), pages that pack smaller are sent
+// packed, and the stub unpacks them while the last page is programming.
+// address and len must be page aligned.  The processor must be halted.
+// Returns 0 if ok, 1 if the loader can't be used here (nothing was touched),
+// or negative on error.
+int InternalLoaderWriteFlash( void * dev, uint32_t address, uint32_t len, const uint8_t * blob )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	static const uint16_t saveregs[] = { 0x1001, 0x1005, 0x1006, 0x1007, 0x1008, 0x1009, 0x100a, 0x100b, 0x100c, 0x100d, 0x100e, 0x100f, 0x300, 0x7b0, 0x7b1 };
+	uint32_t saved[sizeof(saveregs)/sizeof(saveregs[0])];
+	int nsave = sizeof(saveregs)/sizeof(saveregs[0]);
+	uint32_t stubsize = ( sizeof( flashloader_bin ) + 3 ) & ~3;
+	uint32_t pagesize = iss->sector_size;
+	uint32_t flags;
+	int i, r = 0;
+
+	if( !iss->target_chip || iss->target_chip->protocol != PROTOCOL_DEFAULT || iss->current_area == BOOTLOADER_AREA ||
+		!MCF( dev ).WriteReg32 || !MCF( dev ).ReadReg32 || !MCF( dev ).ReadCPURegister || !MCF( dev ).WriteCPURegister ||
+		!pagesize || ( address & ( pagesize - 1 ) ) || ( len & ( pagesize - 1 ) ) ||
+		stubsize + pagesize * 2 > iss->target_chip->ram_size )
+		return 1;
+
+	switch( iss->target_chip_type )
+	{
+	case CHIP_CH32V003:
+	case CHIP_CH32V00x:
+		flags = 2; // BUF_RST/BUF_LOAD, start with ADDR + STRT
+		break;
+	case CHIP_CH32V20x:
+	case CHIP_CH32V30x:
+		flags = 0; // Start with PGSTRT
+		break;
+	default:
+		return 1;
+	}
+
+	uint32_t stub_base = iss->target_chip->ram_base;
+	uint32_t page_buffer = stub_base + stubsize;
+	uint32_t packed_buffer = page_buffer + pagesize;
+	uint8_t packed[pagesize];
+	uint32_t sent = 0;
+	double start_time = OGGetAbsoluteTime();
+
+	for( i = 0; i < nsave; i++ )
+		if( MCF( dev ).ReadCPURegister( dev, saveregs[i], &saved[i] ) ) return 1;
+
+	// Whatever the firmware had where the stub and its buffers go.
+	uint32_t ramsave_len = stubsize + pagesize * 2;
+	uint8_t * ramsave = malloc( ramsave_len );
+	if( MCF( dev ).ReadBinaryBlob( dev, stub_base, ramsave_len, ramsave ) )
+	{
+		free( ramsave );
+		return 1;
+	}
+
+	// The stub fails the first page on a WRPRTERR left over from before.
+	uint32_t statr = 0;
+	if( !MCF( dev ).ReadWord( dev, (intptr_t)&FLASH->STATR, &statr ) && ( statr & FLASH_STATR_WRPRTERR ) )
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->STATR, statr ); // Write 1 to clear, and keep the boot mode bits as they were.
+
+	if( MCF( dev ).WriteBinaryBlob( dev, stub_base, sizeof( flashloader_bin ), flashloader_bin ) )
+	{
+		free( ramsave );
+		return 1;
+	}
+
+	MCF( dev ).WriteCPURegister( dev, 0x300, 0 );                               // mstatus: No interrupts while it runs.
+	MCF( dev ).WriteCPURegister( dev, 0x7b0, ( saved[nsave-2] | 0x8000 ) & ~4 ); // dcsr: ebreakm so the ebreak lands back here, no stepping.
+
+	uint32_t done;
+	for( done = 0; done <= len && !r; done += pagesize )
+	{
+		uint32_t page = address + done;
+		uint32_t args[6] = { page_buffer, page, pagesize, flags, 0x40022000, packed_buffer }; // a0..a5
+		uint32_t dmstatus = 0;
+
+		if( done == len )
+			args[2] = 0; // Just wait for the last page to finish.
+		else
+		{
+			int packedlen = iss->compress_flash ? LoaderCompressPage( blob + done, pagesize, packed, pagesize - 4 ) : -1;
+			if( !InternalIsMemoryErased( iss, page ) ) args[3] |= 1;
+			if( packedlen > 0 )
+			{
+				args[3] |= 4;
+				packedlen = ( packedlen + 3 ) & ~3;
+				r = MCF( dev ).WriteBinaryBlob( dev, packed_buffer, packedlen, packed );
+				sent += packedlen;
+			}
+			else
+			{
+				r = MCF( dev ).WriteBinaryBlob( dev, page_buffer, pagesize, blob + done );
+				sent += pagesize;
+			}
+			if( r )
+			{
+				r = -9;
+				break;
+			}
+		}
+
+		DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+		DMIQueueWriteRegisters( dev, 0x100a, 6, args );
+		DMIQueueWrite( dev, DMDATA0, stub_base );
+		DMIQueueWrite( dev, DMCOMMAND, 0x002307b1 );      // dpc = stub
+		DMIQueueWrite( dev, DMCONTROL, 0x40000001 );      // resumereq
+		DMIQueueRead( dev, DMSTATUS, &dmstatus );
+		r = DMIFlush( dev );
+		iss->statetag = STTAG( "LOAD" );
+
+		double start = OGGetAbsoluteTime();
+		while( !r && !( dmstatus & (1<<9) ) ) // allhalted
+		{
+			if( OGGetAbsoluteTime() - start > 2.0 )
+			{
+				fprintf( stderr, "Error: Flash loader timed out (DMSTATUS = %08x)\n", dmstatus );
+				r = -9;
+				break;
+			}
+			r = MCF( dev ).ReadReg32( dev, DMSTATUS, &dmstatus );
+		}
+
+		uint32_t status = 0;
+		DMIQueueWrite( dev, DMCONTROL, 0x80000001 ); // Make sure we stay halted.
+		DMIQueueReadRegisters( dev, 0x100a, 1, &status );
+		if( DMIFlush( dev ) && !r ) r = -9;
+		if( !r && status )
+		{
+			fprintf( stderr, "Error: Flash write failed near %08x (FLASH->STATR = %08x)\n", page - ( done == len ? pagesize : 0 ), status );
+			r = -9;
+		}
+		if( done < len ) InternalMarkMemoryNotErased( iss, page );
+
+		// The stub went through the registers the memory access code keeps its state in.
+		if( MCF( dev ).VoidHighLevelState ) MCF( dev ).VoidHighLevelState( dev );
+		else iss->statetag = STTAG( "VOID" );
+	}
+
+	// Put the firmware's RAM back, so this is safe to do under running code (like setting breakpoints).
+	if( MCF( dev ).WriteBinaryBlob( dev, stub_base, ramsave_len, ramsave ) && !r ) r = -9;
+	free( ramsave );
+
+	for( i = 0; i < nsave; i++ )
+		MCF( dev ).WriteCPURegister( dev, saveregs[i], saved[i] );
+	if( MCF( dev ).VoidHighLevelState ) MCF( dev ).VoidHighLevelState( dev );
+	else iss->statetag = STTAG( "VOID" );
+
+	if( !r && iss->compress_flash )
+	{
+		double dt = OGGetAbsoluteTime() - start_time;
+		printf( "Compressed %u bytes to %u (%.1f%%), %.1f kB/s effective\n", len, sent,
+			len ? sent * 100.0 / len : 0.0, dt > 0 ? len / dt / 1024.0 : 0.0 );
+	}
+	return r;
+}
+
 static int DefaultReadWord( void * dev, uint32_t address_to_read, uint32_t * data )
 {
 	int r = 0;
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	uint32_t abstractcs = 0;
+	int check_done = 0;
 
 	int autoincrement = 1;
 	if( address_to_read == 0x40022010 ||
@@ -2499,61 +3473,71 @@ static int DefaultReadWord( void * dev, uint32_t address_to_read, uint32_t * dat
 				StaticUpdatePROGBUFRegs( dev );
 			}
 
-			MCF.WriteReg32( dev, DMABSTRACTAUTO, 0 ); // Disable Autoexec.
+			DMIQueueWrite( dev, DMABSTRACTAUTO, 0 ); // Disable Autoexec.
 
 			// c.lw x8,0(x11) // Pull the address from DATA1
 			// c.lw x9,0(x8)  // Read the data at that location.
-			MCF.WriteReg32( dev, DMPROGBUF0, 0x40044180 );
+			DMIQueueWrite( dev, DMPROGBUF0, 0x40044180 );
 
 			if( autoincrement )
 			{
 				// c.addi x8, 4
 				// c.sw x9, 0(x10) // Write back to DATA0
 
-				MCF.WriteReg32( dev, DMPROGBUF1, 0xc1040411 );
+				DMIQueueWrite( dev, DMPROGBUF1, 0xc1040411 );
 			}
 			else
 			{
 				// c.nop
 				// c.sw x9, 0(x10) // Write back to DATA0
 
-				MCF.WriteReg32( dev, DMPROGBUF1, 0xc1040001 );
+				DMIQueueWrite( dev, DMPROGBUF1, 0xc1040001 );
 			}
 			// c.sw x8, 0(x11) // Write addy to DATA1
 			// c.ebreak
-			MCF.WriteReg32( dev, DMPROGBUF2, 0x9002c180 );
+			DMIQueueWrite( dev, DMPROGBUF2, 0x9002c180 );
 
 			if( !iss->target_chip->no_autoexec )
-				MCF.WriteReg32( dev, DMABSTRACTAUTO, 1 ); // Enable Autoexec (different kind of autoinc than outer autoinc)
+				DMIQueueWrite( dev, DMABSTRACTAUTO, 1 ); // Enable Autoexec (different kind of autoinc than outer autoinc)
 
 			iss->autoincrement = autoincrement;
 		}
 
-		MCF.WriteReg32( dev, DMDATA1, address_to_read );
+		DMIQueueWrite( dev, DMDATA1, address_to_read );
 		if( !iss->target_chip->no_autoexec )
-			MCF.WriteReg32( dev, DMCOMMAND, 0x00240000 );
+			DMIQueueWrite( dev, DMCOMMAND, 0x00240000 );
 
 		iss->statetag = STTAG( "RDSQ" );
 		iss->currentstateval = address_to_read;
 
-		MCF.WaitForDoneOp( dev, 1 );
-
-		if( r ) fprintf( stderr, "Fault on DefaultReadWord Part 1\n" );
+		check_done = 1;
 	}
 
 	if( iss->autoincrement )
 		iss->currentstateval += 4;
 
 	// If you were running locally, you might need to do this.
-	//MCF.WaitForDoneOp( dev, 1 );
+	//MCF( dev ).WaitForDoneOp( dev, 1 );
 
 	if( iss->target_chip->no_autoexec ) {
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00240000 );
+		DMIQueueWrite( dev, DMCOMMAND, 0x00240000 );
+	}
+	DMIQueueRead( dev, DMDATA0, data );
+	if( check_done ) DMIQueueRead( dev, DMABSTRACTCS, &abstractcs );
+	r |= DMIFlush( dev );
+
+	if( ( abstractcs >> 8 ) & 7 )
+	{
+		// The first command hadn't finished by the time we read DATA0 (or it
+		// faulted).  Wait it out and clear it, and if it was just busy, the
+		// read got dropped, so do it again.
+		MCF( dev ).WaitForDoneOp( dev, 1 );
+		if( ( ( abstractcs >> 8 ) & 7 ) == 1 )
+			r |= MCF( dev ).ReadReg32( dev, DMDATA0, data );
 	}
-	r |= MCF.ReadReg32( dev, DMDATA0, data );
 
 	if( iss->currentstateval == iss->ram_base + iss->ram_size )
-		MCF.WaitForDoneOp( dev, 1 ); // Ignore any post-errors. 
+		MCF( dev ).WaitForDoneOp( dev, 1 ); // Ignore any post-errors. 
 	return r;
 }
 
@@ -2562,23 +3546,23 @@ int InternalUnlockFlash( void * dev, struct InternalState * iss )
 	int ret = 0;
 	uint32_t rw;
 
-	ret = MCF.ReadWord( dev, 0x40022010, &rw );  // FLASH->CTLR = 0x40022010
+	ret = MCF( dev ).ReadWord( dev, 0x40022010, &rw );  // FLASH->CTLR = 0x40022010
 	if( rw & 0x8080 ) 
 	{
-		ret = MCF.WriteWord( dev, 0x40022004, 0x45670123 ); // FLASH->KEYR = 0x40022004
+		ret = MCF( dev ).WriteWord( dev, 0x40022004, 0x45670123 ); // FLASH->KEYR = 0x40022004
 		if( ret ) goto reterr;
-		ret = MCF.WriteWord( dev, 0x40022004, 0xCDEF89AB );
+		ret = MCF( dev ).WriteWord( dev, 0x40022004, 0xCDEF89AB );
 		if( ret ) goto reterr;
-		ret = MCF.WriteWord( dev, 0x40022008, 0x45670123 ); // OBKEYR = 0x40022008  // For user word unlocking
+		ret = MCF( dev ).WriteWord( dev, 0x40022008, 0x45670123 ); // OBKEYR = 0x40022008  // For user word unlocking
 		if( ret ) goto reterr;
-		ret = MCF.WriteWord( dev, 0x40022008, 0xCDEF89AB );
+		ret = MCF( dev ).WriteWord( dev, 0x40022008, 0xCDEF89AB );
 		if( ret ) goto reterr;
-		ret = MCF.WriteWord( dev, 0x40022024, 0x45670123 ); // MODEKEYR = 0x40022024
+		ret = MCF( dev ).WriteWord( dev, 0x40022024, 0x45670123 ); // MODEKEYR = 0x40022024
 		if( ret ) goto reterr;
-		ret = MCF.WriteWord( dev, 0x40022024, 0xCDEF89AB );
+		ret = MCF( dev ).WriteWord( dev, 0x40022024, 0xCDEF89AB );
 		if( ret ) goto reterr;
 
-		ret = MCF.ReadWord( dev, 0x40022010, &rw ); // FLASH->CTLR = 0x40022010
+		ret = MCF( dev ).ReadWord( dev, 0x40022010, &rw ); // FLASH->CTLR = 0x40022010
 		if( ret ) goto reterr;
 
 		if( rw & 0x8080 ) 
@@ -2588,7 +3572,7 @@ int InternalUnlockFlash( void * dev, struct InternalState * iss )
 		}
 	}
 
-	MCF.ReadWord( dev, 0x4002201c, &rw ); //(FLASH_OBTKEYR)
+	MCF( dev ).ReadWord( dev, 0x4002201c, &rw ); //(FLASH_OBTKEYR)
 	if( rw & 2 )
 	{
 		fprintf( stderr, "\n-------------------------------------------------------\n");
@@ -2621,13 +3605,13 @@ int DefaultErase( void * dev, uint32_t address, uint32_t length, int type )
 		// Whole-chip flash
 		iss->statetag = STTAG( "XXXX" );
 		printf( "Whole-chip erase\n" );
-		if( MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, 0 ) ) goto flashoperr;
-		if( MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_MER  ) ) goto flashoperr;
-		if( MCF.PrepForLongOp ) MCF.PrepForLongOp( dev );  // Give the programmer a headsup this next operation could take a while.
-		if( MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_STRT_Set|FLASH_CTLR_MER ) ) goto flashoperr;
-		rw = MCF.WaitForDoneOp( dev, 0 );
-		if( MCF.WaitForFlash && MCF.WaitForFlash( dev ) ) { fprintf( stderr, "Error: Wait for flash error.\n" ); return -11; }
-		MCF.VoidHighLevelState( dev );
+		if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, 0 ) ) goto flashoperr;
+		if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_MER  ) ) goto flashoperr;
+		if( MCF( dev ).PrepForLongOp ) MCF( dev ).PrepForLongOp( dev );  // Give the programmer a headsup this next operation could take a while.
+		if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_STRT_Set|FLASH_CTLR_MER ) ) goto flashoperr;
+		rw = MCF( dev ).WaitForDoneOp( dev, 0 );
+		if( MCF( dev ).WaitForFlash && MCF( dev ).WaitForFlash( dev ) ) { fprintf( stderr, "Error: Wait for flash error.\n" ); return -11; }
+		MCF( dev ).VoidHighLevelState( dev );
 		memset( iss->flash_sector_status, 1, sizeof( iss->flash_sector_status ) );
 	}
 	else
@@ -2653,23 +3637,23 @@ int DefaultErase( void * dev, uint32_t address, uint32_t length, int type )
 			if( type == 2 ) // Special procedure for erasing BOOT partition on ch32v20x and ch32v30x
 			{
 				// Can only erase full 4K pages
-				if( MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, (1<<30) | CR_PER_Set ) ) goto flashoperr;
-				if( MCF.WriteWord( dev, (intptr_t)&FLASH->ADDR, chunk_to_erase ) ) goto flashoperr;
-				if( MCF.PrepForLongOp ) MCF.PrepForLongOp( dev );
-				if( MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, (1<<30) | CR_PER_Set | CR_STRT_Set ) ) goto flashoperr;
+				if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, (1<<30) | CR_PER_Set ) ) goto flashoperr;
+				if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->ADDR, chunk_to_erase ) ) goto flashoperr;
+				if( MCF( dev ).PrepForLongOp ) MCF( dev ).PrepForLongOp( dev );
+				if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, (1<<30) | CR_PER_Set | CR_STRT_Set ) ) goto flashoperr;
 			}
 			else
 			{
 				// Step 4:  set PAGE_ER of FLASH_CTLR(0x40022010)
-				if( MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_PAGE_ER ) ) goto flashoperr; // CR_PAGE_ER is FTER
+				if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_PAGE_ER ) ) goto flashoperr; // CR_PAGE_ER is FTER
 				// Step 5: Write the first address of the fast erase page to the FLASH_ADDR register.
-				if( MCF.WriteWord( dev, (intptr_t)&FLASH->ADDR, chunk_to_erase ) ) goto flashoperr;
-				if( MCF.PrepForLongOp ) MCF.PrepForLongOp( dev );  // Give the programmer a headsup this next operation could take a while.
+				if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->ADDR, chunk_to_erase ) ) goto flashoperr;
+				if( MCF( dev ).PrepForLongOp ) MCF( dev ).PrepForLongOp( dev );  // Give the programmer a headsup this next operation could take a while.
 				// Step 6: Set the STAT/STRT bit of FLASH_CTLR register to '1' to initiate a fast page erase (64 bytes) action.
-				if( MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_STRT_Set | CR_PAGE_ER ) ) goto flashoperr;
+				if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_STRT_Set | CR_PAGE_ER ) ) goto flashoperr;
 			}
 
-			if( MCF.WaitForFlash && MCF.WaitForFlash( dev ) ) return -99;
+			if( MCF( dev ).WaitForFlash && MCF( dev ).WaitForFlash( dev ) ) return -99;
 
 			chunk_to_erase+=sector_size;
 		}
@@ -2717,7 +3701,7 @@ static int DefaultSetSplit(void * dev, enum RAMSplit split) {
 	// Otherwise read it off the chip
 	uint32_t chip_id = iss->target_chip_id;
 	if (!chip_id) {
-		if( MCF.ReadWord( dev, (intptr_t)&INFO->CHIPID, &chip_id ) ) goto flashoperr;
+		if( MCF( dev ).ReadWord( dev, (intptr_t)&INFO->CHIPID, &chip_id ) ) goto flashoperr;
 	}
 
 	uint32_t chip = chip_id & 0xFFFFFF0F;
@@ -2878,13 +3862,13 @@ static int DefaultSetSplit(void * dev, enum RAMSplit split) {
 			
 	}
 
-	if( !MCF.WriteHalfWord || !MCF.ReadHalfWord)
+	if( !MCF( dev ).WriteHalfWord || !MCF( dev ).ReadHalfWord)
 	{
 		fprintf( stderr, "Error: for setting ram split option bytes, half-word read and write is required\n" );
 		return -5;
 	}
 
-	if( MCF.ReadHalfWord( dev, (intptr_t)&OB->USER, &option_bytes ) ) goto flashoperr;
+	if( MCF( dev ).ReadHalfWord( dev, (intptr_t)&OB->USER, &option_bytes ) ) goto flashoperr;
 	printf("initial option_bytes = %04x\n", option_bytes);
 
 	// since WCH expand ram config bits, from 9:8, to 9:7. We expand option_bytes to 3 bit and shift for 5 bit instead of 6.
@@ -2899,35 +3883,35 @@ static int DefaultSetSplit(void * dev, enum RAMSplit split) {
 
 	InternalUnlockFlash(dev, iss);
 
-	if( MCF.ReadWord( dev, (intptr_t)&FLASH->CTLR, &flash_ctlr ) ) goto flashoperr;
+	if( MCF( dev ).ReadWord( dev, (intptr_t)&FLASH->CTLR, &flash_ctlr ) ) goto flashoperr;
 	flash_ctlr |= CR_OPTER_Set;
-	if( MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, flash_ctlr ) ) goto flashoperr;
+	if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, flash_ctlr ) ) goto flashoperr;
 	flash_ctlr |= CR_STRT_Set;
-	if( MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, flash_ctlr ) ) goto flashoperr;
-	if( MCF.WaitForFlash(dev) ) goto flashoperr;
+	if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, flash_ctlr ) ) goto flashoperr;
+	if( MCF( dev ).WaitForFlash(dev) ) goto flashoperr;
 
-	if( MCF.ReadWord( dev, (intptr_t)&FLASH->CTLR, &flash_ctlr ) ) goto flashoperr;
+	if( MCF( dev ).ReadWord( dev, (intptr_t)&FLASH->CTLR, &flash_ctlr ) ) goto flashoperr;
 	flash_ctlr &= CR_OPTER_Reset;
 	flash_ctlr |= CR_OPTPG_Set;
-	if( MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, flash_ctlr ) ) goto flashoperr;
+	if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, flash_ctlr ) ) goto flashoperr;
 	uint16_t rdpr_bytes = (uint16_t)RDP_Key;
 	rdpr_bytes |= (uint16_t)((uint16_t)~rdpr_bytes) << 8;
-	if( MCF.WriteHalfWord( dev, (intptr_t)&OB->RDPR, rdpr_bytes ) ) goto flashoperr;
-	if( MCF.WaitForFlash(dev) ) goto flashoperr;
+	if( MCF( dev ).WriteHalfWord( dev, (intptr_t)&OB->RDPR, rdpr_bytes ) ) goto flashoperr;
+	if( MCF( dev ).WaitForFlash(dev) ) goto flashoperr;
 
-	if( MCF.WriteWord( dev, (intptr_t)&FLASH->OBKEYR, FLASH_KEY1 ) ) goto flashoperr;
-	if( MCF.WriteWord( dev, (intptr_t)&FLASH->OBKEYR, FLASH_KEY2 ) ) goto flashoperr;
-	if( MCF.WaitForFlash(dev) ) goto flashoperr;
+	if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->OBKEYR, FLASH_KEY1 ) ) goto flashoperr;
+	if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->OBKEYR, FLASH_KEY2 ) ) goto flashoperr;
+	if( MCF( dev ).WaitForFlash(dev) ) goto flashoperr;
 
-	if( MCF.ReadWord( dev, (intptr_t)&FLASH->CTLR, &flash_ctlr ) ) goto flashoperr;
+	if( MCF( dev ).ReadWord( dev, (intptr_t)&FLASH->CTLR, &flash_ctlr ) ) goto flashoperr;
 	flash_ctlr |= CR_OPTPG_Set;
-	if( MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, flash_ctlr ) ) goto flashoperr;
-	if( MCF.WriteHalfWord( dev, (intptr_t)&OB->USER, option_bytes ) ) goto flashoperr;
-	if( MCF.WaitForFlash(dev) ) goto flashoperr;
+	if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, flash_ctlr ) ) goto flashoperr;
+	if( MCF( dev ).WriteHalfWord( dev, (intptr_t)&OB->USER, option_bytes ) ) goto flashoperr;
+	if( MCF( dev ).WaitForFlash(dev) ) goto flashoperr;
 
 	flash_ctlr &= CR_OPTPG_Reset;
-	if( MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, flash_ctlr ) ) goto flashoperr;
-	if( MCF.WaitForFlash(dev) ) goto flashoperr;
+	if( MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, flash_ctlr ) ) goto flashoperr;
+	if( MCF( dev ).WaitForFlash(dev) ) goto flashoperr;
 
 	return 0;
 flashoperr:
@@ -2935,13 +3919,76 @@ flashoperr:
 	return -93;
 }
 
+// Streams words out of memory using the DM's autoexec.  The load loop goes into
+// PROGBUF once, and from then on, every read of DMDATA0 returns the current word
+// and kicks off the load of the next one.  So we only pay one DMI read per word
+// and programmers that can queue reads get them all in very few transactions.
+static int DefaultBulkReadWords( void * dev, uint32_t address_to_read_from, uint32_t words, uint32_t * blob )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	int r = 0;
+
+	if( words == 0 ) return 0;
+
+	if( iss->statetag != STTAG( "RDSQ" ) && iss->statetag != STTAG( "WRSQ" ) )
+	{
+		StaticUpdatePROGBUFRegs( dev );
+	}
+
+	DMIQueueWrite( dev, DMABSTRACTAUTO, 0 ); // Disable Autoexec.
+
+	// c.lw x8,0(x11) // Pull the address from DATA1
+	// c.lw x9,0(x8)  // Read the data at that location.
+	DMIQueueWrite( dev, DMPROGBUF0, 0x40044180 );
+	// c.addi x8, 4
+	// c.sw x9, 0(x10) // Write back to DATA0
+	DMIQueueWrite( dev, DMPROGBUF1, 0xc1040411 );
+	// c.sw x8, 0(x11) // Write addy to DATA1
+	// c.ebreak
+	DMIQueueWrite( dev, DMPROGBUF2, 0x9002c180 );
+
+	DMIQueueWrite( dev, DMDATA1, address_to_read_from );
+	DMIQueueWrite( dev, DMCOMMAND, 0x00240000 ); // Execute once, so DATA0 holds the first word.
+	iss->statetag = STTAG( "XXXX" );
+
+	uint32_t w = 0;
+	if( words > 1 )
+	{
+		DMIQueueWrite( dev, DMABSTRACTAUTO, 1 ); // Every access to DATA0 now fetches the next word.
+
+		uint32_t autoread = words - 1;
+		if( MCF( dev ).ReadReg32Multi )
+		{
+			r = DMIFlush( dev );
+			if( !r ) r = MCF( dev ).ReadReg32Multi( dev, DMDATA0, blob, autoread );
+		}
+		else
+		{
+			for( w = 0; w < autoread; w++ )
+				r |= DMIQueueRead( dev, DMDATA0, blob + w );
+		}
+		w = autoread;
+
+		// Don't let the last read kick off a load past the end of what was asked for,
+		// that could land past the end of a memory area.
+		DMIQueueWrite( dev, DMABSTRACTAUTO, 0 );
+	}
+	uint32_t abstractcs = 0;
+	DMIQueueRead( dev, DMDATA0, blob + w );
+	DMIQueueRead( dev, DMABSTRACTCS, &abstractcs );
+	r |= DMIFlush( dev );
+	r |= DMICheckDoneOp( dev, abstractcs, 0 );
+	if( r ) fprintf( stderr, "Fault on DefaultBulkReadWords (%08x, %d words)\n", address_to_read_from, words );
+	return r;
+}
+
 int DefaultReadBinaryBlob( void * dev, uint32_t address_to_read_from, uint32_t read_size, uint8_t * blob )
 {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 	int ret = 0;
 	if( iss->target_chip == NULL)
 	{
-		ret = MCF.DetermineChipType( dev );
+		ret = MCF( dev ).DetermineChipType( dev );
 		if( ret ) return ret;
 	}
 	if( iss->current_area == 0 ) DetectMemoryArea( dev, address_to_read_from );
@@ -2949,14 +3996,29 @@ int DefaultReadBinaryBlob( void * dev, uint32_t address_to_read_from, uint32_t r
 	uint32_t rpos = address_to_read_from;
 	uint32_t rend = address_to_read_from + read_size;
 
+	// Chips without autoexec, and programmers that provide their own ReadWord
+	// (i.e. they don't speak raw DMI) go the word-at-a-time way.
+	int use_bulk = MCF( dev ).ReadWord == DefaultReadWord && MCF( dev ).WriteReg32 && MCF( dev ).ReadReg32 && !iss->target_chip->no_autoexec;
+
 	while( rpos < rend )
 	{
 		int r;
 		int remain = rend - rpos;
-		if( ( rpos & 3 ) == 0 && remain >= 4 )
+		if( use_bulk && ( rpos & 3 ) == 0 && remain >= 8 )
+		{
+			uint32_t words = remain / 4;
+			uint32_t wordbuff[256];
+			if( words > sizeof( wordbuff ) / 4 ) words = sizeof( wordbuff ) / 4;
+			r = DefaultBulkReadWords( dev, rpos, words, wordbuff );
+			if( r ) return r;
+			memcpy( blob, wordbuff, words * 4 );
+			blob += words * 4;
+			rpos += words * 4;
+		}
+		else if( ( rpos & 3 ) == 0 && remain >= 4 )
 		{
 			uint32_t rw;
-			r = MCF.ReadWord( dev, rpos, &rw );
+			r = MCF( dev ).ReadWord( dev, rpos, &rw );
 			if( r ) return r;
 			int rem = remain;
 			if( rem > 4 ) rem = 4;
@@ -2969,7 +4031,7 @@ int DefaultReadBinaryBlob( void * dev, uint32_t address_to_read_from, uint32_t r
 			if( remain >= 1 )
 			{
 				uint8_t rw;
-				r = MCF.ReadByte( dev, rpos, &rw );
+				r = MCF( dev ).ReadByte( dev, rpos, &rw );
 				if( r ) return r;
 				memcpy( blob, &rw, 1 );
 				blob += 1;
@@ -2979,7 +4041,7 @@ int DefaultReadBinaryBlob( void * dev, uint32_t address_to_read_from, uint32_t r
 			if( ( rpos & 1 ) && remain >= 1 )
 			{
 				uint8_t rw;
-				r = MCF.ReadByte( dev, rpos, &rw );
+				r = MCF( dev ).ReadByte( dev, rpos, &rw );
 				if( r ) return r;
 				memcpy( blob, &rw, 1 );
 				blob += 1;
@@ -2989,7 +4051,7 @@ int DefaultReadBinaryBlob( void * dev, uint32_t address_to_read_from, uint32_t r
 			if( ( rpos & 2 ) && remain >= 2 )
 			{
 				uint16_t rw;
-				r = MCF.ReadHalfWord( dev, rpos, &rw );
+				r = MCF( dev ).ReadHalfWord( dev, rpos, &rw );
 				if( r ) return r;
 				memcpy( blob, &rw, 2 );
 				blob += 2;
@@ -2999,92 +4061,176 @@ int DefaultReadBinaryBlob( void * dev, uint32_t address_to_read_from, uint32_t r
 		}
 	}
 
-	int r = MCF.WaitForDoneOp( dev, 0 );
+	int r = MCF( dev ).WaitForDoneOp( dev, 0 );
 	if( r ) fprintf( stderr, "Fault on DefaultReadBinaryBlob, on byte %08x\n", rpos );
 	return r;
 }
 
 int DefaultReadCPURegister( void * dev, uint32_t regno, uint32_t * regret )
 {
-	if( !MCF.WriteReg32 || !MCF.ReadReg32 )
+	if( !MCF( dev ).WriteReg32 || !MCF( dev ).ReadReg32 )
 	{
 		fprintf( stderr, "Error: Can't read CPU register on this programmer because it is missing read/writereg32\n" );
 		return -5;
 	}
 
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
-	MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+	DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
 	iss->statetag = STTAG( "REGR" );
 
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00220000 | regno ); // Read xN into DATA0.
-	int r = MCF.ReadReg32( dev, DMDATA0, regret );
+	DMIQueueWrite( dev, DMCOMMAND, 0x00220000 | regno ); // Read xN into DATA0.
+	DMIQueueRead( dev, DMDATA0, regret );
 
-	return r;
+	return DMIFlush( dev );
 }
 
-int DefaultReadAllCPURegisters( void * dev, uint32_t * regret )
+// The QingKe debug module only has DATA0/DATA1, so there's no room to stream
+// registers out through a PROGBUF routine.  Instead, aarpostincrement makes
+// each command move on to the next register, and autoexec on DATA0 re-runs it
+// every time DATA0 is touched, so N registers cost N+3 DM accesses instead of
+// 2N.  Not every DM implements aarpostincrement, so it is tried once (on s0/s1,
+// which get put back) before it's trusted.
+static int InternalRegPostIncrementWorks( void * dev )
 {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
-	MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
-	iss->statetag = STTAG( "RER2" );
+	uint32_t saved[2] = { 0, 0 };
+	uint32_t check[2] = { 0, 0 };
+	uint32_t abstractcs = 0;
+	if( iss->reg_postincrement ) return iss->reg_postincrement > 0;
+
+	DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+	DMIQueueWrite( dev, DMCOMMAND, 0x00221008 );      // Read s0 into DATA0.
+	DMIQueueRead( dev, DMDATA0, &saved[0] );
+	DMIQueueWrite( dev, DMCOMMAND, 0x00221009 );      // Read s1 into DATA0.
+	DMIQueueRead( dev, DMDATA0, &saved[1] );
+	DMIQueueWrite( dev, DMDATA0, 0x5a5a1234 );
+	DMIQueueWrite( dev, DMCOMMAND, 0x00231008 );      // Write s0 from DATA0.
+	DMIQueueWrite( dev, DMDATA0, 0xa5a56789 );
+	DMIQueueWrite( dev, DMCOMMAND, 0x00231009 );      // Write s1 from DATA0.
+	DMIQueueWrite( dev, DMCOMMAND, 0x002a1008 );      // Read s0 into DATA0, then move to s1.
+	DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000001 ); // Reading DATA0 re-runs the command.
+	DMIQueueRead( dev, DMDATA0, &check[0] );
+	DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000000 );
+	DMIQueueRead( dev, DMDATA0, &check[1] );
+	DMIQueueRead( dev, DMABSTRACTCS, &abstractcs );
+	DMIQueueWrite( dev, DMABSTRACTCS, 0x00000700 );   // Clear out any error from trying.
+	if( DMIFlush( dev ) ) return 0; // Don't remember, it may have just been a bad transfer.
+
+	DMIQueueWrite( dev, DMDATA0, saved[0] );
+	DMIQueueWrite( dev, DMCOMMAND, 0x00231008 );
+	DMIQueueWrite( dev, DMDATA0, saved[1] );
+	DMIQueueWrite( dev, DMCOMMAND, 0x00231009 );
+	if( DMIFlush( dev ) ) return 0;
+
+	if( ( ( abstractcs >> 8 ) & 7 ) == 4 ) return 0; // Wasn't halted, so this said nothing.
+	iss->reg_postincrement = ( !( abstractcs & 0x700 ) && check[0] == 0x5a5a1234 && check[1] == 0xa5a56789 ) ? 1 : -1;
+	if( iss->reg_postincrement < 0 )
+		fprintf( stderr, "Note: Debug module doesn't step through registers by itself, reading them one at a time.\n" );
+	return iss->reg_postincrement > 0;
+}
+
+int DMIQueueReadRegisters( void * dev, uint32_t regno, int count, uint32_t * regret )
+{
+	int r = 0;
 	int i;
-	for( i = 0; i < iss->nr_registers_for_debug; i++ )
+	if( count <= 0 ) return 0;
+	if( count < 3 || !InternalRegPostIncrementWorks( dev ) )
 	{
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00220000 | 0x1000 | i ); // Read xN into DATA0.
-		if( MCF.ReadReg32( dev, DMDATA0, regret + i ) )
+		for( i = 0; i < count; i++ )
 		{
-			return -5;
+			r |= DMIQueueWrite( dev, DMCOMMAND, 0x00220000 | ( regno + i ) ); // Read reg into DATA0.
+			r |= DMIQueueRead( dev, DMDATA0, regret + i );
 		}
+		return r;
 	}
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00220000 | 0x7b1 ); // Read xN into DATA0.
-	int r = MCF.ReadReg32( dev, DMDATA0, regret + i );
+
+	r |= DMIQueueWrite( dev, DMCOMMAND, 0x002a0000 | regno ); // Read reg into DATA0, then move to the next.
+	r |= DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000001 );    // Reading DATA0 re-runs the command.
+	for( i = 0; i < count - 1; i++ )
+		r |= DMIQueueRead( dev, DMDATA0, regret + i );
+	r |= DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000000 );    // So the last one doesn't run past the end.
+	r |= DMIQueueRead( dev, DMDATA0, regret + i );
 	return r;
 }
 
-int DefaultWriteAllCPURegisters( void * dev, uint32_t * regret )
+int DMIQueueWriteRegisters( void * dev, uint32_t regno, int count, const uint32_t * values )
 {
-	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
-	MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
-	iss->statetag = STTAG( "WER2" );
+	int r = 0;
 	int i;
-	for( i = 0; i < iss->nr_registers_for_debug; i++ )
+	if( count <= 0 ) return 0;
+	if( count < 3 || !InternalRegPostIncrementWorks( dev ) )
 	{
-		if( MCF.WriteReg32( dev, DMDATA0, regret[i] ) )
+		for( i = 0; i < count; i++ )
 		{
-			return -5;
+			r |= DMIQueueWrite( dev, DMDATA0, values[i] );
+			r |= DMIQueueWrite( dev, DMCOMMAND, 0x00230000 | ( regno + i ) ); // Write reg from DATA0.
 		}
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00230000 | 0x1000 | i ); // Read xN into DATA0.
+		return r;
 	}
-	int r = MCF.WriteReg32( dev, DMDATA0, regret[i] );
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00230000 | 0x7b1 ); // Read xN into DATA0.
+
+	r |= DMIQueueWrite( dev, DMDATA0, values[0] );
+	r |= DMIQueueWrite( dev, DMCOMMAND, 0x002b0000 | regno ); // Write reg from DATA0, then move to the next.
+	r |= DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000001 );    // Writing DATA0 re-runs the command.
+	for( i = 1; i < count; i++ )
+		r |= DMIQueueWrite( dev, DMDATA0, values[i] );
+	r |= DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000000 );
 	return r;
 }
 
+int DefaultReadAllCPURegisters( void * dev, uint32_t * regret )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+	iss->statetag = STTAG( "RER2" );
+	DMIQueueReadRegisters( dev, 0x1000, iss->nr_registers_for_debug, regret );
+	DMIQueueReadRegisters( dev, 0x7b1, 1, regret + iss->nr_registers_for_debug ); // dpc
+	if( DMIFlush( dev ) )
+	{
+		return -5;
+	}
+	return 0;
+}
+
+int DefaultWriteAllCPURegisters( void * dev, uint32_t * regret )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+	iss->statetag = STTAG( "WER2" );
+	DMIQueueWriteRegisters( dev, 0x1000, iss->nr_registers_for_debug, regret );
+	DMIQueueWriteRegisters( dev, 0x7b1, 1, regret + iss->nr_registers_for_debug ); // dpc
+	if( DMIFlush( dev ) )
+	{
+		return -5;
+	}
+	return 0;
+}
+
 
 int DefaultWriteCPURegister( void * dev, uint32_t regno, uint32_t value )
 {
-	if( !MCF.WriteReg32 || !MCF.ReadReg32 )
+	if( !MCF( dev ).WriteReg32 || !MCF( dev ).ReadReg32 )
 	{
 		fprintf( stderr, "Error: Can't read CPU register on this programmer because it is missing read/writereg32\n" );
 		return -5;
 	}
 
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
-	MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+	DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
 	iss->statetag = STTAG( "REGW" );
-	MCF.WriteReg32( dev, DMDATA0, value );
-	return MCF.WriteReg32( dev, DMCOMMAND, 0x00230000 | regno ); // Write xN from DATA0.
+	DMIQueueWrite( dev, DMDATA0, value );
+	DMIQueueWrite( dev, DMCOMMAND, 0x00230000 | regno ); // Write xN from DATA0.
+	return DMIFlush( dev );
 }
 
 int DefaultSetEnableBreakpoints( void * dev, int is_enabled, int single_step )
 {
-	if( !MCF.ReadCPURegister || !MCF.WriteCPURegister )
+	if( !MCF( dev ).ReadCPURegister || !MCF( dev ).WriteCPURegister )
 	{
 		fprintf( stderr, "Error: Can't set breakpoints on this programmer because it is missing read/writereg32\n" );
 		return -5;
 	}
 	uint32_t DCSR;
-	if( MCF.ReadCPURegister( dev, 0x7b0, &DCSR ) )
+	if( MCF( dev ).ReadCPURegister( dev, 0x7b0, &DCSR ) )
 		fprintf( stderr, "Error: DCSR could not be read\n" );
 	DCSR |= 0xb600;
 	if( single_step )
@@ -3092,7 +4238,7 @@ int DefaultSetEnableBreakpoints( void * dev, int is_enabled, int single_step )
 	else
 		DCSR &=~4;
 
-	if( MCF.WriteCPURegister( dev, 0x7b0, DCSR ) )
+	if( MCF( dev ).WriteCPURegister( dev, 0x7b0, DCSR ) )
 		fprintf( stderr, "Error: DCSR could not be read\n" );
 
 	return 0;
@@ -3105,46 +4251,46 @@ static int DefaultHaltMode( void * dev, int mode )
 	{
 	case HALT_MODE_HALT_BUT_NO_RESET: // Don't reboot.
 	case HALT_MODE_HALT_AND_RESET:
-		MCF.WriteReg32( dev, DMSHDWCFGR, 0x5aa50000 | (1<<10) ); // Shadow Config Reg
-		MCF.WriteReg32( dev, DMCFGR, 0x5aa50000 | (1<<10) ); // CFGR (1<<10 == Allow output from slave)
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
-		if( mode == HALT_MODE_HALT_AND_RESET ) MCF.WriteReg32( dev, DMCONTROL, 0x80000003 ); // Reboot.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Re-initiate a halt request.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Re-initiate a halt request.
-		// MCF.WriteReg32( dev, DMCONTROL, 0x00000001 ); // Clear Halt Request.  This is recommended, but not doing it seems more stable.
+		MCF( dev ).WriteReg32( dev, DMSHDWCFGR, 0x5aa50000 | (1<<10) ); // Shadow Config Reg
+		MCF( dev ).WriteReg32( dev, DMCFGR, 0x5aa50000 | (1<<10) ); // CFGR (1<<10 == Allow output from slave)
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
+		if( mode == HALT_MODE_HALT_AND_RESET ) MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000003 ); // Reboot.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Re-initiate a halt request.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Re-initiate a halt request.
+		// MCF( dev ).WriteReg32( dev, DMCONTROL, 0x00000001 ); // Clear Halt Request.  This is recommended, but not doing it seems more stable.
 		// Sometimes, even if the processor is halted but the MSB is clear, it will spuriously start?
-		MCF.FlushLLCommands( dev );
+		MCF( dev ).FlushLLCommands( dev );
 		iss->clock_set = 0;
 		break;
 	case HALT_MODE_REBOOT:
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate a halt request.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000003 ); // Reboot.
-		MCF.WriteReg32( dev, DMCONTROL, 0x40000001 ); // resumereq
-		MCF.FlushLLCommands( dev );
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate a halt request.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000003 ); // Reboot.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x40000001 ); // resumereq
+		MCF( dev ).FlushLLCommands( dev );
 		iss->clock_set = 0;
 		break;
 	case HALT_MODE_RESUME:
-		MCF.WriteReg32( dev, DMSHDWCFGR, 0x5aa50000 | (1<<10) ); // Shadow Config Reg
-		MCF.WriteReg32( dev, DMCFGR, 0x5aa50000 | (1<<10) ); // CFGR (1<<10 == Allow output from slave)
+		MCF( dev ).WriteReg32( dev, DMSHDWCFGR, 0x5aa50000 | (1<<10) ); // Shadow Config Reg
+		MCF( dev ).WriteReg32( dev, DMCFGR, 0x5aa50000 | (1<<10) ); // CFGR (1<<10 == Allow output from slave)
 
-		MCF.WriteReg32( dev, DMCONTROL, 0x40000001 ); // resumereq
-		MCF.FlushLLCommands( dev );
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x40000001 ); // resumereq
+		MCF( dev ).FlushLLCommands( dev );
 		break;
 	case HALT_MODE_GO_TO_BOOTLOADER:
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate a halt request.
-
-		MCF.WriteWord( dev, (intptr_t)&FLASH->KEYR, FLASH_KEY1 );
-		MCF.WriteWord( dev, (intptr_t)&FLASH->KEYR, FLASH_KEY2 );
-		MCF.WriteWord( dev, (intptr_t)&FLASH->BOOT_MODEKEYR, FLASH_KEY1 );
-		MCF.WriteWord( dev, (intptr_t)&FLASH->BOOT_MODEKEYR, FLASH_KEY2 );
-		MCF.WriteWord( dev, (intptr_t)&FLASH->STATR, 1<<14 );
-		MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_LOCK_Set );
-
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000003 ); // Reboot.
-		MCF.WriteReg32( dev, DMCONTROL, 0x40000001 ); // resumereq
-		MCF.FlushLLCommands( dev );
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate a halt request.
+
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->KEYR, FLASH_KEY1 );
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->KEYR, FLASH_KEY2 );
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->BOOT_MODEKEYR, FLASH_KEY1 );
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->BOOT_MODEKEYR, FLASH_KEY2 );
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->STATR, 1<<14 );
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_LOCK_Set );
+
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000003 ); // Reboot.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x40000001 ); // resumereq
+		MCF( dev ).FlushLLCommands( dev );
 		break;
 	default:
 		fprintf( stderr, "Error: Unknown halt mode %d\n", mode );
@@ -3171,10 +4317,10 @@ int DefaultPollTerminal( void * dev, uint8_t * buffer, int maxlen, uint32_t leav
 	uint32_t rr;
 	if( iss->statetag != STTAG( "TERM" ) )
 	{
-		MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+		MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
 		iss->statetag = STTAG( "TERM" );
 	}
-	r = MCF.ReadReg32( dev, DMDATA0, &rr );
+	r = MCF( dev ).ReadReg32( dev, DMDATA0, &rr );
 
 	if( r < 0 ) return r;
 	if( maxlen < 8 ) return -9;
@@ -3189,7 +4335,7 @@ int DefaultPollTerminal( void * dev, uint8_t * buffer, int maxlen, uint32_t leav
 			if( num_printf_chars > 3 )
 			{
 				uint32_t r2;
-				r = MCF.ReadReg32( dev, DMDATA1, &r2 );
+				r = MCF( dev ).ReadReg32( dev, DMDATA1, &r2 );
 				memcpy( buffer+3, &r2, num_printf_chars - 3 );
 			}
 			int firstrem = num_printf_chars;
@@ -3197,8 +4343,8 @@ int DefaultPollTerminal( void * dev, uint8_t * buffer, int maxlen, uint32_t leav
 			memcpy( buffer, ((uint8_t*)&rr)+1, firstrem );
 			buffer[num_printf_chars] = 0;
 		}
-		if( leaveflagA ) MCF.WriteReg32( dev, DMDATA1, leaveflagB );
-		MCF.WriteReg32( dev, DMDATA0, leaveflagA ); // Write that we acknowledge the data.
+		if( leaveflagA ) MCF( dev ).WriteReg32( dev, DMDATA1, leaveflagB );
+		MCF( dev ).WriteReg32( dev, DMDATA0, leaveflagA ); // Write that we acknowledge the data.
 		if( num_printf_chars <= 0 ) return num_printf_chars-1;      // was acked (or other error code)
 		return num_printf_chars;
 	}
@@ -3208,21 +4354,151 @@ int DefaultPollTerminal( void * dev, uint8_t * buffer, int maxlen, uint32_t leav
 	}
 }
 
+int InternalLiveHalt( void * dev, uint32_t * saved )
+{
+	uint32_t dmstatus = 0;
+	int i;
+
+	if( !MCF( dev ).ReadReg32 || !MCF( dev ).WriteReg32 || !MCF( dev ).ReadCPURegister || !MCF( dev ).WriteCPURegister )
+		return -5;
+
+	if( MCF( dev ).FlushLLCommands ) MCF( dev ).FlushLLCommands( dev );
+	MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec, so touching DATA0 doesn't run anything.
+	MCF( dev ).ReadReg32( dev, DMSTATUS, &dmstatus );
+	saved[10] = !!( dmstatus & (1<<9) ); // Was already halted.
+	if( !saved[10] )
+	{
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Halt request.
+		for( i = 0; i < 100; i++ )
+		{
+			if( MCF( dev ).ReadReg32( dev, DMSTATUS, &dmstatus ) ) return -5;
+			if( dmstatus & (1<<9) ) break;
+		}
+		if( i == 100 )
+		{
+			fprintf( stderr, "Error: Core would not halt (DMSTATUS = %08x)\n", dmstatus );
+			MCF( dev ).WriteReg32( dev, DMCONTROL, 0x40000001 );
+			return -6;
+		}
+	}
+
+	// The firmware talks to us through DATA0 and DATA1, so they have to survive.
+	MCF( dev ).ReadReg32( dev, DMDATA0, &saved[0] );
+	MCF( dev ).ReadReg32( dev, DMDATA1, &saved[1] );
+	for( i = 0; i < 8; i++ )
+	{
+		if( MCF( dev ).ReadCPURegister( dev, 0x1008 + i, &saved[i+2] ) )
+		{
+			InternalLiveResume( dev, saved );
+			return -5;
+		}
+	}
+	return 0;
+}
+
+int InternalLiveResume( void * dev, uint32_t * saved )
+{
+	int i;
+	int r = 0;
+	for( i = 0; i < 8; i++ )
+		r |= MCF( dev ).WriteCPURegister( dev, 0x1008 + i, saved[i+2] );
+	if( MCF( dev ).FlushLLCommands ) MCF( dev ).FlushLLCommands( dev );
+	MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+	MCF( dev ).WriteReg32( dev, DMDATA0, saved[0] );
+	MCF( dev ).WriteReg32( dev, DMDATA1, saved[1] );
+	if( MCF( dev ).VoidHighLevelState ) MCF( dev ).VoidHighLevelState( dev );
+	if( !saved[10] )
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x40000001 ); // resumereq
+	if( MCF( dev ).FlushLLCommands ) MCF( dev ).FlushLLCommands( dev );
+	return r;
+}
+
+uint32_t InternalProbeDebugRing( void * dev )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	uint32_t ring = 0;
+	uint32_t magic = 0;
+	uint32_t saved[LIVE_SAVE_WORDS];
+
+	if( !iss->target_chip || !MCF( dev ).ReadReg32 ) return 0;
+	if( MCF( dev ).ReadReg32( dev, DMDATA1, &ring ) ) return 0;
+	if( ( ring & 3 ) || ring < iss->target_chip->ram_base ||
+		ring + 20 > iss->target_chip->ram_base + iss->target_chip->ram_size )
+		return 0;
+
+	if( InternalLiveHalt( dev, saved ) ) return 0;
+	if( MCF( dev ).ReadWord( dev, ring, &magic ) ) magic = 0;
+	InternalLiveResume( dev, saved );
+
+	return ( magic == DEBUGPRINTF_RING_MAGIC ) ? ring : 0;
+}
+
+// Reads len bytes at address (which need not be aligned) as whole words.
+static int InternalReadWordsCovering( void * dev, uint32_t address, uint32_t len, uint8_t * out )
+{
+	uint32_t words[DEBUGPRINTF_RING_MAX_READ/4+2];
+	uint32_t start = address & ~3;
+	uint32_t end = ( address + len + 3 ) & ~3;
+	if( end - start > sizeof( words ) ) return -9;
+	int r = MCF( dev ).ReadBinaryBlob( dev, start, end - start, (uint8_t*)words );
+	if( r ) return r;
+	memcpy( out, ((uint8_t*)words) + ( address - start ), len );
+	return 0;
+}
+
+int InternalPollDebugRing( void * dev, uint32_t ring, uint8_t * buffer, int maxlen, uint32_t * dropped )
+{
+	uint32_t saved[LIVE_SAVE_WORDS];
+	uint32_t hdr[5]; // magic, size, head, tail, dropped
+	int r;
+
+	if( maxlen > DEBUGPRINTF_RING_MAX_READ ) maxlen = DEBUGPRINTF_RING_MAX_READ;
+
+	r = InternalLiveHalt( dev, saved );
+	if( r ) return r;
+
+	r = MCF( dev ).ReadBinaryBlob( dev, ring, sizeof( hdr ), (uint8_t*)hdr );
+	if( !r && ( hdr[0] != DEBUGPRINTF_RING_MAGIC || hdr[1] == 0 || ( hdr[1] & ( hdr[1] - 1 ) ) ) )
+		r = -10;
+	if( !r )
+	{
+		uint32_t size = hdr[1];
+		uint32_t avail = hdr[2] - hdr[3];
+		if( avail > size ) avail = size;
+		if( avail > (uint32_t)maxlen ) avail = maxlen;
+
+		uint32_t place = hdr[3] & ( size - 1 );
+		uint32_t first = size - place;
+		if( first > avail ) first = avail;
+		if( first )
+			r = InternalReadWordsCovering( dev, ring + sizeof( hdr ) + place, first, buffer );
+		if( !r && avail > first )
+			r = InternalReadWordsCovering( dev, ring + sizeof( hdr ), avail - first, buffer + first );
+		if( !r && avail )
+			r = MCF( dev ).WriteWord( dev, ring + 12, hdr[3] + avail ); // Give the space back.
+		if( dropped ) *dropped = hdr[4];
+		if( !r ) r = avail;
+	}
+
+	InternalLiveResume( dev, saved );
+	return r;
+}
+
 int DefaultUnbrick( void * dev )
 {
 	printf( "Entering Unbrick Mode\n" );
-	if( MCF.Control5v ) MCF.Control5v( dev, 0 );
-	MCF.Control3v3( dev, 0 );
-
-	MCF.DelayUS( dev, 60000 );
-	MCF.DelayUS( dev, 60000 );
-	MCF.DelayUS( dev, 60000 );
-	MCF.DelayUS( dev, 60000 );
-	MCF.DelayUS( dev, 60000 );
-	MCF.FlushLLCommands( dev );
-	if( MCF.ResetInterface ) MCF.ResetInterface( dev );
-	if( MCF.Control5v ) MCF.Control5v( dev, 1 );
-	MCF.Control3v3( dev, 1 );
+	if( MCF( dev ).Control5v ) MCF( dev ).Control5v( dev, 0 );
+	MCF( dev ).Control3v3( dev, 0 );
+
+	MCF( dev ).DelayUS( dev, 60000 );
+	MCF( dev ).DelayUS( dev, 60000 );
+	MCF( dev ).DelayUS( dev, 60000 );
+	MCF( dev ).DelayUS( dev, 60000 );
+	MCF( dev ).DelayUS( dev, 60000 );
+	MCF( dev ).FlushLLCommands( dev );
+	if( MCF( dev ).ResetInterface ) MCF( dev ).ResetInterface( dev );
+	if( MCF( dev ).Control5v ) MCF( dev ).Control5v( dev, 1 );
+	MCF( dev ).Control3v3( dev, 1 );
 	printf( "Connection starting\n" );
 
 	int timeout = 0;
@@ -3230,21 +4506,21 @@ int DefaultUnbrick( void * dev )
 	uint32_t ds = 0;
 	for( timeout = 0; timeout < max_timeout; timeout++ )
 	{
-		MCF.DelayUS( dev, 10 );
-		MCF.WriteReg32( dev, DMSHDWCFGR, 0x5aa50000 | (1<<10) ); // Shadow Config Reg
-		MCF.WriteReg32( dev, DMCFGR, 0x5aa50000 | (1<<10) ); // CFGR (1<<10 == Allow output from slave)
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate a halt request.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // No, really make sure.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 );
-		MCF.FlushLLCommands( dev );
-		int r = MCF.ReadReg32( dev, DMSTATUS, &ds );
+		MCF( dev ).DelayUS( dev, 10 );
+		MCF( dev ).WriteReg32( dev, DMSHDWCFGR, 0x5aa50000 | (1<<10) ); // Shadow Config Reg
+		MCF( dev ).WriteReg32( dev, DMCFGR, 0x5aa50000 | (1<<10) ); // CFGR (1<<10 == Allow output from slave)
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate a halt request.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // No, really make sure.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 );
+		MCF( dev ).FlushLLCommands( dev );
+		int r = MCF( dev ).ReadReg32( dev, DMSTATUS, &ds );
 		if( r )
 		{
 			fprintf( stderr, "Error: Could not read DMSTATUS from programmers (%d)\n", r );
 			return -99;
 		}
-		MCF.FlushLLCommands( dev );
+		MCF( dev ).FlushLLCommands( dev );
 		if( ds != 0xffffffff && ds != 0x00000000 ) break;
 		else fprintf( stderr, "%08x\n", ds );
 	}
@@ -3259,18 +4535,18 @@ int DefaultUnbrick( void * dev )
 	for( i = 0; i < 10; i++ )
 	{
 		// Make sure we are in halt.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate a halt request.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // No, really make sure.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 );
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate a halt request.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // No, really make sure.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 );
 		
 		// After more experimentation, it appaers to work best by not clearing the halt request.
-		MCF.FlushLLCommands( dev );
+		MCF( dev ).FlushLLCommands( dev );
 	}
 
-	MCF.WriteReg32( dev, DMABSTRACTCS, 0x00000700 ); // Clear out possible abstractcs errors.
+	MCF( dev ).WriteReg32( dev, DMABSTRACTCS, 0x00000700 ); // Clear out possible abstractcs errors.
 
-	int r = MCF.ReadReg32( dev, DMSTATUS, &ds );
+	int r = MCF( dev ).ReadReg32( dev, DMSTATUS, &ds );
 	printf( "DMStatus After Halt: /%d/%08x\n", r, ds );
 
 	r = DefaultDetermineChipType( dev );
@@ -3294,10 +4570,10 @@ int DefaultUnbrick( void * dev )
 
 		DefaultWriteBinaryBlob(dev, 0x1ffff800, 16, option_data );
 
-		MCF.DelayUS( dev, 20000 );
+		MCF( dev ).DelayUS( dev, 20000 );
 
-		MCF.Erase( dev, 0, 0, 1);
-		MCF.FlushLLCommands( dev );
+		MCF( dev ).Erase( dev, 0, 0, 1);
+		MCF( dev ).FlushLLCommands( dev );
 	}
 	else if ( iss->target_chip->protocol == PROTOCOL_CH5xx )
 	{
@@ -3340,29 +4616,29 @@ int DefaultPrintChipInfo( void * dev )
 	int ret = 0;
 	if( iss->target_chip == NULL)
 	{
-		ret = MCF.DetermineChipType( dev );
+		ret = MCF( dev ).DetermineChipType( dev );
 		if( ret ) return ret;
 	}
 
 	uint32_t reg;
-	MCF.HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET );
+	MCF( dev ).HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET );
 	if( iss->target_chip->protocol == PROTOCOL_DEFAULT )
 	{
-		if( MCF.ReadWord( dev, 0x1FFFF800, &reg ) ) goto fail;
+		if( MCF( dev ).ReadWord( dev, 0x1FFFF800, &reg ) ) goto fail;
 		printf( "USER/RDPR  : %04x/%04x\n", reg>>16, reg&0xFFFF );
-		if( MCF.ReadWord( dev, 0x1FFFF804, &reg ) ) goto fail;
+		if( MCF( dev ).ReadWord( dev, 0x1FFFF804, &reg ) ) goto fail;
 		printf( "DATA1/DATA0: %04x/%04x\n", reg>>16, reg&0xFFFF );
-		if( MCF.ReadWord( dev, 0x1FFFF808, &reg ) ) goto fail;
+		if( MCF( dev ).ReadWord( dev, 0x1FFFF808, &reg ) ) goto fail;
 		printf( "WRPR1/WRPR0: %04x/%04x\n", reg>>16, reg&0xFFFF );
-		if( MCF.ReadWord( dev, 0x1FFFF80c, &reg ) ) goto fail;
+		if( MCF( dev ).ReadWord( dev, 0x1FFFF80c, &reg ) ) goto fail;
 		printf( "WRPR3/WRPR2: %04x/%04x\n", reg>>16, reg&0xFFFF );
-		// if( MCF.ReadWord( dev, 0x1FFFF7E0, &reg ) ) goto fail;
+		// if( MCF( dev ).ReadWord( dev, 0x1FFFF7E0, &reg ) ) goto fail;
 		// printf( "Flash Size: %d kB\n", (reg&0xffff) );
-		if( MCF.ReadWord( dev, 0x1FFFF7E8, &reg ) ) goto fail;
+		if( MCF( dev ).ReadWord( dev, 0x1FFFF7E8, &reg ) ) goto fail;
 		printf( "R32_ESIG_UNIID1: %08x\n", reg );
-		if( MCF.ReadWord( dev, 0x1FFFF7EC, &reg ) ) goto fail;
+		if( MCF( dev ).ReadWord( dev, 0x1FFFF7EC, &reg ) ) goto fail;
 		printf( "R32_ESIG_UNIID2: %08x\n", reg );
-		if( MCF.ReadWord( dev, 0x1FFFF7F0, &reg ) ) goto fail;
+		if( MCF( dev ).ReadWord( dev, 0x1FFFF7F0, &reg ) ) goto fail;
 		printf( "R32_ESIG_UNIID3: %08x\n", reg );
 		return 0;
 	}
@@ -3402,71 +4678,71 @@ static int DefaultSetClock( void * dev, uint32_t clock )
 int SetupAutomaticHighLevelFunctions( void * dev )
 {
 	// Will populate high-level functions from low-level functions.
-	if( MCF.WriteReg32 == 0 && MCF.ReadReg32 == 0 && MCF.WriteWord == 0 ) return -5;
+	if( MCF( dev ).WriteReg32 == 0 && MCF( dev ).ReadReg32 == 0 && MCF( dev ).WriteWord == 0 ) return -5;
 
 	// Else, TODO: Build the high level functions from low level functions.
 	// If a high-level function alrady exists, don't override.
 
-	if( !MCF.SetupInterface )
-		MCF.SetupInterface = DefaultSetupInterface;
-	if( !MCF.DetermineChipType )
-		MCF.DetermineChipType = DefaultDetermineChipType;
-	if( !MCF.WriteBinaryBlob )
-		MCF.WriteBinaryBlob = DefaultWriteBinaryBlob;
-	if( !MCF.ReadBinaryBlob )
-		MCF.ReadBinaryBlob = DefaultReadBinaryBlob;
-	if( !MCF.WriteWord )
-		MCF.WriteWord = DefaultWriteWord;
-	if( !MCF.WriteHalfWord )
-		MCF.WriteHalfWord = DefaultWriteHalfWord;
-	if( !MCF.WriteByte )
-		MCF.WriteByte = DefaultWriteByte;
-	if( !MCF.ReadCPURegister )
-		MCF.ReadCPURegister = DefaultReadCPURegister;
-	if( !MCF.WriteCPURegister )
-		MCF.WriteCPURegister = DefaultWriteCPURegister;
-	if( !MCF.WriteAllCPURegisters )
-		MCF.WriteAllCPURegisters = DefaultWriteAllCPURegisters;
-	if( !MCF.ReadAllCPURegisters )
-		MCF.ReadAllCPURegisters = DefaultReadAllCPURegisters;
-	if( !MCF.SetEnableBreakpoints )
-		MCF.SetEnableBreakpoints = DefaultSetEnableBreakpoints;
-	if( !MCF.ReadWord )
-		MCF.ReadWord = DefaultReadWord;
-	if( !MCF.ReadHalfWord )
-		MCF.ReadHalfWord = DefaultReadHalfWord;
-	if( !MCF.ReadByte )
-		MCF.ReadByte = DefaultReadByte;
-	if( !MCF.Erase )
-		MCF.Erase = DefaultErase;
-	if( !MCF.HaltMode )
-		MCF.HaltMode = DefaultHaltMode;
-	if( !MCF.SetSplit )
-		MCF.SetSplit = DefaultSetSplit;
-	if( !MCF.PollTerminal )
-		MCF.PollTerminal = DefaultPollTerminal;
-	if( !MCF.WaitForFlash )
-		MCF.WaitForFlash = DefaultWaitForFlash;
-	if( !MCF.WaitForDoneOp )
-		MCF.WaitForDoneOp = DefaultWaitForDoneOp;
-	if( !MCF.PrintChipInfo )
-		MCF.PrintChipInfo = DefaultPrintChipInfo;
-	if( !MCF.Unbrick )
-		MCF.Unbrick = DefaultUnbrick;
-	if( !MCF.ConfigureNRSTAsGPIO )
-		MCF.ConfigureNRSTAsGPIO = DefaultConfigureNRSTAsGPIO;
-  if( !MCF.ConfigureReadProtection )
-    MCF.ConfigureReadProtection = DefaultConfigureReadProtection;
-	if( !MCF.VoidHighLevelState )
-		MCF.VoidHighLevelState = DefaultVoidHighLevelState;
-	if( !MCF.DelayUS )
-		MCF.DelayUS = DefaultDelayUS;
-	if( !MCF.GetUUID )
-		MCF.GetUUID = DefaultGetUUID;
-  if( !MCF.SetClock )
-    MCF.SetClock = DefaultSetClock;
-  if( !MCF.EnableDebug )
-    MCF.EnableDebug = DefaultEnableDebug;
+	if( !MCF( dev ).SetupInterface )
+		MCF( dev ).SetupInterface = DefaultSetupInterface;
+	if( !MCF( dev ).DetermineChipType )
+		MCF( dev ).DetermineChipType = DefaultDetermineChipType;
+	if( !MCF( dev ).WriteBinaryBlob )
+		MCF( dev ).WriteBinaryBlob = DefaultWriteBinaryBlob;
+	if( !MCF( dev ).ReadBinaryBlob )
+		MCF( dev ).ReadBinaryBlob = DefaultReadBinaryBlob;
+	if( !MCF( dev ).WriteWord )
+		MCF( dev ).WriteWord = DefaultWriteWord;
+	if( !MCF( dev ).WriteHalfWord )
+		MCF( dev ).WriteHalfWord = DefaultWriteHalfWord;
+	if( !MCF( dev ).WriteByte )
+		MCF( dev ).WriteByte = DefaultWriteByte;
+	if( !MCF( dev ).ReadCPURegister )
+		MCF( dev ).ReadCPURegister = DefaultReadCPURegister;
+	if( !MCF( dev ).WriteCPURegister )
+		MCF( dev ).WriteCPURegister = DefaultWriteCPURegister;
+	if( !MCF( dev ).WriteAllCPURegisters )
+		MCF( dev ).WriteAllCPURegisters = DefaultWriteAllCPURegisters;
+	if( !MCF( dev ).ReadAllCPURegisters )
+		MCF( dev ).ReadAllCPURegisters = DefaultReadAllCPURegisters;
+	if( !MCF( dev ).SetEnableBreakpoints )
+		MCF( dev ).SetEnableBreakpoints = DefaultSetEnableBreakpoints;
+	if( !MCF( dev ).ReadWord )
+		MCF( dev ).ReadWord = DefaultReadWord;
+	if( !MCF( dev ).ReadHalfWord )
+		MCF( dev ).ReadHalfWord = DefaultReadHalfWord;
+	if( !MCF( dev ).ReadByte )
+		MCF( dev ).ReadByte = DefaultReadByte;
+	if( !MCF( dev ).Erase )
+		MCF( dev ).Erase = DefaultErase;
+	if( !MCF( dev ).HaltMode )
+		MCF( dev ).HaltMode = DefaultHaltMode;
+	if( !MCF( dev ).SetSplit )
+		MCF( dev ).SetSplit = DefaultSetSplit;
+	if( !MCF( dev ).PollTerminal )
+		MCF( dev ).PollTerminal = DefaultPollTerminal;
+	if( !MCF( dev ).WaitForFlash )
+		MCF( dev ).WaitForFlash = DefaultWaitForFlash;
+	if( !MCF( dev ).WaitForDoneOp )
+		MCF( dev ).WaitForDoneOp = DefaultWaitForDoneOp;
+	if( !MCF( dev ).PrintChipInfo )
+		MCF( dev ).PrintChipInfo = DefaultPrintChipInfo;
+	if( !MCF( dev ).Unbrick )
+		MCF( dev ).Unbrick = DefaultUnbrick;
+	if( !MCF( dev ).ConfigureNRSTAsGPIO )
+		MCF( dev ).ConfigureNRSTAsGPIO = DefaultConfigureNRSTAsGPIO;
+  if( !MCF( dev ).ConfigureReadProtection )
+    MCF( dev ).ConfigureReadProtection = DefaultConfigureReadProtection;
+	if( !MCF( dev ).VoidHighLevelState )
+		MCF( dev ).VoidHighLevelState = DefaultVoidHighLevelState;
+	if( !MCF( dev ).DelayUS )
+		MCF( dev ).DelayUS = DefaultDelayUS;
+	if( !MCF( dev ).GetUUID )
+		MCF( dev ).GetUUID = DefaultGetUUID;
+  if( !MCF( dev ).SetClock )
+    MCF( dev ).SetClock = DefaultSetClock;
+  if( !MCF( dev ).EnableDebug )
+    MCF( dev ).EnableDebug = DefaultEnableDebug;
 
 	return 0;
 }
@@ -3478,36 +4754,36 @@ void TestFunction(void * dev )
 {
 	uint32_t rv;
 	int r;
-	MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
-	MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate a halt request.
-	MCF.WriteReg32( dev, DMCONTROL, 0x00000001 ); // Clear Halt Request.
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate a halt request.
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x00000001 ); // Clear Halt Request.
 
-	r = MCF.WriteWord( dev, 0x20000100, 0xdeadbeef );
-	r = MCF.WriteWord( dev, 0x20000104, 0xcafed0de );
-	r = MCF.WriteWord( dev, 0x20000108, 0x12345678 );
-	r = MCF.WriteWord( dev, 0x20000108, 0x00b00d00 );
-	r = MCF.WriteWord( dev, 0x20000104, 0x33334444 );
+	r = MCF( dev ).WriteWord( dev, 0x20000100, 0xdeadbeef );
+	r = MCF( dev ).WriteWord( dev, 0x20000104, 0xcafed0de );
+	r = MCF( dev ).WriteWord( dev, 0x20000108, 0x12345678 );
+	r = MCF( dev ).WriteWord( dev, 0x20000108, 0x00b00d00 );
+	r = MCF( dev ).WriteWord( dev, 0x20000104, 0x33334444 );
 
-	r = MCF.ReadWord( dev, 0x20000100, &rv );
+	r = MCF( dev ).ReadWord( dev, 0x20000100, &rv );
 	printf( "**>>> %d %08x\n", r, rv );
-	r = MCF.ReadWord( dev, 0x20000104, &rv );
+	r = MCF( dev ).ReadWord( dev, 0x20000104, &rv );
 	printf( "**>>> %d %08x\n", r, rv );
-	r = MCF.ReadWord( dev, 0x20000108, &rv );
+	r = MCF( dev ).ReadWord( dev, 0x20000108, &rv );
 	printf( "**>>> %d %08x\n", r, rv );
 
 
-	r = MCF.ReadWord( dev, 0x00000300, &rv );
+	r = MCF( dev ).ReadWord( dev, 0x00000300, &rv );
 	printf( "F %d %08x\n", r, rv );
-	r = MCF.ReadWord( dev, 0x00000304, &rv );
+	r = MCF( dev ).ReadWord( dev, 0x00000304, &rv );
 	printf( "F %d %08x\n", r, rv );
-	r = MCF.ReadWord( dev, 0x00000308, &rv );
+	r = MCF( dev ).ReadWord( dev, 0x00000308, &rv );
 	printf( "F %d %08x\n", r, rv );
 
 	uint8_t buffer[256];
 	int i;
 	for( i = 0; i < 256; i++ ) buffer[i] = 0;
-	MCF.WriteBinaryBlob( dev, 0x08000300, 256, buffer );
-	MCF.ReadBinaryBlob( dev, 0x08000300, 256, buffer );
+	MCF( dev ).WriteBinaryBlob( dev, 0x08000300, 256, buffer );
+	MCF( dev ).ReadBinaryBlob( dev, 0x08000300, 256, buffer );
 	for( i = 0; i < 256; i++ )
 	{
 		printf( "%02x ", buffer[i] );
@@ -3515,8 +4791,8 @@ void TestFunction(void * dev )
 	}
 
 	for( i = 0; i < 256; i++ ) buffer[i] = i;
-	MCF.WriteBinaryBlob( dev, 0x08000300, 256, buffer );
-	MCF.ReadBinaryBlob( dev, 0x08000300, 256, buffer );
+	MCF( dev ).WriteBinaryBlob( dev, 0x08000300, 256, buffer );
+	MCF( dev ).ReadBinaryBlob( dev, 0x08000300, 256, buffer );
 	for( i = 0; i < 256; i++ )
 	{
 		printf( "%02x ", buffer[i] );
@@ -3530,7 +4806,7 @@ int DetectMemoryArea( void * dev, uint32_t address )
 	int ret = 0;
 	if( iss->target_chip == NULL)
 	{
-		ret = MCF.DetermineChipType( dev );
+		ret = MCF( dev ).DetermineChipType( dev );
 		if( ret ) return ret;
 	}
 	const struct RiscVChip_s * chip = iss->target_chip;
@@ -3584,7 +4860,7 @@ int CheckMemoryLocation( void * dev, enum MemoryArea area, uint32_t address, uin
 	int ret = 0;
 	if( iss->target_chip == NULL)
 	{
-		ret = MCF.DetermineChipType( dev );
+		ret = MCF( dev ).DetermineChipType( dev );
 		if( ret ) return ret;
 	}
 	const struct RiscVChip_s * chip = iss->target_chip;
@@ -3654,20 +4930,20 @@ int CheckMemoryLocation( void * dev, enum MemoryArea area, uint32_t address, uin
 
 static void readCSR( void * dev, uint32_t csr )
 {
-	MCF.HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET );
+	MCF( dev ).HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET );
 
-	// MCF.WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
-	// MCF.WriteReg32(dev, DMPROGBUF0, 0x305022f3); // csrrs t0, mtvec, zero
-	// MCF.WriteReg32(dev, DMPROGBUF1, 0x00100073); // ebreak
+	// MCF( dev ).WriteReg32(dev, DMABSTRACTAUTO, 0x00000000); // Disable Autoexec.
+	// MCF( dev ).WriteReg32(dev, DMPROGBUF0, 0x305022f3); // csrrs t0, mtvec, zero
+	// MCF( dev ).WriteReg32(dev, DMPROGBUF1, 0x00100073); // ebreak
 
-	// MCF.WriteReg32(dev, DMCOMMAND, 0x00271000); // Write execute.
-	MCF.WriteReg32( dev, DMCOMMAND, 0x00220000 | csr ); // Read a0 into DATA0.
+	// MCF( dev ).WriteReg32(dev, DMCOMMAND, 0x00271000); // Write execute.
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00220000 | csr ); // Read a0 into DATA0.
 	uint32_t dmdata = 0;
-	MCF.ReadReg32( dev, DMDATA0, &dmdata );
+	MCF( dev ).ReadReg32( dev, DMDATA0, &dmdata );
 	fprintf( stderr, "Requested CSR: %08x = %08x\n", csr, dmdata );
 
-	MCF.WriteReg32( dev, DMCONTROL, 0x40000001 );
-	MCF.WriteReg32( dev, DMCONTROL, 0x40000001 );
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x40000001 );
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x40000001 );
 }
 
 static int DefaultRebootIntoBootloader( void * dev )
@@ -3676,7 +4952,7 @@ static int DefaultRebootIntoBootloader( void * dev )
 	int r;
 	int max_timeout = 0;
 
-	if( !MCF.Control3v3 && !MCF.Control5v )
+	if( !MCF( dev ).Control3v3 && !MCF( dev ).Control5v )
 	{
 		fprintf( stderr, "This programming method doesn't have power controls.\n" );
 		return -100;
@@ -3697,55 +4973,55 @@ static int DefaultRebootIntoBootloader( void * dev )
 	}
 
 	fprintf( stderr, "Entering Bootloader\n" );
-	if( MCF.Control5v ) MCF.Control5v( dev, 0 );
-	if( MCF.Control3v3 ) MCF.Control3v3( dev, 0 );
-
-	MCF.DelayUS( dev, 60000 );
-	MCF.DelayUS( dev, 60000 );
-	MCF.DelayUS( dev, 60000 );
-	MCF.DelayUS( dev, 60000 );
-	MCF.DelayUS( dev, 60000 );
-	MCF.FlushLLCommands( dev );
-	if( MCF.ResetInterface && max_timeout == 0 ) MCF.ResetInterface( dev );
-	if( MCF.Control5v ) MCF.Control5v( dev, 1 );
-	if( MCF.Control3v3 ) MCF.Control3v3( dev, 1 );
+	if( MCF( dev ).Control5v ) MCF( dev ).Control5v( dev, 0 );
+	if( MCF( dev ).Control3v3 ) MCF( dev ).Control3v3( dev, 0 );
+
+	MCF( dev ).DelayUS( dev, 60000 );
+	MCF( dev ).DelayUS( dev, 60000 );
+	MCF( dev ).DelayUS( dev, 60000 );
+	MCF( dev ).DelayUS( dev, 60000 );
+	MCF( dev ).DelayUS( dev, 60000 );
+	MCF( dev ).FlushLLCommands( dev );
+	if( MCF( dev ).ResetInterface && max_timeout == 0 ) MCF( dev ).ResetInterface( dev );
+	if( MCF( dev ).Control5v ) MCF( dev ).Control5v( dev, 1 );
+	if( MCF( dev ).Control3v3 ) MCF( dev ).Control3v3( dev, 1 );
 	fprintf(stderr, "Connecting to the DM\n" );
 
 	int timeout = 0;
 	uint32_t ds = 0;
 	for( timeout = 0; timeout < max_timeout; timeout++ )
 	{
-		MCF.DelayUS( dev, 10 );
-		MCF.WriteReg32( dev, DMSHDWCFGR, 0x5aa50000 | (1<<10) ); // Shadow Config Reg
-		MCF.WriteReg32( dev, DMCFGR, 0x5aa50000 | (1<<10) ); // CFGR (1<<10 == Allow output from slave)
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate a halt request.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // No, really make sure.
-		MCF.FlushLLCommands( dev );
-		r = MCF.ReadReg32( dev, DMSTATUS, &ds );
+		MCF( dev ).DelayUS( dev, 10 );
+		MCF( dev ).WriteReg32( dev, DMSHDWCFGR, 0x5aa50000 | (1<<10) ); // Shadow Config Reg
+		MCF( dev ).WriteReg32( dev, DMCFGR, 0x5aa50000 | (1<<10) ); // CFGR (1<<10 == Allow output from slave)
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate a halt request.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // No, really make sure.
+		MCF( dev ).FlushLLCommands( dev );
+		r = MCF( dev ).ReadReg32( dev, DMSTATUS, &ds );
 		if( r )
 		{
 			fprintf( stderr, "\nError: Could not read DMSTATUS from programmers (%d)\n", r );
 			continue;
 		}
-		MCF.FlushLLCommands( dev );
+		MCF( dev ).FlushLLCommands( dev );
 		if( ds != 0xffffffff && ds != 0x00000000 ) break;
 		else fprintf( stderr, "." );
 	}
 	fprintf(stderr, "\n" );
-	MCF.SetupInterface(dev);
+	MCF( dev ).SetupInterface(dev);
 	fprintf(stderr, "Connected\n" );
 	if( iss->target_chip->protocol == PROTOCOL_CH5xx )
 	{
 		uint8_t info_reg = 0;
-		r = MCF.ReadByte( dev, 0x40001045, &info_reg );
+		r = MCF( dev ).ReadByte( dev, 0x40001045, &info_reg );
 		// printf("R8_GLOB_CFG_INFO = %02x, BOOTLOADER_BIT = %d\n", info_reg, (info_reg & (1<<5)));
 		if( !(info_reg & (1<<5)) || r ) {
 			fprintf(stderr, "Failed to switch to bootloader\n");
 			return -1;
 		}
 	}
-	MCF.HaltMode = 0;
+	MCF( dev ).HaltMode = 0;
 	printf( "Chip is halted in bootloader mode. Press enter to proceed\n");
 	while(!IsKBHit());
 	ReadKBByte();
@@ -5,6 +5,7 @@
 // #include "chips.h"
 
 enum RAMSplit;
+struct DMIOp;
 
 struct MiniChlinkFunctions
 {
@@ -16,6 +17,16 @@ struct MiniChlinkFunctions
 	int (*FlushLLCommands)( void * dev );
 	int (*DelayUS)( void * dev, int microseconds );
 
+	// Optional: Read the same DM register 'count' times back-to-back, in as few
+	// transactions as the programmer allows.  Used for streaming autoexec reads
+	// out of DMDATA0.  If not provided, ReadReg32 is called in a loop.
+	int (*ReadReg32Multi)( void * dev, uint8_t reg_7_bit, uint32_t * commandresp, int count );
+
+	// Optional: Perform a list of queued DM register accesses, in order, in as
+	// few transactions as possible, filling in the results of the reads.  If
+	// not provided, DMIFlush() calls WriteReg32/ReadReg32 one at a time.
+	int (*ExecuteDMIQueue)( void * dev, struct DMIOp * ops, int count );
+
 	// Higher-level functions can be generated automatically.
 	int (*SetupInterface)( void * dev );
 	int (*Control3v3)( void * dev, int bOn );
@@ -115,6 +126,21 @@ struct ProgrammerStructBase
 
 #define MAX_FLASH_SECTORS 262144
 
+// One queued DM register access.  See DMIQueueWrite/DMIQueueRead.
+struct DMIOp
+{
+	uint8_t reg_7_bit;
+	uint8_t is_read;
+	uint32_t value;    // Value to write.
+	uint32_t * result; // For reads, only valid after the queue is flushed.
+};
+
+// What a queued read gets if the queue failed before it happened.  All ones,
+// like a debug bus with nothing on it.
+#define DMI_READ_FAILED 0xffffffff
+
+#define DMI_QUEUE_MAX 128
+
 enum RiscVChip {
 	CHIP_UNKNOWN = 0x00,
 	CHIP_CH32V10x = 0x01,
@@ -197,8 +223,21 @@ struct InternalState
 	uint32_t clock_set;
 	uint8_t init_skip;
 	uint8_t debugger;
+	struct DMIOp dmi_queue[DMI_QUEUE_MAX];
+	int dmi_queue_len;
+	uint32_t roundtrips; // Number of times we've had to wait on the programmer.
+	int reg_postincrement; // 0 = untested, 1 = DM steps through registers with aarpostincrement, -1 = it doesn't.
+	uint8_t compress_flash; // Set during a -w --compress write, see InternalLoaderWriteFlash.
+	struct MiniChlinkFunctions mcf; // See MCF.
 };
 
+// For drivers to call every time they have to wait for a reply from the programmer.
+inline static void InternalCountRoundTrip( void * dev )
+{
+	struct InternalState * iss = ((struct ProgrammerStructBase*)dev)->internal;
+	if( iss ) iss->roundtrips++;
+}
+
 
 #define DMDATA0        0x04
 #define DMDATA1        0x05
@@ -268,15 +307,84 @@ typedef struct {
 } init_hints_t;
 
 void * MiniCHLinkInitAsDLL(struct MiniChlinkFunctions ** MCFO, const init_hints_t* init_hints) DLLDECORATE;
-extern struct MiniChlinkFunctions MCF;
 
-// Returns 'dev' on success, else 0.
-void * TryInit_WCHLinkE(const init_hints_t * hints);
-void * TryInit_WCHISP(void);
-void * TryInit_ESP32S2CHFUN(uint32_t id);
-void * TryInit_NHCLink042(void);
-void * TryInit_B003Fun(uint32_t id);
-void * TryInit_Ardulink(const init_hints_t*);
+// Every programmer has its own function table (in its InternalState), so
+// several can be driven at once from any threads.  MCF( dev ) is dev's table,
+// as in MCF( dev ).Foo( dev, ... ).
+struct MiniChlinkFunctions * MiniCHLinkFunctions( void * dev ) DLLDECORATE;
+#define MCF( dev ) (((struct ProgrammerStructBase*)(dev))->internal->mcf)
+
+// Flash (and verify) the same image with several WCH-LinkE's at once, one thread each.
+// serials is a comma separated list of programmer serial numbers, or "all".
+// Returns the number of programmers that failed, or negative if none could be used.
+int MiniCHLinkGangFlash( const char * serials, const uint8_t * image, int len, uint32_t address, int diff ) DLLDECORATE;
+
+// Live variable sampling, see -L.  vars is a comma separated list of symbol
+// names (if elf is given) or addresses, each optionally followed by :bytes.
+// Output is CSV, or binary records if output ends in .bin.
+int LiveSample( void * dev, const char * output, double rate, uint32_t samples, const char * elf, const char * vars );
+
+// Statistical PC profiler, see -O.  Prints a flat profile to stdout, and if
+// folded isn't "-", writes caller;function counts for flamegraph.pl there.
+int ProfilePC( void * dev, const char * folded, double rate, uint32_t samples, const char * elf );
+
+// Minimal ELF reading (elf.c).  Everything points into data.
+struct ElfSymbol
+{
+	uint32_t st_name;
+	uint32_t st_value;
+	uint32_t st_size;
+	uint8_t  st_info;
+	uint8_t  st_other;
+	uint16_t st_shndx;
+};
+
+struct ElfFile
+{
+	uint8_t * data;
+	uint32_t len;
+	struct ElfSymbol * symbols;
+	uint32_t num_symbols;
+	const char * strings;
+	uint32_t strings_len;
+};
+
+struct ElfSegment
+{
+	uint32_t address;
+	uint32_t size;
+	const uint8_t * data;
+};
+
+int IsELFFile( const char * filename );
+int ElfLoad( struct ElfFile * elf, const char * filename );
+void ElfFree( struct ElfFile * elf );
+const char * ElfSymbolName( struct ElfFile * elf, struct ElfSymbol * sym );
+int ElfFindSymbol( struct ElfFile * elf, const char * name, uint32_t * address, uint32_t * size );
+struct ElfSymbol * ElfSymbolAt( struct ElfFile * elf, uint32_t address ); // Function containing address (or label below it), or 0.
+int ElfGetLoadSegments( struct ElfFile * elf, struct ElfSegment * segs, int max ); // Returns count, or negative.
+uint32_t ElfEntry( struct ElfFile * elf );
+
+// Writes the loadable parts of an ELF to flash and/or RAM.  Only what's in
+// the file is written, gaps are left alone.
+int WriteELFImage( void * dev, const char * filename, int diff, int verify, int cache );
+
+// Returns 'dev' on success, else 0.  Each fills in mcf, which becomes the
+// new device's function table, see MCF.
+void * TryInit_WCHLinkE(struct MiniChlinkFunctions * mcf, const init_hints_t * hints);
+void * TryInit_WCHISP(struct MiniChlinkFunctions * mcf);
+void * TryInit_ESP32S2CHFUN(struct MiniChlinkFunctions * mcf, uint32_t id);
+void * TryInit_NHCLink042(struct MiniChlinkFunctions * mcf);
+void * TryInit_B003Fun(struct MiniChlinkFunctions * mcf, uint32_t id);
+void * TryInit_Ardulink(struct MiniChlinkFunctions * mcf, const init_hints_t*);
+void * TryInit_Mock(struct MiniChlinkFunctions * mcf, const init_hints_t*); // Not a real programmer, see pgm-mock.c
+
+// Fills in up to max serial numbers of attached WCH-LinkE's (malloc'd).  Returns the count.
+int ListWCHLinkESerials( char ** serials, int max );
+
+// How many DMI ops the WCH-LinkE driver keeps on the wire at once, 1 to wait
+// for every reply.  Returns the old setting.  dev must be a LinkE.
+int WCHLinkESetInflight( void * dev, int inflight );
 
 // Returns 0 if ok, populated, 1 if not populated.
 int SetupAutomaticHighLevelFunctions( void * dev );
@@ -290,6 +398,48 @@ int InternalUnlockBootloader( void * dev );
 int InternalIsMemoryErased( struct InternalState * iss, uint32_t address );
 void InternalMarkMemoryNotErased( struct InternalState * iss, uint32_t address );
 int InternalUnlockFlash( void * dev, struct InternalState * iss );
+int DiffWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob_size, const uint8_t * blob );
+int InternalVerifyCRC32( void * dev, uint32_t address, uint32_t len, const uint8_t * image );
+int InternalChipCRC32( void * dev, uint32_t address, uint32_t words, uint32_t * crc );
+int InternalLoaderWriteFlash( void * dev, uint32_t address, uint32_t len, const uint8_t * blob );
+uint32_t InternalCRC32Words( const uint8_t * data, uint32_t words );
+int InternalWriteChangedSectors( void * dev, uint32_t address_to_write, uint32_t blob_size, const uint8_t * blob, const uint8_t * dirty );
+
+// Like DiffWriteBinaryBlob, but knows what's on the chip from a per-UUID cache
+// of what was last written, see flashcache.c.
+int CachedWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob_size, const uint8_t * blob, int diff );
+
+// Briefly stop a running core so the debug module can be used on it, then let
+// it go again.  Everything the high level functions clobber (DATA0, DATA1 and
+// x8..x15) is put back, so the firmware never notices.  saved must hold
+// LIVE_SAVE_WORDS.  If the core was already halted, it is left halted.
+#define LIVE_SAVE_WORDS 11
+int InternalLiveHalt( void * dev, uint32_t * saved );
+int InternalLiveResume( void * dev, uint32_t * saved );
+
+// Debug printf ring buffer, see FUNCONF_DEBUGPRINTF_RING in ch32fun.h.
+// Probe returns the address of the ring if the firmware advertised one, else 0.
+// Poll returns the number of bytes pulled out of the ring, or negative on error.
+#define DEBUGPRINTF_RING_MAGIC 0x676e6972 // "ring"
+#define DEBUGPRINTF_RING_MAX_READ 4096
+#define DEBUGPRINTF_RING_POLL_MAX 512 // Most minichlink -T reads per halt.
+#define DEBUGPRINTF_RING_POLL_INTERVAL 0.005 // Seconds between -T polls while data is flowing.
+uint32_t InternalProbeDebugRing( void * dev );
+int InternalPollDebugRing( void * dev, uint32_t ring, uint8_t * buffer, int maxlen, uint32_t * dropped );
+
+// Queued DM register access.  Writes are held until a result is needed, reads
+// are filled in when DMIFlush() is called (or the queue fills up).  Everything
+// queued must be flushed before calling MCF( dev ).WriteReg32/ReadReg32 directly, or
+// returning from a high level function.
+int DMIQueueWrite( void * dev, uint8_t reg_7_bit, uint32_t value );
+int DMIQueueRead( void * dev, uint8_t reg_7_bit, uint32_t * result );
+int DMIFlush( void * dev );
+
+// Queue reads/writes of count consecutive abstract registers (0x1000 + n for
+// GPRs, or CSR numbers), streamed with aarpostincrement where the DM has it.
+// Autoexec must be off before these are queued, and is left off.
+int DMIQueueReadRegisters( void * dev, uint32_t regno, int count, uint32_t * regret );
+int DMIQueueWriteRegisters( void * dev, uint32_t regno, int count, const uint32_t * values );
 
 // GDBSever Functions
 int SetupGDBServer( void * dev );
@@ -0,0 +1,273 @@
+// Times the common operations against the mock programmer (pgm-mock.c), so
+// changes that add round trips get caught before they get to real hardware.
+//
+//   make mockbench
+//   ./mockbench [chip, default CH32V003] [latency per round trip in us, default 0]
+//
+// Every test is run twice, once like a programmer that does one DM access
+// per round trip (WCH-LinkE), and once like one that can queue them up
+// (ardulink, esp32s2).  Returns nonzero if anything read back wrong.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "minichlink.h"
+#include "chips.h"
+#include "os_generic.h"
+#include "microgdbstub.h"
+
+// Debug printf's from a program in RAM, 7 bytes at a time, like _write() does.
+// a0 = &DATA0, a1 = &DATA1, a2 = number of times, a4/a5 = what to send.
+static const uint32_t terminal_program[] = {
+	0xf6934114, // 1: c.lw a3, 0(a0);  andi a3, a3, 0x80
+	0xfeed0806, //    c.bnez a3, 1b
+	0xc11cc198, //    c.sw a4, 0(a1);  c.sw a5, 0(a0)
+	0xfa6d167d, //    c.addi a2, -1;   c.bnez a2, 1b
+	0x00019002, //    c.ebreak;        c.nop
+};
+#define TERMINAL_CHUNKS 2000
+
+// For GDB stepping, a2 = number of times around.
+static const uint32_t step_program[] = {
+	0xfe7d167d, // 1: c.addi a2, -1;  c.bnez a2, 1b
+	0x00019002, //    c.ebreak;       c.nop
+};
+#define STEP_LOOPS 50
+
+struct BenchState
+{
+	void * dev;
+	struct InternalState * iss;
+	double start;
+	uint32_t roundtrips;
+	int failures;
+};
+
+static void BenchStart( struct BenchState * b )
+{
+	b->roundtrips = b->iss->roundtrips;
+	b->start = OGGetAbsoluteTime();
+}
+
+// If count isn't 0, also prints how many per second, of bytes (as kB) or whatever unit is.
+static void BenchEndUnits( struct BenchState * b, const char * name, uint32_t count, const char * unit, int ok )
+{
+	double dt = OGGetAbsoluteTime() - b->start;
+	printf( "  %-24s %9.2f ms %8u round trips", name, dt * 1000.0, b->iss->roundtrips - b->roundtrips );
+	if( count && !unit ) printf( " %9.1f kB/s", dt > 0 ? count / dt / 1024.0 : 0.0 );
+	else if( count ) printf( " %9.0f %s/s", dt > 0 ? count / dt : 0.0, unit );
+	printf( "%s\n", ok ? "" : "  FAILED" );
+	fflush( stdout );
+	if( !ok ) b->failures++;
+}
+
+static void BenchEnd( struct BenchState * b, const char * name, uint32_t bytes, int ok )
+{
+	BenchEndUnits( b, name, bytes, 0, ok );
+}
+
+static int BenchTerminal( struct BenchState * b )
+{
+	void * dev = b->dev;
+	struct InternalState * iss = b->iss;
+	uint32_t hartinfo = 0, dcsr = 0;
+	uint8_t buffer[TERMINAL_BUFFER_SIZE];
+	uint32_t got = 0;
+	int ok = 1;
+
+	MCF( dev ).ReadReg32( dev, DMHARTINFO, &hartinfo );
+	uint32_t data0 = 0xe0000000 | ( hartinfo & 0x7ff );
+	if( MCF( dev ).WriteBinaryBlob( dev, iss->ram_base, sizeof( terminal_program ), (const uint8_t*)terminal_program ) )
+		return 0;
+	MCF( dev ).WriteCPURegister( dev, 0x100a, data0 );
+	MCF( dev ).WriteCPURegister( dev, 0x100b, data0 + 4 );
+	MCF( dev ).WriteCPURegister( dev, 0x100c, TERMINAL_CHUNKS );
+	MCF( dev ).WriteCPURegister( dev, 0x100e, 0x47464544 );            // "DEFG"
+	MCF( dev ).WriteCPURegister( dev, 0x100f, 0x4342418b );            // 7 bytes, "ABC"
+	MCF( dev ).ReadCPURegister( dev, 0x7b0, &dcsr );
+	MCF( dev ).WriteCPURegister( dev, 0x7b0, ( dcsr | 0x8000 ) & ~4 ); // ebreakm, so it stops when done.
+	MCF( dev ).WriteCPURegister( dev, 0x7b1, iss->ram_base );
+	MCF( dev ).WriteReg32( dev, DMDATA0, 0 );
+	MCF( dev ).FlushLLCommands( dev );
+
+	BenchStart( b );
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x40000001 ); // resumereq
+	double timeout = OGGetAbsoluteTime() + 30;
+	while( got < TERMINAL_CHUNKS * 7 && OGGetAbsoluteTime() < timeout )
+	{
+		int r = MCF( dev ).PollTerminal( dev, buffer, sizeof( buffer ), 0, 0 );
+		if( r < -1 ) { ok = 0; break; }
+		if( r > 0 )
+		{
+			if( memcmp( buffer, "ABCDEFG", r ) ) ok = 0;
+			got += r;
+		}
+	}
+	if( got != TERMINAL_CHUNKS * 7 ) ok = 0;
+	BenchEnd( b, "terminal (debug printf)", got, ok );
+
+	MCF( dev ).HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET );
+	return ok;
+}
+
+// GDB stepping through a small loop, one instruction per 's' like GDB does
+// without range stepping, then with vCont;r.
+static void BenchGDBStep( struct BenchState * b )
+{
+	void * dev = b->dev;
+	struct InternalState * iss = b->iss;
+	int pcreg = iss->nr_registers_for_debug;
+	uint32_t pc = 0, a2 = 0;
+	int steps, r = 0;
+
+	if( MCF( dev ).WriteBinaryBlob( dev, iss->ram_base, sizeof( step_program ), (const uint8_t*)step_program ) )
+		return;
+	RVNetConnect( dev );
+
+	RVWriteCPURegister( dev, 12, STEP_LOOPS );
+	RVWriteCPURegister( dev, pcreg, iss->ram_base );
+	BenchStart( b );
+	for( steps = 0; steps < STEP_LOOPS * 2 + 10; )
+	{
+		RVDebugExec( dev, HALT_TYPE_SINGLE_STEP, 0, 0 );
+		steps++;
+		RVReadCPURegister( dev, pcreg, &pc ); // GDB looks at where it went.
+		if( pc >= iss->ram_base + 4 ) break;
+	}
+	RVReadCPURegister( dev, 12, &a2 );
+	BenchEndUnits( b, "gdb single steps", steps, "steps", pc == iss->ram_base + 4 && a2 == 0 );
+
+	RVWriteCPURegister( dev, 12, STEP_LOOPS );
+	RVWriteCPURegister( dev, pcreg, iss->ram_base );
+	BenchStart( b );
+	for( steps = 0; r >= 0 && steps < STEP_LOOPS * 2 + 10; )
+	{
+		r = RVDebugRangeStep( dev, iss->ram_base, iss->ram_base + 4 );
+		steps += r;
+		RVReadCPURegister( dev, pcreg, &pc );
+		if( pc >= iss->ram_base + 4 ) break;
+	}
+	RVReadCPURegister( dev, 12, &a2 );
+	BenchEndUnits( b, "gdb range step", steps, "steps", pc == iss->ram_base + 4 && a2 == 0 );
+
+	RVHandleDisconnect( dev );
+}
+
+static int BenchRun( const char * chip, const char * latency, int batched )
+{
+	struct BenchState b;
+	init_hints_t hints;
+	int i;
+
+	memset( &b, 0, sizeof( b ) );
+	memset( &hints, 0, sizeof( hints ) );
+	hints.specific_programmer = "mock";
+	setenv( "MINICHLINK_MOCK_CHIP", chip, 1 );
+	setenv( "MINICHLINK_MOCK_LATENCY_US", latency, 1 );
+	setenv( "MINICHLINK_MOCK_BATCH", batched ? "1" : "0", 1 );
+	unsetenv( "MINICHLINK_MOCK_FLASH" );
+
+	printf( "%s, %s us per round trip, %s:\n", chip, latency, batched ? "batched DMI" : "one DMI op per round trip" );
+	fflush( stdout );
+	void * dev = MiniCHLinkInitAsDLL( 0, &hints );
+	if( !dev ) return 1;
+	b.dev = dev;
+	b.iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+
+	BenchStart( &b );
+	int r = MCF( dev ).SetupInterface( dev );
+	if( !r ) r = MCF( dev ).DetermineChipType( dev );
+	BenchEnd( &b, "setup + detect", 0, !r );
+	if( r ) return 1;
+
+	struct InternalState * iss = b.iss;
+	uint32_t len = iss->flash_size < 16384 ? iss->flash_size : 16384;
+	uint32_t base = iss->target_chip->flash_offset;
+	uint8_t * image = malloc( len );
+	uint8_t * readback = malloc( len );
+	srand( 1 );
+	for( i = 0; i < (int)len; i++ ) image[i] = rand();
+
+	BenchStart( &b );
+	r = MCF( dev ).HaltMode( dev, HALT_MODE_HALT_AND_RESET );
+	BenchEnd( &b, "halt", 0, !r );
+
+	BenchStart( &b );
+	r = MCF( dev ).Erase( dev, 0, 0, 1 );
+	BenchEnd( &b, "erase chip", 0, !r );
+
+	BenchStart( &b );
+	r = MCF( dev ).WriteBinaryBlob( dev, base, len, image );
+	BenchEnd( &b, "write flash", len, !r );
+
+	BenchStart( &b );
+	memset( readback, 0, len );
+	r = MCF( dev ).ReadBinaryBlob( dev, base, len, readback );
+	BenchEnd( &b, "read flash", len, !r && !memcmp( readback, image, len ) );
+
+	BenchStart( &b );
+	r = InternalVerifyCRC32( dev, base, len, image );
+	BenchEnd( &b, "verify flash (CRC)", len, r == 0 );
+
+	BenchStart( &b );
+	r = MCF( dev ).Erase( dev, base, iss->sector_size, 0 );
+	BenchEnd( &b, "erase sector", 0, !r );
+	MCF( dev ).ReadBinaryBlob( dev, base, iss->sector_size, readback );
+	for( i = 0; i < iss->sector_size; i++ )
+		if( readback[i] != 0xff ) break;
+	if( i != iss->sector_size )
+	{
+		printf( "  Sector not erased\n" );
+		b.failures++;
+	}
+
+	BenchStart( &b );
+	r = MCF( dev ).WriteBinaryBlob( dev, iss->ram_base, 1024, image );
+	BenchEnd( &b, "write RAM (1 kB)", 1024, !r );
+
+	// Like gdb setting a breakpoint under running firmware: its RAM has to come through intact.
+	BenchStart( &b );
+	r = MCF( dev ).WriteBinaryBlob( dev, base, iss->sector_size, image + 1024 );
+	BenchEnd( &b, "rewrite sector", iss->sector_size, !r );
+	MCF( dev ).ReadBinaryBlob( dev, iss->ram_base, 1024, readback );
+	if( memcmp( readback, image, 1024 ) )
+	{
+		printf( "  RAM changed by flash write\n" );
+		b.failures++;
+	}
+
+	BenchStart( &b );
+	r = InternalVerifyCRC32( dev, base, iss->sector_size, image + 1024 );
+	BenchEnd( &b, "verify sector (CRC)", iss->sector_size, r == 0 );
+	MCF( dev ).ReadBinaryBlob( dev, iss->ram_base, 1024, readback );
+	if( memcmp( readback, image, 1024 ) )
+	{
+		printf( "  RAM changed by CRC check\n" );
+		b.failures++;
+	}
+
+	uint32_t regs[33];
+	BenchStart( &b );
+	for( i = 0; i < 100 && !r; i++ )
+		r = MCF( dev ).ReadAllCPURegisters( dev, regs );
+	BenchEnd( &b, "register dump (x100)", 0, !r );
+
+	BenchTerminal( &b );
+	BenchGDBStep( &b );
+
+	free( image );
+	free( readback );
+	MCF( dev ).Exit( dev );
+	printf( "\n" );
+	return b.failures;
+}
+
+int main( int argc, char ** argv )
+{
+	const char * chip = ( argc > 1 ) ? argv[1] : "CH32V003";
+	const char * latency = ( argc > 2 ) ? argv[2] : "0";
+	int failures = BenchRun( chip, latency, 0 );
+	failures += BenchRun( chip, latency, 1 );
+	if( failures ) printf( "%d FAILURES\n", failures );
+	return failures != 0;
+}
@@ -5,7 +5,7 @@
 #include "minichlink.h"
 #include "libusb.h"
 
-void * TryInit_NHCLink042(void);
+void * TryInit_NHCLink042(struct MiniChlinkFunctions * mcf);
 
 static int NHCLinkWriteReg32(void * dev, uint8_t reg_7_bit, uint32_t command);
 static int NHCLinkReadReg32(void * dev, uint8_t reg_7_bit, uint32_t * commandresp);
@@ -15,6 +15,11 @@ static int NHCLinkExit(void * dev);
 
 static libusb_device_handle *hdev = 0;
 
+struct NHCLinkProgrammerStruct
+{
+	void * internal; // Part of struct ProgrammerStructBase
+};
+
 int NHCLinkWriteReg32(void * dev, uint8_t reg_7_bit, uint32_t command)
 {
     uint8_t buff[64];
@@ -28,7 +33,7 @@ int NHCLinkWriteReg32(void * dev, uint8_t reg_7_bit, uint32_t command)
     buff[4] = (command >> 16);
     buff[5] = (command >> 24);
 
-    status = libusb_bulk_transfer(dev, 0x01, buff, 64, &len, 5000);
+    status = libusb_bulk_transfer(hdev, 0x01, buff, 64, &len, 5000);
     if ((status) || (len != 64))
     {
         return status;
@@ -47,13 +52,13 @@ int NHCLinkReadReg32(void * dev, uint8_t reg_7_bit, uint32_t * commandresp)
     buff[0] = 0xa2;
     buff[1] = reg_7_bit;
 
-    status = libusb_bulk_transfer(dev, 0x01, buff, 64, &len, 5000);
+    status = libusb_bulk_transfer(hdev, 0x01, buff, 64, &len, 5000);
     if ((status) || (len != 64))
     {
         return status;
     }
 
-    status = libusb_bulk_transfer(dev, 0x81, buff, 64, &len, 5000);
+    status = libusb_bulk_transfer(hdev, 0x81, buff, 64, &len, 5000);
     if ((status) || (len != 64))
     {
         return status;
@@ -97,7 +102,7 @@ int NHCLinkDelayUS(void * dev, int microseconds)
     buff[3] = (tmp >> 16);
     buff[4] = (tmp >> 24);
 
-    status = libusb_bulk_transfer(dev, 0x01, buff, 64, &len, 5000);
+    status = libusb_bulk_transfer(hdev, 0x01, buff, 64, &len, 5000);
     if ((status) || (len != 64))
     {
         return status;
@@ -114,7 +119,7 @@ int NHCLinkExit(void * dev)
 
     buff[0] = 0xa1;
 
-    status = libusb_bulk_transfer(dev, 0x01, buff, 64, &len, 5000);
+    status = libusb_bulk_transfer(hdev, 0x01, buff, 64, &len, 5000);
     if ((status) || (len != 64))
     {
         return status;
@@ -123,7 +128,7 @@ int NHCLinkExit(void * dev)
     return 0;
 }
 
-void * TryInit_NHCLink042(void)
+void * TryInit_NHCLink042(struct MiniChlinkFunctions * mcf)
 {
     libusb_context * ctx = 0;
 	int status;
@@ -153,11 +158,12 @@ void * TryInit_NHCLink042(void)
         return 0;
     }
 
-    MCF.WriteReg32 = NHCLinkWriteReg32;
-	MCF.ReadReg32 = NHCLinkReadReg32;
-    MCF.DelayUS = NHCLinkDelayUS;
-    MCF.FlushLLCommands = NHCLinkFlushLLCommands;
-	MCF.Exit = NHCLinkExit;
+    struct NHCLinkProgrammerStruct * dev = calloc( 1, sizeof( struct NHCLinkProgrammerStruct ) );
+    mcf->WriteReg32 = NHCLinkWriteReg32;
+	mcf->ReadReg32 = NHCLinkReadReg32;
+    mcf->DelayUS = NHCLinkDelayUS;
+    mcf->FlushLLCommands = NHCLinkFlushLLCommands;
+	mcf->Exit = NHCLinkExit;
 
-	return hdev;
+	return dev;
 }
@@ -298,7 +298,7 @@ resend:
 		}
 		else
 		{
-			MCF.DelayUS( eps, pad_size*10 );
+			MCF( eps ).DelayUS( eps, pad_size*10 );
 			goto resend;
 		}
 	}
@@ -309,11 +309,11 @@ resend:
 	// Leaving this for now just in case, will remove later
 	// if( !retries && (pad_size > 128) )
 	// {
-	// 	MCF.DelayUS( eps, pad_size*100 );
+	// 	MCF( eps ).DelayUS( eps, pad_size*100 );
 	// }
 	// else if( eps->long_op > 1 )
 	// {
-	// 	MCF.DelayUS( eps, pad_size*100 );
+	// 	MCF( eps ).DelayUS( eps, pad_size*100 );
 	// }
 
 	int timeout = 0;
@@ -388,7 +388,7 @@ resend:
 				printf( "Error: CommitOp retries = %d\n", retries );
 				return r;
 			}
-			if( eps->long_op ) MCF.DelayUS( eps, 5000 );
+			if( eps->long_op ) MCF( eps ).DelayUS( eps, 5000 );
 			continue;
 		}
 
@@ -400,7 +400,7 @@ resend:
 			return -99;
 		}
 
-		if( eps->long_op ) MCF.DelayUS( eps, 5000 );
+		if( eps->long_op ) MCF( eps ).DelayUS( eps, 5000 );
 	} while( 1 );
 
 	eps->long_op = 0;
@@ -687,7 +687,7 @@ static int InternalB003FunBoot( void * dev )
 int B003DetermineIfInBoot( void * dev )
 {
 	uint32_t flash_statr = 0;
-	MCF.ReadWord( dev, 0x4002200C, &flash_statr );
+	MCF( dev ).ReadWord( dev, 0x4002200C, &flash_statr );
 	if( flash_statr & (1<<13) ) return 1;
 	else return 0;
 }
@@ -705,7 +705,7 @@ int B003DetermineChipType( void * dev )
 	// Counterintuitively, we want first to check for ch5xx CHIP_ID,
 	// Because otherwise, trying to read ch32 vendor ID address om ch5xx will crash it
 
-	MCF.ReadWord( dev, 0x40001041, &chip_id );
+	MCF( dev ).ReadWord( dev, 0x40001041, &chip_id );
 	if( chip_id )
 	{
 		switch (chip_id & 0xff)
@@ -722,21 +722,21 @@ int B003DetermineChipType( void * dev )
 		}
 		if (iss->target_chip->family_id == CHIP_CH570) {
 			uint32_t options = 0;
-			MCF.ReadWord( dev, 0x40001058, &options );
+			MCF( dev ).ReadWord( dev, 0x40001058, &options );
 			if( (options&0x800000) || (options&0x200000) ) read_protection = 1;
 		}
 		goto chip_found;
 	}
 
-	MCF.ReadWord( dev, 0x4002201c, &one );
-	MCF.ReadWord( dev, 0x40022020, (uint32_t*)&two );
-	MCF.ReadWord( dev, 0x1ffff7c4, &chip_id );
+	MCF( dev ).ReadWord( dev, 0x4002201c, &one );
+	MCF( dev ).ReadWord( dev, 0x40022020, (uint32_t*)&two );
+	MCF( dev ).ReadWord( dev, 0x1ffff7c4, &chip_id );
 
 	if( (one & 2) || two != -1 ) read_protection = 1;
 
 	if( chip_id == 0xffffffff || chip_id == 0xe339e339 )
 	{
-		MCF.ReadWord( dev, 0x1ffff704, &chip_id );
+		MCF( dev ).ReadWord( dev, 0x1ffff704, &chip_id );
 		switch (chip_id>>20)
 		{
 			case 0x002: iss->target_chip = &ch32v002; break;
@@ -758,7 +758,7 @@ int B003DetermineChipType( void * dev )
 	}
 	else if( !chip_id )
 	{
-		MCF.ReadWord( dev, 0x1ffff884, &chip_id );
+		MCF( dev ).ReadWord( dev, 0x1ffff884, &chip_id );
 		if( (chip_id & 0xfff00000) == 0x25000000 )
 		{
 			iss->target_chip = &ch32v103;
@@ -772,7 +772,7 @@ int B003DetermineChipType( void * dev )
 chip_found:
 	if( iss->target_chip->protocol == PROTOCOL_CH5xx )
 	{
-		MCF.Erase = B003CH5xxErase;
+		MCF( dev ).Erase = B003CH5xxErase;
 	}
 	iss->target_chip_id = chip_id;
 	iss->target_chip_type = iss->target_chip->family_id;
@@ -784,7 +784,7 @@ chip_found:
 	uint8_t uuid[8];
 	fprintf( stderr, "Detected %s\n", iss->target_chip->name_str );
 	fprintf( stderr, "Flash Storage: %d kB\n", iss->flash_size/1024 );
-	if( MCF.GetUUID( dev, uuid ) ) fprintf( stderr, "Couldn't read UUID\n" );
+	if( MCF( dev ).GetUUID( dev, uuid ) ) fprintf( stderr, "Couldn't read UUID\n" );
 	else fprintf( stderr, "Part UUID: %02x-%02x-%02x-%02x-%02x-%02x-%02x-%02x\n", uuid[0], uuid[1], uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7] );
 	fprintf( stderr, "Part Type: %02x-%02x-%02x-%02x\n", part_type[3], part_type[2], part_type[1], part_type[0] );
 	fprintf( stderr, "Read protection: %s\n", (read_protection > 0)?"enabled":"disabled" );
@@ -872,7 +872,7 @@ static int B003FunBlockWrite64( void * dev, uint32_t address_to_write, const uin
 
 		if( !InternalIsMemoryErased( iss, address_to_write ) )
 		{
-			if( MCF.Erase( dev, address_to_write, 64, 0 ) )
+			if( MCF( dev ).Erase( dev, address_to_write, 64, 0 ) )
 			{
 				fprintf( stderr, "Error: Failed to erase sector at %08x\n", address_to_write );
 				return -9;
@@ -880,15 +880,15 @@ static int B003FunBlockWrite64( void * dev, uint32_t address_to_write, const uin
 		}
 
 		// Not actually needed.
-		MCF.WriteWord( dev, 0x40022010, CR_PAGE_PG ); // (intptr_t)&FLASH->CTLR = 0x40022010
-		MCF.WriteWord( dev, 0x40022010, CR_PAGE_PG | CR_BUF_RST); // (intptr_t)&FLASH->CTLR = 0x40022010
+		MCF( dev ).WriteWord( dev, 0x40022010, CR_PAGE_PG ); // (intptr_t)&FLASH->CTLR = 0x40022010
+		MCF( dev ).WriteWord( dev, 0x40022010, CR_PAGE_PG | CR_BUF_RST); // (intptr_t)&FLASH->CTLR = 0x40022010
 
 		ResetOp( eps );
 		WriteOpArb( eps, write64_flash, sizeof(write64_flash) );
 		WriteOp4( eps, address_to_write ); // Base address to write. @52
 		WriteOp4( eps, 0x4002200c ); // FLASH STATR base address. @ 56
 		memcpy( &eps->commandbuffer[60], data, 64 ); // @60
-		if( MCF.PrepForLongOp ) MCF.PrepForLongOp( dev );  // Give the programmer a headsup this next operation could take a while.
+		if( MCF( dev ).PrepForLongOp ) MCF( dev ).PrepForLongOp( dev );  // Give the programmer a headsup this next operation could take a while.
 		if( CommitOp( eps, 64, 0 ) ) return -5;
 
 	}
@@ -943,12 +943,12 @@ static int B003FunErase( void * dev,  uint32_t address, uint32_t length, int typ
 		// Whole-chip flash
 		iss->statetag = STTAG( "XXXX" );
 		printf( "Whole-chip erase\n" );
-		MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, 0 );
-		MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_MER );
-		MCF.PrepForLongOp( dev );  // Give the programmer a headsup this next operation could take a while.
-		MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_STRT_Set|FLASH_CTLR_MER );
-		rw = MCF.WaitForDoneOp( dev, 0 );
-		if( MCF.WaitForFlash && MCF.WaitForFlash( dev ) ) { fprintf( stderr, "Error: Wait for flash error.\n" ); return -11; }
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, 0 );
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_MER );
+		MCF( dev ).PrepForLongOp( dev );  // Give the programmer a headsup this next operation could take a while.
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, CR_STRT_Set|FLASH_CTLR_MER );
+		rw = MCF( dev ).WaitForDoneOp( dev, 0 );
+		if( MCF( dev ).WaitForFlash && MCF( dev ).WaitForFlash( dev ) ) { fprintf( stderr, "Error: Wait for flash error.\n" ); return -11; }
 		memset( iss->flash_sector_status, 1, sizeof( iss->flash_sector_status ) );
 	}
 	else
@@ -989,7 +989,7 @@ static int B003FunBlockWrite( void * dev, uint32_t address_to_write, const uint8
 			WriteOp4( eps, 0x4002200c ); // FLASH STATR base address. @ 80
 			WriteOp4( eps, (iss->sector_size | current_len<<16));
 			memcpy( &eps->commandbuffer[eps->commandplace], data + data_pos, current_len ); // @84
-			if( MCF.PrepForLongOp ) MCF.PrepForLongOp( dev );  // Give the programmer a headsup this next operation could take a while.
+			if( MCF( dev ).PrepForLongOp ) MCF( dev ).PrepForLongOp( dev );  // Give the programmer a headsup this next operation could take a while.
 			if( CommitOp( eps, current_len, 0 ) ) return -5;
 
 			left_to_write -= current_len;
@@ -1018,7 +1018,7 @@ static int B003FunBlockWrite( void * dev, uint32_t address_to_write, const uint8
 			WriteOp4( eps, current_len ); // Data in this packet
 			memcpy( &eps->commandbuffer[eps->commandplace], data + data_pos, current_len );
 			memcpy( &eps->commandbuffer[eps->commandplace+current_len], &data_ready_key, 4 );
-			if( MCF.PrepForLongOp ) MCF.PrepForLongOp( dev );  // Give the programmer a headsup this next operation could take a while.
+			if( MCF( dev ).PrepForLongOp ) MCF( dev ).PrepForLongOp( dev );  // Give the programmer a headsup this next operation could take a while.
 			// eps->long_op = current_len;
 			if( CommitOp( eps, current_len+4, 0 ) ) return -5;
 			left_to_write -= current_len;
@@ -1042,7 +1042,7 @@ static int B003FunWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32
 	// Special: For user data, need to write to it very carefully.
 	if( address_to_write > 0x1ffff7c0 && address_to_write < 0x20000000 )
 	{
-		if( !MCF.WriteHalfWord )
+		if( !MCF( dev ).WriteHalfWord )
 		{
 			fprintf( stderr, "Error: to write this type of memory, half-word-writing is required\n" );
 			return -5;
@@ -1057,35 +1057,35 @@ static int B003FunWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32
 			return -9;
 		}
 
-		MCF.ReadBinaryBlob( dev, base, 64, block );
+		MCF( dev ).ReadBinaryBlob( dev, base, 64, block );
 
 		uint32_t offset = address_to_write - base;
 		memcpy( block + offset, blob, blob_size );
 
 		uint32_t temp;
-		MCF.ReadWord( dev, 0x4002200c, &temp );
+		MCF( dev ).ReadWord( dev, 0x4002200c, &temp );
 		//STATR & BOOT only exists on the 003 and x03x
 		// No issue if we force an unlock anyway.
 		//if( temp & 0x8000 )
 		{
-			MCF.WriteWord( dev, 0x40022004, 0x45670123 ); // KEYR
-			MCF.WriteWord( dev, 0x40022004, 0xCDEF89AB );
+			MCF( dev ).WriteWord( dev, 0x40022004, 0x45670123 ); // KEYR
+			MCF( dev ).WriteWord( dev, 0x40022004, 0xCDEF89AB );
 
 			// These registers are not on or required on the v20x / v30x, but no harm in writing.
-			MCF.WriteWord( dev, 0x40022008, 0x45670123 ); // OBWRE
-			MCF.WriteWord( dev, 0x40022008, 0xCDEF89AB );
-			MCF.WriteWord( dev, 0x40022028, 0x45670123 ); //(FLASH_BOOT_MODEKEYP)
-			MCF.WriteWord( dev, 0x40022028, 0xCDEF89AB ); //(FLASH_BOOT_MODEKEYP)
+			MCF( dev ).WriteWord( dev, 0x40022008, 0x45670123 ); // OBWRE
+			MCF( dev ).WriteWord( dev, 0x40022008, 0xCDEF89AB );
+			MCF( dev ).WriteWord( dev, 0x40022028, 0x45670123 ); //(FLASH_BOOT_MODEKEYP)
+			MCF( dev ).WriteWord( dev, 0x40022028, 0xCDEF89AB ); //(FLASH_BOOT_MODEKEYP)
 		}
 
-		MCF.ReadWord( dev, 0x4002200c, &temp );
+		MCF( dev ).ReadWord( dev, 0x4002200c, &temp );
 		if( temp & 0x8000 )
 		{
 			fprintf( stderr, "Error: Critical memory zone is still locked out\n" );
 		}
-		if( MCF.WaitForFlash ) MCF.WaitForFlash( dev );
+		if( MCF( dev ).WaitForFlash ) MCF( dev ).WaitForFlash( dev );
 
-		MCF.ReadWord( dev, (intptr_t)&FLASH->CTLR, &temp );
+		MCF( dev ).ReadWord( dev, (intptr_t)&FLASH->CTLR, &temp );
 
 		if( !(temp & (1<<9)) ) // Check OBWRE
 		{
@@ -1093,12 +1093,12 @@ static int B003FunWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32
 		}
 
 		// Perform erase.
-		MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTER | FLASH_CTLR_OPTWRE );
-		MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTER | FLASH_CTLR_OPTWRE | FLASH_CTLR_STRT );
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTER | FLASH_CTLR_OPTWRE );
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTER | FLASH_CTLR_OPTWRE | FLASH_CTLR_STRT );
 
-		if( MCF.WaitForFlash ) MCF.WaitForFlash( dev );
+		if( MCF( dev ).WaitForFlash ) MCF( dev ).WaitForFlash( dev );
 
-		MCF.ReadWord( dev, 0x4002200c, &temp );
+		MCF( dev ).ReadWord( dev, 0x4002200c, &temp );
 		if( temp & 0x10 )
 		{
 			fprintf( stderr, "WRPTRERR is set.  Write failed\n" );
@@ -1109,19 +1109,19 @@ static int B003FunWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32
 		for( i = 0; i < 8; i++ )
 		{
 			// OBPG = FLASH_CTLR_OPTPG
-			MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTPG | FLASH_CTLR_OPTWRE );
-			MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTPG | FLASH_CTLR_STRT | FLASH_CTLR_OPTWRE );
+			MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTPG | FLASH_CTLR_OPTWRE );
+			MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, FLASH_CTLR_OPTPG | FLASH_CTLR_STRT | FLASH_CTLR_OPTWRE );
 			uint32_t writeaddy = i*2+base;
 			uint16_t writeword = block[i*2+0] | (block[i*2+1]<<8);
-			MCF.WriteHalfWord( dev, writeaddy, writeword );
-			if( MCF.WaitForFlash ) MCF.WaitForFlash( dev );
+			MCF( dev ).WriteHalfWord( dev, writeaddy, writeword );
+			if( MCF( dev ).WaitForFlash ) MCF( dev ).WaitForFlash( dev );
 			uint16_t verify = 0;
-			MCF.ReadHalfWord( dev, writeaddy, &verify );
+			MCF( dev ).ReadHalfWord( dev, writeaddy, &verify );
 			if( verify != writeword )
 			{
 				fprintf( stderr, "Warning when writing option bytes at %08x, %04x != %04x\n", writeaddy, writeword, verify );
 			}
-			MCF.ReadWord( dev, 0x4002200c, &temp );
+			MCF( dev ).ReadWord( dev, 0x4002200c, &temp );
 			if( temp & 0x10 )
 			{
 				fprintf( stderr, "WRPTRERR is set.  Write failed\n" );
@@ -1129,8 +1129,8 @@ static int B003FunWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32
 			}
 		}
 		// Turn off OPTPG, OPTWRE.
-		MCF.WriteWord( dev, (intptr_t)&FLASH->CTLR, 0 );
-		if( MCF.WaitForFlash ) MCF.WaitForFlash( dev );
+		MCF( dev ).WriteWord( dev, (intptr_t)&FLASH->CTLR, 0 );
+		if( MCF( dev ).WaitForFlash ) MCF( dev ).WaitForFlash( dev );
 
 		return 0;
 	}
@@ -1179,24 +1179,24 @@ static int B003FunWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32
 		if (spad || epad) {
 			if (spad) {
 				if (spad + blob_size <= sector_size) {
-					MCF.ReadBinaryBlob(dev, (address_to_write - spad), sector_size, new_blob);
+					MCF( dev ).ReadBinaryBlob(dev, (address_to_write - spad), sector_size, new_blob);
 					epad = 0;
 				} else {
-					MCF.ReadBinaryBlob(dev, (address_to_write - spad), spad, new_blob);
+					MCF( dev ).ReadBinaryBlob(dev, (address_to_write - spad), spad, new_blob);
 				}
 			}
 			if (epad) {
-				MCF.ReadBinaryBlob(dev, (address_to_write + blob_size), sector_size - epad, new_blob + spad + blob_size);
+				MCF( dev ).ReadBinaryBlob(dev, (address_to_write + blob_size), sector_size - epad, new_blob + spad + blob_size);
 			}
 		}
 		else if (new_blob_size > blob_size)
 		{
-			MCF.ReadBinaryBlob(dev, address_to_write, sector_size, new_blob);
+			MCF( dev ).ReadBinaryBlob(dev, address_to_write, sector_size, new_blob);
 		}
 
 		memcpy(new_blob+spad, blob, blob_size);
 
-		MCF.Erase(dev, new_address, new_blob_size, 0);
+		MCF( dev ).Erase(dev, new_address, new_blob_size, 0);
 		
 		if (eps->scratchpad_size > 348) {
 			ret = B003FunBlockWrite(dev, new_address, new_blob, new_blob_size);
@@ -1349,13 +1349,13 @@ static int B003FunGetUUID(void * dev, uint8_t * buffer)
 		uuid_address = 0x7F018;
 		if( iss->target_chip->family_id == CHIP_CH570 ) uuid_address = 0x3F018;
 
-		ret |= MCF.ReadWord( dev, uuid_address, (uint32_t*)buffer );
-		ret |= MCF.ReadWord( dev, uuid_address+4, (uint32_t*)(buffer + 4) );
+		ret |= MCF( dev ).ReadWord( dev, uuid_address, (uint32_t*)buffer );
+		ret |= MCF( dev ).ReadWord( dev, uuid_address+4, (uint32_t*)(buffer + 4) );
 	}
 	else
 	{
-		ret |= MCF.ReadWord( dev, uuid_address, (uint32_t*)local_buffer );
-		ret |= MCF.ReadWord( dev, uuid_address+4, (uint32_t*)(local_buffer + 4) );
+		ret |= MCF( dev ).ReadWord( dev, uuid_address, (uint32_t*)local_buffer );
+		ret |= MCF( dev ).ReadWord( dev, uuid_address+4, (uint32_t*)(local_buffer + 4) );
 
 		*((uint32_t*)buffer) = local_buffer[0]<<24|local_buffer[1]<<16|local_buffer[2]<<8|local_buffer[3];
 		*(((uint32_t*)buffer)+1) = local_buffer[4]<<24|local_buffer[5]<<16|local_buffer[6]<<8|local_buffer[7];
@@ -1407,10 +1407,10 @@ static uint8_t ch5xx_flash_open(void* dev, uint8_t op)
 	struct B003FunProgrammerStruct * eps = (struct B003FunProgrammerStruct*) dev;
 
 	uint8_t glob_rom_cfg;
-	MCF.ReadByte(dev, 0x40001044, &glob_rom_cfg);
+	MCF( dev ).ReadByte(dev, 0x40001044, &glob_rom_cfg);
 	if ((glob_rom_cfg & 0xe0) != op) {
 		ch5xx_write_safe(dev, 0x40001044, op, -1);
-		MCF.ReadByte(dev, 0x40001044, &glob_rom_cfg);
+		MCF( dev ).ReadByte(dev, 0x40001044, &glob_rom_cfg);
 	}
 	ResetOp( eps );
 	WriteOpArb( eps, ch5xx_flash_open_bin, sizeof(ch5xx_flash_open_bin) );
@@ -1443,7 +1443,7 @@ static uint8_t ch5xx_flash_wait(void * dev )
 
 static void ch5xx_flash_close(void* dev) {
 	uint8_t glob_rom_cfg;
-	MCF.ReadByte(dev, 0x40001044, &glob_rom_cfg);
+	MCF( dev ).ReadByte(dev, 0x40001044, &glob_rom_cfg);
 	ch5xx_flash_end(dev);
 	ch5xx_write_safe(dev, 0x40001044, glob_rom_cfg & 0x10, 0);
 }
@@ -1475,7 +1475,7 @@ int B003CH5xxErase(void* dev, uint32_t addr, uint32_t len, int type) {
 	return ret;
 }
 
-void * TryInit_B003Fun(uint32_t id)
+void * TryInit_B003Fun(struct MiniChlinkFunctions * mcf, uint32_t id)
 {
 	hid_init();
 	fprintf( stderr, "VID:0x%04x, PID:0x%04x\n", id>>16, id&0xFFFF );
@@ -1528,40 +1528,40 @@ void * TryInit_B003Fun(uint32_t id)
 	eps->scratchpad_size = 128;
 	eps->scratchpad_data_size = 64;
 	eps->no_eight_byte = 1;
-	memset( &MCF, 0, sizeof( MCF ) );
-	MCF.WriteReg32 = 0;
-	MCF.ReadReg32 = 0;
-	MCF.FlushLLCommands = B003FunFlushLLCommands;
-	// MCF.DelayUS = B003FunDelayUS;
-	MCF.Control3v3 = 0;
-	MCF.SetupInterface = B003FunSetupInterface;
-	MCF.Exit = B003FunExit;
-	MCF.HaltMode = 0;
-	MCF.VoidHighLevelState = 0;
-	MCF.PollTerminal = B003PollTerminal;
+	memset( mcf, 0, sizeof( *mcf ) );
+	mcf->WriteReg32 = 0;
+	mcf->ReadReg32 = 0;
+	mcf->FlushLLCommands = B003FunFlushLLCommands;
+	// mcf->DelayUS = B003FunDelayUS;
+	mcf->Control3v3 = 0;
+	mcf->SetupInterface = B003FunSetupInterface;
+	mcf->Exit = B003FunExit;
+	mcf->HaltMode = 0;
+	mcf->VoidHighLevelState = 0;
+	mcf->PollTerminal = B003PollTerminal;
 
 	// These are optional. Disabling these is a good mechanism to make sure the core functions still work.
 	
-	MCF.WriteWord = B003FunWriteWord;
-	MCF.ReadWord = B003FunReadWord;
+	mcf->WriteWord = B003FunWriteWord;
+	mcf->ReadWord = B003FunReadWord;
 
-	MCF.WriteHalfWord = B003FunWriteHalfWord;
-	MCF.ReadHalfWord = B003FunReadHalfWord;
+	mcf->WriteHalfWord = B003FunWriteHalfWord;
+	mcf->ReadHalfWord = B003FunReadHalfWord;
 
-	MCF.WriteByte = B003FunWriteByte;
-	MCF.ReadByte = B003FunReadByte;
+	mcf->WriteByte = B003FunWriteByte;
+	mcf->ReadByte = B003FunReadByte;
 
-	MCF.WaitForDoneOp = B003FunWaitForDoneOp;
-	MCF.BlockWrite64 = B003FunBlockWrite64;
-	MCF.WriteBinaryBlob = B003FunWriteBinaryBlob;
-	MCF.ReadBinaryBlob = B003FunReadBinaryBlob;
-	MCF.Erase = B003FunErase;
+	mcf->WaitForDoneOp = B003FunWaitForDoneOp;
+	mcf->BlockWrite64 = B003FunBlockWrite64;
+	mcf->WriteBinaryBlob = B003FunWriteBinaryBlob;
+	mcf->ReadBinaryBlob = B003FunReadBinaryBlob;
+	mcf->Erase = B003FunErase;
 
-	MCF.PrepForLongOp = B003FunPrepForLongOp;
+	mcf->PrepForLongOp = B003FunPrepForLongOp;
 
-	MCF.HaltMode = B003FunHaltMode;
+	mcf->HaltMode = B003FunHaltMode;
 
-	MCF.GetUUID = B003FunGetUUID;
+	mcf->GetUUID = B003FunGetUUID;
 
 	return eps;
 }
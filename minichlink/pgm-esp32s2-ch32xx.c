@@ -125,6 +125,97 @@ int ESPReadReg32( void * dev, uint8_t reg_7_bit, uint32_t * commandresp )
 	}
 }
 
+static int ESPReadReg32Multi( void * dev, uint8_t reg_7_bit, uint32_t * commandresp, int count )
+{
+	struct ESP32ProgrammerStruct * eps = (struct ESP32ProgrammerStruct *)dev;
+
+	if( (eps->dev_version >> 8) > 4 ) reg_7_bit -= 1;
+	ESPFlushLLCommands( eps );
+
+	while( count > 0 )
+	{
+		// Pack as many reads as we can get replies for into one report.
+		int n = 0;
+		while( n < count && SRemain( eps ) > 2 && ( n + 1 ) * 5 <= eps->replybuffersize - 4 )
+		{
+			Write1( eps, (reg_7_bit<<1) | 0 );
+			n++;
+		}
+		eps->replysize = n * 5;
+		ESPFlushLLCommands( eps );
+
+		if( eps->replylen - 1 < n * 5 )
+		{
+			fprintf( stderr, "Error: Short reply on multi-read (%d/%d)\n", eps->replylen - 1, n * 5 );
+			return -9;
+		}
+
+		uint8_t * e = eps->replybuffer + 1;
+		int i;
+		for( i = 0; i < n; i++ )
+		{
+			if( *e ) return -9;
+			memcpy( commandresp++, e + 1, 4 );
+			e += 5;
+		}
+		count -= n;
+	}
+	return 0;
+}
+
+static int ESPExecuteDMIQueue( void * dev, struct DMIOp * ops, int count )
+{
+	struct ESP32ProgrammerStruct * eps = (struct ESP32ProgrammerStruct *)dev;
+	int regadj = ( (eps->dev_version >> 8) > 4 ) ? 1 : 0;
+	int i = 0;
+
+	ESPFlushLLCommands( eps );
+
+	while( i < count )
+	{
+		// Pack as many ops as fit into one report, leaving room for all the read replies.
+		int first = i;
+		int reads = 0;
+		while( i < count && SRemain( eps ) > 5 && ( !ops[i].is_read || ( reads + 1 ) * 5 <= eps->replybuffersize - 4 ) )
+		{
+			uint8_t reg_7_bit = ops[i].reg_7_bit - regadj;
+			if( ops[i].is_read )
+			{
+				Write1( eps, (reg_7_bit<<1) | 0 );
+				reads++;
+			}
+			else
+			{
+				Write1( eps, (reg_7_bit<<1) | 1 );
+				Write4LE( eps, ops[i].value );
+			}
+			i++;
+		}
+
+		// Trailing writes can just go out with whatever gets sent next.
+		if( reads == 0 && i == count ) break;
+
+		eps->replysize = reads * 5;
+		ESPFlushLLCommands( eps );
+
+		if( eps->replylen - 1 < reads * 5 )
+		{
+			fprintf( stderr, "Error: Short reply on DMI queue (%d/%d)\n", eps->replylen - 1, reads * 5 );
+			return -9;
+		}
+
+		uint8_t * e = eps->replybuffer + 1;
+		for( ; first < i; first++ )
+		{
+			if( !ops[first].is_read ) continue;
+			if( *e ) return -9;
+			memcpy( ops[first].result, e + 1, 4 );
+			e += 5;
+		}
+	}
+	return 0;
+}
+
 int ESPReadAllCPURegisters( void * dev, uint32_t * regret )
 {
 	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
@@ -135,7 +226,7 @@ int ESPReadAllCPURegisters( void * dev, uint32_t * regret )
 	iss->statetag = STTAG( "RER2" ); // Void local high level state.
 
 	ESPWriteReg32( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
-	MCF.DetermineChipType( dev );
+	MCF( dev ).DetermineChipType( dev );
 	int i;
 	for( i = 0; i < iss->nr_registers_for_debug; i++ )
 	{
@@ -252,6 +343,8 @@ int ESPFlushLLCommands( void * dev )
 
 	if( eps->commandplace == 1 ) return 0;
 
+	InternalCountRoundTrip( dev );
+
 	int r;
 	uint8_t descriptor = 0xad;
 	int buffer_size = eps->commandbuffersize;
@@ -852,7 +945,7 @@ int ESPCH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob
 		return -1;
 	}
 
-	MCF.SetClock(dev, 0);
+	MCF( dev ).SetClock(dev, 0);
 
 	uint8_t write_mode = 0;
 
@@ -867,7 +960,7 @@ int ESPCH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob
 
 	if (iss->target_chip_type == CHIP_CH570) {
 		uint32_t options = 0;
-		MCF.ReadWord(dev, 0x40001058, &options);
+		MCF( dev ).ReadWord(dev, 0x40001058, &options);
 		if ((options&0x800000) || (options&0x200000)) {
 			printf("Flash is write/read protected. You may need to remove protection using 'minichlink -p' %08x\n", options); 
 			return -1;
@@ -877,7 +970,7 @@ int ESPCH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob
 	if (iss->current_area == PROGRAM_AREA || iss->current_area == BOOTLOADER_AREA) {
 		if (iss->current_area == BOOTLOADER_AREA) {
 			uint8_t info_reg = 0;
-			MCF.ReadByte(dev, R8_GLOB_CFG_INFO, &info_reg);
+			MCF( dev ).ReadByte(dev, R8_GLOB_CFG_INFO, &info_reg);
 			if (!(info_reg & (1<<5))) {
 				fprintf(stderr, "You need to be in bootloader mode to flash to BOOTLOADER partition.\n R8_GLOB_CFG_INFO = %02x\n", info_reg);
 				ret = -2;
@@ -892,11 +985,11 @@ int ESPCH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob
 		
 		if (spad) {
 			if (spad + blob_size <= sector_size) {
-				MCF.ReadBinaryBlob(dev, (address_to_write - spad), sector_size, start_pad);
+				MCF( dev ).ReadBinaryBlob(dev, (address_to_write - spad), sector_size, start_pad);
 				memcpy(start_pad + spad, blob, blob_size);
 				epad = 0;
 			} else {
-				MCF.ReadBinaryBlob(dev, (address_to_write - spad), spad, start_pad);
+				MCF( dev ).ReadBinaryBlob(dev, (address_to_write - spad), spad, start_pad);
 				memcpy(start_pad + spad, blob, sector_size - spad);
 			}
 			if (new_blob_size >= sector_size - spad) new_blob_size -= sector_size - spad;
@@ -904,7 +997,7 @@ int ESPCH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob
 		}
 		if (epad) {
 			if (new_blob_size) memcpy(end_pad, blob + (blob_size - epad), epad);
-			MCF.ReadBinaryBlob(dev, (address_to_write + blob_size), sector_size - epad, end_pad + epad);
+			MCF( dev ).ReadBinaryBlob(dev, (address_to_write + blob_size), sector_size - epad, end_pad + epad);
 			if (new_blob_size >= epad) new_blob_size -= epad;
 			else new_blob_size = 0;
 		}
@@ -989,7 +1082,7 @@ int ESPCH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob
 	} else if (iss->current_area == RAM_AREA) {
 		if (spad) {
 			for (int i = 0; i < spad; i++) {
-				ret = MCF.WriteByte(dev, address_to_write+i, *((uint8_t*)(blob+i)));
+				ret = MCF( dev ).WriteByte(dev, address_to_write+i, *((uint8_t*)(blob+i)));
 				if (ret) {
 					fprintf(stderr, "Error on WriteByte while writing to RAM.\n");
 					goto end;
@@ -997,7 +1090,7 @@ int ESPCH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob
 			}
 		} 
 		for (int i = 0; i < blob_size-spad-epad; i += 4) {
-			ret = MCF.WriteWord(dev, address_to_write+spad+i, *((uint32_t*)(blob+spad+i)));
+			ret = MCF( dev ).WriteWord(dev, address_to_write+spad+i, *((uint32_t*)(blob+spad+i)));
 			if (ret) {
 				fprintf(stderr, "Error on WriteWord while writing to RAM.\n");
 				goto end;
@@ -1006,7 +1099,7 @@ int ESPCH5xxWriteBinaryBlob(void * dev, uint32_t address_to_write, uint32_t blob
 		if (epad) {
 			uint32_t epad_address = address_to_write + blob_size - epad;
 			for (int i = 0; i < spad; i++) {
-				ret = MCF.WriteByte(dev, epad_address + i, *((uint8_t*)(blob + epad_address + i)));
+				ret = MCF( dev ).WriteByte(dev, epad_address + i, *((uint8_t*)(blob + epad_address + i)));
 				if (ret) {
 					fprintf(stderr, "Error on WriteByte while writing to RAM.\n");
 					goto end;
@@ -1041,7 +1134,7 @@ int ESPCH5xxReadBinaryBlob( void * dev, uint32_t address_to_read_from, uint32_t
 		ret = -1;
 		goto end;
 	}
-	MCF.SetClock(dev, 0);
+	MCF( dev ).SetClock(dev, 0);
 	if (iss->current_area == OPTIONS_AREA) {
 		if( eps->capabilities & HAS_CH5xx_OPTIONS )
 			ret = esp_ch5xx_read_options_bulk(dev, address_to_read_from, blob, read_size);
@@ -1071,7 +1164,7 @@ int ESPDetermineChipTypeOLD( void * dev )
 	if( iss->target_chip == NULL )
 	{
 		uint32_t rr;
-		if( MCF.ReadReg32( dev, DMHARTINFO, &rr ) )
+		if( MCF( dev ).ReadReg32( dev, DMHARTINFO, &rr ) )
 		{
 			fprintf( stderr, "Error: Could not get hart info.\n" );
 			return -1;
@@ -1079,33 +1172,33 @@ int ESPDetermineChipTypeOLD( void * dev )
 
 		uint32_t data0offset = 0xe0000000 | ( rr & 0x7ff );
 
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
-		MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate halt request.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Make the debug module work properly.
+		MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Initiate halt request.
 
 		// Tricky, this function needs to clean everything up because it may be used entering debugger.
 		uint32_t old_data0;
-		MCF.ReadReg32( dev, DMDATA0, &old_data0 );
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+		MCF( dev ).ReadReg32( dev, DMDATA0, &old_data0 );
+		MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
 		uint32_t old_x8;
-		MCF.ReadReg32( dev, DMDATA0, &old_x8 );
+		MCF( dev ).ReadReg32( dev, DMDATA0, &old_x8 );
 
 		uint32_t vendorid = 0;
 		uint32_t marchid = 0;
 
-		MCF.WriteReg32( dev, DMABSTRACTCS, 0x08000700 ); // Clear out any dmabstractcs errors.
+		MCF( dev ).WriteReg32( dev, DMABSTRACTCS, 0x08000700 ); // Clear out any dmabstractcs errors.
 
-		MCF.WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 );
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00220000 | 0xf12 );
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00220000 | 0xf12 ); // Need to double-read, not sure why.
-		MCF.ReadReg32( dev, DMDATA0, &marchid );
+		MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0x00000000 );
+		MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00220000 | 0xf12 );
+		MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00220000 | 0xf12 ); // Need to double-read, not sure why.
+		MCF( dev ).ReadReg32( dev, DMDATA0, &marchid );
 
-		MCF.WriteReg32( dev, DMPROGBUF0, 0x90024000 ); // c.ebreak <<== c.lw x8, 0(x8)
-		MCF.WriteReg32( dev, DMDATA0, 0x1ffff704 ); // Special chip ID location.
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-		MCF.WaitForDoneOp( dev, 0 );
+		MCF( dev ).WriteReg32( dev, DMPROGBUF0, 0x90024000 ); // c.ebreak <<== c.lw x8, 0(x8)
+		MCF( dev ).WriteReg32( dev, DMDATA0, 0x1ffff704 ); // Special chip ID location.
+		MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+		MCF( dev ).WaitForDoneOp( dev, 0 );
 
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-		MCF.ReadReg32( dev, DMDATA0, &vendorid );
+		MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+		MCF( dev ).ReadReg32( dev, DMDATA0, &vendorid );
 
 		uint32_t chip_type = (vendorid & 0xfff00000)>>20;
 		uint32_t flash_size_address = 0x1ffff7e0;
@@ -1182,16 +1275,16 @@ int ESPDetermineChipTypeOLD( void * dev )
 			{
 				uint32_t one;
 				int two;
-				MCF.WriteReg32( dev, DMDATA0, 0x4002201c );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-				MCF.WaitForDoneOp( dev, 1 );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-				MCF.ReadReg32( dev, DMDATA0, &one );
-				MCF.WriteReg32( dev, DMDATA0, 0x40022020 );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-				MCF.WaitForDoneOp( dev, 1 );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-				MCF.ReadReg32( dev, DMDATA0, (uint32_t*)&two );
+				MCF( dev ).WriteReg32( dev, DMDATA0, 0x4002201c );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+				MCF( dev ).WaitForDoneOp( dev, 1 );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+				MCF( dev ).ReadReg32( dev, DMDATA0, &one );
+				MCF( dev ).WriteReg32( dev, DMDATA0, 0x40022020 );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+				MCF( dev ).WaitForDoneOp( dev, 1 );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+				MCF( dev ).ReadReg32( dev, DMDATA0, (uint32_t*)&two );
 				
 				if( (one & 2) || two != -1 ) read_protection = 1;
 			}
@@ -1199,11 +1292,11 @@ int ESPDetermineChipTypeOLD( void * dev )
 			uint32_t rr = 0;
 			if( iss-> target_chip && flash_size_address )
 			{
-				MCF.WriteReg32( dev, DMDATA0, flash_size_address );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
-				MCF.WaitForDoneOp( dev, 1 );
-				MCF.WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
-				MCF.ReadReg32( dev, DMDATA0, &rr );
+				MCF( dev ).WriteReg32( dev, DMDATA0, flash_size_address );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00271008 ); // Copy data to x8, and execute.
+				MCF( dev ).WaitForDoneOp( dev, 1 );
+				MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221008 ); // Copy data from x8.
+				MCF( dev ).ReadReg32( dev, DMDATA0, &rr );
 
 				iss->flash_size = (rr & 0xFFFF) * 1024;
 			}
@@ -1222,7 +1315,7 @@ int ESPDetermineChipTypeOLD( void * dev )
 			}
 			
 			uint8_t uuid[8];
-			if( MCF.GetUUID( dev, uuid ) ) fprintf( stderr, "Couldn't read UUID\n" );
+			if( MCF( dev ).GetUUID( dev, uuid ) ) fprintf( stderr, "Couldn't read UUID\n" );
 			fprintf( stderr, "Detected %s\n", iss->target_chip->name_str );
 			fprintf( stderr, "Flash Storage: %d kB\n", iss->flash_size/1024 );
 			fprintf( stderr, "Part UUID: %02x-%02x-%02x-%02x-%02x-%02x-%02x-%02x\n", uuid[0], uuid[1], uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7] );
@@ -1230,9 +1323,9 @@ int ESPDetermineChipTypeOLD( void * dev )
 		}
 
 		// Cleanup
-		MCF.WriteReg32( dev, DMDATA0, old_x8 );
-		MCF.WriteReg32( dev, DMCOMMAND, 0x00231008 ); // Copy data to x8
-		MCF.WriteReg32( dev, DMDATA0, old_data0 );
+		MCF( dev ).WriteReg32( dev, DMDATA0, old_x8 );
+		MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00231008 ); // Copy data to x8
+		MCF( dev ).WriteReg32( dev, DMDATA0, old_data0 );
 		iss->statetag = STTAG( "XXXX" );
 	}
 	return 0;
@@ -1454,22 +1547,22 @@ int ESPDetermineChipType( void * dev )
 			{
 				if( eps->capabilities & HAS_CH5xx_SUPPORT )
 				{
-					MCF.WriteBinaryBlob = ESPCH5xxWriteBinaryBlob;
-					MCF.Erase = ESPCH5xxErase;
-					MCF.ReadBinaryBlob = ESPCH5xxReadBinaryBlob;
+					MCF( dev ).WriteBinaryBlob = ESPCH5xxWriteBinaryBlob;
+					MCF( dev ).Erase = ESPCH5xxErase;
+					MCF( dev ).ReadBinaryBlob = ESPCH5xxReadBinaryBlob;
 				}
 				else
 				{
-					MCF.WriteBinaryBlob = CH5xxWriteBinaryBlob;
-					MCF.Erase = CH5xxErase;
-					MCF.ReadBinaryBlob = CH5xxReadBinaryBlob;
+					MCF( dev ).WriteBinaryBlob = CH5xxWriteBinaryBlob;
+					MCF( dev ).Erase = CH5xxErase;
+					MCF( dev ).ReadBinaryBlob = CH5xxReadBinaryBlob;
 				}
-				MCF.ConfigureNRSTAsGPIO = CH5xxConfigureNRSTAsGPIO;
+				MCF( dev ).ConfigureNRSTAsGPIO = CH5xxConfigureNRSTAsGPIO;
 			}
 
 			uint8_t * part_type = (uint8_t*)&iss->target_chip_id;
 			uint8_t uuid[8];
-			if( MCF.GetUUID( dev, uuid ) ) fprintf( stderr, "Couldn't read UUID\n" );
+			if( MCF( dev ).GetUUID( dev, uuid ) ) fprintf( stderr, "Couldn't read UUID\n" );
 			fprintf( stderr, "Detected %s\n", iss->target_chip->name_str );
 			fprintf( stderr, "Flash Storage: %d kB\n", iss->flash_size/1024 );
 			fprintf( stderr, "Part UUID: %02x-%02x-%02x-%02x-%02x-%02x-%02x-%02x\n", uuid[0], uuid[1], uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7] );
@@ -1489,7 +1582,7 @@ static int ESPResetInterface( void * dev )
 	return 0;
 }
 
-void * TryInit_ESP32S2CHFUN(uint32_t id)
+void * TryInit_ESP32S2CHFUN(struct MiniChlinkFunctions * mcf, uint32_t id)
 {
 	hid_init();
 
@@ -1538,29 +1631,31 @@ void * TryInit_ESP32S2CHFUN(uint32_t id)
 	eps->commandplace = 1;
 	eps->dev_version = 0;
 
-	memset( &MCF, 0, sizeof( MCF ) );
-	MCF.WriteReg32 = ESPWriteReg32;
-	MCF.ReadReg32 = ESPReadReg32;
-	MCF.FlushLLCommands = ESPFlushLLCommands;
-	MCF.DelayUS = ESPDelayUS;
-	MCF.Control3v3 = ESPControl3v3;
-	MCF.Exit = ESPExit;
-	MCF.VoidHighLevelState = ESPVoidHighLevelState;
-	MCF.VendorCommand = ESPVendorCommand;
-	MCF.ResetInterface = ESPResetInterface;
+	memset( mcf, 0, sizeof( *mcf ) );
+	mcf->WriteReg32 = ESPWriteReg32;
+	mcf->ReadReg32 = ESPReadReg32;
+	mcf->ReadReg32Multi = ESPReadReg32Multi;
+	mcf->ExecuteDMIQueue = ESPExecuteDMIQueue;
+	mcf->FlushLLCommands = ESPFlushLLCommands;
+	mcf->DelayUS = ESPDelayUS;
+	mcf->Control3v3 = ESPControl3v3;
+	mcf->Exit = ESPExit;
+	mcf->VoidHighLevelState = ESPVoidHighLevelState;
+	mcf->VendorCommand = ESPVendorCommand;
+	mcf->ResetInterface = ESPResetInterface;
 
 #if 1
 	// These are optional. Disabling these is a good mechanism to make sure the core functions still work.
 	// Comment these out to test the reference algorithm.
 	// DO NOT Comment them out piecemeal because there are state assumptions built into these functions.
-	MCF.PollTerminal = ESPPollTerminal;
-	MCF.WriteWord = ESPWriteWord;
-	MCF.ReadWord = ESPReadWord;
-	MCF.WaitForFlash = ESPWaitForFlash;
-	MCF.WaitForDoneOp = ESPWaitForDoneOp;
-	MCF.BlockWrite64 = ESPBlockWrite64;
-	MCF.ReadBinaryBlob = ESPReadBinaryBlob;
-	MCF.ReadAllCPURegisters = ESPReadAllCPURegisters;
+	mcf->PollTerminal = ESPPollTerminal;
+	mcf->WriteWord = ESPWriteWord;
+	mcf->ReadWord = ESPReadWord;
+	mcf->WaitForFlash = ESPWaitForFlash;
+	mcf->WaitForDoneOp = ESPWaitForDoneOp;
+	mcf->BlockWrite64 = ESPBlockWrite64;
+	mcf->ReadBinaryBlob = ESPReadBinaryBlob;
+	mcf->ReadAllCPURegisters = ESPReadAllCPURegisters;
 #endif
 
 	ESPFlushLLCommands( eps );
@@ -1595,6 +1690,7 @@ void * TryInit_ESP32S2CHFUN(uint32_t id)
 	else if( eps->replylen <= 1 || !eps->programmer_type )
 	{
 		fprintf( stderr, "Error. Couldn't determine programmer type/version.\n Exiting...\n" );
+		memset( mcf, 0, sizeof( *mcf ) ); // Don't leave our functions for the next programmer tried.
 		return 0;
 	}
 
@@ -1602,13 +1698,13 @@ void * TryInit_ESP32S2CHFUN(uint32_t id)
 	{
 		eps->commandbuffersize = 264;
 		eps->replybuffersize = 264;
-		MCF.DetermineChipType = ESPDetermineChipType;
-		// MCF.SetClock = ESPSetClock;
-		MCF.SetClock = CH5xxSetClock; // Temporary fallback to generic function, untill we update the programmer firmware
+		mcf->DetermineChipType = ESPDetermineChipType;
+		// mcf->SetClock = ESPSetClock;
+		mcf->SetClock = CH5xxSetClock; // Temporary fallback to generic function, untill we update the programmer firmware
 	}
 	else
 	{
-		MCF.DetermineChipType = ESPDetermineChipTypeOLD;
+		mcf->DetermineChipType = ESPDetermineChipTypeOLD;
 	}
 
 	Write2LE( eps, 0x0efe ); // Trigger Init.
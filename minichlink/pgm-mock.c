@@ -0,0 +1,1104 @@
+// Mock programmer: a pretend programmer with a pretend chip on the end of it.
+//
+// Everything minichlink does comes in through WriteReg32/ReadReg32 and goes
+// into a model of the QingKe debug module (DMCONTROL, DMSTATUS, ABSTRACTCS,
+// COMMAND, DATA0/1, PROGBUF, autoexec), a small RV32IMC core that runs PROGBUF
+// (and anything it's resumed into, like the crc32 stub), and the flash
+// controller, RAM and system info block of one of the CH32 chips in chips.c.
+// There are also a few address match triggers (tselect/tdata1/tdata2), for
+// trying out hardware breakpoints and watchpoints in minichgdb.
+// CH5xx parts program their flash a completely different way (ch5xx.c), so
+// those aren't modeled.
+//
+// Use it with -C mock, and these environment variables:
+//   MINICHLINK_MOCK_CHIP=CH32V203   Which chip (name_str from chips.c), default CH32V003
+//   MINICHLINK_MOCK_LATENCY_US=250  How long every round trip to the "programmer" takes
+//   MINICHLINK_MOCK_BATCH=1         Act like a programmer that can queue DMI ops (one round trip per queue)
+//   MINICHLINK_MOCK_FLASH=file      Load the flash from file, and save it back on exit
+//
+// mockbench.c uses it to time the common operations, so changes that add
+// round trips get noticed without having to dig out hardware.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "minichlink.h"
+#include "chips.h"
+#include "os_generic.h"
+
+#define MOCK_HARTINFO      0x002100f4 // What a v003 says.  DATA0 is at 0xe00000f4.
+#define MOCK_DATA0_ADDR    ( 0xe0000000 | ( MOCK_HARTINFO & 0x7ff ) )
+#define MOCK_PROGBUF_ADDR  0xe0000100 // Where PROGBUF appears to run from.
+#define MOCK_INFO_BASE     0x1fff0000 // Bootloader, option bytes, ESIG.
+#define MOCK_INFO_SIZE     0x10000
+#define MOCK_FLASH_REGS    0x40022000
+#define MOCK_CRC_REGS      0x40023000
+#define MOCK_MHZ           48   // For how much a running core gets done during DelayUS.
+#define MOCK_INSNS_PER_OP  1000 // How much a running core gets done per DM access.
+#define MOCK_PROGBUF_LIMIT 1000000
+#define MOCK_TRIGGERS      4
+
+// mcontrol (tdata1) bits we pay attention to.
+#define MTRIG_TYPE_MCONTROL  0x20000000
+#define MTRIG_DMODE          0x08000000
+#define MTRIG_HIT            0x00100000
+#define MTRIG_ACTION_DEBUG   0x00001000
+#define MTRIG_MATCH_MASK     0x00000780
+#define MTRIG_MATCH_NAPOT    0x00000080
+#define MTRIG_M              0x00000040
+#define MTRIG_U              0x00000008
+#define MTRIG_EXECUTE        0x00000004
+#define MTRIG_STORE          0x00000002
+#define MTRIG_LOAD           0x00000001
+
+// Flash controller bits, as minichlink uses them.
+#define MFLASH_CTLR_PG       0x00000001
+#define MFLASH_CTLR_PER      0x00000002
+#define MFLASH_CTLR_MER      0x00000004
+#define MFLASH_CTLR_OPTPG    0x00000010
+#define MFLASH_CTLR_OPTER    0x00000020
+#define MFLASH_CTLR_STRT     0x00000040
+#define MFLASH_CTLR_LOCK     0x00000080
+#define MFLASH_CTLR_OPTWRE   0x00000200
+#define MFLASH_CTLR_FLOCK    0x00008000
+#define MFLASH_CTLR_PAGE_PG  0x00010000
+#define MFLASH_CTLR_PAGE_ER  0x00020000
+#define MFLASH_CTLR_BUF_RST  0x00080000
+#define MFLASH_CTLR_PGSTART  0x00200000 // v20x/v30x: program the page buffer.
+#define MFLASH_STATR_WRPRTERR 0x00000010
+#define MFLASH_STATR_EOP      0x00000020
+#define MFLASH_STATR_BOOTLOCK 0x00008000
+#define MFLASH_KEY1 0x45670123
+#define MFLASH_KEY2 0xCDEF89AB
+
+struct MockChip
+{
+	const struct RiscVChip_s * chip;
+	uint32_t chipid; // What DMCHIPID (0x7f) and the ESIG say.
+};
+
+// Chip IDs that DefaultDetermineChipType() will turn back into the same chip.
+static const struct MockChip mock_chips[] = {
+	{ &ch32v003, 0x00300500 },
+	{ &ch32v002, 0x00200500 },
+	{ &ch32v004, 0x00400500 },
+	{ &ch32v005, 0x00500500 },
+	{ &ch32v006, 0x00600500 },
+	{ &ch32v007, 0x00700500 },
+	{ &ch32x035, 0x03500601 },
+	{ &ch32v103, 0x00000000 }, // No DMCHIPID, found through the ESIG at 0x1ffff880.
+	{ &ch32l103, 0x10300700 },
+	{ &ch32v203, 0x20300500 },
+	{ &ch32v205, 0x20500500 },
+	{ &ch32v208, 0x20800500 },
+	{ &ch32v303, 0x30300500 },
+	{ &ch32v305, 0x30500500 },
+	{ &ch32v307, 0x30700500 },
+	{ &ch32v317, 0x31700500 },
+	{ &ch32h415, 0x41500500 },
+	{ &ch32h416, 0x41600500 },
+	{ &ch32h417, 0x41700500 },
+	{ &ch641,    0x64100500 },
+	{ &ch643,    0x64300600 },
+};
+
+typedef struct {
+	struct ProgrammerStructBase psb;
+	const struct RiscVChip_s * chip;
+	uint32_t chipid;
+	int latency_us;
+	const char * flash_file;
+	int num_gprs; // 16 on RV32E parts.
+	int no_postincrement; // Act like a DM without aarpostincrement.
+
+	uint8_t * flash;
+	uint8_t * ram;
+	uint8_t * info;
+	uint32_t flash_size;
+	uint32_t ram_base;
+	uint32_t ram_size;
+
+	// Debug module
+	uint32_t data[2];
+	uint32_t progbuf[8];
+	uint32_t dmcontrol;
+	uint32_t cmderr;
+	uint32_t command;
+	uint32_t abstractauto;
+	uint32_t cfgr;
+	int resumeack;
+
+	// Core
+	uint32_t x[32];
+	uint32_t pc; // Is dpc when halted.
+	uint32_t csr[4096];
+	int halted;
+
+	// Trigger module
+	uint32_t tselect;
+	uint32_t tdata1[MOCK_TRIGGERS];
+	uint32_t tdata2[MOCK_TRIGGERS];
+	int trigger_fired; // A load/store trigger went off during this instruction.
+
+	// Flash controller
+	uint32_t flash_ctlr;
+	uint32_t flash_statr;
+	uint32_t flash_addr;
+	int flash_busy_us;        // How long each erase/program keeps BSY set.
+	double flash_busy_until;
+	int key_stage[4]; // KEYR, OBKEYR, MODEKEYR, BOOT_MODEKEYR
+	uint8_t pagebuf[4096];
+	uint32_t pagebuf_addr;
+
+	// CRC peripheral
+	uint32_t crc;
+} mock_ctx_t;
+
+static void MockResetCore( mock_ctx_t * m )
+{
+	memset( m->x, 0, sizeof( m->x ) );
+	m->pc = 0;
+	m->csr[0x300] = 0x00001800;   // mstatus
+	m->csr[0x7b0] = 0x40000003;   // dcsr: Debug spec 0.13, M-mode.
+	m->csr[0xf11] = 0x00000612;   // mvendorid
+	m->csr[0xf12] = 0xdc68d841;   // marchid
+	m->csr[0xf13] = 0x00000002;   // mimpid
+	m->tselect = 0;
+	int i;
+	for( i = 0; i < MOCK_TRIGGERS; i++ )
+		m->tdata1[i] = MTRIG_TYPE_MCONTROL;
+	m->flash_ctlr = MFLASH_CTLR_LOCK | MFLASH_CTLR_FLOCK;
+	m->flash_statr = MFLASH_STATR_BOOTLOCK;
+	memset( m->key_stage, 0, sizeof( m->key_stage ) );
+	memset( m->pagebuf, 0xff, sizeof( m->pagebuf ) );
+}
+
+// Where flash (or the info block, which is programmed the same way) is in our
+// arrays, or 0 if address...address+len isn't all in one of them.
+static uint8_t * MockFlashPtr( mock_ctx_t * m, uint32_t address, uint32_t len )
+{
+	if( address < m->flash_size && address + len <= m->flash_size )
+		return m->flash + address; // Mapped at 0 for execution.
+	if( address >= 0x08000000 && address - 0x08000000 + len <= m->flash_size )
+		return m->flash + address - 0x08000000;
+	if( address >= MOCK_INFO_BASE && address - MOCK_INFO_BASE + len <= MOCK_INFO_SIZE )
+		return m->info + address - MOCK_INFO_BASE;
+	return 0;
+}
+
+static uint8_t * MockMemPtr( mock_ctx_t * m, uint32_t address, uint32_t len )
+{
+	if( address >= m->ram_base && address - m->ram_base + len <= m->ram_size )
+		return m->ram + address - m->ram_base;
+	return MockFlashPtr( m, address, len );
+}
+
+static void MockFlashErase( mock_ctx_t * m, uint32_t address, uint32_t len )
+{
+	address &= ~( len - 1 );
+	uint8_t * p = MockFlashPtr( m, address, len );
+	if( p ) memset( p, 0xff, len );
+	else m->flash_statr |= MFLASH_STATR_WRPRTERR;
+}
+
+// Like real flash, programming can only clear bits.
+static void MockFlashProgram( mock_ctx_t * m, uint32_t address, const uint8_t * data, uint32_t len )
+{
+	uint8_t * p = MockFlashPtr( m, address, len );
+	uint32_t i;
+	if( !p )
+	{
+		m->flash_statr |= MFLASH_STATR_WRPRTERR;
+		return;
+	}
+	for( i = 0; i < len; i++ ) p[i] &= data[i];
+}
+
+static void MockFlashWriteCTLR( mock_ctx_t * m, uint32_t value )
+{
+	uint32_t sector = m->chip->sector_size;
+
+	// Lock bits can only be set from here, the keys clear them.
+	m->flash_ctlr = ( value & ~( MFLASH_CTLR_LOCK | MFLASH_CTLR_FLOCK ) ) |
+		( m->flash_ctlr & ( MFLASH_CTLR_LOCK | MFLASH_CTLR_FLOCK ) ) |
+		( value & ( MFLASH_CTLR_LOCK | MFLASH_CTLR_FLOCK ) );
+
+	if( value & MFLASH_CTLR_BUF_RST )
+		memset( m->pagebuf, 0xff, sizeof( m->pagebuf ) );
+
+	if( ( value & ( MFLASH_CTLR_STRT | MFLASH_CTLR_PGSTART ) ) && ( ( m->flash_ctlr & MFLASH_CTLR_LOCK ) ||
+		( ( value & ( MFLASH_CTLR_PAGE_PG | MFLASH_CTLR_PAGE_ER ) ) && ( m->flash_ctlr & MFLASH_CTLR_FLOCK ) ) ) )
+	{
+		m->flash_statr |= MFLASH_STATR_WRPRTERR;
+		return;
+	}
+
+	if( value & ( MFLASH_CTLR_STRT | MFLASH_CTLR_PGSTART ) )
+		m->flash_busy_until = OGGetAbsoluteTime() + m->flash_busy_us / 1000000.0;
+
+	if( value & MFLASH_CTLR_PGSTART )
+	{
+		MockFlashProgram( m, m->pagebuf_addr, m->pagebuf, sector );
+		memset( m->pagebuf, 0xff, sizeof( m->pagebuf ) );
+		m->flash_statr |= MFLASH_STATR_EOP;
+	}
+	if( !( value & MFLASH_CTLR_STRT ) ) return;
+
+	if( value & MFLASH_CTLR_PAGE_ER )
+		MockFlashErase( m, m->flash_addr, sector );
+	else if( value & MFLASH_CTLR_PER )
+		MockFlashErase( m, m->flash_addr, ( m->chip->family_id == CHIP_CH32V003 ) ? 1024 : 4096 );
+	else if( value & MFLASH_CTLR_MER )
+		memset( m->flash, 0xff, m->flash_size );
+	else if( value & MFLASH_CTLR_OPTER )
+		memset( m->info + ( m->chip->options_offset - MOCK_INFO_BASE ), 0xff, m->chip->options_size );
+	else if( value & MFLASH_CTLR_PAGE_PG )
+	{
+		MockFlashProgram( m, m->flash_addr & ~( sector - 1 ), m->pagebuf, sector );
+		memset( m->pagebuf, 0xff, sizeof( m->pagebuf ) );
+	}
+	m->flash_ctlr &= ~MFLASH_CTLR_STRT;
+	m->flash_statr |= MFLASH_STATR_EOP;
+}
+
+static void MockFlashKey( mock_ctx_t * m, int which, uint32_t value )
+{
+	if( value == MFLASH_KEY1 ) { m->key_stage[which] = 1; return; }
+	if( value != MFLASH_KEY2 || m->key_stage[which] != 1 ) { m->key_stage[which] = 0; return; }
+	m->key_stage[which] = 0;
+	switch( which )
+	{
+	case 0: m->flash_ctlr &= ~MFLASH_CTLR_LOCK; break;
+	case 1: m->flash_ctlr |= MFLASH_CTLR_OPTWRE; break;
+	case 2: m->flash_ctlr &= ~MFLASH_CTLR_FLOCK; break;
+	case 3: m->flash_statr &= ~MFLASH_STATR_BOOTLOCK; break;
+	}
+}
+
+static uint32_t MockCRCWord( uint32_t crc, uint32_t word )
+{
+	int b;
+	crc ^= word;
+	for( b = 0; b < 32; b++ )
+		crc = ( crc & 0x80000000 ) ? ( crc << 1 ) ^ 0x04C11DB7 : ( crc << 1 );
+	return crc;
+}
+
+// Does address hit any armed trigger of the given kind (MTRIG_EXECUTE/STORE/LOAD)?
+// Only while running, the debugger's own PROGBUF accesses don't count.
+static int MockTriggerMatch( mock_ctx_t * m, uint32_t address, uint32_t kind )
+{
+	int i, hit = 0;
+	if( m->halted ) return 0;
+	for( i = 0; i < MOCK_TRIGGERS; i++ )
+	{
+		uint32_t t = m->tdata1[i];
+		if( !( t & kind ) || !( t & MTRIG_M ) || !( t & MTRIG_ACTION_DEBUG ) ) continue;
+		uint32_t mask = 0xffffffff;
+		if( ( t & MTRIG_MATCH_MASK ) == MTRIG_MATCH_NAPOT )
+			mask = ~( m->tdata2[i] ^ ( m->tdata2[i] + 1 ) );
+		if( ( address & mask ) != ( m->tdata2[i] & mask ) ) continue;
+		m->tdata1[i] |= MTRIG_HIT;
+		hit = 1;
+	}
+	return hit;
+}
+
+static uint32_t MockReadCSR( mock_ctx_t * m, uint32_t csrno )
+{
+	switch( csrno )
+	{
+	case 0x7a0: return m->tselect;
+	case 0x7a1: return m->tdata1[m->tselect];
+	case 0x7a2: return m->tdata2[m->tselect];
+	case 0x7b1: return m->pc;
+	default: return m->csr[csrno & 0xfff];
+	}
+}
+
+static void MockWriteCSR( mock_ctx_t * m, uint32_t csrno, uint32_t value )
+{
+	switch( csrno )
+	{
+	case 0x7a0: m->tselect = ( value < MOCK_TRIGGERS ) ? value : MOCK_TRIGGERS - 1; break;
+	case 0x7a1:
+		// Always an mcontrol, with only equal and NAPOT matching.
+		value &= MTRIG_DMODE | MTRIG_HIT | MTRIG_ACTION_DEBUG | MTRIG_MATCH_MASK | MTRIG_M | MTRIG_U | MTRIG_EXECUTE | MTRIG_STORE | MTRIG_LOAD;
+		if( ( value & MTRIG_MATCH_MASK ) > MTRIG_MATCH_NAPOT ) value &= ~MTRIG_MATCH_MASK;
+		m->tdata1[m->tselect] = MTRIG_TYPE_MCONTROL | value;
+		break;
+	case 0x7a2: m->tdata2[m->tselect] = value; break;
+	case 0x7b1: m->pc = value; break;
+	default: m->csr[csrno & 0xfff] = value; break;
+	}
+}
+
+// Loads and stores from the core.  Return 0 if ok, nonzero for an access fault.
+static int MockLoad( mock_ctx_t * m, uint32_t address, int size, uint32_t * value )
+{
+	if( MockTriggerMatch( m, address, MTRIG_LOAD ) ) m->trigger_fired = 1;
+
+	uint8_t * p = MockMemPtr( m, address, size );
+	if( p )
+	{
+		uint32_t v = 0;
+		memcpy( &v, p, size );
+		*value = v;
+		return 0;
+	}
+
+	uint32_t word = 0;
+	uint32_t aligned = address & ~3;
+	if( aligned == MOCK_DATA0_ADDR ) word = m->data[0];
+	else if( aligned == MOCK_DATA0_ADDR + 4 ) word = m->data[1];
+	else if( ( aligned & 0xffffff00 ) == MOCK_FLASH_REGS )
+	{
+		switch( aligned & 0xff )
+		{
+		case 0x0c: word = m->flash_statr | ( OGGetAbsoluteTime() < m->flash_busy_until ); break; // BSY
+		case 0x10: word = m->flash_ctlr; break;
+		case 0x14: word = m->flash_addr; break;
+		case 0x1c: word = 0; break;          // OBR: Not read protected.
+		case 0x20: word = 0xffffffff; break; // WPR: Not write protected.
+		}
+	}
+	else if( aligned == MOCK_CRC_REGS ) word = m->crc;
+	else if( ( address >= 0x40000000 && address < 0x60000000 ) || address >= 0xe0000000 )
+		word = 0; // Other peripherals, PFIC, SysTick.  They just read as 0.
+	else
+		return 1;
+
+	word >>= ( address & 3 ) * 8;
+	if( size == 1 ) word &= 0xff;
+	else if( size == 2 ) word &= 0xffff;
+	*value = word;
+	return 0;
+}
+
+static int MockStore( mock_ctx_t * m, uint32_t address, int size, uint32_t value )
+{
+	if( MockTriggerMatch( m, address, MTRIG_STORE ) ) m->trigger_fired = 1;
+	if( m->trigger_fired ) return 0; // The instruction doesn't happen, we stop before it.
+
+	if( address >= m->ram_base && address - m->ram_base + size <= m->ram_size )
+	{
+		memcpy( m->ram + address - m->ram_base, &value, size );
+		return 0;
+	}
+
+	if( MockFlashPtr( m, address, size ) )
+	{
+		uint32_t sector = m->chip->sector_size;
+		if( m->flash_ctlr & MFLASH_CTLR_PAGE_PG )
+		{
+			// Fast programming goes into the page buffer, gets written on STRT.
+			if( m->flash_ctlr & MFLASH_CTLR_FLOCK )
+			{
+				m->flash_statr |= MFLASH_STATR_WRPRTERR;
+				return 0;
+			}
+			memcpy( m->pagebuf + ( address & ( sector - 1 ) ), &value, size );
+			m->pagebuf_addr = address & ~( sector - 1 );
+		}
+		else if( ( m->flash_ctlr & ( MFLASH_CTLR_PG | MFLASH_CTLR_OPTPG ) ) && !( m->flash_ctlr & MFLASH_CTLR_LOCK ) )
+			MockFlashProgram( m, address, (uint8_t*)&value, size );
+		else
+			m->flash_statr |= MFLASH_STATR_WRPRTERR;
+		return 0;
+	}
+
+	uint32_t aligned = address & ~3;
+	if( aligned == MOCK_DATA0_ADDR ) { m->data[0] = value; return 0; }
+	if( aligned == MOCK_DATA0_ADDR + 4 ) { m->data[1] = value; return 0; }
+	if( ( aligned & 0xffffff00 ) == MOCK_FLASH_REGS )
+	{
+		switch( aligned & 0xff )
+		{
+		case 0x04: MockFlashKey( m, 0, value ); break;
+		case 0x08: MockFlashKey( m, 1, value ); break;
+		case 0x0c: // STATR: Status bits are write-1-to-clear, BOOT_MODE is writable once unlocked.
+			m->flash_statr &= ~( value & ( MFLASH_STATR_EOP | MFLASH_STATR_WRPRTERR ) );
+			if( !( m->flash_statr & MFLASH_STATR_BOOTLOCK ) )
+				m->flash_statr = ( m->flash_statr & ~( 1<<14 ) ) | ( value & ( 1<<14 ) );
+			break;
+		case 0x10: MockFlashWriteCTLR( m, value ); break;
+		case 0x14: m->flash_addr = value; break;
+		case 0x24: MockFlashKey( m, 2, value ); break;
+		case 0x28: MockFlashKey( m, 3, value ); break;
+		}
+		return 0;
+	}
+	if( aligned == MOCK_CRC_REGS ) { m->crc = MockCRCWord( m->crc, value ); return 0; }
+	if( aligned == MOCK_CRC_REGS + 8 ) { if( value & 1 ) m->crc = 0xffffffff; return 0; }
+	if( ( address >= 0x40000000 && address < 0x60000000 ) || address >= 0xe0000000 )
+		return 0;
+	return 1;
+}
+
+static int MockFetch16( mock_ctx_t * m, uint32_t pc, uint32_t * parcel )
+{
+	if( pc >= MOCK_PROGBUF_ADDR && pc < MOCK_PROGBUF_ADDR + sizeof( m->progbuf ) )
+	{
+		*parcel = ( m->progbuf[( pc - MOCK_PROGBUF_ADDR ) / 4] >> ( ( pc & 2 ) * 8 ) ) & 0xffff;
+		return 0;
+	}
+	uint8_t * p = MockMemPtr( m, pc, 2 );
+	if( !p ) return 1;
+	*parcel = p[0] | ( p[1] << 8 );
+	return 0;
+}
+
+#define MOCK_STEP_OK        0
+#define MOCK_STEP_EBREAK    1
+#define MOCK_STEP_EXCEPTION 2
+
+#define MOCK_CAUSE_FETCH   1
+#define MOCK_CAUSE_ILLEGAL 2
+#define MOCK_CAUSE_BREAK   3
+#define MOCK_CAUSE_LOAD    5
+#define MOCK_CAUSE_STORE   7
+#define MOCK_CAUSE_ECALL   11
+
+static inline int32_t MockSext( uint32_t v, int bits )
+{
+	return (int32_t)( v << ( 32 - bits ) ) >> ( 32 - bits );
+}
+
+// Executes one instruction at *pc.  On an exception, *pc is left at the
+// instruction and *cause / *tval say why.
+static int MockStep( mock_ctx_t * m, uint32_t * pc, uint32_t * cause, uint32_t * tval )
+{
+	uint32_t * x = m->x;
+	uint32_t lo, hi, inst;
+	uint32_t next;
+	int rd = 0;
+	uint32_t result = 0;
+	int write_rd = 0;
+
+	if( MockFetch16( m, *pc, &lo ) ) { *cause = MOCK_CAUSE_FETCH; *tval = *pc; return MOCK_STEP_EXCEPTION; }
+
+	if( ( lo & 3 ) != 3 )
+	{
+		// Compressed.
+		uint32_t i = lo;
+		int rdp = 8 + ( ( i >> 2 ) & 7 );
+		int rs1p = 8 + ( ( i >> 7 ) & 7 );
+		int r = ( i >> 7 ) & 31;
+		int rs2 = ( i >> 2 ) & 31;
+		int32_t imm6 = MockSext( ( ( i >> 7 ) & 0x20 ) | ( ( i >> 2 ) & 0x1f ), 6 );
+		next = *pc + 2;
+
+		switch( ( ( i >> 13 ) << 2 ) | ( i & 3 ) )
+		{
+		case 0x00: // c.addi4spn
+		{
+			uint32_t nzuimm = ( ( i >> 7 ) & 0x30 ) | ( ( i >> 1 ) & 0x3c0 ) | ( ( i >> 4 ) & 4 ) | ( ( i >> 2 ) & 8 );
+			if( !nzuimm ) goto illegal;
+			rd = rdp; result = x[2] + nzuimm; write_rd = 1;
+			break;
+		}
+		case 0x08: // c.lw
+		case 0x18: // c.sw
+		{
+			uint32_t off = ( ( i >> 7 ) & 0x38 ) | ( ( i >> 4 ) & 4 ) | ( ( i << 1 ) & 0x40 );
+			uint32_t addr = x[rs1p] + off;
+			if( i & 0x8000 )
+			{
+				if( MockStore( m, addr, 4, x[rdp] ) ) { *cause = MOCK_CAUSE_STORE; *tval = addr; return MOCK_STEP_EXCEPTION; }
+			}
+			else
+			{
+				if( MockLoad( m, addr, 4, &result ) ) { *cause = MOCK_CAUSE_LOAD; *tval = addr; return MOCK_STEP_EXCEPTION; }
+				rd = rdp; write_rd = 1;
+			}
+			break;
+		}
+		case 0x01: // c.addi
+			rd = r; result = x[r] + imm6; write_rd = 1;
+			break;
+		case 0x05: // c.jal
+		case 0x15: // c.j
+		{
+			int32_t off = MockSext( ( ( i >> 1 ) & 0x800 ) | ( ( i << 2 ) & 0x400 ) | ( ( i >> 1 ) & 0x300 ) | ( ( i << 1 ) & 0x80 ) |
+				( ( i >> 1 ) & 0x40 ) | ( ( i << 3 ) & 0x20 ) | ( ( i >> 7 ) & 0x10 ) | ( ( i >> 2 ) & 0xe ), 12 );
+			if( !( i & 0x8000 ) ) { rd = 1; result = next; write_rd = 1; }
+			next = *pc + off;
+			break;
+		}
+		case 0x09: // c.li
+			rd = r; result = imm6; write_rd = 1;
+			break;
+		case 0x0d: // c.addi16sp / c.lui
+			if( r == 2 )
+			{
+				int32_t imm = MockSext( ( ( i >> 3 ) & 0x200 ) | ( ( i >> 2 ) & 0x10 ) | ( ( i << 1 ) & 0x40 ) | ( ( i << 4 ) & 0x180 ) | ( ( i << 3 ) & 0x20 ), 10 );
+				rd = 2; result = x[2] + imm;
+			}
+			else
+			{
+				rd = r; result = MockSext( ( ( i << 5 ) & 0x20000 ) | ( ( i << 10 ) & 0x1f000 ), 18 );
+			}
+			write_rd = 1;
+			break;
+		case 0x11: // Misc ALU
+		{
+			uint32_t shamt = ( ( i >> 7 ) & 0x20 ) | ( ( i >> 2 ) & 0x1f );
+			rd = rs1p; write_rd = 1;
+			switch( ( i >> 10 ) & 3 )
+			{
+			case 0: result = x[rd] >> shamt; break;
+			case 1: result = (int32_t)x[rd] >> shamt; break;
+			case 2: result = x[rd] & imm6; break;
+			case 3:
+				if( i & 0x1000 ) goto illegal;
+				switch( ( i >> 5 ) & 3 )
+				{
+				case 0: result = x[rd] - x[rdp]; break;
+				case 1: result = x[rd] ^ x[rdp]; break;
+				case 2: result = x[rd] | x[rdp]; break;
+				case 3: result = x[rd] & x[rdp]; break;
+				}
+				break;
+			}
+			break;
+		}
+		case 0x19: // c.beqz
+		case 0x1d: // c.bnez
+		{
+			int32_t off = MockSext( ( ( i >> 4 ) & 0x100 ) | ( ( i << 1 ) & 0xc0 ) | ( ( i << 3 ) & 0x20 ) | ( ( i >> 7 ) & 0x18 ) | ( ( i >> 2 ) & 6 ), 9 );
+			if( ( x[rs1p] == 0 ) == !( i & 0x2000 ) ) next = *pc + off;
+			break;
+		}
+		case 0x02: // c.slli
+			rd = r; result = x[r] << ( ( ( i >> 7 ) & 0x20 ) | rs2 ); write_rd = 1;
+			break;
+		case 0x0a: // c.lwsp
+		{
+			uint32_t addr = x[2] + ( ( ( i >> 7 ) & 0x20 ) | ( ( i >> 2 ) & 0x1c ) | ( ( i << 4 ) & 0xc0 ) );
+			if( MockLoad( m, addr, 4, &result ) ) { *cause = MOCK_CAUSE_LOAD; *tval = addr; return MOCK_STEP_EXCEPTION; }
+			rd = r; write_rd = 1;
+			break;
+		}
+		case 0x12:
+			if( !( i & 0x1000 ) )
+			{
+				if( rs2 ) { rd = r; result = x[rs2]; write_rd = 1; } // c.mv
+				else { if( !r ) goto illegal; next = x[r] & ~1; } // c.jr
+			}
+			else
+			{
+				if( !rs2 && !r ) return MOCK_STEP_EBREAK; // c.ebreak
+				if( rs2 ) { rd = r; result = x[r] + x[rs2]; write_rd = 1; } // c.add
+				else { uint32_t t = x[r] & ~1; rd = 1; result = next; write_rd = 1; next = t; } // c.jalr
+			}
+			break;
+		case 0x1a: // c.swsp
+		{
+			uint32_t addr = x[2] + ( ( ( i >> 7 ) & 0x3c ) | ( ( i >> 1 ) & 0xc0 ) );
+			if( MockStore( m, addr, 4, x[rs2] ) ) { *cause = MOCK_CAUSE_STORE; *tval = addr; return MOCK_STEP_EXCEPTION; }
+			break;
+		}
+		default:
+			goto illegal;
+		}
+	}
+	else
+	{
+		if( MockFetch16( m, *pc + 2, &hi ) ) { *cause = MOCK_CAUSE_FETCH; *tval = *pc + 2; return MOCK_STEP_EXCEPTION; }
+		inst = lo | ( hi << 16 );
+		next = *pc + 4;
+		rd = ( inst >> 7 ) & 31;
+		int rs1 = ( inst >> 15 ) & 31;
+		int rs2 = ( inst >> 20 ) & 31;
+		int f3 = ( inst >> 12 ) & 7;
+		int32_t immi = (int32_t)inst >> 20;
+		uint32_t a = x[rs1], b = x[rs2];
+
+		switch( inst & 0x7f )
+		{
+		case 0x37: result = inst & 0xfffff000; write_rd = 1; break;         // lui
+		case 0x17: result = *pc + ( inst & 0xfffff000 ); write_rd = 1; break; // auipc
+		case 0x6f: // jal
+			result = next; write_rd = 1;
+			next = *pc + ( ( (int32_t)inst >> 31 << 20 ) | ( inst & 0xff000 ) | ( ( inst >> 9 ) & 0x800 ) | ( ( inst >> 20 ) & 0x7fe ) );
+			break;
+		case 0x67: // jalr
+			result = next; write_rd = 1;
+			next = ( a + immi ) & ~1;
+			break;
+		case 0x63: // Branches
+		{
+			int32_t off = ( (int32_t)inst >> 31 << 12 ) | ( ( inst << 4 ) & 0x800 ) | ( ( inst >> 20 ) & 0x7e0 ) | ( ( inst >> 7 ) & 0x1e );
+			int take;
+			switch( f3 )
+			{
+			case 0: take = a == b; break;
+			case 1: take = a != b; break;
+			case 4: take = (int32_t)a < (int32_t)b; break;
+			case 5: take = (int32_t)a >= (int32_t)b; break;
+			case 6: take = a < b; break;
+			case 7: take = a >= b; break;
+			default: goto illegal;
+			}
+			if( take ) next = *pc + off;
+			break;
+		}
+		case 0x03: // Loads
+		{
+			uint32_t addr = a + immi;
+			int size = 1 << ( f3 & 3 );
+			if( f3 == 3 || f3 > 5 ) goto illegal;
+			if( MockLoad( m, addr, size, &result ) ) { *cause = MOCK_CAUSE_LOAD; *tval = addr; return MOCK_STEP_EXCEPTION; }
+			if( f3 == 0 ) result = MockSext( result, 8 );
+			else if( f3 == 1 ) result = MockSext( result, 16 );
+			write_rd = 1;
+			break;
+		}
+		case 0x23: // Stores
+		{
+			uint32_t addr = a + ( ( (int32_t)inst >> 25 << 5 ) | ( ( inst >> 7 ) & 0x1f ) );
+			if( f3 > 2 ) goto illegal;
+			if( MockStore( m, addr, 1 << f3, b ) ) { *cause = MOCK_CAUSE_STORE; *tval = addr; return MOCK_STEP_EXCEPTION; }
+			break;
+		}
+		case 0x13: // OP-IMM
+		case 0x33: // OP
+		{
+			int is_imm = ( inst & 0x7f ) == 0x13;
+			uint32_t f7 = inst >> 25;
+			uint32_t op2 = is_imm ? (uint32_t)immi : b;
+			write_rd = 1;
+			if( !is_imm && f7 == 1 )
+			{
+				// M extension
+				switch( f3 )
+				{
+				case 0: result = a * b; break;
+				case 1: result = ( (int64_t)(int32_t)a * (int64_t)(int32_t)b ) >> 32; break;
+				case 2: result = ( (int64_t)(int32_t)a * (uint64_t)b ) >> 32; break;
+				case 3: result = ( (uint64_t)a * (uint64_t)b ) >> 32; break;
+				case 4: result = !b ? 0xffffffff : ( a == 0x80000000 && b == 0xffffffff ) ? a : (uint32_t)( (int32_t)a / (int32_t)b ); break;
+				case 5: result = !b ? 0xffffffff : a / b; break;
+				case 6: result = !b ? a : ( a == 0x80000000 && b == 0xffffffff ) ? 0 : (uint32_t)( (int32_t)a % (int32_t)b ); break;
+				case 7: result = !b ? a : a % b; break;
+				}
+				break;
+			}
+			switch( f3 )
+			{
+			case 0: result = ( !is_imm && f7 == 0x20 ) ? a - b : a + op2; break;
+			case 1: result = a << ( op2 & 31 ); break;
+			case 2: result = (int32_t)a < (int32_t)op2; break;
+			case 3: result = a < op2; break;
+			case 4: result = a ^ op2; break;
+			case 5: result = ( f7 & 0x20 ) ? (uint32_t)( (int32_t)a >> ( op2 & 31 ) ) : a >> ( op2 & 31 ); break;
+			case 6: result = a | op2; break;
+			case 7: result = a & op2; break;
+			}
+			break;
+		}
+		case 0x0f: break; // fence, fence.i
+		case 0x73: // SYSTEM
+		{
+			uint32_t csrno = inst >> 20;
+			if( f3 == 0 )
+			{
+				if( inst == 0x00100073 ) return MOCK_STEP_EBREAK;
+				if( inst == 0x00000073 ) { *cause = MOCK_CAUSE_ECALL; *tval = 0; return MOCK_STEP_EXCEPTION; }
+				if( inst == 0x30200073 ) // mret
+				{
+					uint32_t ms = m->csr[0x300];
+					m->csr[0x300] = ( ms & ~0x8 ) | ( ( ms >> 4 ) & 0x8 ) | 0x80; // MIE = MPIE, MPIE = 1
+					next = m->csr[0x341];
+					break;
+				}
+				if( inst == 0x10500073 ) break; // wfi, nothing to wait for.
+				goto illegal;
+			}
+			if( f3 == 4 ) goto illegal;
+			uint32_t src = ( f3 & 4 ) ? (uint32_t)rs1 : a;
+			uint32_t old = MockReadCSR( m, csrno );
+			uint32_t nv = old;
+			switch( f3 & 3 )
+			{
+			case 1: nv = src; break;
+			case 2: nv = old | src; break;
+			case 3: nv = old & ~src; break;
+			}
+			if( ( f3 & 3 ) == 1 || rs1 )
+				MockWriteCSR( m, csrno, nv );
+			result = old; write_rd = 1;
+			break;
+		}
+		default:
+			goto illegal;
+		}
+	}
+
+	if( write_rd && rd )
+	{
+		if( rd >= m->num_gprs ) goto illegal;
+		x[rd] = result;
+	}
+	*pc = next;
+	return MOCK_STEP_OK;
+illegal:
+	*cause = MOCK_CAUSE_ILLEGAL;
+	*tval = lo;
+	return MOCK_STEP_EXCEPTION;
+}
+
+static void MockEnterDebug( mock_ctx_t * m, int cause )
+{
+	m->halted = 1;
+	m->csr[0x7b0] = ( m->csr[0x7b0] & ~0x1c0 ) | ( cause << 6 );
+}
+
+// Let a running core go for up to count instructions.
+static void MockRunCore( mock_ctx_t * m, int count )
+{
+	uint32_t cause, tval;
+	uint32_t saved_x[32];
+	while( !m->halted && count-- > 0 )
+	{
+		if( MockTriggerMatch( m, m->pc, MTRIG_EXECUTE ) )
+		{
+			MockEnterDebug( m, 2 );
+			return;
+		}
+		uint32_t pc = m->pc;
+		memcpy( saved_x, m->x, sizeof( saved_x ) );
+		m->trigger_fired = 0;
+		int r = MockStep( m, &m->pc, &cause, &tval );
+		if( m->trigger_fired )
+		{
+			// Load/store triggers go off before the instruction, so undo it.
+			memcpy( m->x, saved_x, sizeof( saved_x ) );
+			m->pc = pc;
+			m->trigger_fired = 0;
+			MockEnterDebug( m, 2 );
+			return;
+		}
+		if( r == MOCK_STEP_EBREAK )
+		{
+			if( m->csr[0x7b0] & 0x8000 ) // ebreakm
+			{
+				MockEnterDebug( m, 1 );
+				return;
+			}
+			cause = MOCK_CAUSE_BREAK;
+			tval = m->pc;
+			r = MOCK_STEP_EXCEPTION;
+		}
+		if( r == MOCK_STEP_EXCEPTION )
+		{
+			uint32_t ms = m->csr[0x300];
+			m->csr[0x341] = m->pc;
+			m->csr[0x342] = cause;
+			m->csr[0x343] = tval;
+			m->csr[0x300] = ( ms & ~0x88 ) | ( ( ms & 0x8 ) << 4 ); // MPIE = MIE, MIE = 0
+			m->pc = m->csr[0x305] & ~3;
+		}
+		if( m->csr[0x7b0] & 4 ) // step
+		{
+			MockEnterDebug( m, 4 );
+			return;
+		}
+	}
+}
+
+static void MockExecuteCommand( mock_ctx_t * m )
+{
+	uint32_t cmd = m->command;
+	uint32_t regno = cmd & 0xffff;
+
+	if( m->cmderr ) return; // Nothing runs until cmderr is cleared.
+	if( ( cmd >> 24 ) != 0 ) { m->cmderr = 2; return; }
+	if( !m->halted ) { m->cmderr = 4; return; }
+
+	if( cmd & ( 1<<17 ) ) // transfer
+	{
+		if( ( ( cmd >> 20 ) & 7 ) != 2 ) { m->cmderr = 2; return; }
+		if( ( cmd & ( 1<<19 ) ) && m->no_postincrement ) { m->cmderr = 2; return; }
+		if( regno < 0x1000 )
+		{
+			if( cmd & ( 1<<16 ) ) MockWriteCSR( m, regno, m->data[0] );
+			else m->data[0] = MockReadCSR( m, regno );
+		}
+		else if( regno < 0x1000 + (uint32_t)m->num_gprs )
+		{
+			uint32_t * reg = &m->x[regno - 0x1000];
+			if( cmd & ( 1<<16 ) )
+			{
+				if( reg != &m->x[0] ) *reg = m->data[0];
+			}
+			else m->data[0] = *reg;
+		}
+		else { m->cmderr = 3; return; }
+		if( cmd & ( 1<<19 ) ) // aarpostincrement
+			m->command = ( cmd & 0xffff0000 ) | ( ( regno + 1 ) & 0xffff );
+	}
+
+	if( cmd & ( 1<<18 ) ) // postexec
+	{
+		uint32_t pc = MOCK_PROGBUF_ADDR;
+		uint32_t cause, tval;
+		int n;
+		for( n = 0; n < MOCK_PROGBUF_LIMIT; n++ )
+		{
+			int r = MockStep( m, &pc, &cause, &tval );
+			if( r == MOCK_STEP_EBREAK ) return;
+			if( r == MOCK_STEP_EXCEPTION )
+			{
+				m->cmderr = 3;
+				return;
+			}
+		}
+		fprintf( stderr, "Mock: PROGBUF never got to an ebreak\n" );
+		m->cmderr = 3;
+	}
+}
+
+static void MockWriteDMControl( mock_ctx_t * m, uint32_t value )
+{
+	m->dmcontrol = value & 0x3;
+	if( !( value & 1 ) ) return; // dmactive
+
+	if( value & 2 ) // ndmreset
+	{
+		MockResetCore( m );
+		m->halted = 0;
+		m->crc = 0xffffffff;
+	}
+	if( value & ( 1<<31 ) ) // haltreq
+	{
+		if( !m->halted ) MockEnterDebug( m, 3 );
+	}
+	else if( value & ( 1<<30 ) ) // resumereq
+	{
+		if( m->halted )
+		{
+			m->halted = 0;
+			m->resumeack = 1;
+			if( m->csr[0x7b0] & 4 ) MockRunCore( m, 1 ); // Single step
+		}
+	}
+}
+
+static int MockAccess( mock_ctx_t * m, uint8_t reg, int is_read, uint32_t value, uint32_t * result )
+{
+	if( !m->halted ) MockRunCore( m, MOCK_INSNS_PER_OP );
+
+	if( !is_read )
+	{
+		switch( reg )
+		{
+		case DMDATA0:
+		case DMDATA1:
+			m->data[reg - DMDATA0] = value;
+			if( m->abstractauto & ( 1 << ( reg - DMDATA0 ) ) ) MockExecuteCommand( m );
+			break;
+		case DMCONTROL: MockWriteDMControl( m, value ); break;
+		case DMABSTRACTCS: m->cmderr &= ~( ( value >> 8 ) & 7 ); break;
+		case DMCOMMAND: m->command = value; MockExecuteCommand( m ); break;
+		case DMABSTRACTAUTO: m->abstractauto = value & 0x00ff0003; break;
+		case DMCFGR: case DMSHDWCFGR: m->cfgr = value; break;
+		default:
+			if( reg >= DMPROGBUF0 && reg <= DMPROGBUF7 )
+			{
+				m->progbuf[reg - DMPROGBUF0] = value;
+				if( m->abstractauto & ( 1 << ( reg - DMPROGBUF0 + 16 ) ) ) MockExecuteCommand( m );
+			}
+			break;
+		}
+		return 0;
+	}
+
+	uint32_t v = 0;
+	switch( reg )
+	{
+	case DMDATA0:
+	case DMDATA1:
+		// The value read is from before autoexec runs the command again.
+		v = m->data[reg - DMDATA0];
+		if( m->abstractauto & ( 1 << ( reg - DMDATA0 ) ) ) MockExecuteCommand( m );
+		break;
+	case DMCONTROL: v = m->dmcontrol; break;
+	case DMSTATUS:
+		v = 0x00000082 | ( m->halted ? 0x300 : 0xc00 ) | ( m->resumeack ? 0x30000 : 0 );
+		break;
+	case DMHARTINFO: v = MOCK_HARTINFO; break;
+	case DMABSTRACTCS: v = ( 8 << 24 ) | ( m->cmderr << 8 ) | 2; break; // 8 PROGBUF words, 2 DATA words, never busy.
+	case DMCOMMAND: v = m->command; break;
+	case DMABSTRACTAUTO: v = m->abstractauto; break;
+	case DMHALTSUM0: v = m->halted; break;
+	case DMCFGR: case DMSHDWCFGR: v = m->cfgr; break;
+	case DMCHIPID: v = m->chipid; break;
+	default:
+		if( reg >= DMPROGBUF0 && reg <= DMPROGBUF7 ) v = m->progbuf[reg - DMPROGBUF0];
+		break;
+	}
+	*result = v;
+	return 0;
+}
+
+// Every round trip to the programmer costs this much.
+static void MockRoundTrip( void * dev )
+{
+	mock_ctx_t * m = (mock_ctx_t*)dev;
+	InternalCountRoundTrip( dev );
+	if( m->latency_us <= 0 ) return;
+	if( m->latency_us >= 2000 )
+	{
+		OGUSleep( m->latency_us );
+		return;
+	}
+	// Sleeping is too coarse for USB-like latencies, so spin.
+	double until = OGGetAbsoluteTime() + m->latency_us / 1000000.0;
+	while( OGGetAbsoluteTime() < until );
+}
+
+static int MockWriteReg32( void * dev, uint8_t reg_7_bit, uint32_t command )
+{
+	MockRoundTrip( dev );
+	return MockAccess( (mock_ctx_t*)dev, reg_7_bit, 0, command, 0 );
+}
+
+static int MockReadReg32( void * dev, uint8_t reg_7_bit, uint32_t * commandresp )
+{
+	MockRoundTrip( dev );
+	return MockAccess( (mock_ctx_t*)dev, reg_7_bit, 1, 0, commandresp );
+}
+
+static int MockReadReg32Multi( void * dev, uint8_t reg_7_bit, uint32_t * commandresp, int count )
+{
+	int i;
+	MockRoundTrip( dev );
+	for( i = 0; i < count; i++ )
+		MockAccess( (mock_ctx_t*)dev, reg_7_bit, 1, 0, commandresp + i );
+	return 0;
+}
+
+static int MockExecuteDMIQueue( void * dev, struct DMIOp * ops, int count )
+{
+	int i;
+	MockRoundTrip( dev );
+	for( i = 0; i < count; i++ )
+		MockAccess( (mock_ctx_t*)dev, ops[i].reg_7_bit, ops[i].is_read, ops[i].value, ops[i].result );
+	return 0;
+}
+
+static int MockFlushLLCommands( void * dev )
+{
+	return 0;
+}
+
+static int MockDelayUS( void * dev, int microseconds )
+{
+	mock_ctx_t * m = (mock_ctx_t*)dev;
+	// Only bother really waiting if we're pretending to be a real programmer.
+	if( m->latency_us > 0 ) OGUSleep( microseconds );
+	if( !m->halted ) MockRunCore( m, microseconds * MOCK_MHZ );
+	return 0;
+}
+
+static int MockExit( void * dev )
+{
+	mock_ctx_t * m = (mock_ctx_t*)dev;
+	if( m->flash_file )
+	{
+		FILE * f = fopen( m->flash_file, "wb" );
+		if( !f || fwrite( m->flash, m->flash_size, 1, f ) != 1 )
+			fprintf( stderr, "Mock: Could not save flash to %s\n", m->flash_file );
+		if( f ) fclose( f );
+	}
+	free( m->flash );
+	free( m->ram );
+	free( m->info );
+	free( m );
+	return 0;
+}
+
+void * TryInit_Mock( struct MiniChlinkFunctions * mcf, const init_hints_t * hints )
+{
+	const char * chipname = getenv( "MINICHLINK_MOCK_CHIP" );
+	const char * latency = getenv( "MINICHLINK_MOCK_LATENCY_US" );
+	const char * batch = getenv( "MINICHLINK_MOCK_BATCH" );
+	const struct MockChip * mc = 0;
+	int i;
+
+	if( !chipname || !chipname[0] ) chipname = "CH32V003";
+	for( i = 0; i < (int)( sizeof( mock_chips ) / sizeof( mock_chips[0] ) ); i++ )
+		if( strcasecmp( mock_chips[i].chip->name_str, chipname ) == 0 ) mc = &mock_chips[i];
+	if( !mc )
+	{
+		fprintf( stderr, "Error: The mock programmer doesn't know how to be a %s.  It can be:", chipname );
+		for( i = 0; i < (int)( sizeof( mock_chips ) / sizeof( mock_chips[0] ) ); i++ )
+			fprintf( stderr, " %s", mock_chips[i].chip->name_str );
+		fprintf( stderr, "\n" );
+		return 0;
+	}
+
+	mock_ctx_t * m = calloc( 1, sizeof( mock_ctx_t ) );
+	const struct RiscVChip_s * chip = mc->chip;
+	m->chip = chip;
+	m->chipid = mc->chipid;
+	m->latency_us = latency ? atoi( latency ) : 0;
+	m->flash_file = getenv( "MINICHLINK_MOCK_FLASH" );
+	m->flash_busy_us = getenv( "MINICHLINK_MOCK_FLASH_BUSY_US" ) ? atoi( getenv( "MINICHLINK_MOCK_FLASH_BUSY_US" ) ) : 0;
+	m->no_postincrement = getenv( "MINICHLINK_MOCK_NO_POSTINCREMENT" ) && atoi( getenv( "MINICHLINK_MOCK_NO_POSTINCREMENT" ) );
+	m->num_gprs = ( chip->family_id == CHIP_CH32V003 || chip->family_id == CHIP_CH32V00x || chip->family_id == CHIP_CH641 ) ? 16 : 32;
+	m->flash_size = chip->flash_size;
+	m->ram_base = chip->ram_base;
+	m->ram_size = chip->ram_size;
+	m->flash = malloc( m->flash_size );
+	m->ram = calloc( 1, m->ram_size );
+	m->info = malloc( MOCK_INFO_SIZE );
+	memset( m->flash, 0xff, m->flash_size );
+	memset( m->info, 0xff, MOCK_INFO_SIZE );
+
+	if( m->flash_file )
+	{
+		FILE * f = fopen( m->flash_file, "rb" );
+		if( f )
+		{
+			if( fread( m->flash, m->flash_size, 1, f ) != 1 )
+				fprintf( stderr, "Mock: %s is not a %d byte flash image, starting blank\n", m->flash_file, m->flash_size );
+			fclose( f );
+		}
+	}
+
+	// ESIG: Chip ID (where both old and new parts keep it), flash size, UUID.
+	uint32_t flashkb = m->flash_size / 1024;
+	uint32_t uuid[2] = { 0xc0ffee00 | ( mc->chipid >> 20 ), 0x4d4f434b }; // "MOCK"
+	memcpy( m->info + 0xf7c4, &mc->chipid, 4 );
+	memcpy( m->info + 0xf704, &mc->chipid, 4 );
+	memcpy( m->info + 0xf7e0, &flashkb, 4 );
+	memcpy( m->info + 0xf7e8, uuid, 8 );
+	if( chip->family_id == CHIP_CH32V10x )
+	{
+		uint32_t v103id[2] = { 0xdc78fe34, 0x25000000 };
+		memcpy( m->info + 0xf880, v103id, 8 );
+	}
+	m->info[0xf800] = 0xa5; // RDPR: Not read protected.
+	m->info[0xf801] = 0x5a;
+
+	MockResetCore( m );
+	m->halted = 0;
+	m->crc = 0xffffffff;
+
+	mcf->WriteReg32 = MockWriteReg32;
+	mcf->ReadReg32 = MockReadReg32;
+	mcf->FlushLLCommands = MockFlushLLCommands;
+	mcf->DelayUS = MockDelayUS;
+	mcf->Exit = MockExit;
+	if( batch && atoi( batch ) )
+	{
+		mcf->ReadReg32Multi = MockReadReg32Multi;
+		mcf->ExecuteDMIQueue = MockExecuteDMIQueue;
+	}
+
+	fprintf( stderr, "Mock programmer: %s, %d us per round trip%s\n", chip->name_str, m->latency_us,
+		mcf->ExecuteDMIQueue ? ", batched" : "" );
+	return m;
+}
@@ -631,7 +631,7 @@ int ISPCH5xxEnableDebug( void * d, uint8_t disable )
 	return 0;
 }
 
-void * TryInit_WCHISP() {
+void * TryInit_WCHISP(struct MiniChlinkFunctions * mcf) {
 	libusb_device_handle * wch_isp_devh;
 	wch_isp_devh = isp_base_setup(0);
 	if( !wch_isp_devh ) return 0;
@@ -641,18 +641,18 @@ void * TryInit_WCHISP() {
 	ret->devh = wch_isp_devh;
 	ret->lasthaltmode = 0;
 
-	MCF.WriteReg32 = ISPWriteReg32;
-	MCF.ReadReg32 = ISPReadReg32;
-	MCF.WriteWord = ISPWriteWord;
-
-	MCF.SetupInterface = ISPSetupInterface; // no need
-	MCF.Erase = ISPErase;
-	MCF.WriteBinaryBlob = ISPWriteBinaryBlob;
-	MCF.HaltMode = ISPHaltMode;
-	MCF.PrintChipInfo = ISPPrintChipInfo;
-	MCF.ConfigureNRSTAsGPIO = ISPConfigureNRSTAsGPIO;
-	MCF.ConfigureReadProtection = ISPConfigureReadProtection;
-	MCF.EnableDebug = ISPCH5xxEnableDebug;
+	mcf->WriteReg32 = ISPWriteReg32;
+	mcf->ReadReg32 = ISPReadReg32;
+	mcf->WriteWord = ISPWriteWord;
+
+	mcf->SetupInterface = ISPSetupInterface; // no need
+	mcf->Erase = ISPErase;
+	mcf->WriteBinaryBlob = ISPWriteBinaryBlob;
+	mcf->HaltMode = ISPHaltMode;
+	mcf->PrintChipInfo = ISPPrintChipInfo;
+	mcf->ConfigureNRSTAsGPIO = ISPConfigureNRSTAsGPIO;
+	mcf->ConfigureReadProtection = ISPConfigureReadProtection;
+	mcf->EnableDebug = ISPCH5xxEnableDebug;
 
 	return ret;
 };
@@ -14,12 +14,33 @@
 #define FORCE_EXTERNAL_CHIP_DETECTION 1
 #define USB_SERIAL_MAX 256
 
+// How many DMI commands can be on the wire at once, see LEPipeline().
+#define LE_INFLIGHT_DEFAULT 8
+#define LE_INFLIGHT_MAX 32
+
+// One DMI command and its reply, as a pair of async transfers.
+struct LEAsyncSlot
+{
+	struct libusb_transfer * out;
+	struct libusb_transfer * in;
+	int pending; // How many of out/in haven't called back yet.
+	int failed;
+	uint8_t reg_7_bit;
+	uint8_t is_read;
+	uint32_t * result;
+	uint8_t cmd[9];
+	uint8_t reply[128];
+};
+
 struct LinkEProgrammerStruct
 {
 	void * internal;
 	libusb_device_handle * devh;
 	int lasthaltmode; // For non-003 chips
 	char programmer_serial_number[USB_SERIAL_MAX]; /* "" if unfiltered */
+	libusb_context * ctx;
+	int inflight; // 1 = wait for every reply before sending the next command.
+	struct LEAsyncSlot slots[LE_INFLIGHT_MAX];
 };
 #if !FORCE_EXTERNAL_CHIP_DETECTION
 static int checkChip(enum RiscVChip chip) {
@@ -57,10 +78,11 @@ static int LEWriteBinaryBlob( void * d, uint32_t address_to_write, uint32_t len,
 #endif // !FORCE_EXTERNAL_CHIP_DETECTION
 
 #define WCHTIMEOUT 5000
-#define WCHCHECK(x) if( (status = x) ) { fprintf( stderr, "Bad USB Operation on " __FILE__ ":%d (%d)\n", __LINE__, status ); exit( status ); }
+// Returns the error instead of exiting, so one bad programmer doesn't end a --gang run for all of them.
+#define WCHCHECK(x) if( (status = x) ) { fprintf( stderr, "Bad USB Operation on " __FILE__ ":%d (%d)\n", __LINE__, status ); return status; }
 
-// Send a command to the LinkE debugger
-void wch_link_command( libusb_device_handle * devh, const void * command_v, int commandlen, int * transferred, uint8_t * reply, int replymax )
+// Send a command to the LinkE debugger.  Returns nonzero if it didn't get through.
+int wch_link_command( libusb_device_handle * devh, const void * command_v, int commandlen, int * transferred, uint8_t * reply, int replymax )
 {
 	uint8_t * command = (uint8_t*)command_v;
 	uint8_t buffer[1024];
@@ -83,7 +105,7 @@ void wch_link_command( libusb_device_handle * devh, const void * command_v, int
 //	printf("wch_link_command reply (%d)", *transferred); for(int i = 0; i< *transferred; printf(" %02x",reply[i++])); printf("\n"); 
 
 	if( status ) goto sendfail;
-	return;
+	return 0;
 sendfail:
 	fprintf( stderr, "Error sending WCH command (%s): ", got_to_recv?"on recv":"on send" );
 	int i;
@@ -92,7 +114,8 @@ sendfail:
 		printf( "%02x ", command[i] );
 	}
 	printf( "\n" );
-	exit( status );
+	if( transferred ) *transferred = 0;
+	return status;
 }
 
 static void wch_link_multicommands( libusb_device_handle * devh, int nrcommands, ... )
@@ -131,14 +154,14 @@ static int usb_device_matches_serial( libusb_device *device, const char *want_se
 	return strcmp( buf, want_serial ) == 0;
 }
 
-static inline libusb_device_handle * wch_link_base_setup( int inhibit_startup, const char * want_serial )
+static inline libusb_device_handle * wch_link_base_setup( int inhibit_startup, const char * want_serial, libusb_context ** ctx_out )
 {
 	libusb_context * ctx = 0;
 	int status;
 	status = libusb_init(&ctx);
 	if (status < 0) {
 		fprintf( stderr, "Error: libusb_init_context() returned %d\n", status );
-		exit( status );
+		return 0;
 	}
 	
 	libusb_device **list;
@@ -209,7 +232,7 @@ static inline libusb_device_handle * wch_link_base_setup( int inhibit_startup, c
 			if( status )
 			{
 				fprintf( stderr, "Found programmer in ARM mode, but couldn't open it.\n" );
-				exit( -10 );
+				return 0;
 			}
 
 			// https://github.com/wagiminator/MCU-Flash-Tools/blob/main/rvmode.py
@@ -217,7 +240,8 @@ static inline libusb_device_handle * wch_link_base_setup( int inhibit_startup, c
 			int transferred = 0;
 			libusb_bulk_transfer( devh, 0x02, rbuff, 4, &transferred, 1 );
 			fprintf( stderr, "RISC-V command sent (%d)\n", transferred );
-			exit( -3 );
+			libusb_close( devh );
+			return 0;
 		}
 
 
@@ -230,14 +254,15 @@ static inline libusb_device_handle * wch_link_base_setup( int inhibit_startup, c
 			if( status )
 			{
 				fprintf( stderr, "Found programmer in IAP mode, but couldn't open it.\n" );
-				exit( -10 );
+				return 0;
 			}
 			uint8_t rbuff[4];
 			int transferred = 0;
 			rbuff[0] = 0x83;
 			libusb_bulk_transfer( devh, 0x02, rbuff, 1, &transferred, 1 );
 			fprintf( stderr, "Eject command sent (%d)\n", transferred );
-			exit( -3 );
+			libusb_close( devh );
+			return 0;
 		}
 
 		return 0;
@@ -255,7 +280,14 @@ static inline libusb_device_handle * wch_link_base_setup( int inhibit_startup, c
 		return 0;
 	}
 		
-	WCHCHECK( libusb_claim_interface(devh, 0) );
+	status = libusb_claim_interface( devh, 0 );
+	if( status )
+	{
+		fprintf( stderr, "Error: couldn't claim wch link interface (%d)\n", status );
+		libusb_close( devh );
+		return 0;
+	}
+	if( ctx_out ) *ctx_out = ctx;
 
 	uint8_t rbuff[1024];
 	int transferred;
@@ -304,7 +336,9 @@ static int LEWriteReg32( void * dev, uint8_t reg_7_bit, uint32_t command )
 
 	uint8_t resp[128];
 	int resplen;
-	wch_link_command( devh, req, sizeof(req), &resplen, resp, sizeof(resp) );
+	int r = wch_link_command( devh, req, sizeof(req), &resplen, resp, sizeof(resp) );
+	InternalCountRoundTrip( dev );
+	if( r ) return r;
 	if( resplen != 9 || resp[8] == 0x02 || resp[8] == 0x03 ) //|| resp[3] != reg_7_bit )
 	{
 		LE_HANDLE_REG_ERROR( dev, devh, "write", reg_7_bit, resp, resplen );
@@ -323,7 +357,9 @@ static int LEReadReg32( void * dev, uint8_t reg_7_bit, uint32_t * commandresp )
 		0x81, 0x08, 0x06, reg_7_bit,
 		0, 0, 0, 0,
 		iOP };
-	wch_link_command( devh, req, sizeof( req ), (int*)&transferred, rbuff, sizeof( rbuff ) );
+	int r = wch_link_command( devh, req, sizeof( req ), (int*)&transferred, rbuff, sizeof( rbuff ) );
+	InternalCountRoundTrip( dev );
+	if( r ) return r;
 	*commandresp = ( rbuff[4]<<24 ) | (rbuff[5]<<16) | (rbuff[6]<<8) | (rbuff[7]<<0);
 	if( transferred != 9 || rbuff[8] == 0x02 || rbuff[8] == 0x03 ) //|| rbuff[3] != reg_7_bit )
 	{
@@ -342,6 +378,219 @@ static int LEReadReg32( void * dev, uint8_t reg_7_bit, uint32_t * commandresp )
 	return 0;
 }
 
+// Async engine for DMI ops.  The LinkE answers every DMI command with exactly
+// one reply, in order, so there's no need to wait for each reply before
+// sending the next command.  Up to 'inflight' command/reply transfer pairs
+// are kept submitted, and the replies are picked up oldest first as they
+// land.  That hides the USB round trip (up to a frame per direction) behind
+// the programmer's own work, instead of paying it for every single op.
+//
+// Set MINICHLINK_LINKE_INFLIGHT=1 to go back to one op per round trip.
+
+static void LIBUSB_CALL LEAsyncDone( struct libusb_transfer * transfer )
+{
+	struct LEAsyncSlot * s = (struct LEAsyncSlot*)transfer->user_data;
+	if( transfer->status != LIBUSB_TRANSFER_COMPLETED ) s->failed = transfer->status;
+	s->pending--;
+}
+
+// Returns nonzero if the transfers couldn't be submitted.
+static int LEAsyncSubmit( struct LinkEProgrammerStruct * e, struct LEAsyncSlot * s, uint32_t value )
+{
+	int status;
+	if( !s->out ) s->out = libusb_alloc_transfer( 0 );
+	if( !s->in ) s->in = libusb_alloc_transfer( 0 );
+	if( !s->out || !s->in )
+	{
+		fprintf( stderr, "Error: Could not allocate USB transfers\n" );
+		return -1;
+	}
+
+	s->cmd[0] = 0x81; s->cmd[1] = 0x08; s->cmd[2] = 0x06; s->cmd[3] = s->reg_7_bit;
+	s->cmd[4] = value >> 24; s->cmd[5] = value >> 16; s->cmd[6] = value >> 8; s->cmd[7] = value;
+	s->cmd[8] = s->is_read ? 1 : 2;
+	s->failed = 0;
+	s->pending = 0;
+
+	libusb_fill_bulk_transfer( s->out, e->devh, 0x01, s->cmd, sizeof( s->cmd ), LEAsyncDone, s, WCHTIMEOUT );
+	libusb_fill_bulk_transfer( s->in, e->devh, 0x81, s->reply, sizeof( s->reply ), LEAsyncDone, s, WCHTIMEOUT );
+	WCHCHECK( libusb_submit_transfer( s->out ) );
+	s->pending++;
+	if( ( status = libusb_submit_transfer( s->in ) ) )
+	{
+		// The command is already on its way, so LEAsyncWait still waits for it.
+		fprintf( stderr, "Bad USB Operation on " __FILE__ ":%d (%d)\n", __LINE__, status );
+		s->failed = status;
+		return 0;
+	}
+	s->pending++;
+	return 0;
+}
+
+// Returns nonzero if the command or its reply didn't make it.
+static int LEAsyncWait( void * dev, struct LEAsyncSlot * s )
+{
+	struct LinkEProgrammerStruct * e = (struct LinkEProgrammerStruct*)dev;
+	while( s->pending )
+	{
+		// Both transfers have timeouts, so this can't spin forever.
+		struct timeval tv = { 0, 100000 };
+		int r = libusb_handle_events_timeout_completed( e->ctx, &tv, 0 );
+		if( r && r != LIBUSB_ERROR_INTERRUPTED )
+		{
+			fprintf( stderr, "Error: libusb_handle_events failed (%d)\n", r );
+			return r;
+		}
+	}
+	return s->failed;
+}
+
+// Runs 'count' DMI ops through the pipeline.  If ops is 0, they are all reads
+// of multi_reg, into multi_resp[].  If it has to stop early, it returns
+// nonzero, and the reads that never happened get DMI_READ_FAILED.
+static int LEPipeline( void * dev, struct DMIOp * ops, int count, uint8_t multi_reg, uint32_t * multi_resp )
+{
+	struct LinkEProgrammerStruct * e = (struct LinkEProgrammerStruct*)dev;
+	int depth = e->inflight;
+	int head = 0; // Next op to send
+	int tail = 0; // Next op to get the reply for
+	int window = 0; // Replies before this one were already waited for in the same round trip.
+	int error = 0;
+	int failed = 0; // USB trouble, as opposed to a bad reply.
+	int error_len = 0;
+	int r = 0;
+	int i;
+	struct LEAsyncSlot error_slot = { 0 };
+
+	while( tail < count )
+	{
+		// Once something has gone wrong, don't send anything else, just drain.
+		while( !error && head < count && head - tail < depth )
+		{
+			struct LEAsyncSlot * s = &e->slots[head % depth];
+			uint32_t value = 0;
+			if( ops )
+			{
+				s->reg_7_bit = ops[head].reg_7_bit;
+				s->is_read = ops[head].is_read;
+				s->result = ops[head].result;
+				value = ops[head].value;
+			}
+			else
+			{
+				s->reg_7_bit = multi_reg;
+				s->is_read = 1;
+				s->result = multi_resp + head;
+			}
+			if( LEAsyncSubmit( e, s, value ) )
+			{
+				error = 1;
+				failed = -1;
+				break;
+			}
+			head++;
+		}
+		if( tail == head ) break;
+
+		struct LEAsyncSlot * s = &e->slots[tail % depth];
+		if( tail >= window )
+		{
+			InternalCountRoundTrip( dev );
+			window = head;
+		}
+		tail++;
+		if( LEAsyncWait( dev, s ) )
+		{
+			fprintf( stderr, "Error sending WCH command (%d): ", s->failed );
+			int i;
+			for( i = 0; i < (int)sizeof( s->cmd ); i++ )
+				fprintf( stderr, "%02x ", s->cmd[i] );
+			fprintf( stderr, "\n" );
+			if( !failed ) failed = s->failed;
+			error = 1;
+			if( s->is_read && s->result ) *s->result = DMI_READ_FAILED;
+			continue;
+		}
+
+		uint8_t * reply = s->reply;
+		int len = s->in->actual_length;
+		if( failed || len != 9 || reply[8] == 0x02 || reply[8] == 0x03 )
+		{
+			// Deal with it once nothing else is in flight.
+			if( !error )
+			{
+				error_slot = *s;
+				error_len = len;
+			}
+			error = 1;
+			if( s->is_read && s->result ) *s->result = DMI_READ_FAILED;
+			continue;
+		}
+		if( s->is_read && s->result )
+			*s->result = ( reply[4]<<24 ) | ( reply[5]<<16 ) | ( reply[6]<<8 ) | ( reply[7]<<0 );
+	}
+
+	// Whatever was never sent has no result.
+	for( i = head; i < count; i++ )
+	{
+		if( ops && ops[i].is_read && ops[i].result ) *ops[i].result = DMI_READ_FAILED;
+		else if( !ops ) multi_resp[i] = DMI_READ_FAILED;
+	}
+
+	if( failed ) return failed;
+	if( error )
+	{
+		// Like the synchronous path, a bad write reply on its own is reported but
+		// not fatal.  But if ops were dropped, or a read never got its value,
+		// the caller has to know, even if the programmer just needed initializing.
+		if( error_slot.is_read )
+			r = LE_HANDLE_REG_ERROR( dev, e->devh, "read", error_slot.reg_7_bit, error_slot.reply, error_len );
+		else
+			LE_HANDLE_REG_ERROR( dev, e->devh, "write", error_slot.reg_7_bit, error_slot.reply, error_len );
+		if( !r && ( head < count || error_slot.is_read ) ) r = -1;
+	}
+	return r;
+}
+
+static int LEExecuteDMIQueue( void * dev, struct DMIOp * ops, int count )
+{
+	struct LinkEProgrammerStruct * e = (struct LinkEProgrammerStruct*)dev;
+	int i, r = 0;
+	if( e->inflight > 1 && count > 1 )
+		return LEPipeline( dev, ops, count, 0, 0 );
+
+	for( i = 0; i < count && !r; i++ )
+	{
+		if( ops[i].is_read )
+			r = LEReadReg32( dev, ops[i].reg_7_bit, ops[i].result );
+		else
+			r = LEWriteReg32( dev, ops[i].reg_7_bit, ops[i].value );
+	}
+	return r;
+}
+
+static int LEReadReg32Multi( void * dev, uint8_t reg_7_bit, uint32_t * commandresp, int count )
+{
+	struct LinkEProgrammerStruct * e = (struct LinkEProgrammerStruct*)dev;
+	int i, r = 0;
+	if( e->inflight > 1 && count > 1 )
+		return LEPipeline( dev, 0, count, reg_7_bit, commandresp );
+
+	for( i = 0; i < count && !r; i++ )
+		r = LEReadReg32( dev, reg_7_bit, commandresp + i );
+	return r;
+}
+
+int WCHLinkESetInflight( void * dev, int inflight )
+{
+	struct LinkEProgrammerStruct * e = (struct LinkEProgrammerStruct*)dev;
+	int was = e->inflight;
+	if( inflight < 1 ) inflight = 1;
+	if( inflight > LE_INFLIGHT_MAX ) inflight = LE_INFLIGHT_MAX;
+	e->inflight = inflight;
+	return was;
+}
+
 static int LEFlushLLCommands( void * dev )
 {
 	return 0;
@@ -355,31 +604,31 @@ static int LEResetInterface( void * d )
 	return 0;
 }
 
-static int LESetupInterface( void * d )
+static int LESetupInterface( void * dev )
 {
-	libusb_device_handle * dev = ((struct LinkEProgrammerStruct*)d)->devh;
-	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)d)->internal);
+	libusb_device_handle * devh = ((struct LinkEProgrammerStruct*)dev)->devh;
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
 	uint8_t rbuff[1024];
 	uint32_t transferred = 0;
 	int r = 0;
 
 	if( iss->target_chip != NULL )
 	{
-		wch_link_command( dev, "\x81\x0d\x01\x02", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Ignored, 820d050900300500
+		wch_link_command( devh, "\x81\x0d\x01\x02", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Ignored, 820d050900300500
 		if (transferred == 4 || (rbuff[0] == 0x81 && rbuff[1] == 0x55 && rbuff[2] == 0x01) ) // && rbuff[3] == 0x01 )
 		{
-			MCF.DelayUS( iss, 5000 );
-			wch_link_command( dev, "\x81\x0d\x01\x02", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Ignored, 820d050900300500
+			MCF( dev ).DelayUS( dev, 5000 );
+			wch_link_command( devh, "\x81\x0d\x01\x02", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Ignored, 820d050900300500
 		}
 		char cmd_buf[5] = { 0x81, 0x0c, 0x02, iss->target_chip_type, iss->target_chip->interface_speed };
-		wch_link_command( dev, cmd_buf, 5, 0, 0, 0 ); // Set interface clock to suitable speed
+		wch_link_command( devh, cmd_buf, 5, 0, 0, 0 ); // Set interface clock to suitable speed
 		return 0;
 	}
 
 	//Stop programmer to avoid anything being unresponsive
-	wch_link_command( dev, "\x81\x0d\x01\xff", 4, 0, 0, 0);
+	wch_link_command( devh, "\x81\x0d\x01\xff", 4, 0, 0, 0);
 	// Clears programmer state and returns firmware version
-	wch_link_command( dev, "\x81\x0d\x01\x01", 4, (int*)&transferred, rbuff, 1024 );	// Reply is: "\x82\x0d\x04\x02\x08\x02\x00"
+	wch_link_command( devh, "\x81\x0d\x01\x01", 4, (int*)&transferred, rbuff, 1024 );	// Reply is: "\x82\x0d\x04\x02\x08\x02\x00"
 
 	switch(rbuff[5]) {
 		case 1:
@@ -406,7 +655,7 @@ static int LESetupInterface( void * d )
 	}
 
 	// By default set interface speed to "normal" (4Mhz) and change that after we detect the chip
-	wch_link_command( dev, "\x81\x0c\x02\x01\x02", 5, 0, 0, 0 );
+	wch_link_command( devh, "\x81\x0c\x02\x01\x02", 5, 0, 0, 0 );
 
 	// This puts the processor on hold to allow the debugger to run.
 	int already_tried_reset = 0;
@@ -424,13 +673,13 @@ static int LESetupInterface( void * d )
 			{
 				printf( "Already Connected\n" );
 				// Still need to read in the data so we can select the correct chip.
-				wch_link_command( dev, "\x81\x0d\x01\x02", 4, (int*)&transferred, rbuff, 1024 ); // ?? this seems to work?
+				wch_link_command( devh, "\x81\x0d\x01\x02", 4, (int*)&transferred, rbuff, 1024 ); // ?? this seems to work?
 				break;
 			}
 			is_already_connected = 1;
 		}
 
-		wch_link_command( dev, "\x81\x0d\x01\x02", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Ignored, 820d050900300500
+		wch_link_command( devh, "\x81\x0d\x01\x02", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Ignored, 820d050900300500
 		if (transferred == 4 || (rbuff[0] == 0x81 && rbuff[1] == 0x55 && rbuff[2] == 0x01) ) // && rbuff[3] == 0x01 )
 		{
 			// The following code may try to execute a few times to get the processor to actually reset.
@@ -444,20 +693,20 @@ static int LESetupInterface( void * d )
 				break;
 			}
 
-			wch_link_multicommands( (libusb_device_handle *)dev, 1, 4, "\x81\x0d\x01\x13" ); // Try forcing reset line low.
-			wch_link_command( (libusb_device_handle *)dev, "\x81\x0d\x01\xff", 4, 0, 0, 0); //Exit programming
+			wch_link_multicommands( (libusb_device_handle *)devh, 1, 4, "\x81\x0d\x01\x13" ); // Try forcing reset line low.
+			wch_link_command( (libusb_device_handle *)devh, "\x81\x0d\x01\xff", 4, 0, 0, 0); //Exit programming
 
 			if( already_tried_reset > 3 )
 			{
-				MCF.DelayUS( iss, 5000 );
-				wch_link_command( dev, "\x81\x0d\x01\x03", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Ignored, 820d050900300500
+				MCF( dev ).DelayUS( dev, 5000 );
+				wch_link_command( devh, "\x81\x0d\x01\x03", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Ignored, 820d050900300500
 			}
 			else
 			{
-				MCF.DelayUS( iss, 5000 );
+				MCF( dev ).DelayUS( dev, 5000 );
 			}
 
-			wch_link_multicommands( (libusb_device_handle *)dev, 3, 4, "\x81\x0b\x01\x01", 4, "\x81\x0d\x01\x02", 4, "\x81\x0d\x01\xff" );
+			wch_link_multicommands( (libusb_device_handle *)devh, 3, 4, "\x81\x0b\x01\x01", 4, "\x81\x0d\x01\x02", 4, "\x81\x0d\x01\xff" );
 			already_tried_reset++;
 		}
 		else
@@ -487,35 +736,35 @@ static int LESetupInterface( void * d )
 	iss->sector_size = chip->sector_size;
 
 #else
-	r = MCF.DetermineChipType( d );
+	r = MCF( dev ).DetermineChipType( dev );
 	if( r ) return r;
 	// if( iss->target_chip_type == CHIP_CH32V10x )
 	// {
 		// fprintf( stderr, "Using binary blob write for operation.\n" );
-		// MCF.WriteBinaryBlob = LEWriteBinaryBlob;
-		// wch_link_command( dev, "\x81\x11\x01\x05", 4, (int*)&transferred, rbuff, 1024 );
-		// wch_link_command( dev, "\x81\x0d\x01\x03", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Ignored, 820d050900300500
+		// MCF( dev ).WriteBinaryBlob = LEWriteBinaryBlob;
+		// wch_link_command( devh, "\x81\x11\x01\x05", 4, (int*)&transferred, rbuff, 1024 );
+		// wch_link_command( devh, "\x81\x0d\x01\x03", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Ignored, 820d050900300500
 	// }
 
 #endif
 
 	// For some reason, if we don't do this sometimes the programmer starts in a hosey mode.
-	MCF.WriteReg32( d, DMCONTROL, 0x80000003 ); // Reset target
-	MCF.WriteReg32( d, DMCONTROL, 0x80000001 ); // Un-super-halt processor.
-	MCF.WriteReg32( d, DMCONTROL, 0x80000001 );
-	MCF.DelayUS( iss, 10000 ); // Delay to let some chips fully reboot
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000003 ); // Reset target
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 ); // Un-super-halt processor.
+	MCF( dev ).WriteReg32( dev, DMCONTROL, 0x80000001 );
+	MCF( dev ).DelayUS( dev, 10000 ); // Delay to let some chips fully reboot
 	char cmd_buf[5] = { 0x81, 0x0c, 0x02, iss->target_chip_type, iss->target_chip->interface_speed};
 	// if( iss->target_chip_type == CHIP_CH32V10x ) cmd_buf[3] = 0x05; // Why have I added this?!
-	wch_link_command( dev, cmd_buf, 5, 0, 0, 0 ); // Set interface clock to suitable speed
+	wch_link_command( devh, cmd_buf, 5, 0, 0, 0 ); // Set interface clock to suitable speed
 
 	#if !FORCE_EXTERNAL_CHIP_DETECTION
 	int timeout = 0;
 retry_DoneOp:
-	MCF.DelayUS( iss, 4000 );
-	MCF.WriteReg32( d, DMABSTRACTCS, 0x00000700 ); // Ignore any pending errors.
-	MCF.WriteReg32( d, DMABSTRACTAUTO, 0 );
-	MCF.WriteReg32( d, DMCOMMAND, 0x00221000 ); // Read x0 (Null command) with nopostexec (to fix v307 read issues)
-	r = MCF.WaitForDoneOp( d, 0 );
+	MCF( dev ).DelayUS( dev, 4000 );
+	MCF( dev ).WriteReg32( dev, DMABSTRACTCS, 0x00000700 ); // Ignore any pending errors.
+	MCF( dev ).WriteReg32( dev, DMABSTRACTAUTO, 0 );
+	MCF( dev ).WriteReg32( dev, DMCOMMAND, 0x00221000 ); // Read x0 (Null command) with nopostexec (to fix v307 read issues)
+	r = MCF( dev ).WaitForDoneOp( dev, 0 );
 	if( r )
 	{
 		fprintf( stderr, "Retrying\n" );
@@ -531,14 +780,14 @@ retry_DoneOp:
 	// Skipping extended Chip ID for chips that doesn't have it
 	if( iss->target_chip_type == CHIP_CH59x || iss->target_chip_type == CHIP_CH58x || iss->target_chip_type == CHIP_CH57x )
 	{
-		// MCF.WriteBinaryBlob = LEWriteBinaryBlob;
+		// MCF( dev ).WriteBinaryBlob = LEWriteBinaryBlob;
 		return 0;
 	}
 	// This puts the processor on hold to allow the debugger to run.
 	// Recommended to switch to 05 from 09 by Alexander M
-	//	wch_link_command( dev, "\x81\x11\x01\x09", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Chip ID + Other data (see below)
+	//	wch_link_command( devh, "\x81\x11\x01\x09", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Chip ID + Other data (see below)
 retry_ID:
-	wch_link_command( dev, "\x81\x11\x01\x05", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Chip ID + Other data (see below)
+	wch_link_command( devh, "\x81\x11\x01\x05", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Chip ID + Other data (see below)
 
 	if( rbuff[0] == 0x00 )
 	{
@@ -573,11 +822,11 @@ retry_ID:
 	if( result == 1 ) // Using blob write
 	{
 		fprintf( stderr, "Using binary blob write for operation.\n" );
-		MCF.WriteBinaryBlob = LEWriteBinaryBlob;
+		MCF( dev ).WriteBinaryBlob = LEWriteBinaryBlob;
 
 		// iss->sector_size = 256;
 		// Why do we need this exactly? For blobed chips only?
-		wch_link_command( dev, "\x81\x0d\x01\x03", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Ignored, 820d050900300500
+		wch_link_command( devh, "\x81\x0d\x01\x03", 4, (int*)&transferred, rbuff, 1024 ); // Reply: Ignored, 820d050900300500
 
 	} else if( result < 0 ) {
 		fprintf( stderr, "Chip type not supported. Aborting...\n" );
@@ -585,7 +834,7 @@ retry_ID:
 	}
 
 	// Check for read protection
-	wch_link_command( dev, "\x81\x06\x01\x01", 4, (int*)&transferred, rbuff, 1024 );
+	wch_link_command( devh, "\x81\x06\x01\x01", 4, (int*)&transferred, rbuff, 1024 );
 	if(transferred != 4) {
 		fprintf(stderr, "Error: could not get read protection status\n");
 		return -1;
@@ -683,40 +932,78 @@ static int LEConfigureReadProtection( void * d, int one_if_yes_protect )
 
 static int LEExit( void * d )
 {
-	libusb_device_handle * dev = ((struct LinkEProgrammerStruct*)d)->devh;
+	struct LinkEProgrammerStruct * e = (struct LinkEProgrammerStruct*)d;
+	libusb_device_handle * dev = e->devh;
 	wch_link_command( (libusb_device_handle *)dev, "\x81\x0d\x01\xff", 4, 0, 0, 0);
+	int i;
+	for( i = 0; i < LE_INFLIGHT_MAX; i++ )
+	{
+		if( e->slots[i].out ) libusb_free_transfer( e->slots[i].out );
+		if( e->slots[i].in ) libusb_free_transfer( e->slots[i].in );
+		e->slots[i].out = e->slots[i].in = 0;
+	}
 	return 0;
 }
 
-void * TryInit_WCHLinkE(const init_hints_t * hints)
+int ListWCHLinkESerials( char ** serials, int max )
+{
+	libusb_context * ctx = 0;
+	if( libusb_init( &ctx ) < 0 ) return 0;
+
+	libusb_device **list;
+	ssize_t cnt = libusb_get_device_list( ctx, &list );
+	ssize_t i;
+	int found = 0;
+	for( i = 0; i < cnt && found < max; i++ )
+	{
+		struct libusb_device_descriptor desc;
+		if( libusb_get_device_descriptor( list[i], &desc ) != 0 ) continue;
+		if( desc.idVendor != 0x1a86 || desc.idProduct != 0x8010 ) continue;
+		char buf[USB_SERIAL_MAX];
+		if( get_usb_serialnumber( list[i], buf, sizeof( buf ) ) == 0 )
+			serials[found++] = strdup( buf );
+	}
+	libusb_free_device_list( list, 1 );
+	libusb_exit( ctx );
+	return found;
+}
+
+void * TryInit_WCHLinkE(struct MiniChlinkFunctions * mcf, const init_hints_t * hints)
 {
 	const char * want_serial = "";
 	if( hints && hints->programmer_serial_number && hints->programmer_serial_number[0] )
 		want_serial = hints->programmer_serial_number;
 
 	libusb_device_handle * wch_linke_devh;
-	wch_linke_devh = wch_link_base_setup(0, want_serial);
+	libusb_context * ctx = 0;
+	wch_linke_devh = wch_link_base_setup(0, want_serial, &ctx);
 	if( !wch_linke_devh ) return 0;
 
 	struct LinkEProgrammerStruct * ret = malloc( sizeof( struct LinkEProgrammerStruct ) );
 	memset( ret, 0, sizeof( *ret ) );
 	ret->devh = wch_linke_devh;
+	ret->ctx = ctx;
 	ret->lasthaltmode = 0;
 	strncpy( ret->programmer_serial_number, want_serial, sizeof( ret->programmer_serial_number ) - 1 );
 
-	MCF.ReadReg32 = LEReadReg32;
-	MCF.WriteReg32 = LEWriteReg32;
-	MCF.FlushLLCommands = LEFlushLLCommands;
+	const char * inflight = getenv( "MINICHLINK_LINKE_INFLIGHT" );
+	WCHLinkESetInflight( ret, inflight ? atoi( inflight ) : LE_INFLIGHT_DEFAULT );
+
+	mcf->ReadReg32 = LEReadReg32;
+	mcf->WriteReg32 = LEWriteReg32;
+	mcf->ReadReg32Multi = LEReadReg32Multi;
+	mcf->ExecuteDMIQueue = LEExecuteDMIQueue;
+	mcf->FlushLLCommands = LEFlushLLCommands;
 
-	MCF.ResetInterface = LEResetInterface;
-	MCF.SetupInterface = LESetupInterface;
-	MCF.Control3v3 = LEControl3v3;
-	MCF.Control5v = LEControl5v;
-	//MCF.Unbrick = LEUnbrick; // 
-	MCF.ConfigureNRSTAsGPIO = LEConfigureNRSTAsGPIO;
-	MCF.ConfigureReadProtection = LEConfigureReadProtection;
+	mcf->ResetInterface = LEResetInterface;
+	mcf->SetupInterface = LESetupInterface;
+	mcf->Control3v3 = LEControl3v3;
+	mcf->Control5v = LEControl5v;
+	//mcf->Unbrick = LEUnbrick; // 
+	mcf->ConfigureNRSTAsGPIO = LEConfigureNRSTAsGPIO;
+	mcf->ConfigureReadProtection = LEConfigureReadProtection;
 
-	MCF.Exit = LEExit;
+	mcf->Exit = LEExit;
 	return ret;
 };
 
@@ -1099,7 +1386,7 @@ static int LEWriteBinaryBlob( void * d, uint32_t address_to_write, uint32_t len,
 	if( i == 10 )
 	{
 		fprintf( stderr, "Error, confusing responses to 02/01/07\n" );
-		exit( -109 );
+		return -109;
 	}
 
 	wch_link_command( (libusb_device_handle *)dev, "\x81\x02\x01\x02", 4, 0, 0, 0 );
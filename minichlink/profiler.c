@@ -0,0 +1,256 @@
+// Statistical PC profiler.
+//
+// Every sample halts the core, reads dpc (where it stopped) and ra (who called
+// the function it's in, as long as that function hasn't made a call of its
+// own yet), and resumes it.  That takes two DMI batches, since DATA0/DATA1
+// (which the firmware uses to talk to us) are read in the first and put back
+// in the second.  None of the QingKe debug modules can read the PC without
+// halting, so this is as light as it gets: on programmers that pipeline DMI
+// ops (ardulink, esp32s2) the core is only stopped for two round trips.
+//
+// Samples are spaced randomly around the requested rate, so a timer interrupt
+// running at a multiple of it doesn't get over- or under-counted.
+//
+// At the end a flat profile goes to stdout, and optionally "caller;function
+// count" lines (what flamegraph.pl and friends eat) to a file.  Only two
+// levels are known, so the callers are a hint, not a real call graph.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "minichlink.h"
+#include "os_generic.h"
+
+struct ProfileSample
+{
+	uint32_t pc;
+	uint32_t ra;
+	const char * func;
+	const char * caller; // 0 if unknown, or the same as func.
+	char pcname[12];     // For when there's no symbol.
+};
+
+struct ProfileCount
+{
+	const char * func;
+	uint32_t count;
+};
+
+static volatile int profile_stop;
+
+static void ProfileSigInt( int sig )
+{
+	(void)sig;
+	profile_stop = 1;
+}
+
+static int ProfileCompareFunc( const void * a, const void * b )
+{
+	const struct ProfileSample * sa = a;
+	const struct ProfileSample * sb = b;
+	int r = strcmp( sa->func, sb->func );
+	if( r ) return r;
+	if( !sa->caller || !sb->caller ) return ( sa->caller != 0 ) - ( sb->caller != 0 );
+	return strcmp( sa->caller, sb->caller );
+}
+
+static int ProfileCompareCount( const void * a, const void * b )
+{
+	const struct ProfileCount * ca = a;
+	const struct ProfileCount * cb = b;
+	if( ca->count != cb->count ) return ( ca->count < cb->count ) ? 1 : -1;
+	return strcmp( ca->func, cb->func );
+}
+
+static void ProfileResolve( struct ProfileSample * s, struct ElfFile * elf )
+{
+	struct ElfSymbol * fs = elf ? ElfSymbolAt( elf, s->pc ) : 0;
+	snprintf( s->pcname, sizeof( s->pcname ), "0x%08x", s->pc );
+	s->func = fs ? ElfSymbolName( elf, fs ) : s->pcname;
+	s->caller = 0;
+	if( !fs ) return;
+
+	// ra points just past the call, so look up the call itself.
+	struct ElfSymbol * cs = ( s->ra >= 2 ) ? ElfSymbolAt( elf, s->ra - 2 ) : 0;
+	if( cs && cs != fs ) s->caller = ElfSymbolName( elf, cs );
+}
+
+static void ProfileReport( struct ProfileSample * samples, uint32_t count, FILE * folded )
+{
+	struct ProfileCount * funcs = malloc( sizeof( struct ProfileCount ) * ( count + 1 ) );
+	int nfuncs = 0;
+	uint32_t run_start = 0;
+	uint32_t i;
+
+	qsort( samples, count, sizeof( struct ProfileSample ), ProfileCompareFunc );
+
+	for( i = 0; i < count; i++ )
+	{
+		struct ProfileSample * s = &samples[i];
+		if( nfuncs == 0 || strcmp( funcs[nfuncs-1].func, s->func ) )
+		{
+			funcs[nfuncs].func = s->func;
+			funcs[nfuncs].count = 0;
+			nfuncs++;
+		}
+		funcs[nfuncs-1].count++;
+
+		if( folded && ( i + 1 == count || ProfileCompareFunc( s, s + 1 ) ) )
+		{
+			if( s->caller ) fprintf( folded, "%s;%s %u\n", s->caller, s->func, i + 1 - run_start );
+			else fprintf( folded, "%s %u\n", s->func, i + 1 - run_start );
+			run_start = i + 1;
+		}
+	}
+
+	qsort( funcs, nfuncs, sizeof( struct ProfileCount ), ProfileCompareCount );
+	printf( "Flat profile, %u samples:\n", count );
+	printf( "  samples       %%  function\n" );
+	for( i = 0; i < (uint32_t)nfuncs; i++ )
+		printf( "  %7u  %6.2f  %s\n", funcs[i].count, funcs[i].count * 100.0 / count, funcs[i].func );
+	free( funcs );
+}
+
+int ProfilePC( void * dev, const char * foldedname, double rate, uint32_t samples, const char * elfname )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	struct ElfFile elf;
+	int have_elf = 0;
+	uint32_t i;
+
+	if( !MCF( dev ).WriteReg32 || !MCF( dev ).ReadReg32 )
+	{
+		fprintf( stderr, "Error: Profiling needs a programmer with raw DMI access\n" );
+		return -5;
+	}
+
+	if( elfname && strcmp( elfname, "-" ) )
+	{
+		if( ElfLoad( &elf, elfname ) ) return -1;
+		if( !elf.num_symbols ) fprintf( stderr, "Warning: %s has no symbols, only addresses will be shown\n", elfname );
+		have_elf = 1;
+	}
+
+	FILE * folded = 0;
+	if( foldedname && strcmp( foldedname, "-" ) )
+	{
+		folded = fopen( foldedname, "w" );
+		if( !folded )
+		{
+			fprintf( stderr, "Error: Could not open %s\n", foldedname );
+			if( have_elf ) ElfFree( &elf );
+			return -9;
+		}
+	}
+
+	uint32_t alloced = 4096;
+	struct ProfileSample * list = malloc( sizeof( struct ProfileSample ) * alloced );
+
+	if( MCF( dev ).FlushLLCommands ) MCF( dev ).FlushLLCommands( dev );
+	DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+	DMIQueueWrite( dev, DMABSTRACTCS, 0x00000700 );   // Clear out cmderr
+	DMIFlush( dev );
+	iss->statetag = STTAG( "PROF" );
+
+	fprintf( stderr, "Profiling, press Ctrl+C to stop.\n" );
+	profile_stop = 0;
+	void (*oldsig)(int) = signal( SIGINT, ProfileSigInt );
+
+	uint32_t taken = 0;
+	uint32_t errors = 0;
+	int errors_in_a_row = 0;
+	double stopped_total = 0;
+	double stopped_max = 0;
+	double start = OGGetAbsoluteTime();
+	double next = start;
+	while( !profile_stop && ( samples == 0 || taken < samples ) )
+	{
+		uint32_t dmstatus = 0, abstractcs = 0, pc = 0, ra = 0;
+		uint32_t data01[2] = { 0 };
+
+		if( rate > 0 )
+		{
+			double now = OGGetAbsoluteTime();
+			if( next > now + 0.002 ) OGUSleep( ( next - now - 0.001 ) * 1000000 );
+			while( OGGetAbsoluteTime() < next );
+			next += ( 0.5 + rand() / (double)RAND_MAX ) / rate;
+		}
+
+		double t0 = OGGetAbsoluteTime();
+		DMIQueueWrite( dev, DMCONTROL, 0x80000001 ); // Halt request.
+		DMIQueueRead( dev, DMSTATUS, &dmstatus );
+		// The firmware talks to us through DATA0 and DATA1 (debug printf, the
+		// debug ring), so they go back the way they were before it resumes.
+		DMIQueueRead( dev, DMDATA0, &data01[0] );
+		DMIQueueRead( dev, DMDATA1, &data01[1] );
+		DMIQueueWrite( dev, DMCOMMAND, 0x002207b1 ); // Read dpc into DATA0.
+		DMIQueueRead( dev, DMDATA0, &pc );
+		DMIQueueWrite( dev, DMCOMMAND, 0x00221001 ); // Read ra into DATA0.
+		DMIQueueRead( dev, DMDATA0, &ra );
+		DMIQueueRead( dev, DMABSTRACTCS, &abstractcs );
+		int r = DMIFlush( dev );
+		if( !r )
+		{
+			DMIQueueWrite( dev, DMDATA0, data01[0] );
+			DMIQueueWrite( dev, DMDATA1, data01[1] );
+		}
+		DMIQueueWrite( dev, DMCONTROL, 0x40000001 ); // resumereq
+		r |= DMIFlush( dev );
+		double stopped = OGGetAbsoluteTime() - t0;
+
+		if( r )
+		{
+			fprintf( stderr, "Error: Programmer fault while profiling (%d)\n", r );
+			break;
+		}
+		if( !( dmstatus & (1<<9) ) || ( abstractcs & ( 1<<12 ) ) || ( ( abstractcs >> 8 ) & 7 ) )
+		{
+			// Didn't halt in time, or the read faulted.  Drop the sample.
+			MCF( dev ).WriteReg32( dev, DMABSTRACTCS, 0x00000700 ); // Clear out cmderr
+			errors++;
+			if( ++errors_in_a_row == 1000 )
+			{
+				fprintf( stderr, "Error: Can't sample the target (ABSTRACTCS = %08x, DMSTATUS = %08x)\n", abstractcs, dmstatus );
+				break;
+			}
+			continue;
+		}
+		errors_in_a_row = 0;
+
+		stopped_total += stopped;
+		if( stopped > stopped_max ) stopped_max = stopped;
+		if( taken == alloced )
+		{
+			alloced *= 2;
+			list = realloc( list, sizeof( struct ProfileSample ) * alloced );
+		}
+		list[taken].pc = pc;
+		list[taken].ra = ra;
+		taken++;
+	}
+
+	signal( SIGINT, oldsig );
+	double dt = OGGetAbsoluteTime() - start;
+
+	// Anything we left in the debug module is no longer valid.
+	if( MCF( dev ).VoidHighLevelState ) MCF( dev ).VoidHighLevelState( dev );
+	else iss->statetag = STTAG( "VOID" );
+
+	for( i = 0; i < taken; i++ )
+		ProfileResolve( &list[i], have_elf ? &elf : 0 );
+	if( taken ) ProfileReport( list, taken, folded );
+
+	fprintf( stderr, "Took %u samples in %.3f s (%.1f Hz), %u dropped\n", taken, dt, dt > 0 ? taken / dt : 0.0, errors );
+	if( taken )
+	{
+		// The batch time is an upper bound, the core is running again as soon as resumereq lands.
+		fprintf( stderr, "Core stopped for at most %.1f us per sample (worst %.1f us), %.3f%% of the run\n",
+			stopped_total / taken * 1000000.0, stopped_max * 1000000.0, dt > 0 ? stopped_total / dt * 100.0 : 0.0 );
+	}
+
+	if( folded ) fclose( folded );
+	if( have_elf ) ElfFree( &elf );
+	free( list );
+	return 0;
+}
@@ -0,0 +1,306 @@
+// Live variable sampling (data logger).
+//
+// Reads a list of variables over and over on one open connection, with the
+// core running.  Each sample is two DMI batches: halt and save DATA0/DATA1,
+// then for every word, put the address in DATA0 and run a PROGBUF that reads
+// it back into DATA0.  The second batch puts DATA0/DATA1 back and resumes.
+// The PROGBUF saves and restores the registers it uses on the target's stack,
+// so firmware doesn't need to know it's being watched.
+//
+// The core is stopped for the length of the two batches per sample.  On
+// programmers that can pipeline DMI ops (ardulink, esp32s2) that is two
+// round trips.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "minichlink.h"
+#include "os_generic.h"
+
+#define SAMPLE_MAX_VARS  32
+#define SAMPLE_MAX_WORDS 40 // 3 DMI ops a word, keeps a sample inside one DMI queue.
+
+struct SampleVar
+{
+	char name[128];
+	uint32_t address;
+	uint32_t size;
+	int first_word; // Index into the words read for each sample.
+};
+
+static volatile int sample_stop;
+
+static void SampleSigInt( int sig )
+{
+	(void)sig;
+	sample_stop = 1;
+}
+
+static int SampleParseVars( const char * vars, const char * elfname, struct SampleVar * out )
+{
+	struct ElfFile elf;
+	int have_elf = 0;
+	int count = 0;
+
+	if( elfname && strcmp( elfname, "-" ) )
+	{
+		if( ElfLoad( &elf, elfname ) ) return -1;
+		have_elf = 1;
+	}
+
+	const char * s = vars;
+	while( *s )
+	{
+		const char * e = strchr( s, ',' );
+		int sl = e ? e - s : (int)strlen( s );
+		char tok[128];
+		if( sl >= (int)sizeof( tok ) ) sl = sizeof( tok ) - 1;
+		memcpy( tok, s, sl );
+		tok[sl] = 0;
+		s += sl + ( e ? 1 : 0 );
+		if( !tok[0] ) continue;
+
+		if( count == SAMPLE_MAX_VARS )
+		{
+			fprintf( stderr, "Error: Can only sample %d variables at once\n", SAMPLE_MAX_VARS );
+			count = -1;
+			break;
+		}
+
+		struct SampleVar * v = &out[count];
+		char * colon = strchr( tok, ':' );
+		uint32_t size = 0;
+		if( colon )
+		{
+			*colon = 0;
+			size = SimpleReadNumberInt( colon + 1, 0 );
+		}
+		snprintf( v->name, sizeof( v->name ), "%s", tok );
+
+		uint32_t symsize = 4;
+		if( tok[0] >= '0' && tok[0] <= '9' )
+		{
+			v->address = SimpleReadNumberInt( tok, 0 );
+		}
+		else if( !have_elf || ElfFindSymbol( &elf, tok, &v->address, &symsize ) )
+		{
+			fprintf( stderr, "Error: Can't find symbol '%s'%s\n", tok, have_elf ? "" : " (no ELF given)" );
+			count = -1;
+			break;
+		}
+		if( !size ) size = symsize ? symsize : 4;
+		v->size = size;
+		count++;
+	}
+
+	if( have_elf ) ElfFree( &elf );
+	return count;
+}
+
+int LiveSample( void * dev, const char * output, double rate, uint32_t samples, const char * elfname, const char * varlist )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	struct SampleVar vars[SAMPLE_MAX_VARS];
+	uint32_t word_addr[SAMPLE_MAX_WORDS];
+	uint32_t words[SAMPLE_MAX_WORDS];
+	int nwords = 0;
+	int i, j;
+
+	if( !MCF( dev ).WriteReg32 || !MCF( dev ).ReadReg32 )
+	{
+		fprintf( stderr, "Error: Live sampling needs a programmer with raw DMI access\n" );
+		return -5;
+	}
+
+	int nvars = SampleParseVars( varlist, elfname, vars );
+	if( nvars <= 0 )
+	{
+		if( nvars == 0 ) fprintf( stderr, "Error: No variables to sample\n" );
+		return -1;
+	}
+
+	for( i = 0; i < nvars; i++ )
+	{
+		uint32_t start = vars[i].address & ~3;
+		uint32_t end = ( vars[i].address + vars[i].size + 3 ) & ~3;
+		vars[i].first_word = nwords;
+		for( ; start < end; start += 4 )
+		{
+			if( nwords == SAMPLE_MAX_WORDS )
+			{
+				fprintf( stderr, "Error: Too much to sample at once, limit is %d bytes\n", SAMPLE_MAX_WORDS * 4 );
+				return -1;
+			}
+			word_addr[nwords++] = start;
+		}
+	}
+
+	int binary = 0;
+	FILE * f = stdout;
+	if( output && strcmp( output, "-" ) )
+	{
+		int ol = strlen( output );
+		binary = ol > 4 && strcmp( output + ol - 4, ".bin" ) == 0;
+		f = fopen( output, binary ? "wb" : "w" );
+		if( !f )
+		{
+			fprintf( stderr, "Error: Could not open %s\n", output );
+			return -9;
+		}
+	}
+
+	uint32_t hartinfo = 0;
+	if( MCF( dev ).FlushLLCommands ) MCF( dev ).FlushLLCommands( dev );
+	if( MCF( dev ).ReadReg32( dev, DMHARTINFO, &hartinfo ) )
+	{
+		fprintf( stderr, "Error: Could not get hart info.\n" );
+		if( f != stdout ) fclose( f );
+		return -5;
+	}
+	uint32_t data0 = 0xe0000000 | ( hartinfo & 0x7ff );
+	uint32_t data0_hi = ( data0 + 0x800 ) & 0xfffff000;
+	uint32_t data0_lo = ( data0 - data0_hi ) & 0xfff;
+
+	DMIQueueWrite( dev, DMABSTRACTAUTO, 0x00000000 ); // Disable Autoexec.
+	DMIQueueWrite( dev, DMPROGBUF0, 0xc02a717d ); // c.addi16sp sp,-16; c.swsp a0,0(sp)
+	DMIQueueWrite( dev, DMPROGBUF1, 0xc432c22e ); // c.swsp a1,4(sp);   c.swsp a2,8(sp)
+	DMIQueueWrite( dev, DMPROGBUF2, data0_hi | 0x637 ); // lui a2, %hi(DATA0)
+	DMIQueueWrite( dev, DMPROGBUF3, ( data0_lo << 20 ) | 0x60613 ); // addi a2, a2, %lo(DATA0)
+	DMIQueueWrite( dev, DMPROGBUF4, 0x410c4208 ); // c.lw a0,0(a2);  c.lw a1,0(a0)
+	DMIQueueWrite( dev, DMPROGBUF5, 0x4502c20c ); // c.sw a1,0(a2);  c.lwsp a0,0(sp)
+	DMIQueueWrite( dev, DMPROGBUF6, 0x46224592 ); // c.lwsp a1,4(sp); c.lwsp a2,8(sp)
+	DMIQueueWrite( dev, DMPROGBUF7, 0x90026141 ); // c.addi16sp sp,16; c.ebreak
+	if( DMIFlush( dev ) )
+	{
+		fprintf( stderr, "Error: Could not set up PROGBUF\n" );
+		if( f != stdout ) fclose( f );
+		return -5;
+	}
+	iss->statetag = STTAG( "LIVE" );
+
+	if( binary )
+	{
+		fprintf( stderr, "Binary records: double timestamp" );
+		for( i = 0; i < nvars; i++ ) fprintf( stderr, ", %s (%u bytes)", vars[i].name, vars[i].size );
+		fprintf( stderr, "\n" );
+	}
+	else
+	{
+		fprintf( f, "time" );
+		for( i = 0; i < nvars; i++ ) fprintf( f, ",%s", vars[i].name );
+		fprintf( f, "\n" );
+	}
+
+	sample_stop = 0;
+	void (*oldsig)(int) = signal( SIGINT, SampleSigInt );
+
+	uint32_t taken = 0;
+	uint32_t errors = 0;
+	int errors_in_a_row = 0;
+	double start = OGGetAbsoluteTime();
+	double next = start;
+	double last_flush = start;
+	while( !sample_stop && ( samples == 0 || taken < samples ) )
+	{
+		uint32_t dmstatus = 0, abstractcs = 0;
+		uint32_t data01[2] = { 0 };
+
+		if( rate > 0 )
+		{
+			double now = OGGetAbsoluteTime();
+			if( next > now + 0.002 ) OGUSleep( ( next - now - 0.001 ) * 1000000 );
+			while( OGGetAbsoluteTime() < next );
+			next += 1.0 / rate;
+		}
+
+		DMIQueueWrite( dev, DMCONTROL, 0x80000001 ); // Halt request.
+		DMIQueueRead( dev, DMSTATUS, &dmstatus );
+		// The firmware talks to us through DATA0 and DATA1 (debug printf, the
+		// debug ring), so they go back the way they were before it resumes.
+		DMIQueueRead( dev, DMDATA0, &data01[0] );
+		DMIQueueRead( dev, DMDATA1, &data01[1] );
+		for( j = 0; j < nwords; j++ )
+		{
+			DMIQueueWrite( dev, DMDATA0, word_addr[j] );
+			DMIQueueWrite( dev, DMCOMMAND, 0x00240000 ); // Execute PROGBUF
+			DMIQueueRead( dev, DMDATA0, &words[j] );
+		}
+		DMIQueueRead( dev, DMABSTRACTCS, &abstractcs );
+		int r = DMIFlush( dev );
+		double t = OGGetAbsoluteTime() - start;
+
+		if( !r )
+		{
+			DMIQueueWrite( dev, DMDATA0, data01[0] );
+			DMIQueueWrite( dev, DMDATA1, data01[1] );
+		}
+		DMIQueueWrite( dev, DMCONTROL, 0x40000001 ); // resumereq
+		r |= DMIFlush( dev );
+
+		if( r )
+		{
+			fprintf( stderr, "Error: Programmer fault while sampling (%d)\n", r );
+			break;
+		}
+		if( !( dmstatus & (1<<9) ) || ( abstractcs & ( 1<<12 ) ) || ( ( abstractcs >> 8 ) & 7 ) )
+		{
+			// Didn't halt in time, or the read faulted.  Drop the sample.
+			MCF( dev ).WriteReg32( dev, DMABSTRACTCS, 0x00000700 ); // Clear out cmderr
+			errors++;
+			if( ++errors_in_a_row == 1000 )
+			{
+				fprintf( stderr, "Error: Can't read from target (ABSTRACTCS = %08x, DMSTATUS = %08x)\n", abstractcs, dmstatus );
+				break;
+			}
+			continue;
+		}
+
+		if( binary )
+		{
+			fwrite( &t, sizeof( t ), 1, f );
+			for( i = 0; i < nvars; i++ )
+				fwrite( ((uint8_t*)&words[vars[i].first_word]) + ( vars[i].address & 3 ), vars[i].size, 1, f );
+		}
+		else
+		{
+			fprintf( f, "%.6f", t );
+			for( i = 0; i < nvars; i++ )
+			{
+				uint8_t * v = ((uint8_t*)&words[vars[i].first_word]) + ( vars[i].address & 3 );
+				uint32_t val = 0;
+				switch( vars[i].size )
+				{
+				case 1: fprintf( f, ",%u", v[0] ); break;
+				case 2: memcpy( &val, v, 2 ); fprintf( f, ",%u", val ); break;
+				case 4: memcpy( &val, v, 4 ); fprintf( f, ",%u", val ); break;
+				default:
+					fprintf( f, "," );
+					for( j = 0; j < (int)vars[i].size; j++ ) fprintf( f, "%02x", v[j] );
+					break;
+				}
+			}
+			fprintf( f, "\n" );
+		}
+		taken++;
+		errors_in_a_row = 0;
+
+		if( start + t - last_flush > 0.1 )
+		{
+			fflush( f );
+			last_flush = start + t;
+		}
+	}
+
+	signal( SIGINT, oldsig );
+	double dt = OGGetAbsoluteTime() - start;
+	fflush( f );
+	if( f != stdout ) fclose( f );
+
+	// Anything we left in the debug module is no longer valid.
+	if( MCF( dev ).VoidHighLevelState ) MCF( dev ).VoidHighLevelState( dev );
+	else iss->statetag = STTAG( "VOID" );
+
+	fprintf( stderr, "Took %u samples in %.3f s (%.1f Hz), %u dropped\n", taken, dt, dt > 0 ? taken / dt : 0.0, errors );
+	return 0;
+}
@@ -0,0 +1,16 @@
+unsigned char crc32_bin[] = {
+  0x1d, 0xc2, 0xb7, 0x16, 0x02, 0x40, 0xd8, 0x4a, 0x13, 0x67, 0x07, 0x04,
+  0xd8, 0xca, 0xb7, 0x36, 0x02, 0x40, 0x05, 0x47, 0x98, 0xc6, 0x63, 0x76,
+  0xb5, 0x00, 0x18, 0x41, 0x98, 0xc2, 0x11, 0x05, 0xdd, 0xbf, 0x88, 0x42,
+  0x02, 0x90, 0xfd, 0x57, 0x97, 0x06, 0x00, 0x00, 0x93, 0x86, 0x06, 0x03,
+  0x63, 0x72, 0xb5, 0x02, 0x18, 0x41, 0xb9, 0x8f, 0x21, 0x46, 0x93, 0xd2,
+  0xc7, 0x01, 0x8a, 0x02, 0xb6, 0x92, 0x83, 0xa2, 0x02, 0x00, 0x92, 0x07,
+  0xb3, 0xc7, 0x57, 0x00, 0x7d, 0x16, 0x75, 0xf6, 0x11, 0x05, 0xf9, 0xbf,
+  0x3e, 0x85, 0x02, 0x90, 0x00, 0x00, 0x00, 0x00, 0xb7, 0x1d, 0xc1, 0x04,
+  0x6e, 0x3b, 0x82, 0x09, 0xd9, 0x26, 0x43, 0x0d, 0xdc, 0x76, 0x04, 0x13,
+  0x6b, 0x6b, 0xc5, 0x17, 0xb2, 0x4d, 0x86, 0x1a, 0x05, 0x50, 0x47, 0x1e,
+  0xb8, 0xed, 0x08, 0x26, 0x0f, 0xf0, 0xc9, 0x22, 0xd6, 0xd6, 0x8a, 0x2f,
+  0x61, 0xcb, 0x4b, 0x2b, 0x64, 0x9b, 0x0c, 0x35, 0xd3, 0x86, 0xcd, 0x31,
+  0x0a, 0xa0, 0x8e, 0x3c, 0xbd, 0xbd, 0x4f, 0x38
+};
+unsigned int crc32_bin_len = 152;
@@ -0,0 +1,27 @@
+unsigned char flashloader_bin[] = {
+  0x93, 0xf2, 0x46, 0x00, 0x63, 0x85, 0x02, 0x06, 0x2a, 0x83, 0xb3, 0x03,
+  0xc5, 0x00, 0x63, 0x70, 0x73, 0x06, 0x83, 0xc2, 0x07, 0x00, 0x85, 0x07,
+  0x13, 0xf4, 0xf2, 0x03, 0x0d, 0x04, 0x93, 0xd4, 0x62, 0x00, 0xf9, 0x14,
+  0x63, 0xc9, 0x04, 0x02, 0x83, 0xc2, 0x07, 0x00, 0x85, 0x07, 0x91, 0xcc,
+  0x93, 0xc2, 0xf2, 0xff, 0xb3, 0x00, 0x53, 0x00, 0x83, 0xc2, 0x00, 0x00,
+  0x23, 0x00, 0x53, 0x00, 0x85, 0x00, 0x05, 0x03, 0x7d, 0x14, 0x6d, 0xf8,
+  0xd9, 0xb7, 0x23, 0x00, 0x53, 0x00, 0x05, 0x03, 0x7d, 0x14, 0x65, 0xfc,
+  0x6d, 0xbf, 0x13, 0xf4, 0xf2, 0x07, 0x05, 0x04, 0x83, 0xc2, 0x07, 0x00,
+  0x85, 0x07, 0x23, 0x00, 0x53, 0x00, 0x05, 0x03, 0x7d, 0x14, 0x6d, 0xf8,
+  0x4d, 0xb7, 0x5c, 0x47, 0x93, 0xf2, 0x37, 0x00, 0xe3, 0x9d, 0x02, 0xfe,
+  0x93, 0xf2, 0x07, 0x01, 0x63, 0x9d, 0x02, 0x08, 0x49, 0xca, 0x93, 0xf2,
+  0x16, 0x00, 0x63, 0x84, 0x02, 0x02, 0xb7, 0x02, 0x02, 0x00, 0x23, 0x28,
+  0x57, 0x00, 0x4c, 0xcb, 0x93, 0x82, 0x02, 0x04, 0x23, 0x28, 0x57, 0x00,
+  0x5c, 0x47, 0x93, 0xf2, 0x37, 0x00, 0xe3, 0x9d, 0x02, 0xfe, 0x93, 0xf2,
+  0x07, 0x01, 0x63, 0x96, 0x02, 0x06, 0x93, 0xf4, 0x26, 0x00, 0xc1, 0x62,
+  0x23, 0x28, 0x57, 0x00, 0x89, 0xc4, 0xb7, 0x02, 0x09, 0x00, 0x23, 0x28,
+  0x57, 0x00, 0x5c, 0x47, 0x93, 0xf2, 0x37, 0x00, 0xe3, 0x9d, 0x02, 0xfe,
+  0x33, 0x84, 0xc5, 0x00, 0x83, 0x22, 0x05, 0x00, 0x23, 0xa0, 0x55, 0x00,
+  0x89, 0xc4, 0xb7, 0x02, 0x05, 0x00, 0x23, 0x28, 0x57, 0x00, 0x5c, 0x47,
+  0x93, 0xf2, 0x37, 0x00, 0xe3, 0x9d, 0x02, 0xfe, 0x11, 0x05, 0x91, 0x05,
+  0xe3, 0xe0, 0x85, 0xfe, 0x99, 0xc8, 0xb3, 0x82, 0xc5, 0x40, 0x23, 0x2a,
+  0x57, 0x00, 0xc1, 0x62, 0x93, 0x82, 0x02, 0x04, 0x23, 0x28, 0x57, 0x00,
+  0x29, 0xa0, 0xb7, 0x02, 0x20, 0x00, 0x23, 0x28, 0x57, 0x00, 0x01, 0x45,
+  0x02, 0x90, 0x23, 0x28, 0x07, 0x00, 0x3e, 0x85, 0x02, 0x90
+};
+unsigned int flashloader_bin_len = 286;